@@ -6,6 +6,8 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <mat4x4.hpp>
 
 namespace cb
@@ -79,4 +81,18 @@ namespace cb
 		float roughness;
 	};
 
+	//! Push constants of a meshlet draw. Matches `drawcall_info` in `instancing_task.comp`.
+	struct MeshletDrawInfo
+	{
+		std::uint32_t m_batch_size;
+		std::uint32_t m_num_meshlets;
+		glm::vec2 m_viewport;
+		glm::vec4 m_bbox_min;
+		glm::vec4 m_bbox_max;
+		std::uint32_t m_first_instance; // Offset into the bound instance page.
+	};
+
+	static_assert(offsetof(MeshletDrawInfo, m_bbox_min) == 16 && offsetof(MeshletDrawInfo, m_first_instance) == 48,
+		"MeshletDrawInfo doesn't match the std430 layout of the task shader push constants.");
+
 } /* CB */
\ No newline at end of file
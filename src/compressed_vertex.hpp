@@ -0,0 +1,322 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+#include "vertex.hpp"
+#include "meshlet_builder.hpp"
+
+/*
+	Compressed vertex formats usable as `V_T` in `HostModelPool::Load`.
+
+	Both formats store the normal and tangent octahedral encoded and replace the bitangent with a sign.
+	UVs are stored as half floats. `QuantizedVertex` additionally stores the position as 16 bit unorm relative to the mesh bounding box.
+	They are CPU side only for now. No pipeline decodes them yet, so `IsGPUVertex` is false for both and a `ModelPool`
+	that uploads to a device refuses them at compile time. A pipeline that opts in needs matching shader decoding
+	and, for `QuantizedVertex`, the mesh bounding box.
+*/
+
+inline std::uint16_t FloatToHalf(float value)
+{
+	std::uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	std::uint32_t sign = (bits >> 16) & 0x8000;
+	std::int32_t exponent = std::int32_t((bits >> 23) & 0xFF) - 127 + 15;
+	std::uint32_t mantissa = bits & 0x7FFFFF;
+
+	if (((bits >> 23) & 0xFF) == 0xFF) // inf or nan
+	{
+		return static_cast<std::uint16_t>(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+	}
+	if (exponent >= 31) // overflow
+	{
+		return static_cast<std::uint16_t>(sign | 0x7C00);
+	}
+	if (exponent <= 0) // denormal or zero
+	{
+		if (exponent < -10) return static_cast<std::uint16_t>(sign);
+
+		mantissa |= 0x800000;
+		auto shift = std::uint32_t(14 - exponent);
+		auto half_mantissa = mantissa >> shift;
+		// round to nearest even
+		auto remainder = mantissa & ((1u << shift) - 1);
+		auto halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half_mantissa & 1))) half_mantissa++;
+		return static_cast<std::uint16_t>(sign | half_mantissa);
+	}
+
+	std::uint32_t half = sign | (std::uint32_t(exponent) << 10) | (mantissa >> 13);
+	// round to nearest even, a carry into the exponent is still correct.
+	auto remainder = mantissa & 0x1FFF;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) half++;
+	return static_cast<std::uint16_t>(half);
+}
+
+inline float HalfToFloat(std::uint16_t half)
+{
+	std::uint32_t sign = std::uint32_t(half & 0x8000) << 16;
+	std::uint32_t exponent = (half >> 10) & 0x1F;
+	std::uint32_t mantissa = half & 0x3FF;
+
+	std::uint32_t bits;
+	if (exponent == 0x1F)
+	{
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	}
+	else if (exponent == 0)
+	{
+		if (mantissa == 0)
+		{
+			bits = sign;
+		}
+		else
+		{
+			// normalize the denormal
+			exponent = 127 - 15 + 1;
+			while (!(mantissa & 0x400))
+			{
+				mantissa <<= 1;
+				exponent--;
+			}
+			bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+		}
+	}
+	else
+	{
+		bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+	}
+
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+inline std::uint32_t PackHalf2(glm::vec2 v)
+{
+	return std::uint32_t(FloatToHalf(v.x)) | (std::uint32_t(FloatToHalf(v.y)) << 16);
+}
+
+inline glm::vec2 UnpackHalf2(std::uint32_t packed)
+{
+	return glm::vec2(HalfToFloat(packed & 0xFFFF), HalfToFloat(packed >> 16));
+}
+
+//! Octahedral encoding with 16 bit snorm components. Matches `unpackSnorm2x16` in GLSL.
+inline std::uint32_t PackOctSnorm16(glm::vec3 v)
+{
+	// The precise encoding can step just outside of the square, clamp so it doesn't wrap around.
+	glm::vec3 oct = glm::clamp(FVec3ToOctnPrecise(v, 32), glm::vec3(-1.f), glm::vec3(1.f));
+	auto x = static_cast<std::int16_t>(std::lround(oct.x * 32767.f));
+	auto y = static_cast<std::int16_t>(std::lround(oct.y * 32767.f));
+	return std::uint32_t(std::uint16_t(x)) | (std::uint32_t(std::uint16_t(y)) << 16);
+}
+
+inline glm::vec3 UnpackOctSnorm16(std::uint32_t packed)
+{
+	auto x = static_cast<std::int16_t>(packed & 0xFFFF);
+	auto y = static_cast<std::int16_t>(packed >> 16);
+	return OctToFVec3(glm::vec3(std::max(-1.f, x / 32767.f), std::max(-1.f, y / 32767.f), 0.f));
+}
+
+//! Tangent as 2x15 bit snorm octahedral encoding plus the bitangent sign in the highest bit.
+inline std::uint32_t PackTangentFrame(glm::vec3 tangent, float bitangent_sign)
+{
+	glm::vec3 oct = glm::clamp(FVec3ToOctnPrecise(tangent, 30), glm::vec3(-1.f), glm::vec3(1.f));
+	auto x = static_cast<std::int32_t>(std::lround(oct.x * 16383.f));
+	auto y = static_cast<std::int32_t>(std::lround(oct.y * 16383.f));
+	return (std::uint32_t(x) & 0x7FFF) | ((std::uint32_t(y) & 0x7FFF) << 15) | (bitangent_sign < 0.f ? 1u << 31 : 0u);
+}
+
+inline glm::vec3 UnpackTangentFrame(std::uint32_t packed, float& bitangent_sign)
+{
+	// sign extend the 15 bit values
+	auto x = std::int32_t(packed << 17) >> 17;
+	auto y = std::int32_t(packed << 2) >> 17;
+	bitangent_sign = (packed >> 31) ? -1.f : 1.f;
+	return OctToFVec3(glm::vec3(std::max(-1.f, x / 16383.f), std::max(-1.f, y / 16383.f), 0.f));
+}
+
+//! Which way the bitangent points relative to `cross(normal, tangent)`.
+inline float BitangentSign(glm::vec3 normal, glm::vec3 tangent, glm::vec3 bitangent)
+{
+	return glm::dot(glm::cross(normal, tangent), bitangent) < 0.f ? -1.f : 1.f;
+}
+
+namespace internal
+{
+
+	inline glm::vec3 SafeNormalize(glm::vec3 v, glm::vec3 fallback)
+	{
+		float len = glm::length(v);
+		return len > FLT_EPSILON ? v / len : fallback;
+	}
+
+	inline void EncodeSurface(MeshData const & mesh_data, std::size_t idx, std::uint32_t& uv, std::uint32_t& normal, std::uint32_t& tangent)
+	{
+		glm::vec3 n = mesh_data.m_normals.empty() ? glm::vec3(0, 0, 1) : SafeNormalize(mesh_data.m_normals[idx], glm::vec3(0, 0, 1));
+		glm::vec3 t = mesh_data.m_tangents.empty() ? glm::vec3(1, 0, 0) : SafeNormalize(mesh_data.m_tangents[idx], glm::vec3(1, 0, 0));
+		float sign = mesh_data.m_bitangents.empty() ? 1.f : BitangentSign(n, t, mesh_data.m_bitangents[idx]);
+
+		uv = mesh_data.m_uvw.empty() ? 0 : PackHalf2(glm::vec2(mesh_data.m_uvw[idx].x, mesh_data.m_uvw[idx].y));
+		normal = PackOctSnorm16(n);
+		tangent = PackTangentFrame(t, sign);
+	}
+
+	inline void DecodeSurface(std::uint32_t uv, std::uint32_t normal, std::uint32_t tangent, Vertex& vertex)
+	{
+		float sign;
+		vertex.m_uv = UnpackHalf2(uv);
+		vertex.m_normal = UnpackOctSnorm16(normal);
+		vertex.m_tangent = UnpackTangentFrame(tangent, sign);
+		vertex.m_bitangent = glm::cross(vertex.m_normal, vertex.m_tangent) * sign;
+	}
+
+} /* internal */
+
+//! 24 byte vertex with a full precision position.
+struct CompressedVertex
+{
+	glm::vec3 m_position;
+	std::uint32_t m_uv; // half2
+	std::uint32_t m_oct_normal; // snorm16x2 octahedral
+	std::uint32_t m_oct_tangent; // snorm15x2 octahedral + bitangent sign
+
+	static CompressedVertex Encode(MeshData const & mesh_data, std::size_t idx, MeshBoundingBox const &)
+	{
+		CompressedVertex vertex;
+		vertex.m_position = mesh_data.m_positions[idx];
+		internal::EncodeSurface(mesh_data, idx, vertex.m_uv, vertex.m_oct_normal, vertex.m_oct_tangent);
+		return vertex;
+	}
+
+	Vertex Decode(MeshBoundingBox const &) const
+	{
+		Vertex vertex;
+		vertex.m_pos = m_position;
+		internal::DecodeSurface(m_uv, m_oct_normal, m_oct_tangent, vertex);
+		return vertex;
+	}
+
+	static gfx::PipelineState::InputLayout GetInputLayout()
+	{
+		std::vector<VkVertexInputBindingDescription> binding_descs(1);
+		binding_descs[0].binding = 0;
+		binding_descs[0].stride = sizeof(CompressedVertex);
+		binding_descs[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		std::vector<VkVertexInputAttributeDescription> attribute_descs(4);
+		// position attribute
+		attribute_descs[0].binding = 0;
+		attribute_descs[0].location = 0;
+		attribute_descs[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+		attribute_descs[0].offset = offsetof(CompressedVertex, m_position);
+		// uv
+		attribute_descs[1].binding = 0;
+		attribute_descs[1].location = 1;
+		attribute_descs[1].format = VK_FORMAT_R16G16_SFLOAT;
+		attribute_descs[1].offset = offsetof(CompressedVertex, m_uv);
+		// octahedral normal
+		attribute_descs[2].binding = 0;
+		attribute_descs[2].location = 2;
+		attribute_descs[2].format = VK_FORMAT_R16G16_SNORM;
+		attribute_descs[2].offset = offsetof(CompressedVertex, m_oct_normal);
+		// tangent frame
+		attribute_descs[3].binding = 0;
+		attribute_descs[3].location = 3;
+		attribute_descs[3].format = VK_FORMAT_R32_UINT;
+		attribute_descs[3].offset = offsetof(CompressedVertex, m_oct_tangent);
+
+		return { binding_descs, attribute_descs };
+	}
+};
+
+//! 20 byte vertex with the position quantized to 16 bit relative to the bounding box of the mesh.
+struct QuantizedVertex
+{
+	std::uint16_t m_position[4]; // unorm16, w is unused padding.
+	std::uint32_t m_uv; // half2
+	std::uint32_t m_oct_normal; // snorm16x2 octahedral
+	std::uint32_t m_oct_tangent; // snorm15x2 octahedral + bitangent sign
+
+	static QuantizedVertex Encode(MeshData const & mesh_data, std::size_t idx, MeshBoundingBox const & bbox)
+	{
+		QuantizedVertex vertex;
+
+		glm::vec3 extent = bbox.m_max - bbox.m_min;
+		for (auto i = 0; i < 3; i++)
+		{
+			float normalized = extent[i] > 0.f ? (mesh_data.m_positions[idx][i] - bbox.m_min[i]) / extent[i] : 0.f;
+			vertex.m_position[i] = static_cast<std::uint16_t>(std::lround(std::clamp(normalized, 0.f, 1.f) * 65535.f));
+		}
+		vertex.m_position[3] = 0;
+
+		internal::EncodeSurface(mesh_data, idx, vertex.m_uv, vertex.m_oct_normal, vertex.m_oct_tangent);
+		return vertex;
+	}
+
+	Vertex Decode(MeshBoundingBox const & bbox) const
+	{
+		Vertex vertex;
+
+		glm::vec3 extent = bbox.m_max - bbox.m_min;
+		for (auto i = 0; i < 3; i++)
+		{
+			vertex.m_pos[i] = bbox.m_min[i] + (m_position[i] / 65535.f) * extent[i];
+		}
+
+		internal::DecodeSurface(m_uv, m_oct_normal, m_oct_tangent, vertex);
+		return vertex;
+	}
+
+	static gfx::PipelineState::InputLayout GetInputLayout()
+	{
+		std::vector<VkVertexInputBindingDescription> binding_descs(1);
+		binding_descs[0].binding = 0;
+		binding_descs[0].stride = sizeof(QuantizedVertex);
+		binding_descs[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		std::vector<VkVertexInputAttributeDescription> attribute_descs(4);
+		// position attribute
+		attribute_descs[0].binding = 0;
+		attribute_descs[0].location = 0;
+		attribute_descs[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+		attribute_descs[0].offset = offsetof(QuantizedVertex, m_position);
+		// uv
+		attribute_descs[1].binding = 0;
+		attribute_descs[1].location = 1;
+		attribute_descs[1].format = VK_FORMAT_R16G16_SFLOAT;
+		attribute_descs[1].offset = offsetof(QuantizedVertex, m_uv);
+		// octahedral normal
+		attribute_descs[2].binding = 0;
+		attribute_descs[2].location = 2;
+		attribute_descs[2].format = VK_FORMAT_R16G16_SNORM;
+		attribute_descs[2].offset = offsetof(QuantizedVertex, m_oct_normal);
+		// tangent frame
+		attribute_descs[3].binding = 0;
+		attribute_descs[3].location = 3;
+		attribute_descs[3].format = VK_FORMAT_R32_UINT;
+		attribute_descs[3].offset = offsetof(QuantizedVertex, m_oct_tangent);
+
+		return { binding_descs, attribute_descs };
+	}
+};
+
+static_assert(sizeof(CompressedVertex) == 24);
+static_assert(sizeof(QuantizedVertex) == 20);
+
+IS_PROPER_VERTEX_CLASS(CompressedVertex)
+IS_PROPER_VERTEX_CLASS(QuantizedVertex)
+
+template<> struct IsGPUVertex<CompressedVertex> : std::false_type {};
+template<> struct IsGPUVertex<QuantizedVertex> : std::false_type {};
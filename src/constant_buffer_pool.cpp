@@ -14,13 +14,29 @@ ConstantBufferPool::ConstantBufferPool()
 
 ConstantBufferHandle ConstantBufferPool::Allocate(std::uint64_t size)
 {
+	for (auto it = m_free_handles.begin(); it != m_free_handles.end(); it++)
+	{
+		if (m_sizes[it->m_cb_id] >= size)
+		{
+			auto handle = *it;
+			m_free_handles.erase(it);
+			return handle;
+		}
+	}
+
 	auto new_id = m_next_id;
 
 	ConstantBufferHandle handle;
 	handle.m_cb_id = new_id;
 
 	Allocate_Impl(handle, size);
-	
+	m_sizes.push_back(size);
+
 	m_next_id++;
 	return handle;
 }
+
+void ConstantBufferPool::Deallocate(ConstantBufferHandle handle)
+{
+	m_free_handles.push_back(handle);
+}
@@ -31,7 +31,10 @@ public:
 
 	virtual void Flush(std::uint32_t frame_idx) = 0;
 
+	//! Hands out a released buffer of at least `size` bytes when there is one, otherwise creates a new buffer.
 	ConstantBufferHandle Allocate(std::uint64_t size);
+	//! Releases a buffer for reuse by `Allocate`. The buffer and its descriptors stay alive until the pool is destroyed.
+	void Deallocate(ConstantBufferHandle handle);
 	virtual std::vector<std::uint32_t> CreateConstantBufferSet(std::vector<ConstantBufferHandle> handles) = 0;
 	virtual void Update(ConstantBufferHandle handle, std::uint64_t size, void* data, std::uint32_t frame_idx, std::uint64_t offset = 0) = 0;
 
@@ -39,4 +42,6 @@ private:
 	virtual void Allocate_Impl(ConstantBufferHandle& handle, std::uint64_t size) = 0;
 
 	std::uint32_t m_next_id;
+	std::vector<std::uint64_t> m_sizes; // Indexed by `ConstantBufferHandle::m_cb_id`.
+	std::vector<ConstantBufferHandle> m_free_handles;
 };
@@ -9,6 +9,7 @@
 #include <glm.hpp>
 
 #include "vertex.hpp"
+#include "buffer_definitions.hpp"
 #include "graphics/gfx_settings.hpp"
 
 /* ============================================================== */
@@ -119,7 +120,7 @@ REGISTER(root_signatures::basic, RootSignatureRegistry)({
 		params[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_MESH_BIT_NV | VK_SHADER_STAGE_TASK_BIT_NV;
 		params[0].pImmutableSamplers = nullptr;
 		params[1].binding = 1; // per object data
-		params[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		params[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 		params[1].descriptorCount = 1;
 		params[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_MESH_BIT_NV | VK_SHADER_STAGE_TASK_BIT_NV;
 		params[1].pImmutableSamplers = nullptr;
@@ -147,7 +148,7 @@ REGISTER(root_signatures::basic_mesh, RootSignatureRegistry)({
 		params[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_MESH_BIT_NV | VK_SHADER_STAGE_TASK_BIT_NV;
 		params[0].pImmutableSamplers = nullptr;
 		params[1].binding = 1; // per-object data
-		params[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		params[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 		params[1].descriptorCount = 1;
 		params[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_MESH_BIT_NV | VK_SHADER_STAGE_TASK_BIT_NV;
 		params[1].pImmutableSamplers = nullptr;
@@ -183,14 +184,14 @@ REGISTER(root_signatures::basic_mesh, RootSignatureRegistry)({
 		params[7].pImmutableSamplers = nullptr;
 		return params;
 	}(),
-	/*.m_push_constants = []() -> decltype(RootSignatureDesc::m_push_constants)
+	.m_push_constants = []() -> decltype(RootSignatureDesc::m_push_constants)
 	{
 		decltype(RootSignatureDesc::m_push_constants) constants(1);
 		constants[0].offset = 0;
-		constants[0].size = (sizeof(unsigned int) * 4) + (sizeof(glm::vec4) * 2); // meshlet offset (instance) and meshlet count and bbox
-		constants[0].stageFlags = VK_SHADER_STAGE_TASK_BIT_NV;
+		constants[0].size = sizeof(cb::MeshletDrawInfo);
+		constants[0].stageFlags = VK_SHADER_STAGE_TASK_BIT_NV; // Only read by instancing_task.comp.
 		return constants;
-	}()*/
+	}()
 });
 
 REGISTER(root_signatures::composition, RootSignatureRegistry)({
@@ -0,0 +1,176 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include "barrier_planner.hpp"
+
+namespace fg
+{
+
+	BarrierPlanner::BarrierPlanner()
+		: m_num_barriers(0), m_num_transitions(0)
+	{
+	}
+
+	BarrierPlanner::~BarrierPlanner()
+	{
+	}
+
+	void BarrierPlanner::Compile(std::vector<RenderTaskHandle> const & order, std::vector<std::vector<ResourceAccess>> const & accesses,
+		std::vector<bool> const & should_execute, std::vector<bool> const & discard, std::vector<ResourceState> const & initial_states)
+	{
+		auto num_tasks = static_cast<std::uint32_t>(accesses.size());
+		m_barriers.assign(num_tasks, {});
+		m_initial_states = initial_states;
+		m_initial_states.resize(num_tasks);
+		m_final_states = m_initial_states;
+		m_num_barriers = 0;
+		m_num_transitions = 0;
+
+		// The uses of every render target in submission order.
+		struct Use
+		{
+			RenderTaskHandle m_task;
+			ResourceAccess const * m_access;
+		};
+
+		std::vector<std::vector<Use>> uses(num_tasks);
+		for (std::uint32_t i = 0; i < num_tasks; i++)
+		{
+			auto task = order.size() == num_tasks ? order[i] : i;
+			if (task < should_execute.size() && !should_execute[task])
+			{
+				continue;
+			}
+
+			for (auto const & access : accesses[task])
+			{
+				if (access.m_target < num_tasks)
+				{
+					uses[access.m_target].push_back({ task, &access });
+				}
+			}
+		}
+
+		for (RenderTaskHandle target = 0; target < num_tasks; target++)
+		{
+			auto& state = m_final_states[target];
+			auto const & target_uses = uses[target];
+
+			for (std::size_t i = 0; i < target_uses.size(); i++)
+			{
+				auto const & access = *target_uses[i].m_access;
+				auto layout = GetLayout(access.m_usage);
+				auto write = IsWrite(access.m_usage);
+				auto discard_contents = i == 0 && target < discard.size() && discard[target];
+
+				std::optional<ResourceTransition> transition;
+				if (discard_contents || layout != state.m_layout)
+				{
+					transition = ResourceTransition{ target, discard_contents ? ResourceLayout::UNDEFINED : state.m_layout, layout, state.m_writes | state.m_reads, ToMask(access.m_usage) };
+				}
+				else if (write && (state.m_writes || state.m_reads))
+				{
+					transition = ResourceTransition{ target, layout, layout, state.m_writes | state.m_reads, ToMask(access.m_usage) };
+				}
+				else if (!write && state.m_writes && !(state.m_reads & ToMask(access.m_usage)))
+				{
+					transition = ResourceTransition{ target, layout, layout, state.m_writes, ToMask(access.m_usage) };
+				}
+
+				if (transition.has_value())
+				{
+					// The reads after this one in the same layout can wait on this barrier as well.
+					if (!write)
+					{
+						for (auto j = i + 1; j < target_uses.size(); j++)
+						{
+							auto const & next = *target_uses[j].m_access;
+							if (IsWrite(next.m_usage) || GetLayout(next.m_usage) != layout || next.m_left_as.has_value())
+							{
+								break;
+							}
+
+							transition->m_dst_usages |= ToMask(next.m_usage);
+						}
+					}
+
+					auto& batch = m_barriers[target_uses[i].m_task];
+					batch.m_src_usages |= transition->m_src_usages;
+					batch.m_dst_usages |= transition->m_dst_usages;
+					batch.m_transitions.push_back(transition.value());
+				}
+
+				state.m_layout = layout;
+				if (write)
+				{
+					state.m_writes = ToMask(access.m_usage);
+					state.m_reads = 0;
+				}
+				else if (transition.has_value() && transition->m_from != transition->m_to)
+				{
+					state.m_writes = 0;
+					state.m_reads = transition->m_dst_usages;
+				}
+				else
+				{
+					state.m_reads |= transition.has_value() ? transition->m_dst_usages : ToMask(access.m_usage);
+				}
+
+				if (access.m_left_as.has_value())
+				{
+					auto [usage, left_layout] = access.m_left_as.value();
+					state.m_layout = left_layout;
+					state.m_writes = IsWrite(usage) ? ToMask(usage) : 0;
+					state.m_reads = IsWrite(usage) ? 0 : ToMask(usage);
+				}
+			}
+		}
+
+		for (auto const & batch : m_barriers)
+		{
+			if (batch.m_transitions.empty())
+			{
+				continue;
+			}
+
+			m_num_barriers++;
+			for (auto const & transition : batch.m_transitions)
+			{
+				if (transition.m_from != transition.m_to)
+				{
+					m_num_transitions++;
+				}
+			}
+		}
+	}
+
+	BarrierBatch const & BarrierPlanner::GetBarriers(RenderTaskHandle handle) const
+	{
+		static const BarrierBatch no_barriers = {};
+		return handle < m_barriers.size() ? m_barriers[handle] : no_barriers;
+	}
+
+	std::vector<ResourceState> const & BarrierPlanner::GetFinalStates() const
+	{
+		return m_final_states;
+	}
+
+	bool BarrierPlanner::IsSteady() const
+	{
+		return m_final_states == m_initial_states;
+	}
+
+	std::uint32_t BarrierPlanner::GetNumBarriers() const
+	{
+		return m_num_barriers;
+	}
+
+	std::uint32_t BarrierPlanner::GetNumTransitions() const
+	{
+		return m_num_transitions;
+	}
+
+} /* fg */
@@ -0,0 +1,154 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <vector>
+#include <optional>
+#include <utility>
+#include <cstdint>
+
+#include "task_graph.hpp"
+
+namespace fg
+{
+
+	//! How a task uses a render target. Decides the layout it has to be in and what the task has to wait on.
+	enum class ResourceUsage : std::uint8_t
+	{
+		SAMPLED,       //!< Read through a descriptor with a sampler.
+		STORAGE_READ,  //!< Read through a descriptor without a sampler.
+		STORAGE_WRITE, //!< Written and read as a storage image.
+		ATTACHMENT,    //!< Rendered to as the color attachments of a render pass.
+		COPY_SRC,      //!< Copied or blitted from.
+		COPY_DST,      //!< Copied or blitted to.
+		COUNT
+	};
+
+	//! The layouts the usages need. Mirrors `VkImageLayout` so the planning doesn't need a device.
+	enum class ResourceLayout : std::uint8_t
+	{
+		UNDEFINED,
+		GENERAL,
+		SHADER_READ_ONLY,
+		COLOR_ATTACHMENT,
+		TRANSFER_SRC,
+		TRANSFER_DST
+	};
+
+	//! A bit per `ResourceUsage`. The renderer turns it into pipeline stages and access flags.
+	using ResourceUsageMask = std::uint32_t;
+
+	constexpr ResourceUsageMask ToMask(ResourceUsage usage)
+	{
+		return 1u << static_cast<std::uint32_t>(usage);
+	}
+
+	constexpr ResourceLayout GetLayout(ResourceUsage usage)
+	{
+		switch (usage)
+		{
+		case ResourceUsage::SAMPLED: return ResourceLayout::SHADER_READ_ONLY;
+		case ResourceUsage::STORAGE_READ: return ResourceLayout::GENERAL;
+		case ResourceUsage::STORAGE_WRITE: return ResourceLayout::GENERAL;
+		case ResourceUsage::ATTACHMENT: return ResourceLayout::COLOR_ATTACHMENT;
+		case ResourceUsage::COPY_SRC: return ResourceLayout::TRANSFER_SRC;
+		case ResourceUsage::COPY_DST: return ResourceLayout::TRANSFER_DST;
+		default: return ResourceLayout::UNDEFINED;
+		}
+	}
+
+	constexpr bool IsWrite(ResourceUsage usage)
+	{
+		return usage == ResourceUsage::STORAGE_WRITE || usage == ResourceUsage::ATTACHMENT || usage == ResourceUsage::COPY_DST;
+	}
+
+	//! A render target a task uses.
+	struct ResourceAccess
+	{
+		//! The task owning the render target.
+		RenderTaskHandle m_target;
+		ResourceUsage m_usage;
+		//! Set when the task changes the layout itself, like when generating mip maps. The usage that wrote it last and the layout it is left in.
+		std::optional<std::pair<ResourceUsage, ResourceLayout>> m_left_as = std::nullopt;
+	};
+
+	//! The layout of a render target and the accesses the next task using it has to wait on.
+	struct ResourceState
+	{
+		ResourceLayout m_layout = ResourceLayout::UNDEFINED;
+		//! The last write. Reads wait on it and it has to be made visible to them.
+		ResourceUsageMask m_writes = 0;
+		//! The reads since the last write or layout change. They already waited on it, a write has to wait on them.
+		ResourceUsageMask m_reads = 0;
+
+		bool operator==(ResourceState const & other) const = default;
+	};
+
+	//! Changes the layout of a render target, or only makes the previous writes visible when the layouts are the same.
+	struct ResourceTransition
+	{
+		RenderTaskHandle m_target;
+		ResourceLayout m_from;
+		ResourceLayout m_to;
+		ResourceUsageMask m_src_usages;
+		ResourceUsageMask m_dst_usages;
+	};
+
+	//! The barriers a task needs before it runs. Recorded as a single `vkCmdPipelineBarrier`.
+	struct BarrierBatch
+	{
+		ResourceUsageMask m_src_usages = 0;
+		ResourceUsageMask m_dst_usages = 0;
+		std::vector<ResourceTransition> m_transitions;
+	};
+
+	//! Plans the barriers between the tasks of a frame graph from the render targets they use.
+	/*!
+		Follows the state of every render target through the submission order and only adds a barrier when the layout changes,
+		when a write has to wait on earlier accesses or when a read needs a write made visible.
+		Reads in the same layout that follow each other wait on the first barrier, so they don't need one of their own.
+		Everything a task needs goes into one batch.
+		Doesn't know about the renderer, so it can be benchmarked without a device.
+	*/
+	class BarrierPlanner
+	{
+	public:
+		BarrierPlanner();
+		~BarrierPlanner();
+
+		//! Plans the barriers of a frame.
+		/*!
+			\param order The order the tasks get submitted in. See `TaskGraph::GetOrder`. Empty to use the order the tasks got added in.
+			\param accesses The render targets each task uses, including its own.
+			\param should_execute Tasks that don't execute don't access anything.
+			\param discard Render targets that don't keep their contents between frames. Their first use transitions from `UNDEFINED`.
+			\param initial_states The state of every render target at the start of the frame. Missing ones start `UNDEFINED`.
+		*/
+		void Compile(std::vector<RenderTaskHandle> const & order, std::vector<std::vector<ResourceAccess>> const & accesses,
+			std::vector<bool> const & should_execute, std::vector<bool> const & discard, std::vector<ResourceState> const & initial_states);
+
+		BarrierBatch const & GetBarriers(RenderTaskHandle handle) const;
+		//! The state of every render target at the end of the frame.
+		std::vector<ResourceState> const & GetFinalStates() const;
+		//! Whether the frame ends in the states it started in, so the next frame can use the same barriers.
+		bool IsSteady() const;
+
+		//! The number of `vkCmdPipelineBarrier` calls a frame needs.
+		std::uint32_t GetNumBarriers() const;
+		//! The number of layout changes a frame needs.
+		std::uint32_t GetNumTransitions() const;
+
+	private:
+		std::vector<BarrierBatch> m_barriers;
+		std::vector<ResourceState> m_initial_states;
+		std::vector<ResourceState> m_final_states;
+
+		std::uint32_t m_num_barriers;
+		std::uint32_t m_num_transitions;
+	};
+
+} /* fg */
@@ -11,14 +11,21 @@
 #include <type_traits>
 #include <stack>
 #include <deque>
-#include <future>
 #include <cstdint>
 #include <optional>
-#include <any>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <typeindex>
+#include <unordered_map>
 
 #include "../util/log.hpp"
-#include "../util/thread_pool.hpp"
+#include "../util/job_system.hpp"
 #include "../util/delegate.hpp"
+#include "task_graph.hpp"
+#include "render_target_aliasing.hpp"
+#include "barrier_planner.hpp"
 #include "../renderer.hpp"
 #include "../scene_graph/scene_graph.hpp"
 #include "../settings.hpp"
@@ -45,12 +52,31 @@ namespace fg
 		COPY
 	};
 
-	//! Typedef for the render task handle.
-	using RenderTaskHandle = std::uint32_t;
-
 	// Forward declarations.
 	class FrameGraph;
 
+	//! Identifies a task data or settings type. Dense, so the frame graph can find a task by indexing a vector.
+	using TypeID = std::uint32_t;
+
+	namespace internal
+	{
+
+		inline TypeID GetFreeTypeID()
+		{
+			static std::atomic<TypeID> next_id = 0;
+			return next_id++;
+		}
+
+		//! The ID of a type. Assigned the first time it is asked for and the same for every frame graph.
+		template<typename T>
+		inline TypeID GetTypeID()
+		{
+			static const TypeID id = GetFreeTypeID();
+			return id;
+		}
+
+	} /* internal */
+
 	/*! Structure that describes a render task */
 	/*!
 		All non default initialized member variables should be fully initialized to prevent undifined behaviour.
@@ -82,6 +108,9 @@ namespace fg
 	  It will not just run tasks but will also assign command lists and render targets to the tasks.
 	  The Frame Graph is also capable of mulithreaded execution.
 	  It will split the command lists that are allowed to be multithreaded on X amount of threads specified in `settings.hpp`
+	  The order is defined by a `TaskGraph` compiled from the dependencies passed to `AddTask` and the predecessors tasks look up.
+	  A task only starts when all its predecessors finished and the command lists get submitted in that order.
+	  Transient render targets that aren't alive at the same time in that order share memory. See `RenderTargetAliasing`.
 	*/
 	class FrameGraph
 	{
@@ -99,10 +128,17 @@ namespace fg
 		*/
 		FrameGraph(std::size_t num_reserved_tasks = 1) :
 			m_renderer(nullptr),
+			m_scene_graph(nullptr),
 			m_num_tasks(0),
-			m_thread_pool(new util::ThreadPool(settings::num_frame_graph_threads)),
+			m_job_system(new util::JobSystem(settings::num_frame_graph_threads)),
+			m_task_graph_dirty(false),
+			m_record_dependencies(false),
+			m_render_target_aliasing_dirty(false),
+			m_barriers_dirty(false),
 			m_uid(GetFreeUID())
 		{
+			m_execute_task_func = TaskGraph::run_func_t::from<FrameGraph, &FrameGraph::ExecuteTask>(this);
+
 			// lambda to simplify reserving space.
 			auto reserve = [num_reserved_tasks](auto v) { v.reserve(num_reserved_tasks); };
 
@@ -118,21 +154,24 @@ namespace fg
 			reserve(m_dependencies);
 			reserve(m_names);
 #endif
+			reserve(m_predecessors);
+			reserve(m_accesses);
+			reserve(m_allow_multithreading);
 			reserve(m_types);
 			reserve(m_rt_properties);
-			m_settings = decltype(m_settings)(num_reserved_tasks, std::nullopt); // Resizing so I can initialize it with null since this is an optional value.
-			m_futures.resize(num_reserved_tasks); // std::thread doesn't allow me to reserve memory for the vector. Hence I'm resizing.
+			reserve(m_settings);
+			reserve(m_settings_types);
 		}
 
 		//! Destructor
 		/*!
-			This destructor destroys all the task data and the thread pool.
+			This destructor destroys all the task data and the job system.
 			If you want to reuse the frame graph I recommend calling `FrameGraph::Destroy`
 		*/
 		~FrameGraph()
 		{
-			delete m_thread_pool;
 			Destroy();
+			delete m_job_system;
 		}
 
 		FrameGraph(const FrameGraph&) = delete;
@@ -166,8 +205,11 @@ namespace fg
 			m_cmd_lists.resize(m_num_tasks);
 			m_should_execute.resize(m_num_tasks, true); // All tasks should execute by default.
 			m_render_targets.resize(m_num_tasks);
-			m_futures.resize(m_num_tasks);
+			m_render_target_states.assign(m_num_tasks, {}); // The render targets start without contents.
+			m_barriers_dirty = true;
+			m_setup_jobs = std::make_unique<util::JobCounter[]>(m_num_tasks);
 			m_renderer = renderer;
+			m_record_dependencies = true; // Tasks look up most of their predecessors while setting up.
 
 			auto get_command_list_from_render_system = [this](auto type)
 			{
@@ -228,7 +270,7 @@ namespace fg
 					}
 
 					// Call the setup function pointer.
-					m_setup_funcs[i](*m_renderer, *this, i, false);
+					RunSetupFunc(i, false);
 				}
 			}
 
@@ -237,6 +279,9 @@ namespace fg
 			{
 				WaitForCompletion(i);
 			}
+
+			// The first frame runs in order to discover the remaining dependencies. The task graph gets compiled after it.
+			m_task_graph_dirty = true;
 		}
 
 		/*! Execute all render tasks */
@@ -247,21 +292,46 @@ namespace fg
 		*/
 		inline void Execute(sg::SceneGraph& scene_graph)
 		{
+			m_scene_graph = &scene_graph;
+
 			// Check if we need to disable some tasks
 			while (!m_should_execute_change_request.empty())
 			{
 				auto front = m_should_execute_change_request.front();
+				m_barriers_dirty |= m_should_execute[front.first] != front.second;
 				m_should_execute[front.first] = front.second;
 				m_should_execute_change_request.pop();
 			}
 
+			// Move the transient render targets into shared memory before recording anything that uses them.
+			if (m_render_target_aliasing_dirty && !m_task_graph_dirty)
+			{
+				AliasRenderTargets();
+			}
+
+			if (m_barriers_dirty)
+			{
+				PlanBarriers();
+			}
+
+			// Run in the order the tasks got added while recording the predecessors they look up, then compile the graph with them.
+			if (m_task_graph_dirty)
+			{
+				m_record_dependencies = true;
+				Execute_ST_Impl(scene_graph);
+				m_record_dependencies = false;
+
+				CompileTaskGraph();
+				return;
+			}
+
 			if constexpr (settings::use_multithreading)
 			{
 				Execute_MT_Impl(scene_graph);
 			}
 			else
 			{
-				Execute_ST_Impl(scene_graph);
+				m_task_graph.Execute(nullptr, m_should_execute, m_execute_task_func);
 			}
 		}
 
@@ -282,6 +352,7 @@ namespace fg
 			// Make sure the GPU has finished with the tasks
 			m_renderer->WaitForAllPreviousWork();
 
+			m_record_dependencies = true;
 			for (decltype(m_num_tasks) i = 0; i < m_num_tasks; ++i)
 			{
 				m_destroy_funcs[i](*this, i, true);
@@ -293,10 +364,16 @@ namespace fg
 					 m_renderer->ResizeRenderTarget(m_render_targets[i],
 						static_cast<std::uint32_t>(std::ceil(width * m_rt_properties[i].value().m_resolution_scale)),
 						static_cast<std::uint32_t>(std::ceil(height * m_rt_properties[i].value().m_resolution_scale)));
+					m_render_target_states[i] = {}; // New images, the old contents are gone.
+					m_barriers_dirty = true;
 				}
 
-				m_setup_funcs[i](*m_renderer, *this, i, true);
+				RunSetupFunc(i, true);
 			}
+			m_record_dependencies = false;
+
+			// Resized render targets lost their place in the heaps.
+			m_render_target_aliasing_dirty = settings::alias_transient_render_targets;
 		}
 
 		/*! Get Resolution scale of specified Render Task */
@@ -328,7 +405,11 @@ namespace fg
 				WaitForCompletion(i);
 			}
 
-			m_renderer->WaitForAllPreviousWork();
+			// A frame graph that never got set up doesn't have anything on the GPU.
+			if (m_renderer)
+			{
+				m_renderer->WaitForAllPreviousWork();
+			}
 
 			// Send the destroy events to the render tasks.
 			for (decltype(m_num_tasks) i = 0; i < m_num_tasks; ++i)
@@ -347,7 +428,7 @@ namespace fg
 				m_renderer->DestroyCommandList(cmd_list);
 			}
 
-			for(decltype(m_num_tasks) i = 0; i < m_num_tasks; ++i)
+			for(decltype(m_num_tasks) i = 0; i < m_render_targets.size(); ++i)
 			{
 				if(m_rt_properties[i].has_value() && !m_rt_properties[i]->m_is_render_window)
 				{
@@ -355,6 +436,11 @@ namespace fg
 				}
 			}
 
+			for (auto heap : m_render_target_heaps)
+			{
+				m_renderer->DestroyRenderTargetHeap(heap);
+			}
+
 			// Reset all members in the case of the user wanting to reuse this frame graph after `FrameGraph::Destroy`.
 			m_setup_funcs.clear();
 			m_execute_funcs.clear();
@@ -363,16 +449,29 @@ namespace fg
 			m_render_targets.clear();
 			m_data.clear();
 			m_data_type_info.clear();
+			m_handles_by_type.clear();
+			m_handles_by_type_info.clear();
 			m_settings.clear();
+			m_settings_types.clear();
 #ifndef FG_MAX_PERFORMANCE
 			m_dependencies.clear();
 			m_names.clear();
 #endif
+			m_predecessors.clear();
+			m_accesses.clear();
+			m_render_target_states.clear();
+			m_allow_multithreading.clear();
 			m_types.clear();
 			m_rt_properties.clear();
-			m_futures.clear();
+			m_setup_jobs.reset();
+			m_render_target_heaps.clear();
 
 			m_num_tasks = 0;
+			m_task_graph.Compile(m_predecessors, m_allow_multithreading);
+			m_render_target_aliasing.Compile({}, {}, {});
+			m_render_target_aliasing_dirty = false;
+			m_barrier_planner.Compile({}, {}, {}, {}, {});
+			m_barriers_dirty = false;
 		}
 
 		/* Stall the current thread until the render task has finished. */
@@ -381,10 +480,12 @@ namespace fg
 			// If we are not allowed to use multithreading let the compiler optimize this away completely.
 			if constexpr (settings::use_multithreading)
 			{
-				if (auto& future = m_futures[handle]; future.valid())
+				if (m_setup_jobs)
 				{
-					future.wait();
+					m_job_system->Wait(m_setup_jobs[handle]);
 				}
+
+				m_task_graph.Wait(handle);
 			}
 		}
 
@@ -416,9 +517,8 @@ namespace fg
 
 		/*! Wait for a previous task. */
 		/*!
-			This function loops over all tasks and checks whether it has the same type information as the template variable.
-			If a task was found it waits for it.
-			If no task is found with the type specified a nullptr will be returned and a error message send to the logging system.
+			This function finds the task with the type of the template variable and waits for it.
+			If no task is found with the type specified a error message is send to the logging system.
 			The template parameter should be a Data struct of a the task you want to wait for.
 		*/
 		template<typename T>
@@ -431,13 +531,12 @@ namespace fg
 			static_assert(!std::is_pointer<T>::value,
 				"The template variable type should not be a pointer. Its implicitly converted to a pointer.");
 
-			for (decltype(m_num_tasks) i = 0; i < m_num_tasks; i++)
+			auto handle = GetHandleFromType<T>();
+			if (handle.has_value())
 			{
-				if (typeid(T) == m_data_type_info[i])
-				{
-					WaitForCompletion(i);
-					return;
-				}
+				RecordDependency(handle.value());
+				WaitForCompletion(handle.value());
+				return;
 			}
 
 			LOGC("Failed to find predecessor data! Please check your task order.");
@@ -464,7 +563,7 @@ namespace fg
 
 		/*! Get the data of a previously ran task. (Constant) */
 		/*!
-			This function loops over all tasks and checks whether it has the same type information as the template variable.
+			This function finds the task with the type of the template variable.
 			If no task is found with the type specified a nullptr will be returned and a error message send to the logging system.
 			\param handle The handle to the render task. (Given by the `Setup`, `Execute` and `Destroy` functions)
 		*/
@@ -478,14 +577,13 @@ namespace fg
 			static_assert(!std::is_pointer<T>::value,
 				"The template variable type should not be a pointer. Its implicitly converted to a pointer.");
 
-			for (decltype(m_num_tasks) i = 0; i < m_num_tasks; i++)
+			auto handle = GetHandleFromType<T>();
+			if (handle.has_value())
 			{
-				if (typeid(T) == m_data_type_info[i])
-				{
-					WaitForCompletion(i);
+				RecordDependency(handle.value());
+				WaitForCompletion(handle.value());
 
-					return *static_cast<T*>(m_data[i].get());
-				}
+				return *static_cast<T*>(m_data[handle.value()].get());
 			}
 
 			LOGC("Failed to find predecessor data! Please check your task order.")
@@ -494,7 +592,7 @@ namespace fg
 
 		/*! Get the render target properties of a previously added task.*/
 		/*!
-			This function loops over all tasks and checks whether it has the same type information as the template variable.
+			This function finds the task with the type of the template variable.
 			If no task is found with the type specified a nullptr will be returned and a error message send to the logging system.
 		*/
 		template<typename T>
@@ -505,12 +603,10 @@ namespace fg
 			static_assert(!std::is_pointer<T>::value,
 				"The template variable type should not be a pointer. Its implicitly converted to a pointer.");
 
-			for (decltype(m_num_tasks) i = 0; i < m_num_tasks; i++)
+			auto handle = GetHandleFromType<T>();
+			if (handle.has_value())
 			{
-				if (typeid(T) == m_data_type_info[i])
-				{
-					return m_rt_properties[i];
-				}
+				return m_rt_properties[handle.value()];
 			}
 
 			LOGC("Failed to find predecessor render target! Please check your task order.");
@@ -521,25 +617,30 @@ namespace fg
 
 		/*! Get the render target of a previously ran task. (Constant) */
 		/*!
-			This function loops over all tasks and checks whether it has the same type information as the template variable.
+			This function finds the task with the type of the template variable.
 			If no task is found with the type specified a nullptr will be returned and a error message send to the logging system.
+			\param usage How the task uses the render target. The frame graph records the barriers and layout transitions it needs before the task runs.
+			Declare it while setting up, usages looked up later only get barriers from the next frame on.
 		*/
 		template<typename T>
-		[[nodiscard]] inline gfx::RenderTarget* GetPredecessorRenderTarget()
+		[[nodiscard]] inline gfx::RenderTarget* GetPredecessorRenderTarget(std::optional<ResourceUsage> usage = std::nullopt)
 		{
 			static_assert(std::is_class<T>::value,
 				"The template variable should be a class or struct.");
 			static_assert(!std::is_pointer<T>::value,
 				"The template variable type should not be a pointer. Its implicitly converted to a pointer.");
 
-			for (decltype(m_num_tasks) i = 0; i < m_num_tasks; i++)
+			auto handle = GetHandleFromType<T>();
+			if (handle.has_value())
 			{
-				if (typeid(T) == m_data_type_info[i])
+				RecordDependency(handle.value());
+				if (usage.has_value())
 				{
-					WaitForCompletion(i);
-
-					return m_render_targets[i];
+					RecordAccess(handle.value(), usage.value());
 				}
+				WaitForCompletion(handle.value());
+
+				return m_render_targets[handle.value()];
 			}
 
 			LOGC("Failed to find predecessor render target! Please check your task order.");
@@ -576,14 +677,13 @@ namespace fg
 			static_assert(!std::is_pointer<T>::value,
 				"The template variable type should not be a pointer. Its implicitly converted to a pointer.");
 
-			for (decltype(m_num_tasks) i = 0; i < m_num_tasks; i++)
+			auto handle = GetHandleFromType<T>();
+			if (handle.has_value())
 			{
-				if (typeid(T) == m_data_type_info[i])
-				{
-					WaitForCompletion(i);
+				RecordDependency(handle.value());
+				WaitForCompletion(handle.value());
 
-					return m_cmd_lists[i];
-				}
+				return m_cmd_lists[handle.value()];
 			}
 
 			LOGC("Failed to find predecessor command list! Please check your task order.");
@@ -597,8 +697,12 @@ namespace fg
 			retval.reserve(m_num_tasks);
 
 			// TODO: Just return the fucking vector as const ref.
-			for (decltype(m_num_tasks) i = 0; i < m_num_tasks; i++)
+			// Submit in dependency order. Before the task graph is compiled that is the order the tasks got added in.
+			auto const & order = m_task_graph.GetOrder();
+			for (decltype(m_num_tasks) idx = 0; idx < m_num_tasks; idx++)
 			{
+				auto i = m_task_graph.IsCompiled() && order.size() == m_num_tasks ? order[idx] : idx;
+
 				// Don't return command lists from tasks that don't require to be executed.
 				if (!m_should_execute[i])
 				{
@@ -633,6 +737,42 @@ namespace fg
 			return m_rt_properties[handle].has_value();
 		}
 
+		/*! Whether the render target of a task can share memory with other render targets. See `RenderTargetProperties::m_is_transient`. */
+		[[nodiscard]] inline bool HasTransientRenderTarget(RenderTaskHandle handle) const
+		{
+			return m_rt_properties[handle].has_value() && m_rt_properties[handle]->m_is_transient && !m_rt_properties[handle]->m_is_render_window;
+		}
+
+		/*! The lifetimes and placement of the transient render targets and the memory they save. */
+		[[nodiscard]] inline RenderTargetAliasing const & GetRenderTargetAliasing() const
+		{
+			return m_render_target_aliasing;
+		}
+
+		/*! Tell the frame graph a task changes the layout of its own render target itself. */
+		/*!
+			The barriers after the task start from `layout`, as if `usage` was the last access.
+			\param handle The handle to the render task. (Given by the `Setup` function)
+		*/
+		inline void SetRenderTargetLeftAs(RenderTaskHandle handle, ResourceUsage usage, ResourceLayout layout)
+		{
+			std::lock_guard<std::mutex> lock(m_predecessors_mutex);
+			for (auto& access : m_accesses[handle])
+			{
+				if (access.m_target == handle)
+				{
+					access.m_left_as = std::make_pair(usage, layout);
+					m_barriers_dirty = true;
+				}
+			}
+		}
+
+		/*! The barriers between the tasks of the current frame. */
+		[[nodiscard]] inline BarrierPlanner const & GetBarrierPlanner() const
+		{
+			return m_barrier_planner;
+		}
+
 		/*! Check if this frame graph has a task. */
 		/*!
 			This checks if the frame graph has the task that has been given as the template variable.
@@ -691,7 +831,7 @@ namespace fg
 			\param desc A description of the render task.
 		*/
 		template<typename T>
-		inline void AddTask(RenderTaskDesc& desc, [[maybe_unused]] std::string const & name, [[maybe_unused]] std::vector<std::reference_wrapper<const std::type_info>> dependencies = {})
+		inline void AddTask(RenderTaskDesc& desc, [[maybe_unused]] std::string const & name, std::vector<std::reference_wrapper<const std::type_info>> dependencies = {})
 		{
 			static_assert(std::is_class<T>::value ||
 				std::is_floating_point<T>::value ||
@@ -702,6 +842,17 @@ namespace fg
 			static_assert(!std::is_pointer<T>::value,
 				"The template variable type should not be a pointer. Its implicitly converted to a pointer.");
 
+			// Resolve the dependencies to the handles of the predecessors. Missing ones are reported by `Validate`.
+			std::vector<RenderTaskHandle> predecessors;
+			for (auto dependency : dependencies)
+			{
+				auto it = m_handles_by_type_info.find(dependency.get());
+				if (it != m_handles_by_type_info.end())
+				{
+					predecessors.push_back(it->second);
+				}
+			}
+
 			m_setup_funcs.emplace_back(desc.m_setup_func);
 			m_execute_funcs.emplace_back(desc.m_execute_func);
 			m_destroy_funcs.emplace_back(desc.m_destroy_func);
@@ -709,12 +860,33 @@ namespace fg
 			m_dependencies.emplace_back(dependencies);
 			m_names.emplace_back(name);
 #endif
-			m_settings.resize(m_num_tasks + 1ull);
+			m_settings.emplace_back(nullptr);
+			m_settings_types.emplace_back(std::nullopt);
+			m_predecessors.emplace_back(std::move(predecessors));
+			m_accesses.emplace_back();
+			if (desc.m_properties.has_value() && !desc.m_properties->m_is_render_window)
+			{
+				// The task writes its own render target. The render window gets transitioned by the tasks using it.
+				m_accesses.back().push_back({ m_num_tasks, desc.m_type == RenderTaskType::COMPUTE ? ResourceUsage::STORAGE_WRITE : ResourceUsage::ATTACHMENT });
+			}
+			m_allow_multithreading.push_back(desc.m_allow_multithreading);
 			m_types.emplace_back(desc.m_type);
 			m_rt_properties.emplace_back(desc.m_properties);
 			m_data.emplace_back(std::make_shared<T>());
 			m_data_type_info.emplace_back(typeid(T));
 
+			// Lookups by type find the first task added with it.
+			auto type_id = internal::GetTypeID<T>();
+			if (type_id >= m_handles_by_type.size())
+			{
+				m_handles_by_type.resize(type_id + 1ull, std::nullopt);
+			}
+			if (!m_handles_by_type[type_id].has_value())
+			{
+				m_handles_by_type[type_id] = m_num_tasks;
+			}
+			m_handles_by_type_info.emplace(typeid(T), m_num_tasks);
+
 			// If we are allowed to do multithreading place the task in the appropriate vector
 			if constexpr (settings::use_multithreading)
 			{
@@ -769,15 +941,26 @@ namespace fg
 		/*!
 			This is used to update settings of a render task.
 			This must ge called BEFORE `FrameGraph::Setup` or `RenderSystem::Render`.
+			The settings are stored as `S` and have to be read back as `S`.
 		*/
-		template<typename T>
-		inline void UpdateSettings(std::any settings)
+		template<typename T, typename S>
+		inline void UpdateSettings(S settings)
 		{
 			auto handle = GetHandleFromType<T>();
 
 			if (handle.has_value())
 			{
-				m_settings[handle.value()] = settings;
+				// Reuse the slot when the type didn't change.
+				auto type_id = internal::GetTypeID<S>();
+				if (m_settings_types[handle.value()] == type_id)
+				{
+					*static_cast<S*>(m_settings[handle.value()].get()) = std::move(settings);
+				}
+				else
+				{
+					m_settings[handle.value()] = std::make_shared<S>(std::move(settings));
+					m_settings_types[handle.value()] = type_id;
+				}
 			}
 			else
 			{
@@ -787,79 +970,68 @@ namespace fg
 
 		/*! Gives you the settings of a task by handle. */
 		/*!
-			This gives you the settings for a render task casted to `R`.
+			This gives you the settings for a render task as `R`.
 			Meant to be used for INSIDE the tasks.
-			The return value can be a nullptr.
+			Returns a default constructed `R` when the task doesn't have settings of that type.
 			\tparam T The render task data type used for identification.
 			\tparam R The type of the settings object.
 
 		*/
 		template<typename T, typename R>
-		[[nodiscard]] inline R GetSettings() const try
+		[[nodiscard]] inline R GetSettings() const
 		{
 			static_assert(std::is_class<T>::value ||
 				std::is_floating_point<T>::value ||
 				std::is_integral<T>::value,
 				"The first template variable should be a class, struct, floating point value or a integral value.");
 
-			for (decltype(m_num_tasks) i = 0; i < m_num_tasks; i++)
+			auto handle = GetHandleFromType<T>();
+			if (handle.has_value())
 			{
-				if (typeid(T) == m_data_type_info[i])
-				{
-					return std::any_cast<R>(m_settings[i].value());
-				}
+				return GetSettings<R>(handle.value());
 			}
 
 			LOGC("Failed to find task settings! Does your frame graph contain this task?");
 			return R();
 		}
-		catch (const std::bad_any_cast & e) {
-			LOGC("A task settings requested failed to cast to T. ({})", e.what());
-			return R();
-		}
 
 		/*! Gives you the settings of a task by handle. */
 		/*!
-			This gives you the settings for a render task casted to `T`.
+			This gives you the settings for a render task as `T`.
 			Meant to be used for INSIDE the tasks.
-			The return value can be a nullptr.
+			Returns a default constructed `T` when the task doesn't have settings of that type.
 		*/
 		template<typename T>
-		[[nodiscard]] inline T GetSettings(RenderTaskHandle handle) const try
+		[[nodiscard]] inline T GetSettings(RenderTaskHandle handle) const
 		{
 			static_assert(std::is_class<T>::value ||
 				std::is_floating_point<T>::value ||
 				std::is_integral<T>::value,
 				"The template variable should be a class, struct, floating point value or a integral value.");
 
-			return std::any_cast<T>(m_settings[handle].value());
-		}
-		catch (const std::bad_any_cast& e) {
-			LOGW("A task settings requested failed to cast to T. ({})", e.what());
-			return T();
+			if (m_settings_types[handle] != internal::GetTypeID<T>())
+			{
+				LOGW("The settings of task {} aren't of the requested type {}.", handle, typeid(T).name());
+				return T();
+			}
+
+			return *static_cast<T const *>(m_settings[handle].get());
 		}
 
 		[[nodiscard]] inline bool HasSettings(RenderTaskHandle handle) const
 		{
-			return m_settings[handle] != std::nullopt;
+			return m_settings[handle] != nullptr;
 		}
 
 	private:
 
 		/*! Get the handle from a task by data type */
-		/* This function is zero overhead with GCC-8.2, -03 */
+		/*! Indexes the handles by `TypeID`, so it doesn't depend on the number of tasks. */
 		template<typename T>
 		inline std::optional<RenderTaskHandle> GetHandleFromType() const
 		{
-			for (decltype(m_num_tasks) i = 0; i < m_num_tasks; ++i)
-			{
-				if (m_data_type_info[i].get() == typeid(T))
-				{
-					return i;
-				}
-			}
-
-			return std::nullopt;
+			auto type_id = internal::GetTypeID<T>();
+			return type_id < m_handles_by_type.size() ? m_handles_by_type[type_id] : std::nullopt;
 		}
 
 		/*! Setup tasks multi threaded */
@@ -868,48 +1040,27 @@ namespace fg
 			// Multithreading behaviour
 			for (const auto handle : m_multi_threaded_tasks)
 			{
-				m_futures[handle] = m_thread_pool->Enqueue([this, handle]
+				m_job_system->Run([this, handle]
 				{
-					m_setup_funcs[handle](*m_renderer, *this, handle, false);
-				});
+					RunSetupFunc(handle, false);
+				}, m_setup_jobs[handle]);
 			}
 
 			// Singlethreading behaviour
 			for (const auto handle : m_single_threaded_tasks)
 			{
-				m_setup_funcs[handle](*m_renderer, *this, handle, false);
+				RunSetupFunc(handle, false);
 			}
 		}
 
 		/*! Execute tasks multi threaded */
-		inline void Execute_MT_Impl(sg::SceneGraph& scene_graph)
+		/*!
+			Every task is dispatched to the job system as soon as its predecessors finished.
+			Tasks that don't allow multithreading run on this thread. Returns when all tasks are recorded.
+		*/
+		inline void Execute_MT_Impl(sg::SceneGraph&)
 		{
-			// Multithreading behaviour
-			for (const auto handle : m_multi_threaded_tasks)
-			{
-				// Skip this task if it doesn't need to be executed
-				if (!m_should_execute[handle])
-				{
-					continue;
-				}
-
-				m_futures[handle] = m_thread_pool->Enqueue([this, handle, &scene_graph]
-				{
-					ExecuteSingleTask(scene_graph, handle);
-				});
-			}
-
-			// Singlethreading behaviour
-			for (const auto handle : m_single_threaded_tasks)
-			{
-				// Skip this task if it doesn't need to be executed
-				if (!m_should_execute[handle])
-				{
-					continue;
-				}
-
-				ExecuteSingleTask(scene_graph, handle);
-			}
+			m_task_graph.Execute(m_job_system, m_should_execute, m_execute_task_func);
 		}
 
 		/*! Execute tasks single threaded */
@@ -930,12 +1081,24 @@ namespace fg
 		/*! Execute a single task */
 		inline void ExecuteSingleTask(sg::SceneGraph& sg, RenderTaskHandle handle)
 		{
+			m_current_graph = this;
+			m_current_task = handle;
+
 			auto cmd_list = m_cmd_lists[handle];
 			auto render_target = m_render_targets[handle];
 			auto rt_properties = m_rt_properties[handle];
 
 			m_renderer->ResetCommandList(cmd_list);
 
+			// Wait on the tasks using the same render targets and move them into the layouts this task needs.
+			// The memory of an aliased render target was used by another render target, that one has to be done with it first.
+			auto aliased = m_render_target_aliasing.IsAliased(handle);
+			auto const & barriers = m_barrier_planner.GetBarriers(handle);
+			if (aliased || !barriers.m_transitions.empty())
+			{
+				m_renderer->ResourceBarrier(cmd_list, barriers, m_render_targets, aliased);
+			}
+
 			switch (m_types[handle])
 			{
 			case RenderTaskType::DIRECT:
@@ -950,15 +1113,7 @@ namespace fg
 				}
 				break;
 			case RenderTaskType::COMPUTE:
-				if (rt_properties.has_value() && rt_properties->m_bind_by_default)
-				{
-					m_renderer->StartComputeTask(cmd_list, { render_target, rt_properties.value() });
-				}
 				m_execute_funcs[handle](*m_renderer, *this, sg, handle);
-				if (rt_properties.has_value() && rt_properties->m_bind_by_default)
-				{
-					m_renderer->StopComputeTask(cmd_list, { render_target, rt_properties.value() });
-				}
 				break;
 			case RenderTaskType::COPY:
 				if (rt_properties.has_value() && rt_properties->m_bind_by_default)
@@ -974,6 +1129,188 @@ namespace fg
 			}
 
 			m_renderer->CloseCommandList(cmd_list);
+
+			m_current_graph = nullptr;
+		}
+
+		/*! Execute a single task of the scene graph passed to `Execute`. Used by the task graph. */
+		inline void ExecuteTask(RenderTaskHandle handle)
+		{
+			ExecuteSingleTask(*m_scene_graph, handle);
+		}
+
+		/*! Call the setup function of a task */
+		inline void RunSetupFunc(RenderTaskHandle handle, bool resize)
+		{
+			m_current_graph = this;
+			m_current_task = handle;
+
+			m_setup_funcs[handle](*m_renderer, *this, handle, resize);
+
+			m_current_graph = nullptr;
+		}
+
+		/*! Add a predecessor a task looked up to its dependencies. */
+		/*!
+			Tasks don't declare every predecessor they use with `FG_DEPS`, so the lookups done while setting up and during the first frame are added as well.
+			Only predecessors are recorded, looking up a later task doesn't order anything.
+		*/
+		inline void RecordDependency(RenderTaskHandle predecessor)
+		{
+			if (!m_record_dependencies || m_current_graph != this || predecessor >= m_current_task)
+			{
+				return;
+			}
+
+			std::lock_guard<std::mutex> lock(m_predecessors_mutex);
+			auto& predecessors = m_predecessors[m_current_task];
+			if (std::find(predecessors.begin(), predecessors.end(), predecessor) == predecessors.end())
+			{
+				predecessors.push_back(predecessor);
+				m_task_graph_dirty = true;
+			}
+		}
+
+		/*! Add a render target of a predecessor to the render targets the current task uses. */
+		inline void RecordAccess(RenderTaskHandle predecessor, ResourceUsage usage)
+		{
+			if (!m_record_dependencies || m_current_graph != this || predecessor >= m_current_task)
+			{
+				return;
+			}
+
+			std::lock_guard<std::mutex> lock(m_predecessors_mutex);
+			auto& accesses = m_accesses[m_current_task];
+			auto it = std::find_if(accesses.begin(), accesses.end(), [&](ResourceAccess const & access)
+			{
+				return access.m_target == predecessor && access.m_usage == usage;
+			});
+			if (it == accesses.end())
+			{
+				accesses.push_back({ predecessor, usage });
+				m_barriers_dirty = true;
+			}
+		}
+
+		/*! Compile the task graph from the declared and recorded dependencies. */
+		inline void CompileTaskGraph()
+		{
+			m_task_graph.Compile(m_predecessors, m_allow_multithreading);
+			m_task_graph_dirty = false;
+			m_render_target_aliasing_dirty = settings::alias_transient_render_targets;
+			m_barriers_dirty = true;
+
+#ifndef FG_MAX_PERFORMANCE
+			LOG("Compiled a frame graph of {} tasks into {} levels.", m_num_tasks, m_task_graph.GetNumLevels());
+#endif
+		}
+
+		/*! Place the transient render targets in shared heaps. */
+		/*!
+			The lifetimes come from the submission order and the dependencies of the compiled task graph.
+			Placing a render target recreates its images, so the tasks get destroyed and set up again like when resizing.
+		*/
+		inline void AliasRenderTargets()
+		{
+			m_render_target_aliasing_dirty = false;
+
+			std::vector<std::optional<RenderTargetMemoryRequirements>> requirements(m_num_tasks, std::nullopt);
+			for (decltype(m_num_tasks) i = 0; i < m_num_tasks; ++i)
+			{
+				if (HasTransientRenderTarget(i))
+				{
+					auto memory_requirements = m_renderer->GetRenderTargetMemoryRequirements(m_render_targets[i]);
+					requirements[i] = RenderTargetMemoryRequirements{ memory_requirements.size, memory_requirements.alignment, memory_requirements.memoryTypeBits };
+				}
+			}
+
+			m_render_target_aliasing.Compile(m_task_graph.GetOrder(), m_predecessors, requirements);
+
+#ifndef FG_MAX_PERFORMANCE
+			auto to_mb = [](std::uint64_t size) { return static_cast<double>(size) / (1024.0 * 1024.0); };
+			LOG("Frame graph {}: {} of {} transient render targets share {} heaps. {:.1f} MB instead of {:.1f} MB, saving {:.1f} MB.",
+				m_uid, m_render_target_aliasing.GetNumAliasedRenderTargets(), m_render_target_aliasing.GetNumTransientRenderTargets(),
+				m_render_target_aliasing.GetHeaps().size(), to_mb(m_render_target_aliasing.GetAliasedSize()),
+				to_mb(m_render_target_aliasing.GetUnaliasedSize()),
+				to_mb(m_render_target_aliasing.GetUnaliasedSize() - m_render_target_aliasing.GetAliasedSize()));
+#endif
+
+			// Nothing to share and nothing placed before, the render targets can stay where they are.
+			if (m_render_target_aliasing.GetHeaps().empty() && m_render_target_heaps.empty())
+			{
+				return;
+			}
+
+			// Make sure the GPU has finished with the render targets before moving them.
+			m_renderer->WaitForAllPreviousWork();
+
+			for (decltype(m_num_tasks) i = 0; i < m_num_tasks; ++i)
+			{
+				m_destroy_funcs[i](*this, i, true);
+			}
+
+			auto old_heaps = std::move(m_render_target_heaps);
+			m_render_target_heaps.clear();
+			for (auto const & heap : m_render_target_aliasing.GetHeaps())
+			{
+				VkMemoryRequirements memory_requirements = { heap.m_size, heap.m_alignment, heap.m_memory_type_bits };
+				m_render_target_heaps.push_back(m_renderer->CreateRenderTargetHeap(memory_requirements));
+			}
+
+			for (decltype(m_num_tasks) i = 0; i < m_num_tasks; ++i)
+			{
+				if (!requirements[i].has_value())
+				{
+					continue;
+				}
+
+				// Targets without a placement get their own memory again, they might have been in one of the old heaps.
+				auto const & placement = m_render_target_aliasing.GetPlacement(i);
+				m_render_target_states[i] = {};
+				m_barriers_dirty = true;
+				if (placement.has_value())
+				{
+					m_renderer->PlaceRenderTarget(m_render_targets[i], m_render_target_heaps[placement->m_heap], placement->m_offset);
+				}
+				else
+				{
+					m_renderer->PlaceRenderTarget(m_render_targets[i], nullptr, 0);
+				}
+			}
+
+			for (auto heap : old_heaps)
+			{
+				m_renderer->DestroyRenderTargetHeap(heap);
+			}
+
+			m_record_dependencies = true;
+			for (decltype(m_num_tasks) i = 0; i < m_num_tasks; ++i)
+			{
+				RunSetupFunc(i, true);
+			}
+			m_record_dependencies = false;
+		}
+
+		/*! Plan the barriers of the next frame from the render targets the tasks use. */
+		/*!
+			The states the frame ends in are the states the next frame starts in.
+			Once a frame ends in the states it started in the barriers stay the same until something changes.
+		*/
+		inline void PlanBarriers()
+		{
+			std::vector<bool> discard(m_num_tasks, false);
+			for (decltype(m_num_tasks) i = 0; i < m_num_tasks; ++i)
+			{
+				discard[i] = HasTransientRenderTarget(i);
+			}
+
+			// Before the task graph is compiled the tasks run in the order they got added in.
+			static const std::vector<RenderTaskHandle> no_order = {};
+			auto const & order = m_task_graph_dirty || !m_task_graph.IsCompiled() ? no_order : m_task_graph.GetOrder();
+			m_barrier_planner.Compile(order, m_accesses, m_should_execute, discard, m_render_target_states);
+
+			m_render_target_states = m_barrier_planner.GetFinalStates();
+			m_barriers_dirty = !m_barrier_planner.IsSteady();
 		}
 
 		/*! Get a free unique ID. */
@@ -997,10 +1334,12 @@ namespace fg
 		}
 
 		Renderer* m_renderer;
+		/*! The scene graph of the current `Execute`. */
+		sg::SceneGraph* m_scene_graph;
 		/*! The number of tasks we have added. */
 		std::uint32_t m_num_tasks;
-		/*! The thread pool used for multithreading */
-		util::ThreadPool* m_thread_pool;
+		/*! The job system used for multithreading */
+		util::JobSystem* m_job_system;
 
 		/*! Vectors which allow us to itterate over only single threader or only multithreaded tasks. */
 		std::vector<RenderTaskHandle> m_multi_threaded_tasks;
@@ -1016,8 +1355,13 @@ namespace fg
 		/*! Task data and the type information of the original data structure. */
 		std::vector<std::shared_ptr<void>> m_data;
 		std::vector<std::reference_wrapper<const std::type_info>> m_data_type_info;
-		/*! Task settings that can be passed to the frame graph from outside the task. */
-		std::vector<std::optional<std::any>> m_settings;
+		/*! The handle of the first task with a data type, indexed by `TypeID`. */
+		std::vector<std::optional<RenderTaskHandle>> m_handles_by_type;
+		/*! The same for the dependencies passed to `AddTask`, which only have the type information. */
+		std::unordered_map<std::type_index, RenderTaskHandle> m_handles_by_type_info;
+		/*! Task settings that can be passed to the frame graph from outside the task, and the `TypeID` of their type. */
+		std::vector<std::shared_ptr<void>> m_settings;
+		std::vector<std::optional<TypeID>> m_settings_types;
 		/*! Defines whether a task should execute or not. */
 		std::vector<bool> m_should_execute;
 		/*! Used to queue a request to change the should execute value */
@@ -1031,7 +1375,30 @@ namespace fg
 #endif
 		std::vector<RenderTaskType> m_types;
 		std::vector<std::optional<RenderTargetProperties>> m_rt_properties;
-		std::vector<std::future<void>> m_futures;
+		/*! Counts the setup of a task while it runs on the job system. */
+		std::unique_ptr<util::JobCounter[]> m_setup_jobs;
+		/*! The handles of the tasks a task depends on. Declared with `FG_DEPS` or recorded when a task looks them up. */
+		std::vector<std::vector<RenderTaskHandle>> m_predecessors;
+		/*! The render targets a task uses, its own one first. Guarded by `m_predecessors_mutex` while recording. */
+		std::vector<std::vector<ResourceAccess>> m_accesses;
+		std::mutex m_predecessors_mutex;
+		std::vector<bool> m_allow_multithreading;
+		/*! The order tasks are executed and submitted in. */
+		TaskGraph m_task_graph;
+		TaskGraph::run_func_t m_execute_task_func;
+		bool m_task_graph_dirty;
+		bool m_record_dependencies;
+		/*! Where the transient render targets live and the heaps they share. */
+		RenderTargetAliasing m_render_target_aliasing;
+		std::vector<gfx::RenderTargetHeap*> m_render_target_heaps;
+		bool m_render_target_aliasing_dirty;
+		/*! The barriers of a frame and the state the render targets are left in by the previous one. */
+		BarrierPlanner m_barrier_planner;
+		std::vector<ResourceState> m_render_target_states;
+		bool m_barriers_dirty;
+		/*! The task the current thread is running the setup or execute function of. */
+		static inline thread_local FrameGraph* m_current_graph = nullptr;
+		static inline thread_local RenderTaskHandle m_current_task = 0;
 
 		const std::uint64_t m_uid;
 		static inline std::uint64_t m_largest_uid = 0;
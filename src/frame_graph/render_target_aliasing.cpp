@@ -0,0 +1,273 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include "render_target_aliasing.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+#include "../util/log.hpp"
+
+namespace fg
+{
+
+	namespace internal
+	{
+
+		inline std::uint64_t AlignUp(std::uint64_t value, std::uint64_t alignment)
+		{
+			return (value + alignment - 1) / alignment * alignment;
+		}
+
+	} /* internal */
+
+	RenderTargetAliasing::RenderTargetAliasing()
+		: m_num_transient(0), m_num_aliased(0), m_unaliased_size(0), m_aliased_size(0)
+	{
+	}
+
+	RenderTargetAliasing::~RenderTargetAliasing()
+	{
+	}
+
+	void RenderTargetAliasing::Compile(std::vector<RenderTaskHandle> const & order, std::vector<std::vector<RenderTaskHandle>> const & predecessors,
+		std::vector<std::optional<RenderTargetMemoryRequirements>> const & requirements)
+	{
+		auto num_tasks = static_cast<std::uint32_t>(requirements.size());
+		m_placements.assign(num_tasks, std::nullopt);
+		m_first_use.assign(num_tasks, 0);
+		m_last_use.assign(num_tasks, 0);
+		m_heaps.clear();
+		m_num_transient = 0;
+		m_num_aliased = 0;
+		m_unaliased_size = 0;
+		m_aliased_size = 0;
+
+		// Lifetimes in submission order. Without a complete order fall back to the order the tasks got added in.
+		std::vector<std::uint32_t> position(num_tasks);
+		std::iota(position.begin(), position.end(), 0);
+		if (order.size() == num_tasks)
+		{
+			for (std::uint32_t i = 0; i < num_tasks; i++)
+			{
+				position[order[i]] = i;
+			}
+		}
+		else if (!order.empty())
+		{
+			LOGW("The task order doesn't match the number of tasks. Using the order the tasks got added in.");
+		}
+
+		for (RenderTaskHandle handle = 0; handle < num_tasks; handle++)
+		{
+			m_first_use[handle] = position[handle];
+			m_last_use[handle] = position[handle];
+		}
+		for (RenderTaskHandle handle = 0; handle < num_tasks && handle < predecessors.size(); handle++)
+		{
+			for (auto predecessor : predecessors[handle])
+			{
+				if (predecessor < num_tasks)
+				{
+					m_last_use[predecessor] = std::max(m_last_use[predecessor], position[handle]);
+				}
+			}
+		}
+
+		std::vector<RenderTaskHandle> targets;
+		for (RenderTaskHandle handle = 0; handle < num_tasks; handle++)
+		{
+			if (requirements[handle].has_value() && requirements[handle]->m_size > 0)
+			{
+				targets.push_back(handle);
+				m_unaliased_size += requirements[handle]->m_size;
+			}
+		}
+		m_num_transient = static_cast<std::uint32_t>(targets.size());
+
+		// Largest first, so the small targets fill the gaps.
+		std::stable_sort(targets.begin(), targets.end(), [&](RenderTaskHandle a, RenderTaskHandle b)
+		{
+			return requirements[a]->m_size > requirements[b]->m_size;
+		});
+
+		auto alive_together = [this](RenderTaskHandle a, RenderTaskHandle b)
+		{
+			return m_first_use[a] <= m_last_use[b] && m_first_use[b] <= m_last_use[a];
+		};
+
+		struct Range
+		{
+			std::uint64_t m_begin;
+			std::uint64_t m_end;
+		};
+
+		std::vector<std::uint32_t> heap_of(num_tasks, 0);
+		std::vector<std::uint64_t> offset_of(num_tasks, 0);
+		std::vector<RenderTaskHandle> placed;
+		std::vector<Range> ranges;
+		for (auto handle : targets)
+		{
+			auto const & target = requirements[handle].value();
+			auto alignment = std::max<std::uint64_t>(target.m_alignment, 1);
+
+			// Find the heap the target grows the least. Only heaps it can reuse memory of are worth sharing.
+			std::optional<std::uint32_t> best_heap;
+			std::uint64_t best_offset = 0;
+			std::uint64_t best_growth = target.m_size;
+			for (std::uint32_t heap = 0; heap < m_heaps.size(); heap++)
+			{
+				if (!(m_heaps[heap].m_memory_type_bits & target.m_memory_type_bits))
+				{
+					continue;
+				}
+
+				ranges.clear();
+				for (auto other : placed)
+				{
+					if (heap_of[other] == heap && alive_together(handle, other))
+					{
+						ranges.push_back({ offset_of[other], offset_of[other] + requirements[other]->m_size });
+					}
+				}
+				std::sort(ranges.begin(), ranges.end(), [](Range const & a, Range const & b) { return a.m_begin < b.m_begin; });
+
+				std::uint64_t offset = 0;
+				for (auto const & range : ranges)
+				{
+					if (offset + target.m_size <= range.m_begin)
+					{
+						break;
+					}
+					offset = std::max(offset, internal::AlignUp(range.m_end, alignment));
+				}
+
+				auto growth = std::max(m_heaps[heap].m_size, offset + target.m_size) - m_heaps[heap].m_size;
+				if (growth < best_growth)
+				{
+					best_heap = heap;
+					best_offset = offset;
+					best_growth = growth;
+				}
+			}
+
+			if (!best_heap.has_value())
+			{
+				best_heap = static_cast<std::uint32_t>(m_heaps.size());
+				m_heaps.push_back({ 0, 1, ~0u });
+			}
+
+			auto& heap = m_heaps[best_heap.value()];
+			heap.m_size = std::max(heap.m_size, best_offset + target.m_size);
+			heap.m_alignment = std::max(heap.m_alignment, alignment);
+			heap.m_memory_type_bits &= target.m_memory_type_bits;
+
+			heap_of[handle] = best_heap.value();
+			offset_of[handle] = best_offset;
+			placed.push_back(handle);
+		}
+
+		// Drop the heaps that don't share anything.
+		std::vector<std::uint32_t> num_targets(m_heaps.size(), 0);
+		for (auto handle : placed)
+		{
+			num_targets[heap_of[handle]]++;
+		}
+
+		std::vector<std::uint32_t> new_heap_idx(m_heaps.size(), 0);
+		std::vector<RenderTargetMemoryRequirements> heaps;
+		for (std::uint32_t heap = 0; heap < m_heaps.size(); heap++)
+		{
+			if (num_targets[heap] > 1)
+			{
+				new_heap_idx[heap] = static_cast<std::uint32_t>(heaps.size());
+				heaps.push_back(m_heaps[heap]);
+				m_aliased_size += m_heaps[heap].m_size;
+			}
+		}
+
+		for (auto handle : placed)
+		{
+			if (num_targets[heap_of[handle]] > 1)
+			{
+				m_placements[handle] = RenderTargetPlacement{ new_heap_idx[heap_of[handle]], offset_of[handle], false };
+			}
+			else
+			{
+				m_aliased_size += requirements[handle]->m_size;
+			}
+		}
+		m_heaps = std::move(heaps);
+
+		// Targets sharing memory with another target have to wait for it.
+		for (auto a : placed)
+		{
+			for (auto b : placed)
+			{
+				if (a == b || !m_placements[a].has_value() || !m_placements[b].has_value() || m_placements[a]->m_heap != m_placements[b]->m_heap)
+				{
+					continue;
+				}
+
+				if (offset_of[a] < offset_of[b] + requirements[b]->m_size && offset_of[b] < offset_of[a] + requirements[a]->m_size)
+				{
+					m_placements[a]->m_aliased = true;
+				}
+			}
+
+			if (m_placements[a].has_value() && m_placements[a]->m_aliased)
+			{
+				m_num_aliased++;
+			}
+		}
+	}
+
+	std::optional<RenderTargetPlacement> const & RenderTargetAliasing::GetPlacement(RenderTaskHandle handle) const
+	{
+		return m_placements[handle];
+	}
+
+	bool RenderTargetAliasing::IsAliased(RenderTaskHandle handle) const
+	{
+		return handle < m_placements.size() && m_placements[handle].has_value() && m_placements[handle]->m_aliased;
+	}
+
+	std::uint32_t RenderTargetAliasing::GetFirstUse(RenderTaskHandle handle) const
+	{
+		return m_first_use[handle];
+	}
+
+	std::uint32_t RenderTargetAliasing::GetLastUse(RenderTaskHandle handle) const
+	{
+		return m_last_use[handle];
+	}
+
+	std::vector<RenderTargetMemoryRequirements> const & RenderTargetAliasing::GetHeaps() const
+	{
+		return m_heaps;
+	}
+
+	std::uint32_t RenderTargetAliasing::GetNumTransientRenderTargets() const
+	{
+		return m_num_transient;
+	}
+
+	std::uint32_t RenderTargetAliasing::GetNumAliasedRenderTargets() const
+	{
+		return m_num_aliased;
+	}
+
+	std::uint64_t RenderTargetAliasing::GetUnaliasedSize() const
+	{
+		return m_unaliased_size;
+	}
+
+	std::uint64_t RenderTargetAliasing::GetAliasedSize() const
+	{
+		return m_aliased_size;
+	}
+
+} /* fg */
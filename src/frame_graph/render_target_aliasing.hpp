@@ -0,0 +1,86 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <vector>
+#include <optional>
+#include <cstdint>
+
+#include "task_graph.hpp"
+
+namespace fg
+{
+
+	//! The memory a render target needs. Mirrors `VkMemoryRequirements` so the planning doesn't need a device.
+	struct RenderTargetMemoryRequirements
+	{
+		std::uint64_t m_size = 0;
+		std::uint64_t m_alignment = 1;
+		std::uint32_t m_memory_type_bits = ~0u;
+	};
+
+	//! Where a transient render target lives.
+	struct RenderTargetPlacement
+	{
+		std::uint32_t m_heap = 0;
+		std::uint64_t m_offset = 0;
+		//! Shares memory with another target. The task has to wait for the previous users of the memory before writing to it.
+		bool m_aliased = false;
+	};
+
+	//! Places transient render targets that aren't alive at the same time in the same memory.
+	/*!
+		A target is alive from the task writing it up to the last task in the submission order that depends on that task.
+		Targets are placed largest first at the lowest offset of a heap that doesn't overlap a target alive at the same time.
+		Heaps that end up holding a single target are dropped, that target keeps its own allocation.
+		Doesn't know about the renderer, so it can be benchmarked without a device.
+	*/
+	class RenderTargetAliasing
+	{
+	public:
+		RenderTargetAliasing();
+		~RenderTargetAliasing();
+
+		//! Computes the lifetimes of the targets and where they go.
+		/*!
+			\param order The order the tasks get submitted in. See `TaskGraph::GetOrder`.
+			\param predecessors The tasks each task depends on.
+			\param requirements The memory of the render target of each task. `std::nullopt` for tasks without a transient render target.
+		*/
+		void Compile(std::vector<RenderTaskHandle> const & order, std::vector<std::vector<RenderTaskHandle>> const & predecessors,
+			std::vector<std::optional<RenderTargetMemoryRequirements>> const & requirements);
+
+		//! The placement of the render target of a task. `std::nullopt` when it keeps its own allocation.
+		std::optional<RenderTargetPlacement> const & GetPlacement(RenderTaskHandle handle) const;
+		//! Whether the render target of a task shares memory with another one. False for tasks that weren't compiled.
+		bool IsAliased(RenderTaskHandle handle) const;
+		//! Position in the submission order of the first and last task using the render target of a task.
+		std::uint32_t GetFirstUse(RenderTaskHandle handle) const;
+		std::uint32_t GetLastUse(RenderTaskHandle handle) const;
+		//! The size, alignment and allowed memory types of every heap.
+		std::vector<RenderTargetMemoryRequirements> const & GetHeaps() const;
+
+		std::uint32_t GetNumTransientRenderTargets() const;
+		std::uint32_t GetNumAliasedRenderTargets() const;
+		//! Bytes the transient render targets need with their own allocations.
+		std::uint64_t GetUnaliasedSize() const;
+		//! Bytes the transient render targets need with the heaps, including the ones keeping their own allocation.
+		std::uint64_t GetAliasedSize() const;
+
+	private:
+		std::vector<std::optional<RenderTargetPlacement>> m_placements;
+		std::vector<std::uint32_t> m_first_use;
+		std::vector<std::uint32_t> m_last_use;
+		std::vector<RenderTargetMemoryRequirements> m_heaps;
+
+		std::uint32_t m_num_transient;
+		std::uint32_t m_num_aliased;
+		std::uint64_t m_unaliased_size;
+		std::uint64_t m_aliased_size;
+	};
+
+} /* fg */
@@ -0,0 +1,251 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include "task_graph.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <thread>
+
+#include "../util/log.hpp"
+
+namespace fg
+{
+
+	TaskGraph::TaskGraph()
+		: m_compiled(false), m_num_tasks(0), m_num_levels(0), m_job_system(nullptr), m_should_execute(nullptr), m_run(nullptr), m_num_unfinished(0)
+	{
+	}
+
+	TaskGraph::~TaskGraph()
+	{
+	}
+
+	void TaskGraph::Compile(std::vector<std::vector<RenderTaskHandle>> const & predecessors, std::vector<bool> const & allow_multithreading)
+	{
+		m_num_tasks = static_cast<std::uint32_t>(predecessors.size());
+		m_allow_multithreading = allow_multithreading;
+		m_levels.assign(m_num_tasks, 0);
+		m_num_predecessors.assign(m_num_tasks, 0);
+		m_successor_offsets.assign(m_num_tasks + 1ull, 0);
+		m_roots.clear();
+		m_num_levels = m_num_tasks > 0 ? 1 : 0;
+
+		// Predecessors always have a lower handle, so the handles are already a topological order.
+		// Declared and discovered dependencies can overlap, so drop the duplicates as well.
+		std::vector<std::vector<RenderTaskHandle>> edges(m_num_tasks);
+		for (RenderTaskHandle handle = 0; handle < m_num_tasks; handle++)
+		{
+			auto& task_edges = edges[handle];
+			for (auto predecessor : predecessors[handle])
+			{
+				if (predecessor >= handle)
+				{
+					LOGW("Task {} depends on task {} which isn't a predecessor. Ignoring the dependency.", handle, predecessor);
+					continue;
+				}
+
+				if (std::find(task_edges.begin(), task_edges.end(), predecessor) == task_edges.end())
+				{
+					task_edges.push_back(predecessor);
+				}
+			}
+
+			for (auto predecessor : task_edges)
+			{
+				m_levels[handle] = std::max(m_levels[handle], m_levels[predecessor] + 1);
+				m_successor_offsets[predecessor + 1ull]++;
+			}
+			m_num_predecessors[handle] = static_cast<std::uint32_t>(task_edges.size());
+
+			m_num_levels = std::max(m_num_levels, m_levels[handle] + 1);
+			if (task_edges.empty())
+			{
+				m_roots.push_back(handle);
+			}
+		}
+
+		// Flatten the successors.
+		for (RenderTaskHandle handle = 0; handle < m_num_tasks; handle++)
+		{
+			m_successor_offsets[handle + 1ull] += m_successor_offsets[handle];
+		}
+		m_successors.resize(m_successor_offsets[m_num_tasks]);
+		std::vector<std::uint32_t> next_successor(m_successor_offsets.begin(), m_successor_offsets.end() - 1);
+		for (RenderTaskHandle handle = 0; handle < m_num_tasks; handle++)
+		{
+			for (auto predecessor : edges[handle])
+			{
+				m_successors[next_successor[predecessor]++] = handle;
+			}
+		}
+
+		// Sort by level, keeping the order the tasks were added in within a level.
+		m_order.resize(m_num_tasks);
+		std::vector<std::uint32_t> level_offsets(m_num_levels + 1ull, 0);
+		for (auto level : m_levels)
+		{
+			level_offsets[level + 1ull]++;
+		}
+		for (std::uint32_t level = 0; level < m_num_levels; level++)
+		{
+			level_offsets[level + 1ull] += level_offsets[level];
+		}
+		for (RenderTaskHandle handle = 0; handle < m_num_tasks; handle++)
+		{
+			m_order[level_offsets[m_levels[handle]]++] = handle;
+		}
+
+		m_remaining_predecessors = std::make_unique<std::atomic<std::uint32_t>[]>(m_num_tasks);
+		m_finished = std::make_unique<std::atomic<bool>[]>(m_num_tasks);
+		for (RenderTaskHandle handle = 0; handle < m_num_tasks; handle++)
+		{
+			m_finished[handle].store(true);
+		}
+
+		m_compiled = true;
+	}
+
+	void TaskGraph::Execute(util::JobSystem* job_system, std::vector<bool> const & should_execute, run_func_t const & run)
+	{
+		if (!job_system)
+		{
+			for (auto handle : m_order)
+			{
+				if (should_execute[handle])
+				{
+					run(handle);
+				}
+			}
+
+			return;
+		}
+
+		m_job_system = job_system;
+		m_should_execute = &should_execute;
+		m_run = &run;
+
+		for (RenderTaskHandle handle = 0; handle < m_num_tasks; handle++)
+		{
+			m_remaining_predecessors[handle].store(m_num_predecessors[handle], std::memory_order_relaxed);
+			m_finished[handle].store(false, std::memory_order_relaxed);
+		}
+		m_num_unfinished.store(m_num_tasks, std::memory_order_relaxed);
+
+		for (auto handle : m_roots)
+		{
+			Dispatch(handle);
+		}
+
+		// Run the tasks that have to stay on this thread and help with the others until everything finished.
+		// Waiting for the jobs as well makes sure no worker touches the graph anymore after returning.
+		while (true)
+		{
+			std::optional<RenderTaskHandle> main_thread_task;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (!m_main_thread_tasks.empty())
+				{
+					main_thread_task = m_main_thread_tasks.front();
+					m_main_thread_tasks.pop();
+				}
+			}
+
+			if (main_thread_task.has_value())
+			{
+				run(main_thread_task.value());
+				Finish(main_thread_task.value());
+			}
+			else if (m_num_unfinished.load(std::memory_order_acquire) == 0 && m_jobs.m_value.load(std::memory_order_acquire) == 0)
+			{
+				break;
+			}
+			else if (!m_job_system->TryRunJob())
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	void TaskGraph::Wait(RenderTaskHandle handle) const
+	{
+		if (handle >= m_num_tasks)
+		{
+			return;
+		}
+
+		while (!m_finished[handle].load(std::memory_order_acquire))
+		{
+			if (!m_job_system->TryRunJob())
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	std::vector<RenderTaskHandle> const & TaskGraph::GetOrder() const
+	{
+		return m_order;
+	}
+
+	std::uint32_t TaskGraph::GetLevel(RenderTaskHandle handle) const
+	{
+		return m_levels[handle];
+	}
+
+	std::uint32_t TaskGraph::GetNumLevels() const
+	{
+		return m_num_levels;
+	}
+
+	std::uint32_t TaskGraph::GetNumTasks() const
+	{
+		return m_num_tasks;
+	}
+
+	bool TaskGraph::IsCompiled() const
+	{
+		return m_compiled;
+	}
+
+	void TaskGraph::Dispatch(RenderTaskHandle handle)
+	{
+		if (!(*m_should_execute)[handle])
+		{
+			Finish(handle);
+		}
+		else if (m_allow_multithreading[handle])
+		{
+			m_job_system->Run([this, handle]
+			{
+				(*m_run)(handle);
+				Finish(handle);
+			}, m_jobs);
+		}
+		else
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_main_thread_tasks.push(handle);
+		}
+	}
+
+	void TaskGraph::Finish(RenderTaskHandle handle)
+	{
+		m_finished[handle].store(true, std::memory_order_release);
+
+		for (auto i = m_successor_offsets[handle]; i < m_successor_offsets[handle + 1ull]; i++)
+		{
+			auto successor = m_successors[i];
+			if (m_remaining_predecessors[successor].fetch_sub(1, std::memory_order_acq_rel) == 1)
+			{
+				Dispatch(successor);
+			}
+		}
+
+		m_num_unfinished.fetch_sub(1, std::memory_order_acq_rel);
+	}
+
+} /* fg */
@@ -0,0 +1,101 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+
+#include "../util/job_system.hpp"
+#include "../util/delegate.hpp"
+
+namespace fg
+{
+
+	//! Typedef for the render task handle.
+	using RenderTaskHandle = std::uint32_t;
+
+	//! The dependencies between the tasks of a frame graph compiled into a levelled DAG.
+	/*!
+		A task is on level 0 when it has no predecessors, otherwise it is one level below its deepest predecessor.
+		Tasks on the same level don't depend on each other. `Execute` dispatches every task as soon as its last predecessor finished,
+		so independent chains don't wait on each other like they would when running level by level.
+		Doesn't know about the renderer, so it can be benchmarked without a device.
+	*/
+	class TaskGraph
+	{
+	public:
+		using run_func_t = util::Delegate<void(RenderTaskHandle)>;
+
+		TaskGraph();
+		~TaskGraph();
+
+		TaskGraph(const TaskGraph&) = delete;
+		TaskGraph(TaskGraph&&) = delete;
+
+		TaskGraph& operator=(const TaskGraph&) = delete;
+		TaskGraph& operator=(TaskGraph&&) = delete;
+
+		//! Compiles the graph.
+		/*!
+			\param predecessors The tasks each task depends on. Predecessors need a lower handle than the task, others are ignored.
+			\param allow_multithreading Whether a task may run on the job system. Other tasks run on the thread calling `Execute`.
+		*/
+		void Compile(std::vector<std::vector<RenderTaskHandle>> const & predecessors, std::vector<bool> const & allow_multithreading);
+
+		//! Runs `run` for every task that should execute and returns when all of them finished.
+		/*!
+			A task is dispatched when all its predecessors finished. Tasks that shouldn't execute finish right away so their successors still run.
+			The calling thread runs jobs as well while waiting. Without a job system all tasks run on the calling thread in the compiled order.
+		*/
+		void Execute(util::JobSystem* job_system, std::vector<bool> const & should_execute, run_func_t const & run);
+
+		//! Runs other jobs until a task of the current `Execute` finished. Returns immediately when nothing is executing.
+		void Wait(RenderTaskHandle handle) const;
+
+		//! All tasks sorted by level. Tasks on the same level keep the order they got added in.
+		std::vector<RenderTaskHandle> const & GetOrder() const;
+		std::uint32_t GetLevel(RenderTaskHandle handle) const;
+		std::uint32_t GetNumLevels() const;
+		std::uint32_t GetNumTasks() const;
+		bool IsCompiled() const;
+
+	private:
+		void Dispatch(RenderTaskHandle handle);
+		void Finish(RenderTaskHandle handle);
+
+		bool m_compiled;
+		std::uint32_t m_num_tasks;
+		std::uint32_t m_num_levels;
+
+		std::vector<RenderTaskHandle> m_order;
+		std::vector<std::uint32_t> m_levels;
+		std::vector<std::uint32_t> m_num_predecessors;
+		std::vector<RenderTaskHandle> m_roots;
+		// The successors of task i are `m_successors[m_successor_offsets[i]]` up to `m_successors[m_successor_offsets[i + 1]]`.
+		std::vector<std::uint32_t> m_successor_offsets;
+		std::vector<RenderTaskHandle> m_successors;
+		std::vector<bool> m_allow_multithreading;
+
+		// State of the current `Execute`.
+		util::JobSystem* m_job_system;
+		std::vector<bool> const * m_should_execute;
+		run_func_t const * m_run;
+		std::unique_ptr<std::atomic<std::uint32_t>[]> m_remaining_predecessors;
+		std::unique_ptr<std::atomic<bool>[]> m_finished;
+		std::atomic<std::uint32_t> m_num_unfinished;
+		util::JobCounter m_jobs;
+
+		// Tasks that don't allow multithreading, waiting for the thread that called `Execute`.
+		std::mutex m_mutex;
+		std::queue<RenderTaskHandle> m_main_thread_tasks;
+	};
+
+} /* fg */
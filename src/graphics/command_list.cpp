@@ -590,6 +590,47 @@ void gfx::CommandList::TransitionRenderTarget(RenderTarget* render_target, std::
 	);
 }
 
+void gfx::CommandList::PipelineBarrier(VkPipelineStageFlags src_stages, VkPipelineStageFlags dst_stages, VkAccessFlags src_access, VkAccessFlags dst_access,
+	std::vector<RenderTargetBarrier> const & transitions)
+{
+	m_image_barriers.clear();
+	for (auto const & transition : transitions)
+	{
+		auto render_target = transition.m_render_target;
+		for (auto image : render_target->m_images)
+		{
+			VkImageMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.oldLayout = transition.m_from;
+			barrier.newLayout = transition.m_to;
+			barrier.srcAccessMask = transition.m_src_access;
+			barrier.dstAccessMask = transition.m_dst_access;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = image;
+			barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			barrier.subresourceRange.baseMipLevel = 0;
+			barrier.subresourceRange.levelCount = render_target->m_desc.m_mip_levels;
+			barrier.subresourceRange.baseArrayLayer = 0;
+			barrier.subresourceRange.layerCount = render_target->m_desc.m_is_cube_map ? 6 : 1;
+
+			m_image_barriers.push_back(barrier);
+		}
+	}
+
+	VkMemoryBarrier memory_barrier = {};
+	memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	memory_barrier.srcAccessMask = src_access;
+	memory_barrier.dstAccessMask = dst_access;
+	auto num_memory_barriers = src_access || dst_access ? 1u : 0u;
+
+	vkCmdPipelineBarrier(m_cmd_buffers[m_frame_idx],
+	                     src_stages, dst_stages, 0,
+	                     num_memory_barriers, &memory_barrier,
+	                     0, nullptr,
+	                     static_cast<std::uint32_t>(m_image_barriers.size()), m_image_barriers.data());
+}
+
 // Note that it transitions it to `VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL`
 void gfx::CommandList::GenerateMipMap(gfx::Texture* texture)
 {
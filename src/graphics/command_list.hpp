@@ -28,6 +28,16 @@ namespace gfx
 	class Texture;
 	class ShaderTable;
 
+	//! A layout transition of every image of a render target. See `CommandList::PipelineBarrier`.
+	struct RenderTargetBarrier
+	{
+		RenderTarget* m_render_target;
+		VkImageLayout m_from;
+		VkImageLayout m_to;
+		VkAccessFlags m_src_access;
+		VkAccessFlags m_dst_access;
+	};
+
 	class CommandList
 	{
 		friend class RenderWindow;
@@ -59,6 +69,9 @@ namespace gfx
 		void TransitionTexture(StagingTexture* texture, VkImageLayout from, VkImageLayout to);
 		void TransitionRenderTarget(RenderTarget* render_target, VkImageLayout from, VkImageLayout to);
 		void TransitionRenderTarget(RenderTarget* render_target, std::uint32_t rt_idx, VkImageLayout from, VkImageLayout to);
+		//! Records the transitions and a memory barrier as a single `vkCmdPipelineBarrier`. The memory barrier is left out when both access masks are 0.
+		void PipelineBarrier(VkPipelineStageFlags src_stages, VkPipelineStageFlags dst_stages, VkAccessFlags src_access, VkAccessFlags dst_access,
+			std::vector<RenderTargetBarrier> const & transitions);
 		void GenerateMipMap(gfx::Texture* texture);
 		void GenerateMipMap(gfx::RenderTarget* render_target);
 		void GenerateMipMap(VkImage& image, VkFormat format, std::int32_t width, std::int32_t height, std::uint32_t mip_levels, std::uint32_t layers);
@@ -82,6 +95,8 @@ namespace gfx
 
 		std::uint32_t m_frame_idx;
 		VkPipelineBindPoint m_current_bind_point;
+
+		std::vector<VkImageMemoryBarrier> m_image_barriers; // Reused by `PipelineBarrier`.
 	};
 
 } /* gfx */
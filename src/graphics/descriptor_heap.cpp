@@ -20,11 +20,13 @@ gfx::DescriptorHeap::DescriptorHeap(Context* context, Desc desc)
 	m_descriptor_pools.resize(desc.m_versions);
 
 	// Create the descriptor pool
-	std::vector<VkDescriptorPoolSize> pool_sizes(2);
+	std::vector<VkDescriptorPoolSize> pool_sizes(3);
 	pool_sizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 	pool_sizes[0].descriptorCount = desc.m_num_descriptors; // TODO: This wastes space. But gets us closer to DX12 behaviour
 	pool_sizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 	pool_sizes[1].descriptorCount =  desc.m_num_descriptors; // TODO: This wastes space. But gets us closer to DX12 behaviour
+	pool_sizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	pool_sizes[2].descriptorCount = desc.m_num_descriptors; // TODO: This wastes space. But gets us closer to DX12 behaviour
 
 	m_descriptor_pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 	m_descriptor_pool_create_info.poolSizeCount = pool_sizes.size();
@@ -68,7 +70,8 @@ VkDescriptorSet gfx::DescriptorHeap::GetDescriptorSet(std::uint32_t frame_idx, s
 	return m_descriptor_sets[frame_idx % m_desc.m_versions][handle];
 }
 
-std::uint32_t gfx::DescriptorHeap::CreateSRVSetFromCB(std::vector<GPUBuffer*> buffers, VkDescriptorSetLayout layout, std::uint32_t handle, std::uint32_t frame_idx, enums::BufferDescType type)
+std::uint32_t gfx::DescriptorHeap::CreateSRVSetFromCB(std::vector<GPUBuffer*> buffers, VkDescriptorSetLayout layout, std::uint32_t handle, std::uint32_t frame_idx, enums::BufferDescType type,
+	std::vector<std::pair<std::uint64_t, std::uint64_t>> const & offset_sizes)
 {
 	auto logical_device = m_context->m_logical_device;
 
@@ -88,12 +91,12 @@ std::uint32_t gfx::DescriptorHeap::CreateSRVSetFromCB(std::vector<GPUBuffer*> bu
 	auto descriptor_set_id = m_descriptor_sets[frame_idx].size() - 1;
 
 	std::vector<VkDescriptorBufferInfo> buffer_infos;
-	for (auto const& buffer : buffers)
+	for (std::size_t i = 0; i < buffers.size(); i++)
 	{
 		VkDescriptorBufferInfo buffer_info = {};
-		buffer_info.buffer = buffer->m_buffer;
-		buffer_info.offset = 0;
-		buffer_info.range = buffer->m_size;
+		buffer_info.buffer = buffers[i]->m_buffer;
+		buffer_info.offset = offset_sizes.empty() ? 0 : offset_sizes[i].first;
+		buffer_info.range = offset_sizes.empty() ? buffers[i]->m_size : offset_sizes[i].second;
 
 		buffer_infos.push_back(buffer_info);
 	}
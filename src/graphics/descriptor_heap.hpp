@@ -62,7 +62,9 @@ namespace gfx
 
 		VkDescriptorSet GetDescriptorSet(std::uint32_t frame_idx, std::uint32_t handle);
 
-		std::uint32_t CreateSRVSetFromCB(std::vector<GPUBuffer*> buffers, VkDescriptorSetLayout layout, std::uint32_t handle, std::uint32_t frame_idx, enums::BufferDescType type = enums::BufferDescType::UNIFORM);
+		//! `offset_sizes` is either empty to bind the buffers entirely or contains a offset and size per buffer.
+		std::uint32_t CreateSRVSetFromCB(std::vector<GPUBuffer*> buffers, VkDescriptorSetLayout layout, std::uint32_t handle, std::uint32_t frame_idx, enums::BufferDescType type = enums::BufferDescType::UNIFORM,
+			std::vector<std::pair<std::uint64_t, std::uint64_t>> const & offset_sizes = {});
 		std::uint32_t CreateSRVFromCB(GPUBuffer* buffer, VkDescriptorSetLayout layout, std::uint32_t handle, std::uint32_t frame_idx, enums::BufferDescType type = enums::BufferDescType::UNIFORM, std::optional<std::pair<std::uint64_t, std::uint64_t>> offset_size = std::nullopt);
 		std::uint32_t CreateSRVFromCB(GPUBuffer* buffer, RootSignature* root_signature, std::uint32_t handle, std::uint32_t frame_idx, enums::BufferDescType type = enums::BufferDescType::UNIFORM, std::optional<std::pair<std::uint64_t, std::uint64_t>> offset_size = std::nullopt);
 		std::uint32_t CreateSRVFromAS(AccelerationStructure* as, RootSignature* root_signature, std::uint32_t handle, std::uint32_t frame_idx);
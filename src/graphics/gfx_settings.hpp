@@ -34,7 +34,9 @@ namespace gfx::settings
 	static const VkColorSpaceKHR swapchain_color_space = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
 	static const VkCullModeFlags cull_mode = VK_CULL_MODE_NONE;
 	static const std::uint32_t max_lights = 25;
-	static const std::uint32_t max_render_batch_size = 700;
+	static const std::uint32_t instances_per_page = 1024; //!< Instances per storage buffer page of a render batch. Every page is a draw.
+	static const std::uint32_t max_instance_pages = 1024;
+	static const bool suballocate_constant_buffers = true; //!< Place all buffers of a constant buffer pool in one buffer per frame and only flush what changed.
 	static const std::uint32_t max_num_rtx_materials = 2000;
 	static const std::uint32_t max_num_rtx_textures = 100;
 }
@@ -22,14 +22,14 @@ constexpr inline T SizeAlignAnyAlignment(T size, A alignment)
 	return (size / alignment + (size % alignment > 0)) * alignment;
 }
 
-gfx::MemoryPool::MemoryPool(Context* context, std::size_t block_size, std::size_t num_blocks)
+gfx::MemoryPool::MemoryPool(Context* context, std::size_t block_size, std::size_t num_blocks, enums::BufferUsageFlag usage)
 	: m_context(context), m_block_size(block_size), m_num_blocks(num_blocks)
 {
 	auto vma_allocator = context->m_vma_allocator;
 
 	VkBufferCreateInfo exampleBufCreateInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
 	exampleBufCreateInfo.size = block_size;
-	exampleBufCreateInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	exampleBufCreateInfo.usage = (int)usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
 	VmaAllocationCreateInfo allocCreateInfo = {};
 	allocCreateInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
 	uint32_t memTypeIndex;
@@ -25,7 +25,7 @@ namespace gfx
 		friend class GPUBuffer;
 		friend class Texture;
 	public:
-		MemoryPool(Context* context, std::size_t block_size, std::size_t num_blocks);
+		MemoryPool(Context* context, std::size_t block_size, std::size_t num_blocks, enums::BufferUsageFlag usage = enums::BufferUsageFlag::CONSTANT_BUFFER);
 		~MemoryPool();
 
 	private:
@@ -7,17 +7,52 @@
 #include "render_target.hpp"
 
 #include <stdexcept>
+#include <algorithm>
 
 #include "context.hpp"
 #include "gfx_defines.hpp"
 #include "../util/log.hpp"
 
+template<typename T, typename A>
+constexpr inline T SizeAlignAnyAlignment(T size, A alignment)
+{
+	return (size / alignment + (size % alignment > 0)) * alignment;
+}
+
+gfx::RenderTargetHeap::RenderTargetHeap(Context* context, VkMemoryRequirements const & requirements)
+	: m_context(context), m_allocation(VK_NULL_HANDLE), m_memory(VK_NULL_HANDLE), m_offset(0), m_size(requirements.size)
+{
+	VmaAllocationCreateInfo alloc_create_info = {};
+	alloc_create_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+	alloc_create_info.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+
+	VmaAllocationInfo alloc_info = {};
+	if (vmaAllocateMemory(m_context->m_vma_allocator, &requirements, &alloc_create_info, &m_allocation, &alloc_info) != VK_SUCCESS)
+	{
+		LOGC("Failed to allocate render target heap memory");
+	}
+
+	// Images get bound to the device memory directly, the allocation doesn't have to start at the beginning of it.
+	m_memory = alloc_info.deviceMemory;
+	m_offset = alloc_info.offset;
+}
+
+gfx::RenderTargetHeap::~RenderTargetHeap()
+{
+	vmaFreeMemory(m_context->m_vma_allocator, m_allocation);
+}
+
+VkDeviceSize gfx::RenderTargetHeap::GetSize()
+{
+	return m_size;
+}
+
 gfx::RenderTarget::RenderTarget(Context* context)
 	: m_context(context), m_subpass(),
 	m_render_pass(VK_NULL_HANDLE), m_render_pass_create_info(),
 	m_depth_buffer_create_info(), m_depth_buffer(VK_NULL_HANDLE),
 	m_depth_buffer_memory(VK_NULL_HANDLE), m_depth_buffer_view(VK_NULL_HANDLE),
-	m_desc()
+	m_desc(), m_heap(nullptr), m_heap_offset(0), m_heap_cursor(0)
 {
 
 }
@@ -27,22 +62,9 @@ gfx::RenderTarget::RenderTarget(Context* context, Desc desc)
 		  m_render_pass(VK_NULL_HANDLE), m_render_pass_create_info(),
 		  m_depth_buffer_create_info(), m_depth_buffer(VK_NULL_HANDLE),
 		  m_depth_buffer_memory(VK_NULL_HANDLE), m_depth_buffer_view(VK_NULL_HANDLE),
-		  m_desc(desc)
+		  m_desc(desc), m_heap(nullptr), m_heap_offset(0), m_heap_cursor(0)
 {
-	CreateImages();
-	CreateImageViews();
-
-	if (desc.m_depth_format != VK_FORMAT_UNDEFINED)
-	{
-		CreateDepthBuffer();
-		CreateDepthBufferView();
-	}
-
-	if (!desc.m_allow_uav)
-	{
-		CreateRenderPass();
-		CreateFrameBuffers();
-	}
+	CreateResources();
 }
 
 gfx::RenderTarget::~RenderTarget()
@@ -52,28 +74,17 @@ gfx::RenderTarget::~RenderTarget()
 
 void gfx::RenderTarget::Resize(std::uint32_t width, std::uint32_t height)
 {
-	auto logical_device = m_context->m_logical_device;
 	m_desc.m_width = width;
 	m_desc.m_height = height;
 
 	// Destroy old resources
 	Cleanup();
 
-	// Recreate stuff TODO: This is all duplicate from the cosntructor
-	CreateImages();
-	CreateImageViews();
+	// The heap was sized for the old resolution. The owner of the heap has to place the render target again.
+	m_heap = nullptr;
+	m_heap_offset = 0;
 
-	if (m_desc.m_depth_format != VK_FORMAT_UNDEFINED)
-	{
-		CreateDepthBuffer();
-		CreateDepthBufferView();
-	}
-
-	if (!m_desc.m_allow_uav)
-	{
-		CreateRenderPass();
-		CreateFrameBuffers();
-	}
+	CreateResources();
 }
 
 std::uint32_t gfx::RenderTarget::GetWidth()
@@ -91,6 +102,68 @@ std::uint32_t gfx::RenderTarget::GetMipLevels()
 	return m_desc.m_mip_levels;
 }
 
+VkMemoryRequirements gfx::RenderTarget::GetMemoryRequirements()
+{
+	auto logical_device = m_context->m_logical_device;
+
+	// Same layout as `AllocateImageMemory` places the images in: the color images followed by the depth buffer.
+	std::vector<VkImage> images = m_images;
+	if (m_desc.m_depth_format != VK_FORMAT_UNDEFINED)
+	{
+		images.push_back(m_depth_buffer);
+	}
+
+	VkMemoryRequirements requirements = {};
+	requirements.alignment = 1;
+	requirements.memoryTypeBits = ~0u;
+	for (auto image : images)
+	{
+		VkMemoryRequirements image_requirements;
+		vkGetImageMemoryRequirements(logical_device, image, &image_requirements);
+
+		requirements.size = SizeAlignAnyAlignment(requirements.size, image_requirements.alignment) + image_requirements.size;
+		requirements.alignment = std::max(requirements.alignment, image_requirements.alignment);
+		requirements.memoryTypeBits &= image_requirements.memoryTypeBits;
+	}
+
+	return requirements;
+}
+
+void gfx::RenderTarget::Place(RenderTargetHeap* heap, VkDeviceSize offset)
+{
+	Cleanup();
+
+	m_heap = heap;
+	m_heap_offset = heap ? offset : 0;
+
+	CreateResources();
+}
+
+bool gfx::RenderTarget::IsPlaced()
+{
+	return m_heap != nullptr;
+}
+
+void gfx::RenderTarget::CreateResources()
+{
+	m_heap_cursor = 0;
+
+	CreateImages();
+	CreateImageViews();
+
+	if (m_desc.m_depth_format != VK_FORMAT_UNDEFINED)
+	{
+		CreateDepthBuffer();
+		CreateDepthBufferView();
+	}
+
+	if (!m_desc.m_allow_uav)
+	{
+		CreateRenderPass();
+		CreateFrameBuffers();
+	}
+}
+
 void gfx::RenderTarget::CreateImages()
 {
 	auto num_rtvs = m_desc.m_rtv_formats.size();
@@ -125,21 +198,7 @@ void gfx::RenderTarget::CreateImages()
 			LOGC("Failed to create texture");
 		}
 
-		VkMemoryRequirements memory_requirements;
-		vkGetImageMemoryRequirements(logical_device, m_images[i], &memory_requirements);
-
-		VkMemoryAllocateInfo alloc_info = {};
-		alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		alloc_info.allocationSize = memory_requirements.size;
-		alloc_info.memoryTypeIndex = m_context->FindMemoryType(memory_requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-		if (vkAllocateMemory(logical_device, &alloc_info, nullptr, &m_images_memory[i]) != VK_SUCCESS)
-		{
-			LOGC("failed to allocate image memory!");
-		}
-		VK_NAME_OBJ_DEF(logical_device, m_images_memory[i], VK_DEBUG_REPORT_OBJECT_TYPE_DEVICE_MEMORY_EXT)
-
-		vkBindImageMemory(logical_device, m_images[i], m_images_memory[i], 0);
+		AllocateImageMemory(m_images[i], m_images_memory[i]);
 	}
 }
 
@@ -199,7 +258,7 @@ void gfx::RenderTarget::CreateFrameBuffers()
 	}
 }
 
-void gfx::RenderTarget::CreateRenderPass()
+void gfx::RenderTarget::CreateRenderPass(VkImageLayout final_layout)
 {
 	auto logical_device = m_context->m_logical_device;
 
@@ -219,7 +278,7 @@ void gfx::RenderTarget::CreateRenderPass()
 		color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
 		color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_STORE;
 		color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		color_attachment.finalLayout = final_layout;
 
 		color_attachments.push_back(color_attachment);
 
@@ -312,21 +371,7 @@ void gfx::RenderTarget::CreateDepthBuffer()
 		throw std::runtime_error("failed to create image!");
 	}
 
-	VkMemoryRequirements memory_requirements;
-	vkGetImageMemoryRequirements(logical_device, m_depth_buffer, &memory_requirements);
-
-	VkMemoryAllocateInfo alloc_info = {};
-	alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	alloc_info.allocationSize = memory_requirements.size;
-	alloc_info.memoryTypeIndex = m_context->FindMemoryType(memory_requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-	if (vkAllocateMemory(logical_device, &alloc_info, nullptr, &m_depth_buffer_memory) != VK_SUCCESS)
-	{
-		LOGC("failed to allocate image memory!");
-	}
-	VK_NAME_OBJ_DEF(logical_device, m_depth_buffer_memory, VK_DEBUG_REPORT_OBJECT_TYPE_DEVICE_MEMORY_EXT)
-
-	vkBindImageMemory(logical_device, m_depth_buffer, m_depth_buffer_memory, 0);
+	AllocateImageMemory(m_depth_buffer, m_depth_buffer_memory);
 
 	// Transition
 }
@@ -351,6 +396,43 @@ void gfx::RenderTarget::CreateDepthBufferView()
 	}
 }
 
+void gfx::RenderTarget::AllocateImageMemory(VkImage image, VkDeviceMemory& memory)
+{
+	auto logical_device = m_context->m_logical_device;
+
+	VkMemoryRequirements memory_requirements;
+	vkGetImageMemoryRequirements(logical_device, image, &memory_requirements);
+
+	// Placed images are bound one after another and don't own their memory.
+	if (m_heap)
+	{
+		auto offset = SizeAlignAnyAlignment(m_heap_cursor, memory_requirements.alignment);
+		m_heap_cursor = offset + memory_requirements.size;
+
+		if (m_heap_offset + m_heap_cursor > m_heap->m_size)
+		{
+			LOGC("A render target doesn't fit in the heap it got placed in.");
+		}
+
+		memory = VK_NULL_HANDLE;
+		vkBindImageMemory(logical_device, image, m_heap->m_memory, m_heap->m_offset + m_heap_offset + offset);
+		return;
+	}
+
+	VkMemoryAllocateInfo alloc_info = {};
+	alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	alloc_info.allocationSize = memory_requirements.size;
+	alloc_info.memoryTypeIndex = m_context->FindMemoryType(memory_requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	if (vkAllocateMemory(logical_device, &alloc_info, nullptr, &memory) != VK_SUCCESS)
+	{
+		LOGC("failed to allocate image memory!");
+	}
+	VK_NAME_OBJ_DEF(logical_device, memory, VK_DEBUG_REPORT_OBJECT_TYPE_DEVICE_MEMORY_EXT)
+
+	vkBindImageMemory(logical_device, image, memory, 0);
+}
+
 void gfx::RenderTarget::Cleanup()
 {
 	auto logical_device = m_context->m_logical_device;
@@ -372,7 +454,7 @@ void gfx::RenderTarget::Cleanup()
 
 	for (auto& image_memory : m_images_memory)
 	{
-		vkFreeMemory(logical_device, image_memory, nullptr);
+		if (image_memory != VK_NULL_HANDLE) vkFreeMemory(logical_device, image_memory, nullptr);
 	}
 
 	vkDestroyRenderPass(logical_device, m_render_pass, nullptr);
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
 #include <vector>
 #include <cstdint>
 
@@ -17,6 +18,24 @@ namespace gfx
 
 	class Context;
 
+	//! Device memory render targets can be placed in. Render targets that aren't used at the same time can share it.
+	class RenderTargetHeap
+	{
+		friend class RenderTarget;
+	public:
+		RenderTargetHeap(Context* context, VkMemoryRequirements const & requirements);
+		~RenderTargetHeap();
+
+		VkDeviceSize GetSize();
+
+	private:
+		Context* m_context;
+		VmaAllocation m_allocation;
+		VkDeviceMemory m_memory;
+		VkDeviceSize m_offset;
+		VkDeviceSize m_size;
+	};
+
 	class RenderTarget
 	{
 		friend class PipelineState;
@@ -47,13 +66,22 @@ namespace gfx
 		std::uint32_t GetHeight();
 		std::uint32_t GetMipLevels();
 
+		//! The memory all images of this render target need when placed in a heap.
+		VkMemoryRequirements GetMemoryRequirements();
+		//! Recreates the images in `heap` at `offset`. Without a heap the images get their own memory again.
+		/*! The images, views and frame buffers get recreated, so descriptors of the old ones have to be recreated as well. */
+		void Place(RenderTargetHeap* heap, VkDeviceSize offset);
+		bool IsPlaced();
+
 	protected:
+		void CreateResources();
 		void CreateImages();
 		void CreateImageViews();
 		void CreateFrameBuffers();
-		void CreateRenderPass();
+		void CreateRenderPass(VkImageLayout final_layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
 		void CreateDepthBuffer();
 		void CreateDepthBufferView();
+		void AllocateImageMemory(VkImage image, VkDeviceMemory& memory);
 		void Cleanup();
 
 		Context* m_context;
@@ -73,6 +101,11 @@ namespace gfx
 		VkDeviceMemory m_depth_buffer_memory;
 		VkImageView m_depth_buffer_view;
 		Desc m_desc;
+
+		// Placement
+		RenderTargetHeap* m_heap;
+		VkDeviceSize m_heap_offset;
+		VkDeviceSize m_heap_cursor; // Offset of the next image relative to `m_heap_offset`.
 	};
 
 } /* gfx */
\ No newline at end of file
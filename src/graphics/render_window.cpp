@@ -33,7 +33,7 @@ gfx::RenderWindow::RenderWindow(Context* context)
 	CreateDepthBuffer();
 	CreateDepthBufferView();
 
-	CreateRenderPass();
+	CreateRenderPass(VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
 
 	CreateSwapchainFrameBuffers();
 }
@@ -118,7 +118,7 @@ void gfx::RenderWindow::Resize(std::uint32_t width, std::uint32_t height)
 	CreateDepthBuffer();
 	CreateDepthBufferView();
 
-	CreateRenderPass();
+	CreateRenderPass(VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
 
 	CreateSwapchainFrameBuffers();
 
@@ -12,8 +12,10 @@
 #include "gpu_buffers.hpp"
 #include "../util/log.hpp"
 
-gfx::VkConstantBufferPool::VkConstantBufferPool(Context* context, std::size_t buffer_size, std::size_t num_buffers, std::uint32_t binding, VkShaderStageFlags flags)
-	: m_context(context), m_binding(binding), m_cb_set_layout(VK_NULL_HANDLE), m_desc_heap(nullptr)
+gfx::VkConstantBufferPool::VkConstantBufferPool(Context* context, std::size_t buffer_size, std::size_t num_buffers, std::uint32_t binding, VkShaderStageFlags flags, enums::BufferDescType type,
+	bool suballocate)
+	: m_context(context), m_binding(binding), m_type(type), m_cb_set_layout(VK_NULL_HANDLE), m_desc_heap(nullptr), m_pool(nullptr), m_suballocate(suballocate),
+	m_buffer_size(buffer_size), m_slot_size(buffer_size), m_num_buffers(num_buffers)
 {
 	auto logical_device = context->m_logical_device;
 
@@ -22,14 +24,33 @@ gfx::VkConstantBufferPool::VkConstantBufferPool(Context* context, std::size_t bu
 	descriptor_heap_desc.m_num_descriptors = num_buffers;
 	m_desc_heap = new gfx::DescriptorHeap(m_context, descriptor_heap_desc);
 
-	m_pool = new MemoryPool(m_context, buffer_size, num_buffers * gfx::settings::num_back_buffers);
+	if (m_suballocate)
+	{
+		auto limits = context->GetPhysicalDeviceProperties().properties.limits;
+		auto alignment = m_type == enums::BufferDescType::STORAGE ? limits.minStorageBufferOffsetAlignment : limits.minUniformBufferOffsetAlignment;
+		alignment = std::max(alignment, limits.nonCoherentAtomSize);
+		m_slot_size = (buffer_size + alignment - 1) / alignment * alignment;
+
+		for (std::uint32_t frame_idx = 0; frame_idx < gfx::settings::num_back_buffers; frame_idx++)
+		{
+			auto buffer = new gfx::GPUBuffer(m_context, std::nullopt, m_slot_size * num_buffers, GetBufferUsage());
+			buffer->Map();
+			m_frame_buffers.push_back(buffer);
+		}
+		// Flushes get rounded to whole atoms anyway, so track dirty memory in blocks of at least a atom.
+		m_dirty_ranges.resize(gfx::settings::num_back_buffers, util::DirtyRanges(alignment));
+	}
+	else
+	{
+		m_pool = new MemoryPool(m_context, buffer_size, num_buffers * gfx::settings::num_back_buffers, GetBufferUsage());
+	}
 
 	m_buffers.resize(gfx::settings::num_back_buffers);
 
 	// TODO: make this entire layout static and use it when creating root signatures.
 	std::vector<VkDescriptorSetLayoutBinding> parameters(1);
 	parameters[0].binding = m_binding;
-	parameters[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	parameters[0].descriptorType = VkDescriptorType(m_type);
 	parameters[0].descriptorCount = 1;
 	parameters[0].stageFlags = flags;
 	parameters[0].pImmutableSamplers = nullptr;
@@ -58,6 +79,12 @@ gfx::VkConstantBufferPool::~VkConstantBufferPool()
 		}
 	}
 
+	for (auto & buffer : m_frame_buffers)
+	{
+		buffer->Unmap();
+		delete buffer;
+	}
+
 	vkDestroyDescriptorSetLayout(logical_device, m_cb_set_layout, nullptr);
 
 	delete m_desc_heap;
@@ -66,6 +93,18 @@ gfx::VkConstantBufferPool::~VkConstantBufferPool()
 
 void gfx::VkConstantBufferPool::Flush(std::uint32_t frame_idx)
 {
+	if (m_suballocate)
+	{
+		auto allocation = m_frame_buffers[frame_idx]->m_buffer_allocation;
+		for (auto const & range : m_dirty_ranges[frame_idx].GetRanges())
+		{
+			vmaFlushAllocation(m_context->m_vma_allocator, allocation, range.m_offset, range.m_size);
+		}
+		m_dirty_ranges[frame_idx].Clear();
+
+		return;
+	}
+
 	for (auto& buffer : m_buffers[frame_idx])
 	{
 		// Flush to make writes visible to GPU
@@ -80,12 +119,21 @@ std::vector<std::uint32_t> gfx::VkConstantBufferPool::CreateConstantBufferSet(st
 	for (std::uint32_t frame_idx = 0; frame_idx < gfx::settings::num_back_buffers; frame_idx++)
 	{
 		std::vector<GPUBuffer*> buffers;
+		std::vector<std::pair<std::uint64_t, std::uint64_t>> offset_sizes;
 		for (auto const& handle : handles)
 		{
-			buffers.push_back(m_buffers[frame_idx][handle.m_cb_id]);
+			if (m_suballocate)
+			{
+				buffers.push_back(m_frame_buffers[frame_idx]);
+				offset_sizes.emplace_back(GetOffset(handle), m_buffer_size);
+			}
+			else
+			{
+				buffers.push_back(m_buffers[frame_idx][handle.m_cb_id]);
+			}
 		}
 
-		retval.emplace_back(m_desc_heap->CreateSRVSetFromCB(buffers, m_cb_set_layout, m_binding, frame_idx));
+		retval.emplace_back(m_desc_heap->CreateSRVSetFromCB(buffers, m_cb_set_layout, m_binding, frame_idx, m_type, offset_sizes));
 	}
 
 	return retval;
@@ -93,6 +141,14 @@ std::vector<std::uint32_t> gfx::VkConstantBufferPool::CreateConstantBufferSet(st
 
 void gfx::VkConstantBufferPool::Update(ConstantBufferHandle handle, std::uint64_t size, void* data, std::uint32_t frame_idx, std::uint64_t offset)
 {
+	if (m_suballocate)
+	{
+		auto buffer_offset = GetOffset(handle) + offset;
+		m_frame_buffers[frame_idx]->Update(data, size, buffer_offset);
+		m_dirty_ranges[frame_idx].Add(buffer_offset, size);
+		return;
+	}
+
 	m_buffers[frame_idx][handle.m_cb_id]->Update(data, size, offset);
 }
 
@@ -103,14 +159,39 @@ gfx::DescriptorHeap* gfx::VkConstantBufferPool::GetDescriptorHeap()
 
 void gfx::VkConstantBufferPool::Allocate_Impl(ConstantBufferHandle& handle, std::uint64_t size)
 {
+	if (m_suballocate)
+	{
+		if (handle.m_cb_id >= m_num_buffers || size > m_buffer_size)
+		{
+			LOGC("Constant buffer pool is out of buffers or the buffer is too large.");
+		}
+
+		for (std::uint32_t frame_idx = 0; frame_idx < gfx::settings::num_back_buffers; frame_idx++)
+		{
+			handle.m_cb_set_id = m_desc_heap->CreateSRVFromCB(m_frame_buffers[frame_idx], m_cb_set_layout, m_binding, frame_idx, m_type, std::make_pair(GetOffset(handle), size));
+		}
+
+		return;
+	}
+
 	for (std::uint32_t frame_idx = 0; frame_idx < gfx::settings::num_back_buffers; frame_idx++)
 	{
 		// TODO: memory pool
-		auto buffer= new gfx::GPUBuffer(m_context, m_pool, size, gfx::enums::BufferUsageFlag::CONSTANT_BUFFER);
+		auto buffer= new gfx::GPUBuffer(m_context, m_pool, size, GetBufferUsage());
 		buffer->Map();
-		handle.m_cb_set_id = m_desc_heap->CreateSRVFromCB(buffer, m_cb_set_layout, m_binding, frame_idx);
+		handle.m_cb_set_id = m_desc_heap->CreateSRVFromCB(buffer, m_cb_set_layout, m_binding, frame_idx, m_type);
 		m_buffers[frame_idx].push_back(buffer);
 
 		// TODO: In theory cb set id and cb id are always the same.
 	}
 }
+
+gfx::enums::BufferUsageFlag gfx::VkConstantBufferPool::GetBufferUsage() const
+{
+	return m_type == enums::BufferDescType::STORAGE ? enums::BufferUsageFlag::STORAGE : enums::BufferUsageFlag::CONSTANT_BUFFER;
+}
+
+std::uint64_t gfx::VkConstantBufferPool::GetOffset(ConstantBufferHandle handle) const
+{
+	return handle.m_cb_id * m_slot_size;
+}
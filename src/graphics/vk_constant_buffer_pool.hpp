@@ -7,6 +7,7 @@
 #pragma once
 
 #include "../constant_buffer_pool.hpp"
+#include "../util/dirty_ranges.hpp"
 
 namespace gfx
 {
@@ -19,7 +20,14 @@ namespace gfx
 	class VkConstantBufferPool : public ConstantBufferPool
 	{
 	public:
-		explicit VkConstantBufferPool(Context* context, std::size_t buffer_size, std::size_t num_buffers, std::uint32_t binding, VkShaderStageFlags flags = VK_SHADER_STAGE_VERTEX_BIT);
+		//! Buffers are bound as `type`. Use `enums::BufferDescType::STORAGE` for data that doesn't fit the uniform buffer size limits.
+		/*!
+			Without `suballocate` every buffer is a separate `GPUBuffer` per back buffer and `Flush` flushes all of them.
+			With `suballocate` all `num_buffers` buffers are placed in one persistently mapped `GPUBuffer` per back buffer
+			and `Flush` only flushes the ranges written by `Update` since the last flush of that back buffer.
+		*/
+		explicit VkConstantBufferPool(Context* context, std::size_t buffer_size, std::size_t num_buffers, std::uint32_t binding, VkShaderStageFlags flags = VK_SHADER_STAGE_VERTEX_BIT,
+			enums::BufferDescType type = enums::BufferDescType::UNIFORM, bool suballocate = false);
 		~VkConstantBufferPool() final;
 
 		void Flush(std::uint32_t frame_idx) final;
@@ -31,10 +39,14 @@ namespace gfx
 
 	private:
 		void Allocate_Impl(ConstantBufferHandle& handle, std::uint64_t size) final;
+		enums::BufferUsageFlag GetBufferUsage() const;
+		//! Offset of a buffer in the buffer of a frame. Only used when suballocating.
+		std::uint64_t GetOffset(ConstantBufferHandle handle) const;
 
 		Context* m_context;
 
 		std::uint32_t m_binding;
+		enums::BufferDescType m_type;
 		VkDescriptorSetLayout m_cb_set_layout;
 
 		gfx::DescriptorHeap* m_desc_heap;
@@ -42,6 +54,14 @@ namespace gfx
 		std::vector<std::vector<GPUBuffer*>> m_buffers;
 		MemoryPool* m_pool;
 
+		// Suballocation
+		bool m_suballocate;
+		std::uint64_t m_buffer_size;
+		std::uint64_t m_slot_size; // `m_buffer_size` aligned to the minimum offset alignment.
+		std::size_t m_num_buffers;
+		std::vector<GPUBuffer*> m_frame_buffers; // Persistently mapped.
+		std::vector<util::DirtyRanges> m_dirty_ranges; // Indexed by frame.
+
 	};
 
 } /* gfx */
\ No newline at end of file
@@ -0,0 +1,97 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include "host_constant_buffer_pool.hpp"
+
+#include <cassert>
+#include <cstring>
+
+#include "graphics/gfx_settings.hpp"
+#include "util/log.hpp"
+
+HostConstantBufferPool::HostConstantBufferPool(std::size_t buffer_size, std::size_t num_buffers, std::uint64_t alignment, std::uint64_t atom_size)
+	: ConstantBufferPool(), m_buffer_size(buffer_size), m_slot_size((buffer_size + alignment - 1) / alignment * alignment), m_num_buffers(num_buffers),
+	m_next_set_id(0)
+{
+	m_frame_buffers.resize(gfx::settings::num_back_buffers);
+	m_dirty_ranges.resize(gfx::settings::num_back_buffers, util::DirtyRanges(atom_size));
+}
+
+HostConstantBufferPool::~HostConstantBufferPool()
+{
+}
+
+void HostConstantBufferPool::Flush(std::uint32_t frame_idx)
+{
+	for (auto const & range : m_dirty_ranges[frame_idx].GetRanges())
+	{
+		m_stats.m_num_flushed_ranges++;
+		m_stats.m_flushed_bytes += range.m_size;
+	}
+	m_dirty_ranges[frame_idx].Clear();
+
+	m_stats.m_num_flushes++;
+}
+
+std::vector<std::uint32_t> HostConstantBufferPool::CreateConstantBufferSet(std::vector<ConstantBufferHandle> handles)
+{
+	std::vector<std::uint32_t> retval;
+	for (std::uint32_t frame_idx = 0; frame_idx < gfx::settings::num_back_buffers; frame_idx++)
+	{
+		retval.push_back(m_next_set_id++);
+	}
+
+	return retval;
+}
+
+void HostConstantBufferPool::Update(ConstantBufferHandle handle, std::uint64_t size, void* data, std::uint32_t frame_idx, std::uint64_t offset)
+{
+	assert(offset + size <= m_buffer_size);
+
+	auto buffer_offset = GetOffset(handle) + offset;
+	std::memcpy(m_frame_buffers[frame_idx].data() + buffer_offset, data, size);
+	m_dirty_ranges[frame_idx].Add(buffer_offset, size);
+
+	m_stats.m_num_updates++;
+	m_stats.m_updated_bytes += size;
+}
+
+std::uint8_t const * HostConstantBufferPool::GetData(ConstantBufferHandle handle, std::uint32_t frame_idx) const
+{
+	return m_frame_buffers[frame_idx].data() + GetOffset(handle);
+}
+
+std::uint64_t HostConstantBufferPool::GetOffset(ConstantBufferHandle handle) const
+{
+	return handle.m_cb_id * m_slot_size;
+}
+
+util::DirtyRanges const & HostConstantBufferPool::GetDirtyRanges(std::uint32_t frame_idx) const
+{
+	return m_dirty_ranges[frame_idx];
+}
+
+HostConstantBufferPool::Stats const & HostConstantBufferPool::GetStats() const
+{
+	return m_stats;
+}
+
+void HostConstantBufferPool::Allocate_Impl(ConstantBufferHandle& handle, std::uint64_t size)
+{
+	if (handle.m_cb_id >= m_num_buffers || size > m_buffer_size)
+	{
+		LOGC("Constant buffer pool is out of buffers or the buffer is too large.");
+	}
+
+	for (auto & buffer : m_frame_buffers)
+	{
+		buffer.resize(GetOffset(handle) + m_slot_size, 0);
+	}
+	handle.m_cb_set_id = m_next_set_id++;
+
+	m_stats.m_num_buffers++;
+	m_stats.m_allocated_bytes += m_slot_size * m_frame_buffers.size();
+}
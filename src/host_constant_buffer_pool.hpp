@@ -0,0 +1,62 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include "constant_buffer_pool.hpp"
+#include "util/dirty_ranges.hpp"
+
+//! Constant buffer pool that keeps all buffers in host memory.
+/*!
+	Mirrors the suballocated mode of `gfx::VkConstantBufferPool` (all buffers in one buffer per back buffer, only dirty ranges get flushed)
+	without requiring a device. Used to test and benchmark the scene graph headless.
+*/
+class HostConstantBufferPool : public ConstantBufferPool
+{
+public:
+	struct Stats
+	{
+		std::uint32_t m_num_buffers = 0;
+		std::uint64_t m_allocated_bytes = 0; // Of all versions of all buffers.
+		std::uint64_t m_num_updates = 0;
+		std::uint64_t m_updated_bytes = 0;
+		std::uint32_t m_num_flushes = 0;
+		std::uint64_t m_num_flushed_ranges = 0;
+		std::uint64_t m_flushed_bytes = 0;
+	};
+
+	//! `alignment` mimics the minimum buffer offset alignment and `atom_size` the non coherent atom size of a device. Flushes are done in whole atoms.
+	HostConstantBufferPool(std::size_t buffer_size, std::size_t num_buffers, std::uint64_t alignment = 256, std::uint64_t atom_size = 64);
+	~HostConstantBufferPool() final;
+
+	void Flush(std::uint32_t frame_idx) final;
+
+	//! Returns one (fake) set id per back buffer like `gfx::VkConstantBufferPool` does.
+	std::vector<std::uint32_t> CreateConstantBufferSet(std::vector<ConstantBufferHandle> handles) final;
+	void Update(ConstantBufferHandle handle, std::uint64_t size, void* data, std::uint32_t frame_idx, std::uint64_t offset = 0) final;
+
+	//! Returns the contents of the version of a buffer used by `frame_idx`.
+	std::uint8_t const * GetData(ConstantBufferHandle handle, std::uint32_t frame_idx) const;
+	//! Offset of a buffer in the buffer of a frame.
+	std::uint64_t GetOffset(ConstantBufferHandle handle) const;
+	//! Ranges that are written but not flushed yet.
+	util::DirtyRanges const & GetDirtyRanges(std::uint32_t frame_idx) const;
+
+	Stats const & GetStats() const;
+
+private:
+	void Allocate_Impl(ConstantBufferHandle& handle, std::uint64_t size) final;
+
+	std::uint64_t m_buffer_size;
+	std::uint64_t m_slot_size; // `m_buffer_size` aligned.
+	std::size_t m_num_buffers;
+	std::uint32_t m_next_set_id;
+
+	std::vector<std::vector<std::uint8_t>> m_frame_buffers; // Grows with the allocated buffers.
+	std::vector<util::DirtyRanges> m_dirty_ranges; // Indexed by frame.
+
+	Stats m_stats;
+};
@@ -0,0 +1,244 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include "host_model_pool.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+HostModelPool::HostModelPool(std::uint64_t index_alignment, std::uint64_t capacity)
+	: ModelPool(), m_index_alignment(index_alignment), m_capacity(capacity)
+{
+}
+
+HostModelPool::~HostModelPool()
+{
+}
+
+ModelHandle::MeshOffsets HostModelPool::AllocateMesh(void* vertex_data, std::uint32_t num_vertices, std::uint32_t vertex_stride,
+	void* index_data, std::uint32_t num_indices, std::uint32_t index_stride, void* meshlet_data, std::uint32_t num_meshlets)
+{
+	std::uint64_t vb_size = (std::uint64_t)vertex_stride * num_vertices;
+	std::uint64_t ib_size = (std::uint64_t)index_stride * num_indices;
+
+	Mesh mesh = {};
+	mesh.m_num_vertices = num_vertices;
+	mesh.m_vertex_stride = vertex_stride;
+	mesh.m_num_indices = num_indices;
+	mesh.m_index_stride = index_stride;
+
+	ModelHandle::MeshOffsets offsets
+	{
+		.m_vb = AllocateRange(m_big_vertex_buffer, m_free_vertex_ranges, SizeAlignTwoPower(vb_size, 1)),
+		.m_ib = AllocateRange(m_big_index_buffer, m_free_index_ranges, SizeAlignTwoPower(ib_size, m_index_alignment))
+	};
+
+	if (offsets.m_vb == invalid_offset || offsets.m_ib == invalid_offset)
+	{
+		LOGE("Host model pool is out of memory. Failed to allocate {} vertex and {} index bytes.", vb_size, ib_size);
+
+		if (offsets.m_vb != invalid_offset) m_free_vertex_ranges.Free(offsets.m_vb, SizeAlignTwoPower(vb_size, 1));
+		if (offsets.m_ib != invalid_offset) m_free_index_ranges.Free(offsets.m_ib, SizeAlignTwoPower(ib_size, m_index_alignment));
+		offsets = { invalid_offset, invalid_offset };
+
+		mesh.m_offsets = offsets;
+		m_pending_shading_buffers.reset();
+		m_stats.m_num_failed_allocations++;
+		m_meshes.push_back(std::move(mesh));
+
+		return offsets;
+	}
+
+	if (vb_size) std::memcpy(m_big_vertex_buffer.data() + offsets.m_vb, vertex_data, vb_size);
+	if (ib_size) std::memcpy(m_big_index_buffer.data() + offsets.m_ib, index_data, ib_size);
+
+	mesh.m_offsets = offsets;
+	mesh.m_allocated = true;
+
+	auto meshlets = static_cast<MeshletDesc const*>(meshlet_data);
+	mesh.m_meshlets.assign(meshlets, meshlets + num_meshlets);
+
+	if (m_pending_shading_buffers.has_value())
+	{
+		mesh.m_vertex_indices = std::move(m_pending_shading_buffers->first);
+		mesh.m_flat_indices = std::move(m_pending_shading_buffers->second);
+		m_pending_shading_buffers.reset();
+	}
+	else
+	{
+		LOGW("Allocated a mesh without mesh shading buffers.");
+	}
+
+	m_stats.m_num_meshes++;
+	m_stats.m_num_meshlets += num_meshlets;
+	m_stats.m_vertex_bytes += vb_size;
+	m_stats.m_index_bytes += ib_size;
+	m_stats.m_meshlet_bytes += (std::uint64_t)num_meshlets * sizeof(MeshletDesc);
+	m_stats.m_vertex_index_bytes += mesh.m_vertex_indices.size() * sizeof(std::uint32_t);
+	m_stats.m_flat_index_bytes += mesh.m_flat_indices.size();
+
+	m_meshes.push_back(std::move(mesh));
+
+	return offsets;
+}
+
+void HostModelPool::AllocateMeshShadingBuffers(std::vector<std::uint32_t> vertex_indices, std::vector<std::uint8_t> flat_indices)
+{
+	if (m_pending_shading_buffers.has_value())
+	{
+		LOGW("Mesh shading buffers were allocated twice without allocating a mesh in between.");
+	}
+
+	m_pending_shading_buffers = { std::move(vertex_indices), std::move(flat_indices) };
+}
+
+void HostModelPool::Stage(gfx::CommandList* command_list)
+{
+	for (auto i = m_first_unstaged_mesh; i < m_meshes.size(); i++)
+	{
+		auto& mesh = m_meshes[i];
+		if (!mesh.m_allocated)
+		{
+			continue;
+		}
+		mesh.m_staged = true;
+
+		m_stats.m_staged_bytes += (std::uint64_t)mesh.m_vertex_stride * mesh.m_num_vertices
+			+ (std::uint64_t)mesh.m_index_stride * mesh.m_num_indices
+			+ mesh.m_meshlets.size() * sizeof(MeshletDesc)
+			+ mesh.m_vertex_indices.size() * sizeof(std::uint32_t)
+			+ mesh.m_flat_indices.size();
+	}
+
+	m_first_unstaged_mesh = m_meshes.size();
+	m_stats.m_num_stages++;
+}
+
+void HostModelPool::PostStage()
+{
+}
+
+void HostModelPool::FreeMesh(std::uint32_t id)
+{
+	auto& mesh = m_meshes[id];
+	if (!mesh.m_allocated)
+	{
+		LOGW("Tried to free mesh {} which isn't allocated.", id);
+		return;
+	}
+
+	m_free_vertex_ranges.Free(mesh.m_offsets.m_vb, SizeAlignTwoPower((std::uint64_t)mesh.m_vertex_stride * mesh.m_num_vertices, 1));
+	m_free_index_ranges.Free(mesh.m_offsets.m_ib, SizeAlignTwoPower((std::uint64_t)mesh.m_index_stride * mesh.m_num_indices, m_index_alignment));
+
+	mesh.m_allocated = false;
+	mesh.m_meshlets.clear();
+	mesh.m_vertex_indices.clear();
+	mesh.m_flat_indices.clear();
+
+	m_stats.m_num_freed_meshes++;
+}
+
+HostModelPool::Mesh const & HostModelPool::GetMesh(std::uint32_t id) const
+{
+	return m_meshes[id];
+}
+
+std::size_t HostModelPool::GetNumMeshes() const
+{
+	return m_meshes.size();
+}
+
+std::uint8_t const * HostModelPool::GetIndices(std::uint32_t id) const
+{
+	return m_big_index_buffer.data() + GetMesh(id).m_offsets.m_ib;
+}
+
+HostModelPool::Stats const & HostModelPool::GetStats() const
+{
+	return m_stats;
+}
+
+std::uint64_t HostModelPool::GetVertexBufferSize() const
+{
+	return m_big_vertex_buffer.size();
+}
+
+std::uint64_t HostModelPool::GetIndexBufferSize() const
+{
+	return m_big_index_buffer.size();
+}
+
+std::uint64_t HostModelPool::AllocateRange(std::vector<std::uint8_t>& buffer, FreeRanges& free_ranges, std::uint64_t size)
+{
+	if (auto offset = free_ranges.Allocate(size); offset.has_value())
+	{
+		return offset.value();
+	}
+
+	std::uint64_t offset = buffer.size();
+	if (size > m_capacity - offset)
+	{
+		return invalid_offset;
+	}
+
+	buffer.resize(offset + size);
+	return offset;
+}
+
+std::optional<std::uint64_t> HostModelPool::FreeRanges::Allocate(std::uint64_t size)
+{
+	for (auto it = m_ranges.begin(); it != m_ranges.end(); it++)
+	{
+		if (it->second < size)
+		{
+			continue;
+		}
+
+		auto offset = it->first;
+		it->first += size;
+		it->second -= size;
+		if (it->second == 0)
+		{
+			m_ranges.erase(it);
+		}
+
+		return offset;
+	}
+
+	return std::nullopt;
+}
+
+void HostModelPool::FreeRanges::Free(std::uint64_t offset, std::uint64_t size)
+{
+	if (size == 0)
+	{
+		return;
+	}
+
+	auto it = std::lower_bound(m_ranges.begin(), m_ranges.end(), std::make_pair(offset, std::uint64_t(0)));
+	it = m_ranges.insert(it, { offset, size });
+
+	// Merge with the next range first so `it` stays valid.
+	if (auto next = it + 1; next != m_ranges.end() && it->first + it->second == next->first)
+	{
+		it->second += next->second;
+		m_ranges.erase(next);
+	}
+	if (it != m_ranges.begin())
+	{
+		auto prev = it - 1;
+		if (prev->first + prev->second == it->first)
+		{
+			prev->second += it->second;
+			m_ranges.erase(it);
+		}
+	}
+}
+
+std::uint64_t HostModelPool::Stats::GetTotalBytes() const
+{
+	return m_vertex_bytes + m_index_bytes + m_meshlet_bytes + m_vertex_index_bytes + m_flat_index_bytes;
+}
@@ -0,0 +1,136 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <cassert>
+#include <limits>
+#include <optional>
+
+#include "model_pool.hpp"
+
+//! Model pool that keeps all mesh data in host memory.
+/*!
+	Mirrors the buffer layout of `gfx::VkModelPool` (one big vertex and index buffer plus per mesh meshlet buffers)
+	without requiring a device. Used to test and benchmark the model loading pipeline headless.
+	Freed meshes return their ranges of the big buffers, later allocations reuse them first fit before the buffers grow.
+*/
+class HostModelPool : public ModelPool
+{
+public:
+	//! Offset returned for both buffers when a allocation doesn't fit in the capacity of the pool.
+	static inline const std::uint64_t invalid_offset = std::numeric_limits<std::uint64_t>::max();
+
+	struct Mesh
+	{
+		ModelHandle::MeshOffsets m_offsets;
+		std::uint32_t m_num_vertices;
+		std::uint32_t m_vertex_stride;
+		std::uint32_t m_num_indices;
+		std::uint32_t m_index_stride;
+
+		std::vector<MeshletDesc> m_meshlets;
+		std::vector<std::uint32_t> m_vertex_indices;
+		std::vector<std::uint8_t> m_flat_indices;
+
+		bool m_staged = false;
+		bool m_allocated = false; // False after `FreeMesh` or when the pool was exhausted.
+	};
+
+	struct Stats
+	{
+		std::uint32_t m_num_meshes = 0;
+		std::uint32_t m_num_meshlets = 0;
+		std::uint64_t m_vertex_bytes = 0;
+		std::uint64_t m_index_bytes = 0;
+		std::uint64_t m_meshlet_bytes = 0;
+		std::uint64_t m_vertex_index_bytes = 0;
+		std::uint64_t m_flat_index_bytes = 0;
+		std::uint64_t m_staged_bytes = 0;
+		std::uint32_t m_num_stages = 0;
+		std::uint32_t m_num_freed_meshes = 0;
+		std::uint32_t m_num_failed_allocations = 0;
+
+		//! Total amount of bytes that would have been uploaded to the GPU.
+		std::uint64_t GetTotalBytes() const;
+	};
+
+	//! `index_alignment` mimics the minimum storage buffer offset alignment of a device, `capacity` the size of each big buffer in bytes.
+	explicit HostModelPool(std::uint64_t index_alignment = 256, std::uint64_t capacity = std::numeric_limits<std::uint64_t>::max());
+	~HostModelPool() final;
+
+	using ModelPool::Load;
+	//! Unlike `ModelPool::Load` this accepts every vertex format, the data never reaches a device.
+	template<typename V_T>
+	ModelHandle Load(ModelData* data);
+
+	ModelHandle::MeshOffsets AllocateMesh(void* vertex_data, std::uint32_t num_vertices, std::uint32_t vertex_stride,
+			void* index_data, std::uint32_t num_indices, std::uint32_t index_stride, void* meshlet_data, std::uint32_t num_meshlets) final;
+
+	void AllocateMeshShadingBuffers(std::vector<std::uint32_t> vertex_indices, std::vector<std::uint8_t> flat_indices) final;
+
+	void Stage(gfx::CommandList* command_list) final;
+	void PostStage() final;
+
+	//! Releases the big buffer ranges of a mesh. The id stays taken so the ids of other meshes don't change.
+	void FreeMesh(std::uint32_t id);
+
+	//! Mesh ids are handed out in allocation order, so `id` indexes the allocated meshes directly.
+	Mesh const & GetMesh(std::uint32_t id) const;
+	std::size_t GetNumMeshes() const;
+	//! Returns the vertices of a mesh reinterpreted as `V_T`. Asserts the stride matches.
+	template<typename V_T>
+	V_T const * GetVertices(std::uint32_t id) const;
+	//! Returns the raw index bytes of a mesh. Use `Mesh::m_index_stride` to interpret them.
+	std::uint8_t const * GetIndices(std::uint32_t id) const;
+
+	Stats const & GetStats() const;
+	//! Used size of the big buffers, including freed ranges that haven't been reused.
+	std::uint64_t GetVertexBufferSize() const;
+	std::uint64_t GetIndexBufferSize() const;
+
+private:
+	//! First fit free list of a big buffer. Neighbouring free ranges are merged.
+	struct FreeRanges
+	{
+		std::vector<std::pair<std::uint64_t, std::uint64_t>> m_ranges; // Offset and size, sorted by offset.
+
+		std::optional<std::uint64_t> Allocate(std::uint64_t size);
+		void Free(std::uint64_t offset, std::uint64_t size);
+	};
+
+	//! Returns the offset of `size` bytes in `buffer`, growing it when no free range fits. Returns `invalid_offset` when it exceeds the capacity.
+	std::uint64_t AllocateRange(std::vector<std::uint8_t>& buffer, FreeRanges& free_ranges, std::uint64_t size);
+
+	std::uint64_t m_index_alignment;
+	std::uint64_t m_capacity;
+
+	std::vector<std::uint8_t> m_big_vertex_buffer;
+	std::vector<std::uint8_t> m_big_index_buffer;
+	FreeRanges m_free_vertex_ranges;
+	FreeRanges m_free_index_ranges;
+
+	std::vector<Mesh> m_meshes;
+	std::size_t m_first_unstaged_mesh = 0;
+	//! Set by `AllocateMeshShadingBuffers` and consumed by the `AllocateMesh` call that follows it.
+	std::optional<std::pair<std::vector<std::uint32_t>, std::vector<std::uint8_t>>> m_pending_shading_buffers;
+
+	Stats m_stats;
+};
+
+template<typename V_T>
+ModelHandle HostModelPool::Load(ModelData* data)
+{
+	return LoadWithMaterials_Impl<V_T>(data, nullptr, nullptr, std::nullopt, nullptr);
+}
+
+template<typename V_T>
+V_T const * HostModelPool::GetVertices(std::uint32_t id) const
+{
+	auto const & mesh = GetMesh(id);
+	assert(mesh.m_vertex_stride == sizeof(V_T));
+	return reinterpret_cast<V_T const*>(m_big_vertex_buffer.data() + mesh.m_offsets.m_vb);
+}
@@ -0,0 +1,376 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+#include "meshlet_builder.hpp"
+
+namespace internal
+{
+
+	//! FIFO post-transform cache simulated with timestamps.
+	/*!
+		A vertex is in the cache when it was transformed less than `cache_size` misses ago.
+		Resetting the cache is O(1) by advancing the time past the cache size.
+	*/
+	class VertexCacheSimulator
+	{
+	public:
+		VertexCacheSimulator(std::size_t num_vertices, std::uint32_t cache_size)
+			: m_cache_size(cache_size), m_time(cache_size + 1), m_timestamps(num_vertices, 0)
+		{
+		}
+
+		//! Returns true on a cache miss.
+		bool Access(std::uint32_t vertex)
+		{
+			if (m_time - m_timestamps[vertex] > m_cache_size)
+			{
+				m_timestamps[vertex] = m_time++;
+				return true;
+			}
+			return false;
+		}
+
+		std::uint32_t Triangle(std::uint32_t const * tri)
+		{
+			return std::uint32_t(Access(tri[0])) + std::uint32_t(Access(tri[1])) + std::uint32_t(Access(tri[2]));
+		}
+
+		void Reset()
+		{
+			m_time += m_cache_size + 1;
+		}
+
+	private:
+		std::uint32_t m_cache_size;
+		std::uint32_t m_time;
+		std::vector<std::uint32_t> m_timestamps;
+	};
+
+	template<typename T>
+	void RemapAttribute(std::vector<T>& attribute, std::vector<std::uint32_t> const & remap)
+	{
+		if (attribute.size() != remap.size())
+		{
+			return;
+		}
+
+		std::vector<T> remapped(attribute.size());
+		for (std::size_t i = 0; i < attribute.size(); i++)
+		{
+			remapped[remap[i]] = attribute[i];
+		}
+		attribute = std::move(remapped);
+	}
+
+} /* internal */
+
+std::vector<std::uint32_t> MeshOptimizer::OptimizeVertexCache(std::vector<std::uint32_t> const & indices,
+	std::size_t num_vertices,
+	std::uint32_t cache_size)
+{
+	auto num_triangles = indices.size() / 3;
+
+	// Vertex -> triangle adjacency
+	std::vector<std::uint32_t> live_triangles(num_vertices, 0);
+	for (auto index : indices)
+	{
+		live_triangles[index]++;
+	}
+
+	std::vector<std::uint32_t> adjacency_offsets(num_vertices + 1, 0);
+	for (std::size_t v = 0; v < num_vertices; v++)
+	{
+		adjacency_offsets[v + 1] = adjacency_offsets[v] + live_triangles[v];
+	}
+
+	std::vector<std::uint32_t> adjacency(indices.size());
+	{
+		std::vector<std::uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+		for (std::size_t i = 0; i < indices.size(); i++)
+		{
+			adjacency[fill[indices[i]]++] = static_cast<std::uint32_t>(i / 3);
+		}
+	}
+
+	std::vector<std::uint32_t> output;
+	output.reserve(indices.size());
+
+	std::vector<std::uint32_t> cache_timestamps(num_vertices, 0);
+	std::vector<bool> emitted(num_triangles, false);
+	std::vector<std::uint32_t> dead_end_stack;
+	std::vector<std::uint32_t> candidates;
+	dead_end_stack.reserve(indices.size());
+
+	std::uint32_t time = cache_size + 1;
+	std::uint32_t cursor = 0;
+
+	auto skip_dead_end = [&]() -> std::int64_t
+	{
+		while (!dead_end_stack.empty())
+		{
+			auto vertex = dead_end_stack.back();
+			dead_end_stack.pop_back();
+			if (live_triangles[vertex] > 0) return vertex;
+		}
+
+		for (; cursor < num_vertices; cursor++)
+		{
+			if (live_triangles[cursor] > 0) return cursor;
+		}
+
+		return -1;
+	};
+
+	std::int64_t fanning_vertex = skip_dead_end();
+	while (fanning_vertex >= 0)
+	{
+		candidates.clear();
+
+		// Emit all remaining triangles around the fanning vertex.
+		for (auto a = adjacency_offsets[fanning_vertex]; a < adjacency_offsets[fanning_vertex + 1]; a++)
+		{
+			auto t = adjacency[a];
+			if (emitted[t]) continue;
+
+			for (auto k = 0; k < 3; k++)
+			{
+				auto vertex = indices[t * 3 + k];
+				output.push_back(vertex);
+				dead_end_stack.push_back(vertex);
+				candidates.push_back(vertex);
+				live_triangles[vertex]--;
+
+				if (time - cache_timestamps[vertex] > cache_size)
+				{
+					cache_timestamps[vertex] = time++;
+				}
+			}
+
+			emitted[t] = true;
+		}
+
+		// Pick the candidate that will still be in the cache after its remaining triangles are emitted, preferring the oldest.
+		std::int64_t best_vertex = -1;
+		std::int64_t best_priority = -1;
+		for (auto vertex : candidates)
+		{
+			if (live_triangles[vertex] == 0) continue;
+
+			std::int64_t priority = 0;
+			if (time - cache_timestamps[vertex] + 2 * live_triangles[vertex] <= cache_size)
+			{
+				priority = time - cache_timestamps[vertex];
+			}
+
+			if (priority > best_priority)
+			{
+				best_priority = priority;
+				best_vertex = vertex;
+			}
+		}
+
+		fanning_vertex = best_vertex != -1 ? best_vertex : skip_dead_end();
+	}
+
+	return output;
+}
+
+std::vector<std::uint32_t> MeshOptimizer::OptimizeOverdraw(std::vector<std::uint32_t> const & indices,
+	std::vector<glm::vec3> const & positions,
+	float threshold,
+	std::uint32_t cache_size)
+{
+	auto num_triangles = static_cast<std::uint32_t>(indices.size() / 3);
+	if (num_triangles == 0)
+	{
+		return indices;
+	}
+
+	internal::VertexCacheSimulator cache(positions.size(), cache_size);
+
+	// Hard boundaries: triangles that miss on all vertices, the cache context is lost there anyway.
+	std::vector<std::uint32_t> hard_boundaries;
+	for (std::uint32_t t = 0; t < num_triangles; t++)
+	{
+		if (cache.Triangle(&indices[t * 3]) == 3)
+		{
+			hard_boundaries.push_back(t);
+		}
+	}
+	hard_boundaries.push_back(num_triangles);
+
+	// Soft boundaries: split hard clusters as soon as the ACMR of the part so far is close enough to the ACMR of the whole cluster.
+	std::vector<std::uint32_t> cluster_starts;
+	for (std::size_t c = 0; c + 1 < hard_boundaries.size(); c++)
+	{
+		auto begin = hard_boundaries[c];
+		auto end = hard_boundaries[c + 1];
+
+		cache.Reset();
+		std::uint32_t cluster_misses = 0;
+		for (auto t = begin; t < end; t++)
+		{
+			cluster_misses += cache.Triangle(&indices[t * 3]);
+		}
+		float cluster_acmr = float(cluster_misses) / float(end - begin);
+
+		cache.Reset();
+		std::uint32_t start = begin;
+		std::uint32_t misses = 0;
+		cluster_starts.push_back(begin);
+		for (auto t = begin; t < end; t++)
+		{
+			misses += cache.Triangle(&indices[t * 3]);
+
+			if (t + 1 < end && float(misses) / float(t - start + 1) <= cluster_acmr * threshold)
+			{
+				start = t + 1;
+				misses = 0;
+				cluster_starts.push_back(start);
+				cache.Reset();
+			}
+		}
+	}
+	cluster_starts.push_back(num_triangles);
+
+	// Sort clusters by how much they face away from the mesh center. Outward facing clusters occlude the rest so they go first.
+	glm::vec3 mesh_center = glm::vec3(0);
+	float mesh_area = 0;
+	std::size_t num_clusters = cluster_starts.size() - 1;
+	std::vector<float> sort_keys(num_clusters);
+	std::vector<glm::vec3> cluster_centers(num_clusters);
+	std::vector<glm::vec3> cluster_normals(num_clusters);
+
+	for (std::size_t c = 0; c < num_clusters; c++)
+	{
+		glm::vec3 center = glm::vec3(0);
+		glm::vec3 normal = glm::vec3(0);
+		float area = 0;
+
+		for (auto t = cluster_starts[c]; t < cluster_starts[c + 1]; t++)
+		{
+			auto v0 = positions[indices[t * 3 + 0]];
+			auto v1 = positions[indices[t * 3 + 1]];
+			auto v2 = positions[indices[t * 3 + 2]];
+
+			glm::vec3 cross = glm::cross(v1 - v0, v2 - v0);
+			float tri_area = glm::length(cross);
+
+			center += (v0 + v1 + v2) * (tri_area / 3.f);
+			normal += cross;
+			area += tri_area;
+		}
+
+		mesh_center += center;
+		mesh_area += area;
+
+		cluster_centers[c] = area > 0 ? center / area : positions[indices[cluster_starts[c] * 3]];
+		float normal_length = glm::length(normal);
+		cluster_normals[c] = normal_length > 0 ? normal / normal_length : glm::vec3(0);
+	}
+
+	mesh_center = mesh_area > 0 ? mesh_center / mesh_area : glm::vec3(0);
+
+	for (std::size_t c = 0; c < num_clusters; c++)
+	{
+		sort_keys[c] = glm::dot(cluster_centers[c] - mesh_center, cluster_normals[c]);
+	}
+
+	std::vector<std::uint32_t> cluster_order(num_clusters);
+	std::iota(cluster_order.begin(), cluster_order.end(), 0);
+	std::stable_sort(cluster_order.begin(), cluster_order.end(), [&](auto a, auto b) { return sort_keys[a] > sort_keys[b]; });
+
+	std::vector<std::uint32_t> output;
+	output.reserve(indices.size());
+	for (auto c : cluster_order)
+	{
+		output.insert(output.end(), indices.begin() + cluster_starts[c] * 3, indices.begin() + cluster_starts[c + 1] * 3);
+	}
+
+	return output;
+}
+
+std::vector<std::uint32_t> MeshOptimizer::OptimizeVertexFetch(std::vector<std::uint32_t> const & indices, std::size_t num_vertices)
+{
+	static const auto unused = std::numeric_limits<std::uint32_t>::max();
+
+	std::vector<std::uint32_t> remap(num_vertices, unused);
+	std::uint32_t next_vertex = 0;
+
+	for (auto index : indices)
+	{
+		if (remap[index] == unused)
+		{
+			remap[index] = next_vertex++;
+		}
+	}
+
+	for (auto& new_index : remap)
+	{
+		if (new_index == unused)
+		{
+			new_index = next_vertex++;
+		}
+	}
+
+	return remap;
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(std::vector<std::uint32_t> const & indices,
+	std::size_t num_vertices,
+	std::uint32_t cache_size)
+{
+	VertexCacheStats stats = {};
+	if (indices.empty() || num_vertices == 0)
+	{
+		return stats;
+	}
+
+	internal::VertexCacheSimulator cache(num_vertices, cache_size);
+	for (std::size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		stats.m_num_transformed += cache.Triangle(&indices[i]);
+	}
+
+	stats.m_acmr = float(stats.m_num_transformed) / float(indices.size() / 3);
+	stats.m_atvr = float(stats.m_num_transformed) / float(num_vertices);
+
+	return stats;
+}
+
+std::vector<std::uint32_t> MeshOptimizer::Optimize(MeshData & mesh_data)
+{
+	auto num_vertices = mesh_data.m_positions.size();
+
+	auto indices = MeshletBuilder::UnpackIndices(mesh_data);
+	indices = OptimizeVertexCache(indices, num_vertices);
+	indices = OptimizeOverdraw(indices, mesh_data.m_positions);
+
+	auto remap = OptimizeVertexFetch(indices, num_vertices);
+	for (auto& index : indices)
+	{
+		index = remap[index];
+	}
+
+	internal::RemapAttribute(mesh_data.m_positions, remap);
+	internal::RemapAttribute(mesh_data.m_normals, remap);
+	internal::RemapAttribute(mesh_data.m_uvw, remap);
+	internal::RemapAttribute(mesh_data.m_tangents, remap);
+	internal::RemapAttribute(mesh_data.m_bitangents, remap);
+
+	// Write the indices back with the original stride.
+	MeshletBuilder::PackIndices(indices, mesh_data.m_indices_stride, mesh_data.m_indices);
+
+	return indices;
+}
@@ -0,0 +1,60 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm.hpp>
+
+#include "resource_structs.hpp"
+
+static inline const std::uint32_t default_vertex_cache_size = 16;
+static inline const float default_overdraw_threshold = 1.05f;
+
+//! Post-transform vertex cache statistics of a index buffer.
+struct VertexCacheStats
+{
+	std::size_t m_num_transformed = 0; // Cache misses.
+	float m_acmr = 0; // Average cache miss ratio: transformed vertices per triangle. 0.5 is the optimum for large grids, 3 the worst case.
+	float m_atvr = 0; // Average transformed vertex ratio: transformed vertices per vertex. 1 is optimal.
+};
+
+//! Triangle and vertex reordering passes applied before meshlets get build.
+/*!
+	Based on "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" by Sander, Nehab and Barczak.
+	https://gfx.cs.princeton.edu/pubs/Sander_2007_%3ETR/tipsy.pdf
+*/
+struct MeshOptimizer
+{
+	//! Reorders triangles for a FIFO post-transform cache of `cache_size` entries (Tipsify).
+	static std::vector<std::uint32_t> OptimizeVertexCache(std::vector<std::uint32_t> const & indices,
+		std::size_t num_vertices,
+		std::uint32_t cache_size = default_vertex_cache_size);
+
+	//! Reorders clusters of a cache optimized index buffer so outward facing clusters are drawn first.
+	/*!
+		The index buffer is split in clusters at points where the cache is effectively flushed and where the cluster's ACMR stays
+		below `threshold` times the ACMR of the input. The clusters are then sorted on how much they face away from the mesh center.
+	*/
+	static std::vector<std::uint32_t> OptimizeOverdraw(std::vector<std::uint32_t> const & indices,
+		std::vector<glm::vec3> const & positions,
+		float threshold = default_overdraw_threshold,
+		std::uint32_t cache_size = default_vertex_cache_size);
+
+	//! Returns a remap table (old index -> new index) which orders vertices by first use. Unreferenced vertices are moved to the end.
+	static std::vector<std::uint32_t> OptimizeVertexFetch(std::vector<std::uint32_t> const & indices, std::size_t num_vertices);
+
+	static VertexCacheStats AnalyzeVertexCache(std::vector<std::uint32_t> const & indices,
+		std::size_t num_vertices,
+		std::uint32_t cache_size = default_vertex_cache_size);
+
+	//! Runs all passes on a mesh, rewriting its index buffer (keeping the stride) and vertex attributes in place.
+	/*!
+		\return The optimized indices unpacked to 32 bit.
+	*/
+	static std::vector<std::uint32_t> Optimize(MeshData & mesh_data);
+};
@@ -0,0 +1,480 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include "mesh_simplifier.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+namespace internal
+{
+
+	static const double border_weight = 10.0;
+	static const float min_lod_gain = 0.9f; // A level has to have less than this fraction of the previous level's indices.
+
+	enum class VertexKind : std::uint8_t
+	{
+		MANIFOLD,
+		BORDER, // Only collapses along a border edge.
+		LOCKED
+	};
+
+	//! Symmetric 4x4 quadric error matrix accumulated with area weights.
+	struct Quadric
+	{
+		double m_a00 = 0, m_a11 = 0, m_a22 = 0;
+		double m_a01 = 0, m_a02 = 0, m_a12 = 0;
+		double m_b0 = 0, m_b1 = 0, m_b2 = 0;
+		double m_c = 0;
+		double m_weight = 0;
+
+		//! Quadric of the squared distance to the plane `dot(n, p) + d = 0`. `n` has to be normalized.
+		static Quadric FromPlane(double nx, double ny, double nz, double d, double weight)
+		{
+			Quadric q;
+			q.m_a00 = weight * nx * nx;
+			q.m_a11 = weight * ny * ny;
+			q.m_a22 = weight * nz * nz;
+			q.m_a01 = weight * nx * ny;
+			q.m_a02 = weight * nx * nz;
+			q.m_a12 = weight * ny * nz;
+			q.m_b0 = weight * nx * d;
+			q.m_b1 = weight * ny * d;
+			q.m_b2 = weight * nz * d;
+			q.m_c = weight * d * d;
+			q.m_weight = weight;
+			return q;
+		}
+
+		void operator+=(Quadric const & other)
+		{
+			m_a00 += other.m_a00; m_a11 += other.m_a11; m_a22 += other.m_a22;
+			m_a01 += other.m_a01; m_a02 += other.m_a02; m_a12 += other.m_a12;
+			m_b0 += other.m_b0; m_b1 += other.m_b1; m_b2 += other.m_b2;
+			m_c += other.m_c;
+			m_weight += other.m_weight;
+		}
+
+		//! Weighted average squared distance of `p` to the accumulated planes.
+		double Error(glm::vec3 const & p) const
+		{
+			double x = p.x, y = p.y, z = p.z;
+			double r = m_a00 * x * x + m_a11 * y * y + m_a22 * z * z
+				+ 2 * (m_a01 * x * y + m_a02 * x * z + m_a12 * y * z)
+				+ 2 * (m_b0 * x + m_b1 * y + m_b2 * z)
+				+ m_c;
+
+			return m_weight > 0 ? std::fabs(r) / m_weight : 0;
+		}
+	};
+
+	struct Collapse
+	{
+		std::uint32_t m_from;
+		std::uint32_t m_to;
+		double m_error;
+	};
+
+	struct PositionHash
+	{
+		std::size_t operator()(glm::vec3 const & p) const
+		{
+			std::uint32_t bits[3];
+			memcpy(bits, &p, sizeof(bits));
+			return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+		}
+	};
+
+	//! Directed edges of a index buffer grouped by their first vertex.
+	class EdgeAdjacency
+	{
+	public:
+		void Build(std::vector<std::uint32_t> const & indices, std::vector<std::uint32_t> const & remap)
+		{
+			m_offsets.assign(remap.size() + 1, 0);
+			for (std::size_t i = 0; i < indices.size(); i++)
+			{
+				m_offsets[remap[indices[i]] + 1]++;
+			}
+			for (std::size_t v = 0; v < remap.size(); v++)
+			{
+				m_offsets[v + 1] += m_offsets[v];
+			}
+
+			m_targets.resize(indices.size());
+			auto write_offsets = m_offsets;
+			for (std::size_t i = 0; i < indices.size(); i += 3)
+			{
+				for (std::size_t e = 0; e < 3; e++)
+				{
+					m_targets[write_offsets[remap[indices[i + e]]]++] = remap[indices[i + (e + 1) % 3]];
+				}
+			}
+		}
+
+		std::uint32_t Count(std::uint32_t from, std::uint32_t to) const
+		{
+			return static_cast<std::uint32_t>(std::count(m_targets.begin() + m_offsets[from], m_targets.begin() + m_offsets[from + 1], to));
+		}
+
+		std::vector<std::uint32_t> m_offsets;
+		std::vector<std::uint32_t> m_targets;
+	};
+
+	inline glm::vec3 TriangleNormal(glm::vec3 const & a, glm::vec3 const & b, glm::vec3 const & c)
+	{
+		return glm::cross(b - a, c - a);
+	}
+
+	//! Maps every vertex to the first vertex with the same position and returns whether a vertex shares its position.
+	static std::vector<std::uint32_t> BuildPositionRemap(std::vector<glm::vec3> const & positions, std::vector<bool>& has_wedges)
+	{
+		std::vector<std::uint32_t> remap(positions.size());
+		std::unordered_map<glm::vec3, std::uint32_t, PositionHash> first_vertex;
+		first_vertex.reserve(positions.size());
+		has_wedges.assign(positions.size(), false);
+
+		for (std::uint32_t i = 0; i < positions.size(); i++)
+		{
+			auto it = first_vertex.emplace(positions[i], i).first;
+			remap[i] = it->second;
+			if (it->second != i)
+			{
+				has_wedges[i] = true;
+				has_wedges[it->second] = true;
+			}
+		}
+
+		return remap;
+	}
+
+} /* internal */
+
+std::vector<std::uint32_t> MeshSimplifier::Simplify(std::vector<std::uint32_t> const & input_indices,
+	std::vector<glm::vec3> const & input_positions,
+	std::size_t target_index_count,
+	float max_error,
+	float* out_error)
+{
+	using namespace internal;
+
+	std::vector<std::uint32_t> indices = input_indices;
+	double result_error = 0;
+
+	if (out_error) *out_error = 0;
+	if (indices.size() <= target_index_count || input_positions.empty())
+	{
+		return indices;
+	}
+
+	// Work in a unit cube so the error is relative to the size of the mesh.
+	glm::vec3 bbox_min = input_positions[0];
+	glm::vec3 bbox_max = input_positions[0];
+	for (auto const & p : input_positions)
+	{
+		bbox_min = glm::min(bbox_min, p);
+		bbox_max = glm::max(bbox_max, p);
+	}
+	float extent = std::max(bbox_max.x - bbox_min.x, std::max(bbox_max.y - bbox_min.y, bbox_max.z - bbox_min.z));
+	if (extent <= 0)
+	{
+		return indices;
+	}
+
+	std::vector<glm::vec3> positions(input_positions.size());
+	for (std::size_t i = 0; i < positions.size(); i++)
+	{
+		positions[i] = (input_positions[i] - bbox_min) / extent;
+	}
+
+	auto num_vertices = positions.size();
+	std::vector<bool> has_wedges;
+	auto canonical = BuildPositionRemap(positions, has_wedges);
+
+	// Edges are build on positions so attribute seams don't show up as borders.
+	EdgeAdjacency edges;
+	auto is_border_edge = [&](std::uint32_t a, std::uint32_t b)
+	{
+		auto ca = canonical[a], cb = canonical[b];
+		return (edges.Count(ca, cb) != 0) != (edges.Count(cb, ca) != 0);
+	};
+
+	// Plane quadrics of the triangles and of the planes perpendicular to border edges.
+	std::vector<Quadric> quadrics(num_vertices);
+	edges.Build(indices, canonical);
+	for (std::size_t i = 0; i < indices.size(); i += 3)
+	{
+		glm::vec3 const & p0 = positions[indices[i + 0]];
+		glm::vec3 const & p1 = positions[indices[i + 1]];
+		glm::vec3 const & p2 = positions[indices[i + 2]];
+
+		glm::vec3 normal = TriangleNormal(p0, p1, p2);
+		float length = glm::length(normal);
+		if (length <= 0)
+		{
+			continue;
+		}
+		normal /= length;
+
+		auto q = Quadric::FromPlane(normal.x, normal.y, normal.z, -glm::dot(normal, p0), length * 0.5);
+		for (std::size_t e = 0; e < 3; e++)
+		{
+			quadrics[indices[i + e]] += q;
+		}
+
+		for (std::size_t e = 0; e < 3; e++)
+		{
+			auto a = indices[i + e];
+			auto b = indices[i + (e + 1) % 3];
+			if (!is_border_edge(a, b))
+			{
+				continue;
+			}
+
+			glm::vec3 edge = positions[b] - positions[a];
+			float edge_length = glm::length(edge);
+			if (edge_length <= 0)
+			{
+				continue;
+			}
+
+			glm::vec3 border_normal = glm::normalize(glm::cross(edge, normal));
+			auto border_q = Quadric::FromPlane(border_normal.x, border_normal.y, border_normal.z, -glm::dot(border_normal, positions[a]),
+				edge_length * edge_length * border_weight);
+			quadrics[a] += border_q;
+			quadrics[b] += border_q;
+		}
+	}
+
+	double error_limit = double(max_error) * double(max_error);
+	std::vector<VertexKind> kinds(num_vertices);
+	std::vector<std::uint32_t> adjacency_offsets(num_vertices + 1);
+	std::vector<std::uint32_t> adjacency;
+	std::vector<std::uint32_t> remap(num_vertices);
+	std::vector<bool> touched(num_vertices);
+	std::vector<Collapse> collapses;
+
+	while (indices.size() > target_index_count)
+	{
+		// Classify vertices on the current topology.
+		edges.Build(indices, canonical);
+		for (std::size_t v = 0; v < num_vertices; v++)
+		{
+			kinds[v] = has_wedges[v] ? VertexKind::LOCKED : VertexKind::MANIFOLD;
+		}
+		for (std::uint32_t a = 0; a < num_vertices; a++)
+		{
+			for (auto e = edges.m_offsets[a]; e < edges.m_offsets[a + 1]; e++)
+			{
+				auto b = edges.m_targets[e];
+				auto count = edges.Count(a, b);
+				auto reverse_count = edges.Count(b, a);
+
+				if (count > 1 || reverse_count > 1)
+				{
+					kinds[a] = VertexKind::LOCKED;
+					kinds[b] = VertexKind::LOCKED;
+				}
+				else if (reverse_count == 0)
+				{
+					if (kinds[a] == VertexKind::MANIFOLD) kinds[a] = VertexKind::BORDER;
+					if (kinds[b] == VertexKind::MANIFOLD) kinds[b] = VertexKind::BORDER;
+				}
+			}
+		}
+
+		// Vertex to triangle adjacency.
+		std::fill(adjacency_offsets.begin(), adjacency_offsets.end(), 0);
+		for (auto index : indices)
+		{
+			adjacency_offsets[index + 1]++;
+		}
+		for (std::size_t v = 0; v < num_vertices; v++)
+		{
+			adjacency_offsets[v + 1] += adjacency_offsets[v];
+		}
+		adjacency.resize(indices.size());
+		{
+			auto write_offsets = adjacency_offsets;
+			for (std::size_t i = 0; i < indices.size(); i++)
+			{
+				adjacency[write_offsets[indices[i]]++] = std::uint32_t(i / 3);
+			}
+		}
+
+		// Pick the cheapest direction of every edge.
+		auto can_collapse = [&](std::uint32_t from, std::uint32_t to)
+		{
+			return kinds[from] == VertexKind::MANIFOLD || (kinds[from] == VertexKind::BORDER && is_border_edge(from, to));
+		};
+
+		collapses.clear();
+		for (std::size_t i = 0; i < indices.size(); i += 3)
+		{
+			for (std::size_t e = 0; e < 3; e++)
+			{
+				auto a = indices[i + e];
+				auto b = indices[i + (e + 1) % 3];
+
+				// Interior edges are seen from both of their triangles, only evaluate them once.
+				bool maybe_border = kinds[a] != VertexKind::MANIFOLD && kinds[b] != VertexKind::MANIFOLD;
+				if (a > b && !(maybe_border && is_border_edge(a, b)))
+				{
+					continue;
+				}
+
+				double error_ab = can_collapse(a, b) ? quadrics[a].Error(positions[b]) : std::numeric_limits<double>::max();
+				double error_ba = can_collapse(b, a) ? quadrics[b].Error(positions[a]) : std::numeric_limits<double>::max();
+
+				if (error_ab == std::numeric_limits<double>::max() && error_ba == std::numeric_limits<double>::max())
+				{
+					continue;
+				}
+
+				collapses.push_back(error_ab <= error_ba ? Collapse{ a, b, error_ab } : Collapse{ b, a, error_ba });
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](Collapse const & a, Collapse const & b) { return a.m_error < b.m_error; });
+
+		// Collapse independent edges, a vertex takes part in at most one collapse per pass.
+		std::fill(touched.begin(), touched.end(), false);
+		for (std::uint32_t v = 0; v < num_vertices; v++)
+		{
+			remap[v] = v;
+		}
+
+		std::size_t num_triangles = indices.size() / 3;
+		std::size_t target_triangles = target_index_count / 3;
+		std::size_t num_collapsed = 0;
+
+		for (auto const & collapse : collapses)
+		{
+			if (collapse.m_error > error_limit || num_triangles <= target_triangles)
+			{
+				break;
+			}
+
+			auto from = collapse.m_from;
+			auto to = collapse.m_to;
+			if (touched[from] || touched[to])
+			{
+				continue;
+			}
+
+			// Reject collapses that flip a triangle.
+			bool flips = false;
+			std::size_t num_removed = 0;
+			for (auto t = adjacency_offsets[from]; t < adjacency_offsets[from + 1]; t++)
+			{
+				auto const * tri = &indices[adjacency[t] * 3];
+				if (tri[0] == to || tri[1] == to || tri[2] == to)
+				{
+					num_removed++;
+					continue;
+				}
+
+				glm::vec3 p[3] = { positions[tri[0]], positions[tri[1]], positions[tri[2]] };
+				glm::vec3 old_normal = TriangleNormal(p[0], p[1], p[2]);
+				for (std::size_t c = 0; c < 3; c++)
+				{
+					if (tri[c] == from) p[c] = positions[to];
+				}
+				glm::vec3 new_normal = TriangleNormal(p[0], p[1], p[2]);
+
+				if (glm::dot(old_normal, new_normal) <= 0)
+				{
+					flips = true;
+					break;
+				}
+			}
+
+			if (flips)
+			{
+				continue;
+			}
+
+			remap[from] = to;
+			quadrics[to] += quadrics[from];
+			result_error = std::max(result_error, collapse.m_error);
+			num_triangles -= num_removed;
+			num_collapsed++;
+
+			for (auto t = adjacency_offsets[from]; t < adjacency_offsets[from + 1]; t++)
+			{
+				auto const * tri = &indices[adjacency[t] * 3];
+				touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = true;
+			}
+		}
+
+		if (num_collapsed == 0)
+		{
+			break;
+		}
+
+		// Apply the collapses and drop the triangles that became degenerate.
+		std::size_t write = 0;
+		for (std::size_t i = 0; i < indices.size(); i += 3)
+		{
+			auto a = remap[indices[i + 0]];
+			auto b = remap[indices[i + 1]];
+			auto c = remap[indices[i + 2]];
+
+			if (a == b || b == c || c == a)
+			{
+				continue;
+			}
+
+			indices[write++] = a;
+			indices[write++] = b;
+			indices[write++] = c;
+		}
+		indices.resize(write);
+	}
+
+	if (out_error) *out_error = float(std::sqrt(result_error));
+
+	return indices;
+}
+
+std::vector<MeshLodData> MeshSimplifier::GenerateLods(std::vector<std::uint32_t> const & indices,
+	std::vector<glm::vec3> const & positions,
+	std::uint32_t num_lods,
+	float reduction,
+	float max_error)
+{
+	std::vector<MeshLodData> lods;
+	lods.reserve(num_lods);
+
+	// Simplify every level from the previous one, the errors of the steps are added up as a upper bound.
+	auto const * previous = &indices;
+	float error = 0;
+
+	for (std::uint32_t i = 0; i < num_lods && error < max_error; i++)
+	{
+		auto target_index_count = std::size_t(float(previous->size() / 3) * reduction) * 3;
+		if (target_index_count < 3)
+		{
+			break;
+		}
+
+		float lod_error = 0;
+		auto simplified = Simplify(*previous, positions, target_index_count, max_error - error, &lod_error);
+		if (simplified.empty() || float(simplified.size()) > float(previous->size()) * internal::min_lod_gain)
+		{
+			break;
+		}
+
+		error += lod_error;
+		lods.push_back({ std::move(simplified), error });
+		previous = &lods.back().m_indices;
+	}
+
+	return lods;
+}
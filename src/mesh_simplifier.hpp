@@ -0,0 +1,54 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm.hpp>
+
+static inline const float default_lod_reduction = 0.5f;
+static inline const float default_lod_max_error = 0.05f;
+
+//! A simplified index buffer of a mesh.
+struct MeshLodData
+{
+	std::vector<std::uint32_t> m_indices; // Index the vertices of the original mesh.
+	float m_error; // Geometric error relative to the largest extent of the mesh.
+};
+
+//! Quadric error metric edge collapse simplification.
+/*!
+	Based on "Surface Simplification Using Quadric Error Metrics" by Garland and Heckbert.
+	https://www.cs.cmu.edu/~./garland/Papers/quadrics.pdf
+
+	Edges are collapsed onto one of their vertices so the simplified index buffers keep indexing the original vertices.
+	Vertices on attribute seams (duplicated positions) and non-manifold edges are locked,
+	vertices on open borders only collapse along the border.
+*/
+struct MeshSimplifier
+{
+	//! Collapses edges until the index count drops below `target_index_count` or the next collapse would exceed `max_error`.
+	/*!
+		\param max_error Maximum geometric error relative to the largest extent of the mesh.
+		\param out_error When not null receives the error of the result relative to the largest extent of the mesh.
+	*/
+	static std::vector<std::uint32_t> Simplify(std::vector<std::uint32_t> const & indices,
+		std::vector<glm::vec3> const & positions,
+		std::size_t target_index_count,
+		float max_error = default_lod_max_error,
+		float* out_error = nullptr);
+
+	//! Generates up to `num_lods` successively simplified levels, each with `reduction` times the triangles of the previous one.
+	/*!
+		Stops early when a level can't be reduced any further within `max_error`. The original mesh is not part of the result.
+	*/
+	static std::vector<MeshLodData> GenerateLods(std::vector<std::uint32_t> const & indices,
+		std::vector<glm::vec3> const & positions,
+		std::uint32_t num_lods,
+		float reduction = default_lod_reduction,
+		float max_error = default_lod_max_error);
+};
@@ -0,0 +1,646 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include "meshlet_builder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace internal
+{
+
+	inline glm::vec3 TriangleNormal(std::vector<glm::vec3> const & positions, std::vector<std::uint32_t> const & indices, std::uint32_t triangle)
+	{
+		auto v0 = positions[indices[triangle * 3 + 0]];
+		auto v1 = positions[indices[triangle * 3 + 1]];
+		auto v2 = positions[indices[triangle * 3 + 2]];
+
+		glm::vec3 cross = glm::cross(v1 - v0, v2 - v0);
+		float length = glm::length(cross);
+
+		return length > FLT_EPSILON ? cross * (1.0f / length) : cross;
+	}
+
+	//! Uniform grid over triangle centroids used to find spatially close triangles that don't share a vertex.
+	class TriangleGrid
+	{
+	public:
+		TriangleGrid(std::vector<glm::vec3> const & centroids)
+		{
+			m_min = glm::vec3(std::numeric_limits<float>::max());
+			glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+			for (auto const & c : centroids)
+			{
+				m_min = glm::min(m_min, c);
+				max = glm::max(max, c);
+			}
+
+			// Aim for roughly 4 triangles per cell.
+			glm::vec3 extent = glm::max(max - m_min, glm::vec3(FLT_EPSILON));
+			float volume = extent.x * extent.y * extent.z;
+			float num_cells = std::max(1.f, centroids.size() / 4.f);
+			m_cell_size = std::cbrt(volume / num_cells);
+
+			// Flat or degenerate meshes: base the cell size on the largest extent instead.
+			float max_extent = std::max(extent.x, std::max(extent.y, extent.z));
+			m_cell_size = std::max(m_cell_size, max_extent / 256.f);
+			m_cell_size = std::max(m_cell_size, FLT_EPSILON);
+
+			for (auto i = 0; i < 3; i++)
+			{
+				m_dims[i] = std::max(1, std::min(256, int(std::ceil(extent[i] / m_cell_size))));
+			}
+
+			auto total_cells = std::size_t(m_dims[0]) * m_dims[1] * m_dims[2];
+			m_cell_start.resize(total_cells + 1, 0);
+			m_cell_count.resize(total_cells, 0);
+
+			std::vector<std::uint32_t> cell_of_triangle(centroids.size());
+			for (std::size_t i = 0; i < centroids.size(); i++)
+			{
+				cell_of_triangle[i] = CellIndex(CellCoord(centroids[i]));
+				m_cell_count[cell_of_triangle[i]]++;
+			}
+
+			for (std::size_t i = 0; i < total_cells; i++)
+			{
+				m_cell_start[i + 1] = m_cell_start[i] + m_cell_count[i];
+			}
+
+			m_triangles.resize(centroids.size());
+			std::vector<std::uint32_t> offsets(m_cell_start.begin(), m_cell_start.end() - 1);
+			for (std::size_t i = 0; i < centroids.size(); i++)
+			{
+				m_triangles[offsets[cell_of_triangle[i]]++] = static_cast<std::uint32_t>(i);
+			}
+		}
+
+		//! Returns the closest triangle that hasn't been emitted within `max_rings` cells. Returns ~0 if none was found.
+		std::uint32_t FindClosest(glm::vec3 const & point, std::vector<glm::vec3> const & centroids, std::vector<bool> const & emitted, int max_rings)
+		{
+			auto center = CellCoord(point);
+
+			std::uint32_t best = ~0u;
+			float best_dist = std::numeric_limits<float>::max();
+
+			for (int ring = 0; ring <= max_rings; ring++)
+			{
+				for (int z = center.z - ring; z <= center.z + ring; z++)
+				{
+					if (z < 0 || z >= m_dims[2]) continue;
+					for (int y = center.y - ring; y <= center.y + ring; y++)
+					{
+						if (y < 0 || y >= m_dims[1]) continue;
+						for (int x = center.x - ring; x <= center.x + ring; x++)
+						{
+							if (x < 0 || x >= m_dims[0]) continue;
+
+							// Only visit the shell of the ring.
+							if (std::max(std::abs(x - center.x), std::max(std::abs(y - center.y), std::abs(z - center.z))) != ring) continue;
+
+							auto cell = CellIndex({ x, y, z });
+							auto start = m_cell_start[cell];
+							auto& count = m_cell_count[cell];
+
+							for (std::uint32_t i = 0; i < count;)
+							{
+								auto tri = m_triangles[start + i];
+
+								// Lazily remove emitted triangles from the cell.
+								if (emitted[tri])
+								{
+									std::swap(m_triangles[start + i], m_triangles[start + count - 1]);
+									count--;
+									continue;
+								}
+
+								float dist = glm::length(centroids[tri] - point);
+								if (dist < best_dist)
+								{
+									best_dist = dist;
+									best = tri;
+								}
+								i++;
+							}
+						}
+					}
+				}
+
+				// Everything outside of this ring is at least `ring * cell size` away.
+				if (best != ~0u && best_dist <= ring * m_cell_size)
+				{
+					break;
+				}
+			}
+
+			return best;
+		}
+
+	private:
+		glm::ivec3 CellCoord(glm::vec3 const & p) const
+		{
+			glm::ivec3 coord;
+			for (auto i = 0; i < 3; i++)
+			{
+				coord[i] = std::max(0, std::min(m_dims[i] - 1, int((p[i] - m_min[i]) / m_cell_size)));
+			}
+			return coord;
+		}
+
+		std::uint32_t CellIndex(glm::ivec3 const & c) const
+		{
+			return std::uint32_t((c.z * m_dims[1] + c.y) * m_dims[0] + c.x);
+		}
+
+		glm::vec3 m_min;
+		float m_cell_size;
+		int m_dims[3];
+
+		std::vector<std::uint32_t> m_cell_start;
+		std::vector<std::uint32_t> m_cell_count;
+		std::vector<std::uint32_t> m_triangles;
+	};
+
+} /* internal */
+
+std::vector<std::uint32_t> MeshletBuilder::UnpackIndices(MeshData const & mesh_data)
+{
+	std::vector<std::uint32_t> indices(mesh_data.m_num_indices);
+
+	switch (mesh_data.m_indices_stride)
+	{
+	case 1:
+		for (std::size_t i = 0; i < mesh_data.m_num_indices; i++)
+		{
+			indices[i] = mesh_data.m_indices[i];
+		}
+		break;
+	case 2:
+		for (std::size_t i = 0; i < mesh_data.m_num_indices; i++)
+		{
+			std::uint16_t index;
+			memcpy(&index, &mesh_data.m_indices[i * 2], sizeof(std::uint16_t));
+			indices[i] = index;
+		}
+		break;
+	case 4:
+		memcpy(indices.data(), mesh_data.m_indices.data(), mesh_data.m_num_indices * sizeof(std::uint32_t));
+		break;
+	default:
+		assert(false && "Unsupported index stride");
+	}
+
+	return indices;
+}
+
+void MeshletBuilder::PackIndices(std::vector<std::uint32_t> const & indices, std::size_t stride, std::vector<unsigned char>& out_indices)
+{
+	out_indices.resize(indices.size() * stride);
+
+	switch (stride)
+	{
+	case 1:
+		for (std::size_t i = 0; i < indices.size(); i++)
+		{
+			out_indices[i] = static_cast<std::uint8_t>(indices[i]);
+		}
+		break;
+	case 2:
+		for (std::size_t i = 0; i < indices.size(); i++)
+		{
+			auto index = static_cast<std::uint16_t>(indices[i]);
+			memcpy(&out_indices[i * 2], &index, sizeof(std::uint16_t));
+		}
+		break;
+	case 4:
+		memcpy(out_indices.data(), indices.data(), indices.size() * sizeof(std::uint32_t));
+		break;
+	default:
+		assert(false && "Unsupported index stride");
+	}
+}
+
+std::vector<MeshletCluster> MeshletBuilder::BuildMeshlets(std::vector<glm::vec3> const & positions,
+	std::vector<std::uint32_t> const & indices,
+	std::uint32_t max_vertices,
+	std::uint32_t max_primitives)
+{
+	assert(max_vertices >= 3 && max_vertices <= max_vertex_count_limit);
+	assert(max_primitives >= 1 && max_primitives <= max_primitive_count_limit);
+
+	const std::uint32_t num_triangles = static_cast<std::uint32_t>(indices.size() / 3);
+	const std::uint32_t num_vertices = static_cast<std::uint32_t>(positions.size());
+	const int max_search_rings = 4;
+
+	std::vector<MeshletCluster> meshlets;
+	if (num_triangles == 0)
+	{
+		return meshlets;
+	}
+
+	// Vertex to triangle adjacency. `live_count` shrinks as triangles get emitted so we never revisit them.
+	std::vector<std::uint32_t> adjacency_offsets(num_vertices + 1, 0);
+	std::vector<std::uint32_t> live_count(num_vertices, 0);
+	for (auto index : indices)
+	{
+		live_count[index]++;
+	}
+	for (std::uint32_t i = 0; i < num_vertices; i++)
+	{
+		adjacency_offsets[i + 1] = adjacency_offsets[i] + live_count[i];
+	}
+	std::vector<std::uint32_t> adjacency(indices.size());
+	{
+		std::vector<std::uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+		for (std::uint32_t t = 0; t < num_triangles; t++)
+		{
+			for (auto k = 0; k < 3; k++)
+			{
+				adjacency[fill[indices[t * 3 + k]]++] = t;
+			}
+		}
+	}
+
+	std::vector<glm::vec3> centroids(num_triangles);
+	for (std::uint32_t t = 0; t < num_triangles; t++)
+	{
+		centroids[t] = (positions[indices[t * 3 + 0]] + positions[indices[t * 3 + 1]] + positions[indices[t * 3 + 2]]) / 3.f;
+	}
+
+	internal::TriangleGrid grid(centroids);
+	std::vector<bool> emitted(num_triangles, false);
+	std::vector<std::uint32_t> vertex_meshlet(num_vertices, ~0u); // The id of the meshlet the vertex was last added to.
+	// Triangles sharing a vertex with the current meshlet, bucketed by how many vertices they would add. Only updated from
+	// the live triangles of a vertex when it joins the meshlet. Entries go stale once their triangle is emitted or moves to a
+	// lower bucket and are dropped when their bucket gets scanned.
+	std::vector<std::uint32_t> candidates[3];
+	std::vector<std::uint32_t> triangle_meshlet(num_triangles, ~0u); // The id of the meshlet the triangle was last a candidate of.
+	std::vector<std::uint8_t> triangle_new_vertices(num_triangles, 0);
+	std::uint32_t next_unemitted = 0;
+	std::uint32_t num_emitted = 0;
+
+	auto count_new_vertices = [&](std::uint32_t t, std::uint32_t meshlet_id)
+	{
+		auto a = indices[t * 3 + 0];
+		auto b = indices[t * 3 + 1];
+		auto c = indices[t * 3 + 2];
+
+		std::uint32_t result = 0;
+		result += vertex_meshlet[a] != meshlet_id;
+		result += vertex_meshlet[b] != meshlet_id && b != a;
+		result += vertex_meshlet[c] != meshlet_id && c != a && c != b;
+		return result;
+	};
+
+	auto add_candidates = [&](std::uint32_t v, std::uint32_t meshlet_id)
+	{
+		auto begin = adjacency_offsets[v];
+		for (auto i = begin; i < begin + live_count[v]; i++)
+		{
+			auto t = adjacency[i];
+			auto new_vertices = static_cast<std::uint8_t>(count_new_vertices(t, meshlet_id));
+			if (triangle_meshlet[t] == meshlet_id && triangle_new_vertices[t] == new_vertices) continue;
+
+			triangle_meshlet[t] = meshlet_id;
+			triangle_new_vertices[t] = new_vertices;
+			candidates[new_vertices].push_back(t);
+		}
+	};
+
+	auto emit = [&](MeshletCluster& meshlet, std::uint32_t meshlet_id, std::uint32_t t)
+	{
+		emitted[t] = true;
+
+		for (auto k = 0; k < 3; k++)
+		{
+			auto v = indices[t * 3 + k];
+			if (vertex_meshlet[v] != meshlet_id)
+			{
+				vertex_meshlet[v] = meshlet_id;
+				meshlet.m_vertices.push_back(v);
+				add_candidates(v, meshlet_id);
+			}
+
+			// Remove the triangle from the live adjacency of the vertex.
+			auto begin = adjacency.begin() + adjacency_offsets[v];
+			auto end = begin + live_count[v];
+			auto it = std::find(begin, end, t);
+			if (it != end)
+			{
+				std::iter_swap(it, end - 1);
+				live_count[v]--;
+			}
+		}
+
+		meshlet.m_triangles.push_back(t);
+		num_emitted++;
+	};
+
+	glm::vec3 previous_center = centroids[0];
+
+	while (num_emitted < num_triangles)
+	{
+		auto meshlet_id = static_cast<std::uint32_t>(meshlets.size());
+		MeshletCluster meshlet;
+		meshlet.m_vertices.reserve(max_vertices);
+		meshlet.m_triangles.reserve(max_primitives);
+		for (auto& bucket : candidates)
+		{
+			bucket.clear();
+		}
+
+		// Seed the meshlet with the triangle closest to the previous meshlet to keep consecutive meshlets close together.
+		std::uint32_t seed = grid.FindClosest(previous_center, centroids, emitted, max_search_rings);
+		if (seed == ~0u)
+		{
+			while (emitted[next_unemitted]) next_unemitted++;
+			seed = next_unemitted;
+		}
+
+		emit(meshlet, meshlet_id, seed);
+		glm::vec3 centroid_sum = centroids[seed];
+
+		while (meshlet.m_triangles.size() < max_primitives)
+		{
+			glm::vec3 center = centroid_sum / float(meshlet.m_triangles.size());
+
+			std::uint32_t best = ~0u;
+			float best_dist = std::numeric_limits<float>::max();
+
+			// Connected triangles: the closest one of the lowest bucket that still fits.
+			for (std::uint32_t new_vertices = 0; new_vertices < 3 && best == ~0u; new_vertices++)
+			{
+				if (meshlet.m_vertices.size() + new_vertices > max_vertices) break;
+
+				auto& bucket = candidates[new_vertices];
+				std::size_t num_live = 0;
+				for (auto t : bucket)
+				{
+					if (emitted[t] || triangle_new_vertices[t] != new_vertices) continue;
+					bucket[num_live++] = t;
+
+					float dist = glm::length(centroids[t] - center);
+					if (dist < best_dist)
+					{
+						best = t;
+						best_dist = dist;
+					}
+				}
+				bucket.resize(num_live);
+			}
+
+			// No connected triangles left, continue with the closest disconnected triangle.
+			if (best == ~0u)
+			{
+				auto t = grid.FindClosest(center, centroids, emitted, max_search_rings);
+				if (t != ~0u && meshlet.m_vertices.size() + count_new_vertices(t, meshlet_id) <= max_vertices)
+				{
+					best = t;
+				}
+			}
+
+			if (best == ~0u)
+			{
+				break;
+			}
+
+			emit(meshlet, meshlet_id, best);
+			centroid_sum += centroids[best];
+		}
+
+		previous_center = centroid_sum / float(meshlet.m_triangles.size());
+		meshlets.emplace_back(std::move(meshlet));
+	}
+
+	return meshlets;
+}
+
+void MeshletBuilder::FlattenMeshlets(std::vector<MeshletCluster> const & meshlets,
+	std::vector<std::uint32_t> const & indices,
+	std::size_t num_vertices,
+	std::vector<MeshletDesc>& out_descs,
+	std::vector<std::uint32_t>& out_vertex_indices,
+	std::vector<std::uint8_t>& out_flat_indices)
+{
+	std::size_t total_vertices = 0;
+	std::size_t total_prims = 0;
+	for (auto const & meshlet : meshlets)
+	{
+		total_vertices += SizeAlignTwoPower(static_cast<std::uint32_t>(meshlet.m_vertices.size()), vertex_packing_alignment);
+		total_prims += SizeAlignTwoPower(static_cast<std::uint32_t>(meshlet.m_triangles.size()), static_cast<std::uint32_t>(primitive_packing_alignment));
+	}
+
+	out_descs.clear();
+	out_vertex_indices.clear();
+	out_flat_indices.clear();
+	out_descs.reserve(meshlets.size());
+	out_vertex_indices.reserve(total_vertices);
+	out_flat_indices.reserve(total_prims * 3);
+
+	// Generation stamped remap from mesh vertex to meshlet local vertex.
+	// A vertex belongs to the current meshlet when its stamp equals the current generation so nothing needs to be cleared between meshlets.
+	std::vector<std::uint32_t> stamps(num_vertices, 0);
+	std::vector<std::uint8_t> local_indices(num_vertices);
+	std::uint32_t generation = 0;
+
+	for (auto const & meshlet : meshlets)
+	{
+		generation++;
+
+		auto vertex_begin = SizeAlignTwoPower(static_cast<std::uint32_t>(out_vertex_indices.size()), vertex_packing_alignment);
+		auto prim_begin = SizeAlignTwoPower(static_cast<std::uint32_t>(out_flat_indices.size() / 3), static_cast<std::uint32_t>(primitive_packing_alignment));
+
+		// pad to alignment
+		out_vertex_indices.resize(vertex_begin, 0);
+		out_flat_indices.resize(prim_begin * 3, 0);
+
+		for (auto t : meshlet.m_triangles)
+		{
+			for (auto k = 0; k < 3; k++)
+			{
+				auto index = indices[t * 3 + k];
+
+				if (stamps[index] != generation)
+				{
+					stamps[index] = generation;
+					local_indices[index] = static_cast<std::uint8_t>(out_vertex_indices.size() - vertex_begin);
+					out_vertex_indices.push_back(index);
+				}
+
+				out_flat_indices.push_back(local_indices[index]);
+			}
+		}
+
+		MeshletDesc desc = {};
+		desc.SetNumVertices(static_cast<std::uint32_t>(out_vertex_indices.size() - vertex_begin));
+		desc.SetVertexBegin(vertex_begin);
+		desc.SetNumPrims(static_cast<std::uint32_t>(meshlet.m_triangles.size()));
+		desc.SetPrimBegin(prim_begin);
+		out_descs.push_back(desc);
+	}
+}
+
+MeshletBounds MeshletBuilder::CalculateBounds(MeshletCluster const & meshlet,
+	std::vector<glm::vec3> const & positions,
+	std::vector<std::uint32_t> const & indices)
+{
+	MeshletBounds bounds = {};
+	if (meshlet.m_vertices.empty())
+	{
+		return bounds;
+	}
+
+	// Normal cone
+	glm::vec3 average_normal = glm::vec3(0);
+	for (auto t : meshlet.m_triangles)
+	{
+		glm::vec3 normal = internal::TriangleNormal(positions, indices, t);
+		average_normal += normal;
+	}
+
+	// potential improvement, instead of average maybe use
+	// http://www.cs.technion.ac.il/~cggc/files/gallery-pdfs/Barequet-1.pdf
+	float len = glm::length(average_normal);
+	if (len <= FLT_EPSILON)
+	{
+		// Normals cancel each other out, the meshlet can't be backface culled.
+		return bounds;
+	}
+	average_normal = average_normal / len;
+
+	glm::vec3 packed = FVec3ToOctnPrecise(average_normal, 16);
+	bounds.m_cone_oct_x = std::min(127, std::max(-127, std::int32_t(packed.x * 127.0f)));
+	bounds.m_cone_oct_y = std::min(127, std::max(-127, std::int32_t(packed.y * 127.0f)));
+
+	// post quantization normal
+	bounds.m_cone_axis = OctToFVec3(glm::vec3(float(bounds.m_cone_oct_x) / 127.0f, float(bounds.m_cone_oct_y) / 127.0f, 0.0f));
+
+	float mindot = 1.0f;
+	for (auto t : meshlet.m_triangles)
+	{
+		mindot = std::min(mindot, glm::dot(internal::TriangleNormal(positions, indices, t), bounds.m_cone_axis));
+	}
+
+	// apply safety delta due to quantization
+	mindot -= 1.0f / 127.0f;
+	mindot = std::max(-1.0f, mindot);
+	bounds.m_cone_cutoff = mindot;
+
+	// positive value for cluster not being backface cullable (normals > 90)
+	bounds.m_cone_angle = 127;
+	if (mindot > 0)
+	{
+		// otherwise store -sin(cone angle)
+		// we test against dot product (cosine) so this is equivalent to cos(cone angle + 90 degrees)
+		float angle = -sinf(acosf(mindot));
+		bounds.m_cone_angle = std::max(-127, std::min(127, int32_t(angle * 127.0f)));
+	}
+
+	return bounds;
+}
+
+void MeshletBuilder::FinalizeMeshlets(std::vector<MeshletCluster> const & clusters,
+	std::vector<glm::vec3> const & positions,
+	std::vector<std::uint32_t> const & indices,
+	MeshBoundingBox const & mesh_bbox,
+	std::vector<MeshletDesc>& out_meshlet_data,
+	std::vector<std::uint32_t>& out_vertex_indices,
+	std::vector<std::uint8_t>& out_index_indices,
+	MeshletStats& stats)
+{
+	FlattenMeshlets(clusters, indices, positions.size(), out_meshlet_data, out_vertex_indices, out_index_indices);
+
+	for (std::size_t i = 0; i < clusters.size(); i++)
+	{
+		auto const & cluster = clusters[i];
+		auto& meshlet = out_meshlet_data[i];
+
+		glm::vec3 bbox_min = glm::vec3(std::numeric_limits<float>::max());
+		glm::vec3 bbox_max = glm::vec3(-std::numeric_limits<float>::max());
+
+		for (auto v : cluster.m_vertices)
+		{
+			bbox_min = glm::min(bbox_min, positions[v]);
+			bbox_max = glm::max(bbox_max, positions[v]);
+		}
+
+		TruncateBBoxToMeshBBox(bbox_min, bbox_max, mesh_bbox);
+
+		// Snap to grid
+		const int grid_bits = 8;
+		const int grid_last = (1 << grid_bits) - 1;
+		uint8_t   grid_min[3];
+		uint8_t   grid_max[3];
+
+		grid_min[0] = std::max(0, std::min(int(truncf(bbox_min.x * float(grid_last))), grid_last - 1));
+		grid_min[1] = std::max(0, std::min(int(truncf(bbox_min.y * float(grid_last))), grid_last - 1));
+		grid_min[2] = std::max(0, std::min(int(truncf(bbox_min.z * float(grid_last))), grid_last - 1));
+		grid_max[0] = std::max(0, std::min(int(ceilf(bbox_max.x * float(grid_last))), grid_last));
+		grid_max[1] = std::max(0, std::min(int(ceilf(bbox_max.y * float(grid_last))), grid_last));
+		grid_max[2] = std::max(0, std::min(int(ceilf(bbox_max.z * float(grid_last))), grid_last));
+
+		meshlet.SetBBox(grid_min, grid_max);
+
+		auto bounds = CalculateBounds(cluster, positions, indices);
+		stats.m_num_backface_cullable += bounds.IsBackfaceCullable() ? 1 : 0;
+
+		meshlet.SetCone(bounds.m_cone_oct_x, bounds.m_cone_oct_y, bounds.m_cone_angle);
+	}
+}
+
+MeshletStats MeshletBuilder::CalculateStats(std::vector<MeshletCluster> const & meshlets,
+	std::vector<glm::vec3> const & positions,
+	std::vector<std::uint32_t> const & indices)
+{
+	MeshletStats stats = {};
+	if (meshlets.empty())
+	{
+		return stats;
+	}
+
+	glm::vec3 mesh_min = glm::vec3(std::numeric_limits<float>::max());
+	glm::vec3 mesh_max = glm::vec3(-std::numeric_limits<float>::max());
+	for (auto index : indices)
+	{
+		mesh_min = glm::min(mesh_min, positions[index]);
+		mesh_max = glm::max(mesh_max, positions[index]);
+	}
+
+	auto volume = [](glm::vec3 const & min, glm::vec3 const & max)
+	{
+		// Clamp the extent to avoid zero volumes for flat geometry.
+		glm::vec3 extent = glm::max(max - min, glm::vec3(1e-6f));
+		return double(extent.x) * extent.y * extent.z;
+	};
+
+	double mesh_volume = volume(mesh_min, mesh_max);
+	double total_relative_volume = 0;
+
+	for (auto const & meshlet : meshlets)
+	{
+		stats.m_num_triangles += meshlet.m_triangles.size();
+		stats.m_num_vertex_references += meshlet.m_vertices.size();
+
+		glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+		glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+		for (auto v : meshlet.m_vertices)
+		{
+			min = glm::min(min, positions[v]);
+			max = glm::max(max, positions[v]);
+		}
+
+		total_relative_volume += volume(min, max) / mesh_volume;
+	}
+
+	stats.m_num_meshlets = meshlets.size();
+	stats.m_vertices_per_triangle = float(stats.m_num_vertex_references) / float(stats.m_num_triangles);
+	stats.m_vertex_fill_rate = float(stats.m_num_vertex_references) / float(stats.m_num_meshlets * max_vertex_count_limit);
+	stats.m_primitive_fill_rate = float(stats.m_num_triangles) / float(stats.m_num_meshlets * max_primitive_count_limit);
+	stats.m_average_bbox_volume = float(total_relative_volume / stats.m_num_meshlets);
+
+	return stats;
+}
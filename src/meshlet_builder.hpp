@@ -9,14 +9,19 @@
 #include <cstdint>
 #include <cassert>
 #include <cstring>
+#include <cfloat>
+#include <cmath>
+#include <vector>
 #include <glm.hpp>
 
 #include "vertex.hpp"
+#include "resource_structs.hpp"
 #include "util/bitfield.hpp"
 
-static inline const int max_vertex_count_limit = 256;
+// The vertex and primitive limits need to match `NVMESHLET_VERTEX_COUNT` and `NVMESHLET_PRIMITIVE_COUNT` in `mesh_shader_util.glsl`.
+static inline const int max_vertex_count_limit = 64;
 static inline const int primitive_packing_alignment = 1;
-static inline const int max_primitive_count_limit = 21;
+static inline const int max_primitive_count_limit = 126;
 static inline const std::uint32_t vertex_packing_alignment = 16;
 static inline const std::uint32_t meshlets_per_task = 32;
 
@@ -26,6 +31,65 @@ constexpr inline T SizeAlignTwoPower(T size, A alignment)
 	return (size + (alignment - 1U)) & ~(alignment - 1U);
 }
 
+// all oct functions derived from "A Survey of Efficient Representations for Independent Unit Vectors"
+// http://jcgt.org/published/0003/02/01/paper.pdf
+inline glm::vec3 OctSignNotZero(glm::vec3 v)
+{
+	// leaves z as is
+	return glm::vec3((v.x >= 0.0f) ? +1.0f : -1.0f, (v.y >= 0.0f) ? +1.0f : -1.0f, 1.0f);
+}
+
+inline glm::vec3 OctToFVec3(glm::vec3 e)
+{
+	auto v = glm::vec3(e.x, e.y, 1.0f - fabsf(e.x) - fabsf(e.y));
+	if (v.z < 0.0f)
+	{
+		v = glm::vec3(1.0f - fabs(v.y), 1.0f - fabs(v.x), v.z) * OctSignNotZero(v);
+	}
+	return glm::normalize(v);
+}
+
+inline glm::vec3 FVec3ToOct(glm::vec3 v)
+{
+	// Project the sphere onto the octahedron, and then onto the xy plane
+	glm::vec3 p = glm::vec3(v.x, v.y, 0) * (1.0f / (fabsf(v.x) + fabsf(v.y) + fabsf(v.z)));
+	// Reflect the folds of the lower hemisphere over the diagonals
+	return (v.z <= 0.0f) ? glm::vec3(1.0f - fabsf(p.y), 1.0f - fabsf(p.x), 0.0f) * OctSignNotZero(p) : p;
+}
+
+inline glm::vec3 FVec3ToOctnPrecise(glm::vec3 v, const int n)
+{
+	glm::vec3 s = FVec3ToOct(v);  // Remap to the square
+								  // Each snorm's max value interpreted as an integer,
+								  // e.g., 127.0 for snorm8
+	float M = float(1 << ((n / 2) - 1)) - 1.0;
+	// Remap components to snorm(n/2) precision...with floor instead
+	// of round (see equation 1)
+	s = glm::floor(glm::clamp(s, glm::vec3(-1.0f), glm::vec3(1.0f)) * M) * glm::vec3(1.0 / M);
+	glm::vec3 bestRepresentation = s;	
+	float highestCosine = glm::dot(OctToFVec3(s), v);
+	// Test all combinations of floor and ceil and keep the best.
+	// Note that at +/- 1, this will exit the square... but that
+	// will be a worse encoding and never win.
+	for (int i = 0; i <= 1; ++i)
+		for (int j = 0; j <= 1; ++j)
+			// This branch will be evaluated at compile time
+			if ((i != 0) || (j != 0))
+			{
+				// Offset the bit pattern (which is stored in floating
+				// point!) to effectively change the rounding mode
+				// (when i or j is 0: floor, when it is one: ceiling)
+				glm::vec3 candidate = glm::vec3(i, j, 0) * (1 / M) + s;
+				float cosine = glm::dot(OctToFVec3(candidate), v);
+				if (cosine > highestCosine)
+				{
+					bestRepresentation = candidate;
+					highestCosine = cosine;
+				}
+			}
+	return bestRepresentation;
+}
+
 struct MeshletDesc
 {
 	MeshletDesc() : m_x(0), m_y(0), m_z(0), m_w(0)
@@ -142,69 +206,130 @@ struct MeshletDesc
 
 struct MeshBoundingBox
 {
-	glm::vec3 m_average_normal = glm::vec3(0);
-	std::vector<glm::vec3> m_tri_normals;
 	glm::vec3 m_min = glm::vec3(std::numeric_limits<float>::max());
 	glm::vec3 m_max = glm::vec3(-std::numeric_limits<float>::max());
 };
 
-struct MeshletBuilder
+//! Culling data of a single meshlet computed from its own triangles.
+struct MeshletBounds
 {
-	template<typename VT>
-	static MeshBoundingBox CalculateBoundingBox(MeshData const & mesh_data)
-	{
-		MeshBoundingBox bbox = {};
-
-		for (auto i = 0; i < mesh_data.m_num_indices; i += 3)
-		{
-			glm::ivec3 triangle;
-			memcpy(&triangle, &mesh_data.m_indices[i * mesh_data.m_indices_stride], mesh_data.m_indices_stride * 3);
+	glm::vec3 m_cone_axis = glm::vec3(0); // Post quantization axis.
+	float m_cone_cutoff = 1; // cos(cone angle) the minimum dot product between the axis and any triangle normal.
 
-			auto v0 = mesh_data.m_positions[triangle[0]];
-			auto v1 = mesh_data.m_positions[triangle[1]];
-			auto v2 = mesh_data.m_positions[triangle[2]];
+	// Quantized values as stored in `MeshletDesc`.
+	std::int8_t m_cone_oct_x = 0;
+	std::int8_t m_cone_oct_y = 0;
+	std::int8_t m_cone_angle = 127; // -sin(cone angle) as snorm8, positive when the meshlet can't be backface culled.
 
-			// bounding box
-			{
-				bbox.m_min = glm::min(bbox.m_min, v0);
-				bbox.m_min = glm::min(bbox.m_min, v1);
-				bbox.m_min = glm::min(bbox.m_min, v2);
+	bool IsBackfaceCullable() const { return m_cone_angle < 0; }
+};
 
-				bbox.m_max = glm::max(bbox.m_max, v0);
-				bbox.m_max = glm::max(bbox.m_max, v1);
-				bbox.m_max = glm::max(bbox.m_max, v2);
-			}
+//! A cluster of triangles produced by `MeshletBuilder::BuildMeshlets`.
+struct MeshletCluster
+{
+	std::vector<std::uint32_t> m_vertices; // Unique vertex indices used by the meshlet in order of first use.
+	std::vector<std::uint32_t> m_triangles; // Triangle id's (index / 3) into the index buffer of the mesh.
+};
 
-			// cone
-			{
-				glm::vec3 cross = glm::cross(v1 - v0, v2 - v0);
-				float length = glm::length(cross);
+//! Quality metrics of a set of meshlets.
+struct MeshletStats
+{
+	std::size_t m_num_meshlets = 0;
+	std::size_t m_num_triangles = 0;
+	std::size_t m_num_vertex_references = 0;
+	std::size_t m_num_backface_cullable = 0; // Meshlets with a normal cone narrow enough for backface culling. Filled in by the caller of `CalculateBounds`.
+	float m_vertices_per_triangle = 0; // Lower is better. A perfectly reused regular grid approaches 0.5.
+	float m_vertex_fill_rate = 0; // Average number of vertices divided by `max_vertex_count_limit`.
+	float m_primitive_fill_rate = 0; // Average number of primitives divided by `max_primitive_count_limit`.
+	float m_average_bbox_volume = 0; // Average volume of a meshlet bounding box relative to the volume of the mesh bounding box.
+
+	//! Combines the statistics of two meshes. Averages are weighted by meshlet and triangle count.
+	void Merge(MeshletStats const & other)
+	{
+		auto num_meshlets = m_num_meshlets + other.m_num_meshlets;
+		if (num_meshlets == 0) return;
+
+		m_average_bbox_volume = (m_average_bbox_volume * m_num_meshlets + other.m_average_bbox_volume * other.m_num_meshlets) / num_meshlets;
+		m_num_meshlets = num_meshlets;
+		m_num_triangles += other.m_num_triangles;
+		m_num_vertex_references += other.m_num_vertex_references;
+		m_num_backface_cullable += other.m_num_backface_cullable;
+		m_vertices_per_triangle = float(m_num_vertex_references) / float(m_num_triangles);
+		m_vertex_fill_rate = float(m_num_vertex_references) / float(m_num_meshlets * max_vertex_count_limit);
+		m_primitive_fill_rate = float(m_num_triangles) / float(m_num_meshlets * max_primitive_count_limit);
+	}
+};
 
-				glm::vec3 normal;
-				if (length > FLT_EPSILON)
-				{
-					normal = cross * (1.0f / length);
-				}
-				else
-				{
-					normal = cross;
-				}
+struct MeshletBuilder
+{
+	//! Reads the index buffer of a mesh into 32 bit indices. Supports 8, 16 and 32 bit index strides.
+	static std::vector<std::uint32_t> UnpackIndices(MeshData const & mesh_data);
+
+	//! Writes 32 bit indices into a index buffer with a stride of 1, 2 or 4 bytes.
+	static void PackIndices(std::vector<std::uint32_t> const & indices, std::size_t stride, std::vector<unsigned char>& out_indices);
+
+	//! Greedily partitions a triangle list into meshlets.
+	/*!
+		Meshlets are grown from a seed triangle by picking the neighbouring triangle that adds the least amount of new vertices,
+		ties are broken by the distance to the center of the meshlet. When a meshlet runs out of connected triangles it continues
+		with the spatially closest triangle so disconnected geometry still produces full meshlets.
+		A meshlet is closed when either `max_vertices` or `max_primitives` would be exceeded.
+	*/
+	static std::vector<MeshletCluster> BuildMeshlets(std::vector<glm::vec3> const & positions,
+		std::vector<std::uint32_t> const & indices,
+		std::uint32_t max_vertices = max_vertex_count_limit,
+		std::uint32_t max_primitives = max_primitive_count_limit);
+
+	static MeshletStats CalculateStats(std::vector<MeshletCluster> const & meshlets,
+		std::vector<glm::vec3> const & positions,
+		std::vector<std::uint32_t> const & indices);
+
+	//! Converts meshlets into the buffers consumed by the mesh shaders.
+	/*!
+		Writes one `MeshletDesc` per meshlet with the vertex/primitive counts and offsets filled in,
+		the vertex indices into the vertex buffer (aligned to `vertex_packing_alignment`) and 3 local 8 bit indices per primitive.
+		The bounding box and cone of the descriptors are left for the caller.
+		The outputs are cleared first so they can be reused between meshes.
+	*/
+	static void FlattenMeshlets(std::vector<MeshletCluster> const & meshlets,
+		std::vector<std::uint32_t> const & indices,
+		std::size_t num_vertices,
+		std::vector<MeshletDesc>& out_descs,
+		std::vector<std::uint32_t>& out_vertex_indices,
+		std::vector<std::uint8_t>& out_flat_indices);
+
+	//! Flattens the meshlets of a mesh and encodes their bounding box (snapped to a grid in `mesh_bbox`) and normal cone in the descriptors.
+	/*!
+		This is everything `ModelPool` does to turn meshlets into uploadable buffers. Adds the backface cullable meshlets to `stats`.
+	*/
+	static void FinalizeMeshlets(std::vector<MeshletCluster> const & clusters,
+		std::vector<glm::vec3> const & positions,
+		std::vector<std::uint32_t> const & indices,
+		MeshBoundingBox const & mesh_bbox,
+		std::vector<MeshletDesc>& out_meshlet_data,
+		std::vector<std::uint32_t>& out_vertex_indices,
+		std::vector<std::uint8_t>& out_index_indices,
+		MeshletStats& stats);
+
+	//! Calculates the normal cone of a single meshlet.
+	/*!
+		The task shader culls against the bounding box in `MeshletDesc`, so no bounding sphere is needed.
+		The cone axis is the average of the triangle normals, quantized the same way as `MeshletDesc` stores it.
+		The cutoff is derived from the quantized axis so the cone stays conservative after packing.
+	*/
+	static MeshletBounds CalculateBounds(MeshletCluster const & meshlet,
+		std::vector<glm::vec3> const & positions,
+		std::vector<std::uint32_t> const & indices);
 
-				bbox.m_average_normal += normal;
-				bbox.m_tri_normals.push_back(normal);
-			}
-		}
+	template<typename VT>
+	static MeshBoundingBox CalculateBoundingBox(MeshData const & mesh_data)
+	{
+		MeshBoundingBox bbox = {};
 
-		// potential improvement, instead of average maybe use
-		// http://www.cs.technion.ac.il/~cggc/files/gallery-pdfs/Barequet-1.pdf
-		float len = glm::length(bbox.m_average_normal);
-		if (len > FLT_EPSILON)
-		{
-			bbox.m_average_normal = bbox.m_average_normal / len;
-		}
-		else
+		for (auto const & pos : mesh_data.m_positions)
 		{
-			bbox.m_average_normal = glm::vec3(0.0f);
+			bbox.m_min = glm::min(bbox.m_min, pos);
+			bbox.m_max = glm::max(bbox.m_max, pos);
 		}
 
 		return bbox;
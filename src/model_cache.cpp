@@ -0,0 +1,468 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include "model_cache.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+#include "settings.hpp"
+#include "stb_image_loader.hpp"
+#include "util/hash.hpp"
+#include "util/log.hpp"
+
+namespace internal
+{
+
+	//! Returns the external buffer uri's of a glTF file. Only looks for `"uri"` strings ending in `.bin` to avoid a full JSON parse.
+	inline std::vector<std::string> FindGLTFBuffers(std::string_view json)
+	{
+		std::vector<std::string> uris;
+
+		std::size_t pos = 0;
+		while ((pos = json.find("\"uri\"", pos)) != std::string_view::npos)
+		{
+			pos += 5;
+			auto begin = json.find('"', pos);
+			if (begin == std::string_view::npos) break;
+			auto end = json.find('"', begin + 1);
+			if (end == std::string_view::npos) break;
+
+			auto uri = json.substr(begin + 1, end - begin - 1);
+			if (uri.size() > 4 && uri.substr(uri.size() - 4) == ".bin")
+			{
+				uris.emplace_back(uri);
+			}
+			pos = end + 1;
+		}
+
+		return uris;
+	}
+
+	//! Size of the pixels of a embedded texture. Matches the allocation of the loaders, which store tightly packed components.
+	inline std::size_t GetEmbeddedPixelSize(TextureData const & texture)
+	{
+		return std::size_t(texture.m_width) * texture.m_height * texture.m_channels * (texture.m_is_hdr ? sizeof(float) : sizeof(std::uint8_t));
+	}
+
+	inline std::array<TextureData MaterialData::*, ModelCacheMaterial::num_textures> GetMaterialTextures()
+	{
+		return {
+			&MaterialData::m_albedo_texture,
+			&MaterialData::m_metallic_texture,
+			&MaterialData::m_roughness_texture,
+			&MaterialData::m_ambient_occlusion_texture,
+			&MaterialData::m_normal_map_texture,
+			&MaterialData::m_emissive_texture,
+			&MaterialData::m_thickness_texture,
+			&MaterialData::m_displacement_texture
+		};
+	}
+
+} /* internal */
+
+std::optional<std::uint64_t> model_cache::HashSourceFile(std::string const & path)
+{
+	util::MappedFile file(path);
+	if (!file.IsValid())
+	{
+		return std::nullopt;
+	}
+
+	auto hash = util::FNV1a(file.GetData(), file.GetSize());
+
+	auto extension = path.substr(path.find_last_of('.') + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+	if (extension == "gltf")
+	{
+		std::string base_dir = path.find('/') != std::string::npos ? path.substr(0, path.find_last_of('/') + 1) : "";
+
+		for (auto const & uri : internal::FindGLTFBuffers(std::string_view(reinterpret_cast<char const *>(file.GetData()), file.GetSize())))
+		{
+			util::MappedFile buffer(base_dir + uri);
+			if (!buffer.IsValid())
+			{
+				return std::nullopt;
+			}
+			hash = util::FNV1a(buffer.GetData(), buffer.GetSize(), hash);
+		}
+	}
+
+	return hash;
+}
+
+std::uint64_t model_cache::HashProcessingSettings()
+{
+	auto hash = util::fnv_offset_basis;
+	auto add = [&hash](auto const & value)
+	{
+		hash = util::FNV1aValue(value, hash);
+	};
+
+	add(std::uint32_t(settings::optimize_meshes));
+	add(settings::mesh_lod_reduction);
+	add(settings::mesh_lod_max_error);
+	add(settings::model_loading_chunk_size);
+
+	return hash;
+}
+
+std::string model_cache::GetCachePath(std::string const & source_path, std::uint32_t vertex_layout)
+{
+	auto path_hash = util::FNV1a(source_path.data(), source_path.size());
+	auto stem = std::filesystem::path(source_path).stem().string();
+
+	return fmt::format("{}{}_{:016x}_{:08x}.skmc", settings::model_cache_directory, stem, path_hash, vertex_layout);
+}
+
+ModelCacheWriter::ModelCacheWriter(std::uint64_t source_hash, std::uint32_t vertex_layout, std::uint32_t vertex_stride)
+	: m_header()
+{
+	m_header.m_magic = model_cache::magic;
+	m_header.m_version = model_cache::version;
+	m_header.m_source_hash = source_hash;
+	m_header.m_vertex_layout = vertex_layout;
+	m_header.m_vertex_stride = vertex_stride;
+	m_header.m_max_vertices = max_vertex_count_limit;
+	m_header.m_max_primitives = max_primitive_count_limit;
+	m_header.m_max_lods = settings::num_mesh_lods;
+	m_header.m_preserve_hierarchy = settings::preserve_model_hierarchy;
+	m_header.m_settings_hash = model_cache::HashProcessingSettings();
+}
+
+void ModelCacheWriter::AddMesh(void const * vertices, std::uint32_t num_vertices,
+	void const * indices, std::uint32_t num_indices, std::uint32_t index_stride,
+	std::vector<MeshletDesc> const & meshlets,
+	std::vector<std::uint32_t> const & vertex_indices,
+	std::vector<std::uint8_t> const & flat_indices,
+	MeshBoundingBox const & bbox,
+	std::uint32_t material_id,
+	std::uint32_t num_lods,
+	float lod_error)
+{
+	ModelCacheMesh mesh = {};
+	mesh.m_vertices = AddBlob(vertices, std::size_t(num_vertices) * m_header.m_vertex_stride);
+	mesh.m_indices = AddBlob(indices, std::size_t(num_indices) * index_stride);
+	mesh.m_meshlets = AddBlob(meshlets.data(), meshlets.size() * sizeof(MeshletDesc));
+	mesh.m_vertex_indices = AddBlob(vertex_indices.data(), vertex_indices.size() * sizeof(std::uint32_t));
+	mesh.m_flat_indices = AddBlob(flat_indices.data(), flat_indices.size() * sizeof(std::uint8_t));
+	mesh.m_num_vertices = num_vertices;
+	mesh.m_num_indices = num_indices;
+	mesh.m_index_stride = index_stride;
+	mesh.m_material_id = material_id;
+	memcpy(mesh.m_bbox_min, &bbox.m_min, sizeof(mesh.m_bbox_min));
+	memcpy(mesh.m_bbox_max, &bbox.m_max, sizeof(mesh.m_bbox_max));
+	mesh.m_num_lods = num_lods;
+	mesh.m_lod_error = lod_error;
+
+	m_meshes.push_back(mesh);
+}
+
+void ModelCacheWriter::SetMaterials(std::vector<MaterialData> const & materials)
+{
+	auto textures = internal::GetMaterialTextures();
+
+	m_materials.clear();
+	for (auto const & data : materials)
+	{
+		ModelCacheMaterial material = {};
+
+		for (std::size_t i = 0; i < textures.size(); i++)
+		{
+			auto const & texture = data.*textures[i];
+			if (!texture.m_pixels)
+			{
+				continue;
+			}
+
+			auto& cached = material.m_textures[i];
+			cached.m_path = AddBlob(texture.m_path.data(), texture.m_path.size());
+			if (texture.m_path.empty())
+			{
+				cached.m_pixels = AddBlob(texture.m_pixels, internal::GetEmbeddedPixelSize(texture));
+			}
+			cached.m_width = texture.m_width;
+			cached.m_height = texture.m_height;
+			cached.m_channels = texture.m_channels;
+			cached.m_is_hdr = texture.m_is_hdr;
+		}
+
+		memcpy(material.m_base_color, &data.m_base_color, sizeof(material.m_base_color));
+		material.m_base_metallic = data.m_base_metallic;
+		material.m_base_roughness = data.m_base_roughness;
+		material.m_base_reflectivity = data.m_base_reflectivity;
+		material.m_base_transparency = data.m_base_transparency;
+		material.m_base_emissive = data.m_base_emissive;
+		material.m_base_normal_strength = data.m_base_normal_strength;
+		material.m_base_anisotropy = data.m_base_anisotropy;
+		memcpy(material.m_base_anisotropy_dir, &data.m_base_anisotropy_dir, sizeof(material.m_base_anisotropy_dir));
+		material.m_base_clear_coat = data.m_base_clear_coat;
+		material.m_base_clear_coat_roughness = data.m_base_clear_coat_roughness;
+		memcpy(material.m_base_uv_scale, &data.m_base_uv_scale, sizeof(material.m_base_uv_scale));
+		material.m_two_sided = data.m_two_sided;
+
+		m_materials.push_back(material);
+	}
+}
+
+void ModelCacheWriter::SetNodes(std::vector<ModelNodeData> const & nodes)
+{
+	m_nodes.clear();
+	for (auto const & data : nodes)
+	{
+		ModelCacheNode node = {};
+		node.m_parent = data.m_parent;
+		memcpy(node.m_position, &data.m_position, sizeof(node.m_position));
+		memcpy(node.m_rotation, &data.m_rotation, sizeof(node.m_rotation));
+		memcpy(node.m_scale, &data.m_scale, sizeof(node.m_scale));
+		node.m_meshes = AddBlob(data.m_meshes.data(), data.m_meshes.size() * sizeof(std::uint32_t));
+
+		m_nodes.push_back(node);
+	}
+}
+
+ModelCacheBlob ModelCacheWriter::AddBlob(void const * data, std::size_t size)
+{
+	auto offset = SizeAlignTwoPower(m_blob_data.size(), ModelCacheFile::alignment);
+	m_blob_data.resize(offset + size, 0);
+	if (size > 0)
+	{
+		memcpy(m_blob_data.data() + offset, data, size);
+	}
+
+	return { offset, size };
+}
+
+bool ModelCacheWriter::Write(std::string const & path) const
+{
+	auto header = m_header;
+	header.m_num_meshes = static_cast<std::uint32_t>(m_meshes.size());
+	header.m_num_materials = static_cast<std::uint32_t>(m_materials.size());
+	header.m_num_nodes = static_cast<std::uint32_t>(m_nodes.size());
+
+	auto records_size = sizeof(ModelCacheHeader) + m_meshes.size() * sizeof(ModelCacheMesh) + m_materials.size() * sizeof(ModelCacheMaterial)
+		+ m_nodes.size() * sizeof(ModelCacheNode);
+	auto blob_start = SizeAlignTwoPower(records_size, ModelCacheFile::alignment);
+
+	// Make the blob offsets relative to the start of the file.
+	auto relocate = [blob_start](ModelCacheBlob& blob) { blob.m_offset += blob_start; };
+
+	auto meshes = m_meshes;
+	for (auto& mesh : meshes)
+	{
+		relocate(mesh.m_vertices);
+		relocate(mesh.m_indices);
+		relocate(mesh.m_meshlets);
+		relocate(mesh.m_vertex_indices);
+		relocate(mesh.m_flat_indices);
+	}
+
+	auto materials = m_materials;
+	for (auto& material : materials)
+	{
+		for (auto& texture : material.m_textures)
+		{
+			relocate(texture.m_path);
+			relocate(texture.m_pixels);
+		}
+	}
+
+	auto nodes = m_nodes;
+	for (auto& node : nodes)
+	{
+		relocate(node.m_meshes);
+	}
+
+	return util::WriteFileAtomic(path, [&](std::ostream& file)
+	{
+		std::vector<char> padding(blob_start - records_size, 0);
+
+		file.write(reinterpret_cast<char const *>(&header), sizeof(header));
+		file.write(reinterpret_cast<char const *>(meshes.data()), meshes.size() * sizeof(ModelCacheMesh));
+		file.write(reinterpret_cast<char const *>(materials.data()), materials.size() * sizeof(ModelCacheMaterial));
+		file.write(reinterpret_cast<char const *>(nodes.data()), nodes.size() * sizeof(ModelCacheNode));
+		file.write(padding.data(), padding.size());
+		file.write(reinterpret_cast<char const *>(m_blob_data.data()), m_blob_data.size());
+	});
+}
+
+ModelCacheFile::ModelCacheFile(std::string const & path)
+	: m_file(path),
+	m_intact(false)
+{
+	if (!m_file.IsValid() || m_file.GetSize() < sizeof(ModelCacheHeader))
+	{
+		return;
+	}
+
+	auto const & header = GetHeader();
+	if (header.m_magic != model_cache::magic || header.m_version != model_cache::version)
+	{
+		return;
+	}
+
+	auto records_size = sizeof(ModelCacheHeader) + std::size_t(header.m_num_meshes) * sizeof(ModelCacheMesh)
+		+ std::size_t(header.m_num_materials) * sizeof(ModelCacheMaterial) + std::size_t(header.m_num_nodes) * sizeof(ModelCacheNode);
+	if (records_size > m_file.GetSize())
+	{
+		return;
+	}
+
+	for (std::size_t i = 0; i < header.m_num_meshes; i++)
+	{
+		auto const & mesh = GetMesh(i);
+		if (!IsInBounds(mesh.m_vertices) || !IsInBounds(mesh.m_indices) || !IsInBounds(mesh.m_meshlets)
+			|| !IsInBounds(mesh.m_vertex_indices) || !IsInBounds(mesh.m_flat_indices)
+			|| mesh.m_material_id >= std::max(1u, header.m_num_materials)
+			|| mesh.m_num_lods >= header.m_num_meshes - i)
+		{
+			return;
+		}
+	}
+
+	auto materials = reinterpret_cast<ModelCacheMaterial const *>(m_file.GetData() + sizeof(ModelCacheHeader) + header.m_num_meshes * sizeof(ModelCacheMesh));
+	for (std::size_t i = 0; i < header.m_num_materials; i++)
+	{
+		for (auto const & texture : materials[i].m_textures)
+		{
+			if (!IsInBounds(texture.m_path) || !IsInBounds(texture.m_pixels))
+			{
+				return;
+			}
+		}
+	}
+
+	std::uint32_t num_base_meshes = 0;
+	for (std::size_t i = 0; i < header.m_num_meshes; i += GetMesh(i).m_num_lods + 1)
+	{
+		num_base_meshes++;
+	}
+
+	auto nodes = GetNodeRecords();
+	for (std::size_t i = 0; i < header.m_num_nodes; i++)
+	{
+		if (nodes[i].m_parent >= std::int32_t(i) || !IsInBounds(nodes[i].m_meshes))
+		{
+			return;
+		}
+
+		auto meshes = GetData<std::uint32_t>(nodes[i].m_meshes);
+		for (std::size_t j = 0; j < nodes[i].m_meshes.m_size / sizeof(std::uint32_t); j++)
+		{
+			if (meshes[j] >= num_base_meshes)
+			{
+				return;
+			}
+		}
+	}
+
+	m_intact = true;
+}
+
+bool ModelCacheFile::IsValid(std::uint64_t source_hash, std::uint32_t vertex_layout, std::uint32_t vertex_stride) const
+{
+	if (!m_intact)
+	{
+		return false;
+	}
+
+	auto const & header = GetHeader();
+	return header.m_source_hash == source_hash &&
+		header.m_vertex_layout == vertex_layout &&
+		header.m_vertex_stride == vertex_stride &&
+		header.m_max_vertices == max_vertex_count_limit &&
+		header.m_max_primitives == max_primitive_count_limit &&
+		header.m_max_lods == settings::num_mesh_lods &&
+		header.m_preserve_hierarchy == std::uint32_t(settings::preserve_model_hierarchy) &&
+		header.m_settings_hash == model_cache::HashProcessingSettings();
+}
+
+ModelCacheHeader const & ModelCacheFile::GetHeader() const
+{
+	return *reinterpret_cast<ModelCacheHeader const *>(m_file.GetData());
+}
+
+ModelCacheMesh const & ModelCacheFile::GetMesh(std::size_t idx) const
+{
+	return reinterpret_cast<ModelCacheMesh const *>(m_file.GetData() + sizeof(ModelCacheHeader))[idx];
+}
+
+MaterialData ModelCacheFile::GetMaterial(std::size_t idx, STBImageLoader* image_loader) const
+{
+	auto const & header = GetHeader();
+	auto const & material = reinterpret_cast<ModelCacheMaterial const *>(m_file.GetData() + sizeof(ModelCacheHeader) + header.m_num_meshes * sizeof(ModelCacheMesh))[idx];
+
+	MaterialData data = {};
+
+	auto textures = internal::GetMaterialTextures();
+	for (std::size_t i = 0; i < textures.size(); i++)
+	{
+		auto const & texture = material.m_textures[i];
+		if (texture.m_path.m_size > 0)
+		{
+			std::string path(GetData<char>(texture.m_path), texture.m_path.m_size);
+			data.*textures[i] = *image_loader->LoadFromDisc(path).get();
+		}
+		else if (texture.m_pixels.m_size > 0)
+		{
+			auto& target = data.*textures[i];
+			// The mapping is read only, the texture pool only reads the pixels when it stages them.
+			target.m_pixels = const_cast<std::uint8_t*>(GetData<std::uint8_t>(texture.m_pixels));
+			target.m_width = texture.m_width;
+			target.m_height = texture.m_height;
+			target.m_channels = texture.m_channels;
+			target.m_is_hdr = texture.m_is_hdr != 0;
+		}
+	}
+
+	memcpy(&data.m_base_color, material.m_base_color, sizeof(material.m_base_color));
+	data.m_base_metallic = material.m_base_metallic;
+	data.m_base_roughness = material.m_base_roughness;
+	data.m_base_reflectivity = material.m_base_reflectivity;
+	data.m_base_transparency = material.m_base_transparency;
+	data.m_base_emissive = material.m_base_emissive;
+	data.m_base_normal_strength = material.m_base_normal_strength;
+	data.m_base_anisotropy = material.m_base_anisotropy;
+	memcpy(&data.m_base_anisotropy_dir, material.m_base_anisotropy_dir, sizeof(material.m_base_anisotropy_dir));
+	data.m_base_clear_coat = material.m_base_clear_coat;
+	data.m_base_clear_coat_roughness = material.m_base_clear_coat_roughness;
+	memcpy(&data.m_base_uv_scale, material.m_base_uv_scale, sizeof(material.m_base_uv_scale));
+	data.m_two_sided = material.m_two_sided != 0;
+
+	return data;
+}
+
+std::vector<ModelNodeData> ModelCacheFile::GetNodes() const
+{
+	auto nodes = GetNodeRecords();
+
+	std::vector<ModelNodeData> data(GetHeader().m_num_nodes);
+	for (std::size_t i = 0; i < data.size(); i++)
+	{
+		data[i].m_parent = nodes[i].m_parent;
+		memcpy(&data[i].m_position, nodes[i].m_position, sizeof(nodes[i].m_position));
+		memcpy(&data[i].m_rotation, nodes[i].m_rotation, sizeof(nodes[i].m_rotation));
+		memcpy(&data[i].m_scale, nodes[i].m_scale, sizeof(nodes[i].m_scale));
+		data[i].m_meshes = GetVector<std::uint32_t>(nodes[i].m_meshes);
+	}
+
+	return data;
+}
+
+ModelCacheNode const * ModelCacheFile::GetNodeRecords() const
+{
+	auto const & header = GetHeader();
+	return reinterpret_cast<ModelCacheNode const *>(m_file.GetData() + sizeof(ModelCacheHeader)
+		+ header.m_num_meshes * sizeof(ModelCacheMesh) + header.m_num_materials * sizeof(ModelCacheMaterial));
+}
+
+bool ModelCacheFile::IsInBounds(ModelCacheBlob const & blob) const
+{
+	return blob.m_offset <= m_file.GetSize() && blob.m_size <= m_file.GetSize() - blob.m_offset;
+}
@@ -0,0 +1,200 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "meshlet_builder.hpp"
+#include "resource_structs.hpp"
+#include "util/mapped_file.hpp"
+
+class STBImageLoader;
+
+/*
+	Baked model cache.
+
+	A cache file contains everything `ModelPool::LoadWithMaterials` produces for a model so it can be uploaded without parsing:
+
+	| ModelCacheHeader
+	| ModelCacheMesh[num_meshes] (every mesh followed by its levels of detail)
+	| ModelCacheMaterial[num_materials]
+	| ModelCacheNode[num_nodes]
+	| blobs (vertices, indices, meshlets, vertex indices, flat indices, texture paths, embedded pixels) aligned to `ModelCacheFile::alignment`
+
+	All offsets are relative to the start of the file. The file is only valid for the source file hash, vertex layout,
+	meshlet limits, hierarchy mode and mesh processing settings it was baked with, anything else is treated as a cache miss.
+*/
+
+struct ModelCacheBlob
+{
+	std::uint64_t m_offset;
+	std::uint64_t m_size; // In bytes.
+};
+
+struct ModelCacheHeader
+{
+	std::uint32_t m_magic;
+	std::uint32_t m_version;
+	std::uint64_t m_source_hash;
+	std::uint32_t m_vertex_layout;
+	std::uint32_t m_vertex_stride;
+	std::uint32_t m_max_vertices;
+	std::uint32_t m_max_primitives;
+	std::uint32_t m_num_meshes; // Including levels of detail.
+	std::uint32_t m_num_materials;
+	std::uint32_t m_max_lods;
+	std::uint32_t m_num_nodes;
+	std::uint32_t m_preserve_hierarchy;
+	std::uint64_t m_settings_hash; // See `model_cache::HashProcessingSettings`.
+};
+
+struct ModelCacheMesh
+{
+	ModelCacheBlob m_vertices;
+	ModelCacheBlob m_indices;
+	ModelCacheBlob m_meshlets;
+	ModelCacheBlob m_vertex_indices;
+	ModelCacheBlob m_flat_indices;
+	std::uint32_t m_num_vertices;
+	std::uint32_t m_num_indices;
+	std::uint32_t m_index_stride;
+	std::uint32_t m_material_id;
+	float m_bbox_min[3];
+	float m_bbox_max[3];
+	std::uint32_t m_num_lods; // Number of level of detail records following this mesh.
+	float m_lod_error; // Object space error when this record is a level of detail.
+};
+
+struct ModelCacheTexture
+{
+	ModelCacheBlob m_path; // Empty when the texture is embedded in the model or unused.
+	ModelCacheBlob m_pixels; // Only used by embedded textures.
+	std::uint32_t m_width;
+	std::uint32_t m_height;
+	std::uint32_t m_channels;
+	std::uint32_t m_is_hdr;
+};
+
+struct ModelCacheMaterial
+{
+	static inline const std::size_t num_textures = 8;
+
+	ModelCacheTexture m_textures[num_textures];
+	float m_base_color[3];
+	float m_base_metallic;
+	float m_base_roughness;
+	float m_base_reflectivity;
+	float m_base_transparency;
+	float m_base_emissive;
+	float m_base_normal_strength;
+	float m_base_anisotropy;
+	float m_base_anisotropy_dir[2];
+	float m_base_clear_coat;
+	float m_base_clear_coat_roughness;
+	float m_base_uv_scale[2];
+	std::uint32_t m_two_sided;
+};
+
+struct ModelCacheNode
+{
+	std::int32_t m_parent;
+	float m_position[3];
+	float m_rotation[3];
+	float m_scale[3];
+	ModelCacheBlob m_meshes; // std::uint32_t indices of the meshes, not counting levels of detail.
+};
+
+namespace model_cache
+{
+
+	static inline const std::uint32_t magic = 0x434D4B53; // "SKMC"
+	static inline const std::uint32_t version = 5; // Increment when the layout or the way meshes are processed changes.
+
+	//! FNV-1a hash of the source file contents. For glTF files the referenced binary buffers are hashed as well.
+	std::optional<std::uint64_t> HashSourceFile(std::string const & path);
+
+	//! Hash of the settings that change the baked meshes without changing the layout (optimization, levels of detail and chunking).
+	std::uint64_t HashProcessingSettings();
+
+	//! Location of the cache file of a source file for a specific vertex layout.
+	std::string GetCachePath(std::string const & source_path, std::uint32_t vertex_layout);
+
+} /* model_cache */
+
+//! Collects the processed meshes of a model and writes them to a cache file.
+class ModelCacheWriter
+{
+public:
+	ModelCacheWriter(std::uint64_t source_hash, std::uint32_t vertex_layout, std::uint32_t vertex_stride);
+
+	void AddMesh(void const * vertices, std::uint32_t num_vertices,
+		void const * indices, std::uint32_t num_indices, std::uint32_t index_stride,
+		std::vector<MeshletDesc> const & meshlets,
+		std::vector<std::uint32_t> const & vertex_indices,
+		std::vector<std::uint8_t> const & flat_indices,
+		MeshBoundingBox const & bbox,
+		std::uint32_t material_id,
+		std::uint32_t num_lods,
+		float lod_error);
+
+	//! Textures loaded from a file are stored by path, embedded textures have their pixels copied into the cache.
+	void SetMaterials(std::vector<MaterialData> const & materials);
+	void SetNodes(std::vector<ModelNodeData> const & nodes);
+
+	bool Write(std::string const & path) const;
+
+private:
+	ModelCacheBlob AddBlob(void const * data, std::size_t size);
+
+	ModelCacheHeader m_header;
+	std::vector<ModelCacheMesh> m_meshes;
+	std::vector<ModelCacheMaterial> m_materials;
+	std::vector<ModelCacheNode> m_nodes;
+	std::vector<std::uint8_t> m_blob_data; // Offsets in here are relative to the start of the blob section.
+};
+
+//! Memory mapped, read only view of a cache file.
+class ModelCacheFile
+{
+public:
+	static inline const std::size_t alignment = 16;
+
+	explicit ModelCacheFile(std::string const & path);
+
+	//! Whether the file is intact and was baked from the given source file with the given vertex layout.
+	bool IsValid(std::uint64_t source_hash, std::uint32_t vertex_layout, std::uint32_t vertex_stride) const;
+
+	ModelCacheHeader const & GetHeader() const;
+	ModelCacheMesh const & GetMesh(std::size_t idx) const;
+	//! Embedded textures point into the mapped file, so their pixels are only valid while this file is open.
+	MaterialData GetMaterial(std::size_t idx, STBImageLoader* image_loader) const;
+	std::vector<ModelNodeData> GetNodes() const;
+
+	template<typename T>
+	T const * GetData(ModelCacheBlob const & blob) const
+	{
+		return reinterpret_cast<T const *>(m_file.GetData() + blob.m_offset);
+	}
+
+	template<typename T>
+	std::vector<T> GetVector(ModelCacheBlob const & blob) const
+	{
+		auto data = GetData<T>(blob);
+		return std::vector<T>(data, data + blob.m_size / sizeof(T));
+	}
+
+private:
+	bool IsInBounds(ModelCacheBlob const & blob) const;
+	ModelCacheNode const * GetNodeRecords() const;
+
+	util::MappedFile m_file;
+	bool m_intact;
+};
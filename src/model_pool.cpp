@@ -7,9 +7,52 @@
 #include "model_pool.hpp"
 
 ModelPool::ModelPool()
-	: m_next_id(0)
+	: m_next_id(0),
+	m_job_system(nullptr)
 {
+	if (settings::use_parallel_model_loading)
+	{
+		auto num_threads = settings::num_model_loading_threads;
+		if (num_threads == 0)
+		{
+			num_threads = std::max(1u, std::thread::hardware_concurrency());
+		}
+
+		// The thread waiting for the jobs runs them as well.
+		m_job_system = new util::JobSystem(num_threads - 1);
+	}
+}
+
+ModelPool::~ModelPool()
+{
+	delete m_job_system;
+}
+
+void ModelPool::ParallelFor(std::size_t count, std::function<void(std::size_t)> const & func)
+{
+	util::ParallelFor(m_job_system, count, func);
+}
 
+void ModelPool::ApplyExtraMaterialData(std::vector<MaterialData>& materials, std::optional<ExtraMaterialData> const & extra)
+{
+	if (!extra.has_value())
+	{
+		return;
+	}
+
+	STBImageLoader image_loader;
+
+	const auto& thickness_paths = extra.value().m_thickness_texture_paths;
+	for (std::size_t i = 0; i < std::min(materials.size(), thickness_paths.size()); i++)
+	{
+		materials[i].m_thickness_texture = *image_loader.LoadFromDisc(thickness_paths[i]).get();
+	}
+
+	const auto& displacement_paths = extra.value().m_displacement_texture_paths;
+	for (std::size_t i = 0; i < std::min(materials.size(), displacement_paths.size()); i++)
+	{
+		materials[i].m_displacement_texture = *image_loader.LoadFromDisc(displacement_paths[i]).get();
+	}
 }
 
 ModelData* ModelPool::GetRawData(ModelHandle handle)
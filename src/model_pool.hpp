@@ -8,16 +8,23 @@
 
 #include <algorithm>
 #include <unordered_map>
+#include <functional>
 
 #include "resource_loader.hpp"
 #include "resource_structs.hpp"
 #include "material_pool.hpp"
 #include "texture_pool.hpp"
+#include "vertex.hpp"
 #include "meshlet_builder.hpp"
+#include "mesh_optimizer.hpp"
+#include "mesh_simplifier.hpp"
+#include "model_cache.hpp"
 #include "stb_image_loader.hpp"
 #include <glm.hpp>
 
+#include "settings.hpp"
 #include "util/log.hpp"
+#include "util/job_system.hpp"
 
 struct ModelHandle
 {
@@ -27,6 +34,16 @@ struct ModelHandle
 		std::uint64_t m_ib;
 	};
 
+	//! A simplified level of a mesh. Uses the material, bounding box and strides of the mesh it belongs to.
+	struct MeshLod
+	{
+		std::uint32_t m_id;
+		MeshOffsets m_offsets;
+		std::uint32_t m_num_indices;
+		std::uint32_t m_num_vertices;
+		float m_error; // Geometric error in object space units.
+	};
+
 	struct MeshHandle
 	{
 		std::uint32_t m_id;
@@ -40,6 +57,48 @@ struct ModelHandle
 		glm::vec3 m_bbox_min;
 		glm::vec3 m_bbox_max;
 
+		std::vector<MeshLod> m_lods; // Level 1 and coarser. Level 0 is the mesh itself.
+
+		std::size_t GetNumLods() const
+		{
+			return m_lods.size() + 1;
+		}
+
+		//! Returns this mesh with the id, offsets and counts of level `lod` (clamped to the coarsest level). The result has no levels of its own.
+		MeshHandle GetLod(std::size_t lod) const
+		{
+			MeshHandle handle = *this;
+			handle.m_lods.clear();
+
+			if (lod == 0 || m_lods.empty())
+			{
+				return handle;
+			}
+
+			auto const & level = m_lods[std::min(lod, m_lods.size()) - 1];
+			handle.m_id = level.m_id;
+			handle.m_offsets = level.m_offsets;
+			handle.m_num_indices = level.m_num_indices;
+			handle.m_num_vertices = level.m_num_vertices;
+
+			return handle;
+		}
+
+		//! Returns the coarsest level whose error stays below `max_pixel_error` on screen.
+		/*!
+			\param pixels_per_unit Size in pixels of one object space unit at the distance of the mesh. See `ModelHandle::GetPixelsPerUnit`.
+		*/
+		std::size_t SelectLod(float pixels_per_unit, float max_pixel_error = 1.f) const
+		{
+			std::size_t lod = 0;
+			for (std::size_t i = 0; i < m_lods.size() && m_lods[i].m_error * pixels_per_unit <= max_pixel_error; i++)
+			{
+				lod = i + 1;
+			}
+
+			return lod;
+		}
+
 		bool operator==(MeshHandle const & other) const
 		{
 			return m_id == other.m_id &&
@@ -50,6 +109,55 @@ struct ModelHandle
 	};
 
 	std::vector<MeshHandle> m_mesh_handles;
+	std::vector<ModelNodeData> m_nodes; // Source hierarchy. Empty when it was baked into the meshes.
+
+	//! Returns a model with only the given meshes and no hierarchy. Used to instance the meshes of a single node.
+	ModelHandle GetMeshes(std::vector<std::uint32_t> const & mesh_indices) const
+	{
+		ModelHandle handle;
+		handle.m_mesh_handles.reserve(mesh_indices.size());
+		for (auto idx : mesh_indices)
+		{
+			handle.m_mesh_handles.push_back(m_mesh_handles[idx]);
+		}
+
+		return handle;
+	}
+
+	//! Returns the model with every mesh replaced by level `lod` of that mesh.
+	ModelHandle GetLod(std::size_t lod) const
+	{
+		ModelHandle handle;
+		handle.m_mesh_handles.reserve(m_mesh_handles.size());
+		for (auto const & mesh_handle : m_mesh_handles)
+		{
+			handle.m_mesh_handles.push_back(mesh_handle.GetLod(lod));
+		}
+
+		return handle;
+	}
+
+	//! Returns the coarsest level that none of the meshes exceed `max_pixel_error` with.
+	std::size_t SelectLod(float pixels_per_unit, float max_pixel_error = 1.f) const
+	{
+		std::size_t lod = std::numeric_limits<std::size_t>::max();
+		for (auto const & mesh_handle : m_mesh_handles)
+		{
+			lod = std::min(lod, mesh_handle.SelectLod(pixels_per_unit, max_pixel_error));
+		}
+
+		return m_mesh_handles.empty() ? 0 : lod;
+	}
+
+	//! Size in pixels of one world space unit at `distance` from a perspective camera.
+	/*!
+		\param fov Vertical field of view in radians.
+		Multiply the result by the scale of a instance to get the value `SelectLod` expects.
+	*/
+	static float GetPixelsPerUnit(float distance, float fov, float viewport_height)
+	{
+		return viewport_height / (2.f * std::max(distance, 0.0001f) * std::tan(fov * 0.5f));
+	}
 
 	bool operator==(ModelHandle const & other) const
 	{
@@ -87,7 +195,7 @@ class ModelPool
 {
 public:
 	ModelPool();
-	virtual ~ModelPool() = default;
+	virtual ~ModelPool();
 
 	template<typename V_T>
 	ModelHandle Load(std::string const & path,
@@ -120,7 +228,26 @@ protected:
 
 	virtual void AllocateMeshShadingBuffers(std::vector<std::uint32_t> vertex_indices, std::vector<std::uint8_t> flat_indices) = 0;
 
+	template<typename V_T>
+	ModelHandle LoadWithMaterials_Impl(ModelData* data,
+		MaterialPool* material_pool,
+		TexturePool* texture_pool,
+		std::optional<ExtraMaterialData> extra,
+		ModelCacheWriter* cache_writer);
+	//! Uploads a baked model without parsing or processing it.
+	template<typename V_T>
+	ModelHandle LoadFromCache(ModelCacheFile const & cache,
+		MaterialPool* material_pool,
+		TexturePool* texture_pool,
+		std::optional<ExtraMaterialData> extra);
+
+	static void ApplyExtraMaterialData(std::vector<MaterialData>& materials, std::optional<ExtraMaterialData> const & extra);
+
+	//! Calls `func` for every index in `[0, count)`. Runs on `m_job_system` when parallel model loading is enabled and blocks until all calls finished.
+	void ParallelFor(std::size_t count, std::function<void(std::size_t)> const & func);
+
 	std::uint32_t m_next_id;
+	util::JobSystem* m_job_system;
 
 	inline static std::vector<ResourceLoader<ModelData>*> m_registered_loaders = {};
 };
@@ -148,65 +275,6 @@ inline glm::vec4 GetBoxCorner(glm::vec3 bboxMin, glm::vec3 bboxMax, int n)
 	}
 }
 
-// all oct functions derived from "A Survey of Efficient Representations for Independent Unit Vectors"
-// http://jcgt.org/published/0003/02/01/paper.pdf
-inline glm::vec3 OctSignNotZero(glm::vec3 v)
-{
-	// leaves z as is
-	return glm::vec3((v.x >= 0.0f) ? +1.0f : -1.0f, (v.y >= 0.0f) ? +1.0f : -1.0f, 1.0f);
-}
-
-inline glm::vec3 OctToFVec3(glm::vec3 e)
-{
-	auto v = glm::vec3(e.x, e.y, 1.0f - fabsf(e.x) - fabsf(e.y));
-	if (v.z < 0.0f)
-	{
-		v = glm::vec3(1.0f - fabs(v.y), 1.0f - fabs(v.x), v.z) * OctSignNotZero(v);
-	}
-	return glm::normalize(v);
-}
-
-inline glm::vec3 FVec3ToOct(glm::vec3 v)
-{
-	// Project the sphere onto the octahedron, and then onto the xy plane
-	glm::vec3 p = glm::vec3(v.x, v.y, 0) * (1.0f / (fabsf(v.x) + fabsf(v.y) + fabsf(v.z)));
-	// Reflect the folds of the lower hemisphere over the diagonals
-	return (v.z <= 0.0f) ? glm::vec3(1.0f - fabsf(p.y), 1.0f - fabsf(p.x), 0.0f) * OctSignNotZero(p) : p;
-}
-
-inline glm::vec3 FVec3ToOctnPrecise(glm::vec3 v, const int n)
-{
-	glm::vec3 s = FVec3ToOct(v);  // Remap to the square
-								  // Each snorm's max value interpreted as an integer,
-								  // e.g., 127.0 for snorm8
-	float M = float(1 << ((n / 2) - 1)) - 1.0;
-	// Remap components to snorm(n/2) precision...with floor instead
-	// of round (see equation 1)
-	s = glm::floor(glm::clamp(s, glm::vec3(-1.0f), glm::vec3(1.0f)) * M) * glm::vec3(1.0 / M);
-	glm::vec3 bestRepresentation = s;	
-	float highestCosine = glm::dot(OctToFVec3(s), v);
-	// Test all combinations of floor and ceil and keep the best.
-	// Note that at +/- 1, this will exit the square... but that
-	// will be a worse encoding and never win.
-	for (int i = 0; i <= 1; ++i)
-		for (int j = 0; j <= 1; ++j)
-			// This branch will be evaluated at compile time
-			if ((i != 0) || (j != 0))
-			{
-				// Offset the bit pattern (which is stored in floating
-				// point!) to effectively change the rounding mode
-				// (when i or j is 0: floor, when it is one: ceiling)
-				glm::vec3 candidate = glm::vec3(i, j, 0) * (1 / M) + s;
-				float cosine = glm::dot(OctToFVec3(candidate), v);
-				if (cosine > highestCosine)
-				{
-					bestRepresentation = candidate;
-					highestCosine = cosine;
-				}
-			}
-	return bestRepresentation;
-}
-
 template<typename T>
 void ModelPool::RegisterLoader()
 {
@@ -226,6 +294,65 @@ DEFINE_HAS_STRUCT(UV, m_uv)
 DEFINE_HAS_STRUCT(Normal, m_normal)
 DEFINE_HAS_STRUCT(Tangent, m_tangent)
 DEFINE_HAS_STRUCT(Bitangent, m_bitangent)
+DEFINE_HAS_STRUCT(Encode, Encode)
+
+namespace internal
+{
+
+	//! Identifies which attributes a vertex type has. Used to tell cached vertex streams apart.
+	template<typename V_T>
+	constexpr std::uint32_t GetVertexLayout()
+	{
+		return (HasPos<V_T>::value ? 1u << 0 : 0u) |
+			(HasUV<V_T>::value ? 1u << 1 : 0u) |
+			(HasNormal<V_T>::value ? 1u << 2 : 0u) |
+			(HasTangent<V_T>::value ? 1u << 3 : 0u) |
+			(HasBitangent<V_T>::value ? 1u << 4 : 0u) |
+			(HasEncode<V_T>::value ? 1u << 5 : 0u) |
+			(static_cast<std::uint32_t>(sizeof(V_T)) << 8);
+	}
+
+	//! Simplified level of a `ProcessedMesh` with its own compacted vertex buffer.
+	template<typename V_T>
+	struct ProcessedLod
+	{
+		std::vector<V_T> m_vertices;
+		std::vector<unsigned char> m_indices; // Packed with the stride of the mesh.
+		std::uint32_t m_num_indices;
+		float m_error; // Object space.
+
+		std::vector<MeshletDesc> m_meshlet_data;
+		std::vector<std::uint32_t> m_vertex_indices;
+		std::vector<std::uint8_t> m_index_indices;
+	};
+
+	//! Intermediate results of a mesh before it gets allocated.
+	template<typename V_T>
+	struct ProcessedMesh
+	{
+		std::vector<V_T> m_vertices;
+		std::vector<std::uint32_t> m_indices; // Unpacked to 32 bit.
+		MeshBoundingBox m_bbox;
+		std::vector<MeshletCluster> m_clusters;
+
+		std::vector<MeshletDesc> m_meshlet_data;
+		std::vector<std::uint32_t> m_vertex_indices; // used to index the vertex buffer from mesh shading (Uploaded to the GPU)
+		std::vector<std::uint8_t> m_index_indices; // used to index the vertex indices buffer  (Uploaded to the GPU)
+		MeshletStats m_stats;
+
+		std::vector<ProcessedLod<V_T>> m_lods;
+	};
+
+	//! A range of triangles of a mesh meshlets are build for independently.
+	struct MeshletChunk
+	{
+		std::uint32_t m_mesh;
+		std::uint32_t m_first_triangle;
+		std::uint32_t m_num_triangles;
+		std::vector<MeshletCluster> m_clusters;
+	};
+
+} /* internal */
 
 template<typename V_T>
 ModelHandle ModelPool::Load(std::string const & path,
@@ -241,7 +368,29 @@ ModelHandle ModelPool::LoadWithMaterials(std::string const & path,
 	bool store_data,
 	std::optional<ExtraMaterialData> extra)
 {
+	static_assert(IsGPUVertex<V_T>::value, "No pipeline can decode this vertex format yet.");
+
 	auto extension = path.substr(path.find_last_of('.') + 1);
+	constexpr auto vertex_layout = internal::GetVertexLayout<V_T>();
+
+	// Fast path: Use the baked model when it was build from the same source file.
+	// Raw data can't be stored from a cache file so the cache is skipped when `store_data` is requested.
+	std::optional<std::uint64_t> source_hash = std::nullopt;
+	std::string cache_path;
+	if (settings::use_model_cache && !store_data)
+	{
+		source_hash = model_cache::HashSourceFile(path);
+		if (source_hash.has_value())
+		{
+			cache_path = model_cache::GetCachePath(path, vertex_layout);
+
+			ModelCacheFile cache(cache_path);
+			if (cache.IsValid(source_hash.value(), vertex_layout, sizeof(V_T)))
+			{
+				return LoadFromCache<V_T>(cache, material_pool, texture_pool, extra);
+			}
+		}
+	}
 
 	for (auto& loader : m_registered_loaders)
 	{
@@ -249,7 +398,22 @@ ModelHandle ModelPool::LoadWithMaterials(std::string const & path,
 		{
 			auto model_data = loader->Load(path);
 
-			auto handle = LoadWithMaterials<V_T>(model_data, material_pool, texture_pool, extra);
+			std::optional<ModelCacheWriter> cache_writer = std::nullopt;
+			if (source_hash.has_value())
+			{
+				cache_writer.emplace(source_hash.value(), vertex_layout, sizeof(V_T));
+			}
+
+			auto handle = LoadWithMaterials_Impl<V_T>(model_data, material_pool, texture_pool, extra, cache_writer ? &cache_writer.value() : nullptr);
+
+			if (cache_writer.has_value())
+			{
+				cache_writer->SetMaterials(model_data->m_materials);
+				if (!cache_writer->Write(cache_path))
+				{
+					LOGW("Failed to write model cache {}", cache_path);
+				}
+			}
 
 			if (store_data)
 			{
@@ -280,33 +444,184 @@ ModelHandle ModelPool::LoadWithMaterials(ModelData* data,
 	MaterialPool* material_pool,
 	TexturePool* texture_pool,
 	std::optional<ExtraMaterialData> extra)
+{
+	static_assert(IsGPUVertex<V_T>::value, "No pipeline can decode this vertex format yet.");
+
+	return LoadWithMaterials_Impl<V_T>(data, material_pool, texture_pool, extra, nullptr);
+}
+
+template<typename V_T>
+ModelHandle ModelPool::LoadWithMaterials_Impl(ModelData* data,
+	MaterialPool* material_pool,
+	TexturePool* texture_pool,
+	std::optional<ExtraMaterialData> extra,
+	ModelCacheWriter* cache_writer)
 {
 	ModelHandle model_handle;
 
 	bool mat_and_texture_pool_available = material_pool && texture_pool;
 
-	// Apply extra material data
-	if (extra.has_value())
+	ApplyExtraMaterialData(data->m_materials, extra);
+
+	// Meshes are independent until they get allocated. Process them up front (in parallel when enabled) and allocate them in order afterwards.
+	std::vector<internal::ProcessedMesh<V_T>> processed_meshes(data->m_meshes.size());
+	std::vector<internal::MeshletChunk> chunks;
+
+	ParallelFor(data->m_meshes.size(), [&](std::size_t mesh_idx)
+	{
+		auto& mesh = data->m_meshes[mesh_idx];
+		auto& processed = processed_meshes[mesh_idx];
+
+		// Reorders the mesh data itself so the index buffer uploaded for the vertex shader path benefits as well.
+		processed.m_indices = settings::optimize_meshes ? MeshOptimizer::Optimize(mesh) : MeshletBuilder::UnpackIndices(mesh);
+
+		// Compressed vertex types quantize against the bounding box so it has to be known first.
+		processed.m_bbox = MeshletBuilder::CalculateBoundingBox<V_T>(mesh);
+
+		auto num_vertices = mesh.m_positions.size();
+		processed.m_vertices.resize(num_vertices);
+
+		for (std::size_t i = 0; i < num_vertices; i++)
+		{
+			using namespace internal;
+			auto& vertex = processed.m_vertices[i];
+			if constexpr (HasEncode<V_T>::value)
+			{
+				vertex = V_T::Encode(mesh, i, processed.m_bbox);
+			}
+			else
+			{
+				if constexpr (HasPos<V_T>::value) { vertex.m_pos = mesh.m_positions[i]; }
+				if constexpr (HasUV<V_T>::value) { vertex.m_uv = {mesh.m_uvw[i].x, mesh.m_uvw[i].y }; }
+				if constexpr (HasNormal<V_T>::value) { vertex.m_normal = mesh.m_normals[i]; }
+				if constexpr (HasTangent<V_T>::value) { vertex.m_tangent = mesh.m_tangents[i]; }
+				if constexpr (HasBitangent<V_T>::value) { vertex.m_bitangent = mesh.m_bitangents[i]; }
+			}
+		}
+	});
+
+	// Split huge meshes into triangle ranges so their meshlets can be build in parallel.
+	for (std::size_t i = 0; i < processed_meshes.size(); i++)
+	{
+		std::uint32_t num_triangles = processed_meshes[i].m_indices.size() / 3;
+		for (std::uint32_t first = 0; first < num_triangles; first += settings::model_loading_chunk_size)
+		{
+			chunks.push_back({ static_cast<std::uint32_t>(i), first, std::min(num_triangles - first, settings::model_loading_chunk_size) });
+		}
+	}
+
+	ParallelFor(chunks.size(), [&](std::size_t chunk_idx)
 	{
-		auto image_loader = new STBImageLoader(); // TODO: Memory leak
+		auto& chunk = chunks[chunk_idx];
+		auto const & processed = processed_meshes[chunk.m_mesh];
+
+		auto const & positions = data->m_meshes[chunk.m_mesh].m_positions;
+		auto begin = processed.m_indices.begin() + chunk.m_first_triangle * 3;
+		std::vector<std::uint32_t> chunk_indices(begin, begin + chunk.m_num_triangles * 3);
 
-		const auto& thickness_paths = extra.value().m_thickness_texture_paths;
-		for (std::size_t i = 0; i < std::min(data->m_materials.size(), thickness_paths.size()); i++)
+		// Remap the chunk to the vertices it references so the builder's per vertex data scales with the chunk instead of the mesh.
+		std::vector<std::uint32_t> chunk_vertices(chunk_indices);
+		std::sort(chunk_vertices.begin(), chunk_vertices.end());
+		chunk_vertices.erase(std::unique(chunk_vertices.begin(), chunk_vertices.end()), chunk_vertices.end());
+
+		std::vector<glm::vec3> chunk_positions(chunk_vertices.size());
+		for (std::size_t i = 0; i < chunk_vertices.size(); i++)
+		{
+			chunk_positions[i] = positions[chunk_vertices[i]];
+		}
+		for (auto& index : chunk_indices)
 		{
-			data->m_materials[i].m_thickness_texture = *image_loader->LoadFromDisc(thickness_paths[i]).get();
+			index = static_cast<std::uint32_t>(std::lower_bound(chunk_vertices.begin(), chunk_vertices.end(), index) - chunk_vertices.begin());
 		}
 
-		const auto& displacement_paths = extra.value().m_displacement_texture_paths;
-		for (std::size_t i = 0; i < std::min(data->m_materials.size(), displacement_paths.size()); i++)
+		chunk.m_clusters = MeshletBuilder::BuildMeshlets(chunk_positions, chunk_indices);
+		for (auto& cluster : chunk.m_clusters)
 		{
-			data->m_materials[i].m_displacement_texture = *image_loader->LoadFromDisc(displacement_paths[i]).get();
+			for (auto& v : cluster.m_vertices)
+			{
+				v = chunk_vertices[v];
+			}
+			for (auto& t : cluster.m_triangles)
+			{
+				t += chunk.m_first_triangle;
+			}
 		}
+	});
+
+	// Chunks are sorted by mesh so merging them keeps the meshlet order deterministic.
+	for (auto& chunk : chunks)
+	{
+		auto& clusters = processed_meshes[chunk.m_mesh].m_clusters;
+		clusters.insert(clusters.end(), std::make_move_iterator(chunk.m_clusters.begin()), std::make_move_iterator(chunk.m_clusters.end()));
 	}
+	chunks.clear();
+
+	ParallelFor(data->m_meshes.size(), [&](std::size_t mesh_idx)
+	{
+		auto const & mesh = data->m_meshes[mesh_idx];
+		auto& processed = processed_meshes[mesh_idx];
+		auto const & mesh_bbox = processed.m_bbox;
+
+		processed.m_stats = MeshletBuilder::CalculateStats(processed.m_clusters, mesh.m_positions, processed.m_indices);
+
+		MeshletBuilder::FinalizeMeshlets(processed.m_clusters, mesh.m_positions, processed.m_indices, mesh_bbox,
+			processed.m_meshlet_data, processed.m_vertex_indices, processed.m_index_indices, processed.m_stats);
+
+		// Levels of detail index a compacted copy of the vertices they use so they can be allocated like any other mesh.
+		auto lods = MeshSimplifier::GenerateLods(processed.m_indices, mesh.m_positions, settings::num_mesh_lods,
+			settings::mesh_lod_reduction, settings::mesh_lod_max_error);
+		glm::vec3 extent = mesh_bbox.m_max - mesh_bbox.m_min;
+		float max_extent = std::max(extent.x, std::max(extent.y, extent.z));
 
+		for (auto& lod_data : lods)
+		{
+			auto& lod = processed.m_lods.emplace_back();
+
+			auto lod_indices = settings::optimize_meshes ? MeshOptimizer::OptimizeVertexCache(lod_data.m_indices, mesh.m_positions.size()) : std::move(lod_data.m_indices);
+			auto remap = MeshOptimizer::OptimizeVertexFetch(lod_indices, mesh.m_positions.size());
+
+			std::uint32_t num_used_vertices = 0;
+			for (auto& index : lod_indices)
+			{
+				index = remap[index];
+				num_used_vertices = std::max(num_used_vertices, index + 1);
+			}
+
+			std::vector<glm::vec3> lod_positions(num_used_vertices);
+			lod.m_vertices.resize(num_used_vertices);
+			for (std::size_t v = 0; v < remap.size(); v++)
+			{
+				if (remap[v] < num_used_vertices)
+				{
+					lod_positions[remap[v]] = mesh.m_positions[v];
+					lod.m_vertices[remap[v]] = processed.m_vertices[v];
+				}
+			}
+
+			MeshletStats lod_stats = {};
+			auto clusters = MeshletBuilder::BuildMeshlets(lod_positions, lod_indices);
+			MeshletBuilder::FinalizeMeshlets(clusters, lod_positions, lod_indices, mesh_bbox, lod.m_meshlet_data, lod.m_vertex_indices, lod.m_index_indices, lod_stats);
+
+			MeshletBuilder::PackIndices(lod_indices, mesh.m_indices_stride, lod.m_indices);
+			lod.m_num_indices = static_cast<std::uint32_t>(lod_indices.size());
+			lod.m_error = lod_data.m_error * max_extent;
+		}
+
+		// Only the flattened buffers are needed from here on.
+		processed.m_clusters = {};
+		processed.m_indices = {};
+	});
+
+	// Allocate in mesh order so offsets and id's don't depend on thread timing.
 	std::unordered_map<std::uint32_t, MaterialHandle> loaded_materials;
+	MeshletStats meshlet_stats = {};
+	std::size_t num_lods = 0;
 
-	for (auto const & mesh : data->m_meshes)
+	for (std::size_t i = 0; i < data->m_meshes.size(); i++)
 	{
+		auto& mesh = data->m_meshes[i];
+		auto& processed = processed_meshes[i];
+
 		std::optional<MaterialHandle> material_handle = std::nullopt;
 
 		if (mat_and_texture_pool_available)
@@ -327,199 +642,170 @@ ModelHandle ModelPool::LoadWithMaterials(ModelData* data,
 		auto num_indices = mesh.m_num_indices;
 		auto index_stide = mesh.m_indices_stride;
 
-		std::vector<V_T> vertices(num_vertices);
-		auto indices = mesh.m_indices;
+		meshlet_stats.Merge(processed.m_stats);
 
-		for (std::size_t i = 0; i < num_vertices; i++)
-		{
-			using namespace internal;
-			if constexpr (HasPos<V_T>::value) { vertices[i].m_pos = mesh.m_positions[i]; }
-			if constexpr (HasUV<V_T>::value) { vertices[i].m_uv = {mesh.m_uvw[i].x, mesh.m_uvw[i].y }; }
-			if constexpr (HasNormal<V_T>::value) { vertices[i].m_normal = mesh.m_normals[i]; }
-			if constexpr (HasTangent<V_T>::value) { vertices[i].m_tangent = mesh.m_tangents[i]; }
-			if constexpr (HasBitangent<V_T>::value) { vertices[i].m_bitangent = mesh.m_bitangents[i]; }
-		}
-
-		auto mesh_bbox = MeshletBuilder::CalculateBoundingBox<V_T>(mesh);
-
-		// Generate meshlets
-		std::vector<MeshletDesc> meshlet_data;
-		std::vector<std::uint32_t> vertex_indices; // used to index the vertex buffer from mesh shading (Uploaded to the GPU)
-		std::vector<std::uint8_t> index_indices; // used to index the vertex indices buffer  (Uploaded to the GPU)
-
-		int vertices_start = 0;
-		int prim_begin = 0;
-
-		for (auto indices_start = 0; indices_start < mesh.m_num_indices; indices_start += max_primitive_count_limit * 3)
+		if (cache_writer)
 		{
-			MeshletDesc meshlet = {};
+			cache_writer->AddMesh(processed.m_vertices.data(), num_vertices, mesh.m_indices.data(), num_indices, index_stide,
+				processed.m_meshlet_data, processed.m_vertex_indices, processed.m_index_indices, processed.m_bbox, mesh.m_material_id,
+				static_cast<std::uint32_t>(processed.m_lods.size()), 0.f);
 
-			glm::vec3 bbox_min = glm::vec3(std::numeric_limits<float>::max());
-			glm::vec3 bbox_max = glm::vec3(-std::numeric_limits<float>::max());
-
-			auto num_indices_in_meshlet = std::min((int)mesh.m_num_indices - indices_start, max_primitive_count_limit * 3);
-			std::vector<std::uint32_t> meshlet_vertex_indices;
-			std::vector<std::uint32_t> meshlet_indices;
-
-			// obtain all indices required for this meshlet.
-			for (auto i = indices_start; i < indices_start + num_indices_in_meshlet; i += 3)
+			for (auto const & lod : processed.m_lods)
 			{
-				glm::ivec3 triangle;
-				memcpy(&triangle, &mesh.m_indices[i * mesh.m_indices_stride], mesh.m_indices_stride * 3);
-
-				// bounding box
-				{
-					bbox_min = glm::min(bbox_min, vertices[triangle[0]].m_pos);
-					bbox_min = glm::min(bbox_min, vertices[triangle[1]].m_pos);
-					bbox_min = glm::min(bbox_min, vertices[triangle[2]].m_pos);
-
-					bbox_max = glm::max(bbox_max, vertices[triangle[0]].m_pos);
-					bbox_max = glm::max(bbox_max, vertices[triangle[1]].m_pos);
-					bbox_max = glm::max(bbox_max, vertices[triangle[2]].m_pos);
-				}
-
-				for (auto k = 0; k < 3; k++)
-				{
-					meshlet_indices.push_back(triangle[k]);
-				}
+				cache_writer->AddMesh(lod.m_vertices.data(), lod.m_vertices.size(), lod.m_indices.data(), lod.m_num_indices, index_stide,
+					lod.m_meshlet_data, lod.m_vertex_indices, lod.m_index_indices, processed.m_bbox, mesh.m_material_id, 0, lod.m_error);
 			}
+		}
 
-			// Create the vertex indices vector based on the flat indices vector.
-			std::vector<std::uint8_t> flat_meshlet_indices(meshlet_indices.size());
-			std::vector<std::pair<std::uint32_t, std::uint8_t>> flat_helper; // first = original, second = flat
+		AllocateMeshShadingBuffers(std::move(processed.m_vertex_indices), std::move(processed.m_index_indices));
 
-			for (auto i = 0; i < meshlet_indices.size(); i++)
-			{
-				auto index = meshlet_indices[i];
+		auto offsets = AllocateMesh(processed.m_vertices.data(), num_vertices, sizeof(V_T), mesh.m_indices.data(), num_indices, index_stide,
+			processed.m_meshlet_data.data(), processed.m_meshlet_data.size());
 
-				if (std::find(meshlet_vertex_indices.begin(), meshlet_vertex_indices.end(), index) == meshlet_vertex_indices.end())
-				{
-					meshlet_vertex_indices.push_back(index);
-					auto new_flat_idx = meshlet_vertex_indices.size() - 1;
-					flat_meshlet_indices[i] = new_flat_idx;
-					flat_helper.push_back({ index, new_flat_idx });
-				}
-				else
-				{
-					bool found_match = false;
-					for (auto const & pair : flat_helper)
-					{
-						if (pair.first == index)
-						{
-							flat_meshlet_indices[i] = pair.second;
-							found_match = true;
-							break;
-						}
-					}
-
-					if (!found_match)
-					{
-						LOGW("The flattening code appears to be broken");
-					}
-				}
-			}
+		model_handle.m_mesh_handles.emplace_back(ModelHandle::MeshHandle{
+			.m_id = m_next_id,
+			.m_offsets = offsets,
+			.m_num_indices = static_cast<std::uint32_t>(num_indices),
+			.m_num_vertices = static_cast<std::uint32_t>(num_vertices),
+			.m_vertex_stride = sizeof(V_T),
+			.m_index_stride = index_stide,
+			.m_material_handle = material_handle,
+			.m_bbox_min = processed.m_bbox.m_min,
+			.m_bbox_max = processed.m_bbox.m_max
+		});
+		m_next_id++;
 
-			// alignment
-			auto alligned_vertices_start = SizeAlignTwoPower(vertices_start, vertex_packing_alignment);
-			auto alligned_prim_start = SizeAlignTwoPower(prim_begin, primitive_packing_alignment);
+		// Levels get the id's following their mesh.
+		for (auto& lod : processed.m_lods)
+		{
+			AllocateMeshShadingBuffers(std::move(lod.m_vertex_indices), std::move(lod.m_index_indices));
+
+			auto lod_offsets = AllocateMesh(lod.m_vertices.data(), lod.m_vertices.size(), sizeof(V_T), lod.m_indices.data(), lod.m_num_indices, index_stide,
+				lod.m_meshlet_data.data(), lod.m_meshlet_data.size());
+
+			model_handle.m_mesh_handles.back().m_lods.push_back({
+				.m_id = m_next_id,
+				.m_offsets = lod_offsets,
+				.m_num_indices = lod.m_num_indices,
+				.m_num_vertices = static_cast<std::uint32_t>(lod.m_vertices.size()),
+				.m_error = lod.m_error
+			});
+			m_next_id++;
+			num_lods++;
+		}
 
-			// pad array to allignment
-			for (auto i = 0; i < alligned_vertices_start - vertices_start; i++)
-			{
-				vertex_indices.push_back(0);
-			}
-			for (auto i = 0; i < alligned_prim_start - prim_begin; i++)
-			{
-				flat_meshlet_indices.push_back(0);
-				flat_meshlet_indices.push_back(0);
-				flat_meshlet_indices.push_back(0);
-			}
+		processed = {};
+	}
 
-			// Get new size with padding.
-			int num_unique_vertices = meshlet_vertex_indices.size();
-			int num_unique_indices = flat_meshlet_indices.size();
+	if (cache_writer)
+	{
+		cache_writer->SetNodes(data->m_nodes);
+	}
+	model_handle.m_nodes = data->m_nodes;
 
-			vertices_start = alligned_vertices_start;
-			prim_begin = alligned_prim_start;
+	if (num_lods > 0)
+	{
+		LOG("Generated {} levels of detail for {} meshes", num_lods, data->m_meshes.size());
+	}
 
-			meshlet.SetNumVertices(num_unique_vertices);
-			meshlet.SetVertexBegin(vertices_start);
-			meshlet.SetNumPrims((num_indices_in_meshlet / 3));
-			meshlet.SetPrimBegin(prim_begin);
+	LOG("Built {} meshlets ({:.2f} vertices per triangle, {:.0f}% vertex fill, {:.0f}% primitive fill, {:.4f} average relative bbox volume, {} backface cullable)",
+		meshlet_stats.m_num_meshlets, meshlet_stats.m_vertices_per_triangle, meshlet_stats.m_vertex_fill_rate * 100.f,
+		meshlet_stats.m_primitive_fill_rate * 100.f, meshlet_stats.m_average_bbox_volume, meshlet_stats.m_num_backface_cullable);
 
-			vertices_start += num_unique_vertices;
-			prim_begin += (num_unique_indices / 3);
+	return model_handle;
+}
 
-			vertex_indices.insert(vertex_indices.end(), meshlet_vertex_indices.begin(), meshlet_vertex_indices.end());
-			index_indices.insert(index_indices.end(), flat_meshlet_indices.begin(), flat_meshlet_indices.end());
+template<typename V_T>
+ModelHandle ModelPool::LoadFromCache(ModelCacheFile const & cache,
+	MaterialPool* material_pool,
+	TexturePool* texture_pool,
+	std::optional<ExtraMaterialData> extra)
+{
+	ModelHandle model_handle;
 
-			MeshletBuilder::TruncateBBoxToMeshBBox(bbox_min, bbox_max, mesh_bbox);
+	auto const & header = cache.GetHeader();
+	bool mat_and_texture_pool_available = material_pool && texture_pool;
 
-			// Snap to grid
-			const int grid_bits = 8;
-			const int grid_last = (1 << grid_bits) - 1;
-			uint8_t   grid_min[3];
-			uint8_t   grid_max[3];
+	std::vector<MaterialData> materials;
+	if (mat_and_texture_pool_available)
+	{
+		// Embedded textures point into `cache`, which stays open until the materials are loaded below.
+		STBImageLoader image_loader;
+		for (std::size_t i = 0; i < header.m_num_materials; i++)
+		{
+			materials.push_back(cache.GetMaterial(i, &image_loader));
+		}
 
-			grid_min[0] = std::max(0, std::min(int(truncf(bbox_min.x * float(grid_last))), grid_last - 1));
-			grid_min[1] = std::max(0, std::min(int(truncf(bbox_min.y * float(grid_last))), grid_last - 1));
-			grid_min[2] = std::max(0, std::min(int(truncf(bbox_min.z * float(grid_last))), grid_last - 1));
-			grid_max[0] = std::max(0, std::min(int(ceilf(bbox_max.x * float(grid_last))), grid_last));
-			grid_max[1] = std::max(0, std::min(int(ceilf(bbox_max.y * float(grid_last))), grid_last));
-			grid_max[2] = std::max(0, std::min(int(ceilf(bbox_max.z * float(grid_last))), grid_last));
+		ApplyExtraMaterialData(materials, extra);
+	}
 
-			meshlet.SetBBox(grid_min, grid_max);
+	std::unordered_map<std::uint32_t, MaterialHandle> loaded_materials;
 
-			glm::vec3 packed = FVec3ToOctnPrecise(mesh_bbox.m_average_normal, 16);
-			std::int8_t cone_x = std::min(127, std::max(-127, std::int32_t(packed.x * 127.0f)));
-			std::int8_t cone_y = std::min(127, std::max(-127, std::int32_t(packed.y * 127.0f)));
+	for (std::size_t i = 0; i < header.m_num_meshes; i++)
+	{
+		auto const & mesh = cache.GetMesh(i);
+		std::size_t first_lod = i + 1;
+		i += mesh.m_num_lods; // Levels of detail are stored directly after their mesh.
 
-			// post quantization normal
-			mesh_bbox.m_average_normal = OctToFVec3(glm::vec3(float(cone_x) / 127.0f, float(cone_y) / 127.0f, 0.0f));
+		std::optional<MaterialHandle> material_handle = std::nullopt;
 
-			float mindot = 1.0f;
-			for (auto const & n : mesh_bbox.m_tri_normals)
+		if (mat_and_texture_pool_available)
+		{
+			// If we already loaded that material use that one
+			if (auto it = loaded_materials.find(mesh.m_material_id); it != loaded_materials.end())
 			{
-				mindot = std::min(mindot, glm::dot(n, mesh_bbox.m_average_normal));
+				material_handle = it->second;
 			}
-
-			// apply safety delta due to quantization
-			mindot -= 1.0f / 127.0f;
-			mindot = std::max(-1.0f, mindot);
-
-			// positive value for cluster not being backface cullable (normals > 90)
-			std::int8_t cone_angle = 127;
-			if (mindot > 0)
+			else // if we haven't loaded the material load it.
 			{
-				// otherwise store -sin(cone angle)
-				// we test against dot product (cosine) so this is equivalent to cos(cone angle + 90)
-				float angle = -sinf(acosf(mindot));
-				cone_angle = std::max(-127, std::min(127, int32_t(angle * 127.0f)));
+				material_handle = material_pool->Load(materials[mesh.m_material_id], texture_pool);
+				loaded_materials.insert({ mesh.m_material_id, material_handle.value() });
 			}
-
-			meshlet.SetCone(cone_x, cone_y, cone_angle);
-
-			meshlet_data.push_back(meshlet);
 		}
 
-		AllocateMeshShadingBuffers(vertex_indices, index_indices);
+		AllocateMeshShadingBuffers(cache.GetVector<std::uint32_t>(mesh.m_vertex_indices), cache.GetVector<std::uint8_t>(mesh.m_flat_indices));
 
-		auto offsets = AllocateMesh(vertices.data(), num_vertices, sizeof(V_T), indices.data(), num_indices, index_stide, meshlet_data.data(), meshlet_data.size());
+		// The mapping is read only, `AllocateMesh` only reads from the data.
+		auto offsets = AllocateMesh(const_cast<std::uint8_t*>(cache.GetData<std::uint8_t>(mesh.m_vertices)), mesh.m_num_vertices, sizeof(V_T),
+			const_cast<std::uint8_t*>(cache.GetData<std::uint8_t>(mesh.m_indices)), mesh.m_num_indices, mesh.m_index_stride,
+			const_cast<std::uint8_t*>(cache.GetData<std::uint8_t>(mesh.m_meshlets)), mesh.m_meshlets.m_size / sizeof(MeshletDesc));
 
 		model_handle.m_mesh_handles.emplace_back(ModelHandle::MeshHandle{
 			.m_id = m_next_id,
 			.m_offsets = offsets,
-			.m_num_indices = static_cast<std::uint32_t>(num_indices),
-			.m_num_vertices = static_cast<std::uint32_t>(num_vertices),
+			.m_num_indices = mesh.m_num_indices,
+			.m_num_vertices = mesh.m_num_vertices,
 			.m_vertex_stride = sizeof(V_T),
-			.m_index_stride = index_stide,
+			.m_index_stride = mesh.m_index_stride,
 			.m_material_handle = material_handle,
-			.m_bbox_min = mesh_bbox.m_min,
-			.m_bbox_max = mesh_bbox.m_max
+			.m_bbox_min = glm::vec3(mesh.m_bbox_min[0], mesh.m_bbox_min[1], mesh.m_bbox_min[2]),
+			.m_bbox_max = glm::vec3(mesh.m_bbox_max[0], mesh.m_bbox_max[1], mesh.m_bbox_max[2])
 		});
 		m_next_id++;
+
+		for (std::size_t lod_idx = first_lod; lod_idx < first_lod + mesh.m_num_lods; lod_idx++)
+		{
+			auto const & lod = cache.GetMesh(lod_idx);
+
+			AllocateMeshShadingBuffers(cache.GetVector<std::uint32_t>(lod.m_vertex_indices), cache.GetVector<std::uint8_t>(lod.m_flat_indices));
+
+			auto lod_offsets = AllocateMesh(const_cast<std::uint8_t*>(cache.GetData<std::uint8_t>(lod.m_vertices)), lod.m_num_vertices, sizeof(V_T),
+				const_cast<std::uint8_t*>(cache.GetData<std::uint8_t>(lod.m_indices)), lod.m_num_indices, lod.m_index_stride,
+				const_cast<std::uint8_t*>(cache.GetData<std::uint8_t>(lod.m_meshlets)), lod.m_meshlets.m_size / sizeof(MeshletDesc));
+
+			model_handle.m_mesh_handles.back().m_lods.push_back({
+				.m_id = m_next_id,
+				.m_offsets = lod_offsets,
+				.m_num_indices = lod.m_num_indices,
+				.m_num_vertices = lod.m_num_vertices,
+				.m_error = lod.m_lod_error
+			});
+			m_next_id++;
+		}
 	}
 
+	model_handle.m_nodes = cache.GetNodes();
+
 	return model_handle;
 }
 
@@ -41,8 +41,10 @@ namespace tasks
 	inline void AddCopyToBackBufferTask(fg::FrameGraph& fg)
 	{
 		fg::RenderTaskDesc desc;
-		desc.m_setup_func = [](Renderer&, fg::FrameGraph&, ::fg::RenderTaskHandle, bool)
+		desc.m_setup_func = [](Renderer&, fg::FrameGraph& fg, ::fg::RenderTaskHandle, bool)
 		{
+			// Only declares the copy, so the render target is in the right layout.
+			(void)fg.GetPredecessorRenderTarget<T>(fg::ResourceUsage::COPY_SRC);
 		};
 		desc.m_execute_func = [](Renderer& rs, fg::FrameGraph& fg, sg::SceneGraph& sg, ::fg::RenderTaskHandle handle)
 		{
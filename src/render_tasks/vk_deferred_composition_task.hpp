@@ -58,11 +58,11 @@ namespace tasks
 			gfx::RenderTarget* deferred_main_rt;
 			if (fg.HasTask<DeferredMainMeshData>())
 			{
-				deferred_main_rt = fg.GetPredecessorRenderTarget<DeferredMainMeshData>();
+				deferred_main_rt = fg.GetPredecessorRenderTarget<DeferredMainMeshData>(fg::ResourceUsage::STORAGE_READ);
 			}
 			else if (fg.HasTask<DeferredMainData>())
 			{
-				deferred_main_rt = fg.GetPredecessorRenderTarget<DeferredMainData>();
+				deferred_main_rt = fg.GetPredecessorRenderTarget<DeferredMainData>(fg::ResourceUsage::STORAGE_READ);
 			}
 
 			gfx::SamplerDesc gbuffer_sampler_desc
@@ -97,28 +97,28 @@ namespace tasks
 			// Skybox
 			if (fg.HasTask<GenerateCubemapData>())
 			{
-				auto skybox_rt = fg.GetPredecessorRenderTarget<GenerateCubemapData>();
+				auto skybox_rt = fg.GetPredecessorRenderTarget<GenerateCubemapData>(fg::ResourceUsage::SAMPLED);
 				data.m_skybox_set = data.m_gbuffer_heap->CreateSRVSetFromRT(skybox_rt, data.m_root_sig, 4, 0, false, skybox_sampler_desc);
 			}
 
 			// Irradiance
 			if (fg.HasTask<GenerateIrradianceMapData>())
 			{
-				auto irradiance_rt = fg.GetPredecessorRenderTarget<GenerateIrradianceMapData>();
+				auto irradiance_rt = fg.GetPredecessorRenderTarget<GenerateIrradianceMapData>(fg::ResourceUsage::SAMPLED);
 				data.m_irradiance_set = data.m_gbuffer_heap->CreateSRVSetFromRT(irradiance_rt, data.m_root_sig, 5, 0, false, skybox_sampler_desc);
 			}
 
 			// Environment
 			if (fg.HasTask<GenerateEnvironmentMapData>())
 			{
-				auto environmnet_rt = fg.GetPredecessorRenderTarget<GenerateEnvironmentMapData>();
+				auto environmnet_rt = fg.GetPredecessorRenderTarget<GenerateEnvironmentMapData>(fg::ResourceUsage::SAMPLED);
 				data.m_environment_set = data.m_gbuffer_heap->CreateSRVSetFromRT(environmnet_rt, data.m_root_sig, 6, 0, false, skybox_sampler_desc);
 			}
 
 			// BRDF Lut
 			if (fg.HasTask<GenerateBRDFLutData>())
 			{
-				auto brdf_rt = fg.GetPredecessorRenderTarget<GenerateBRDFLutData>();
+				auto brdf_rt = fg.GetPredecessorRenderTarget<GenerateBRDFLutData>(fg::ResourceUsage::SAMPLED);
 				data.m_brdf_set = data.m_gbuffer_heap->CreateSRVSetFromRT(brdf_rt, data.m_root_sig, 7, 0, false, lut_sampler_desc);
 			}
 
@@ -171,10 +171,9 @@ namespace tasks
 			.m_height = std::nullopt,
 			.m_dsv_format = VK_FORMAT_UNDEFINED,
 			.m_rtv_formats = { VK_FORMAT_R32G32B32A32_SFLOAT },
-			.m_state_execute = VK_IMAGE_LAYOUT_GENERAL,
-			.m_state_finished = std::nullopt,
 			.m_clear = false,
-			.m_clear_depth = false
+			.m_clear_depth = false,
+			.m_is_transient = true
 		};
 
 		fg::RenderTaskDesc desc;
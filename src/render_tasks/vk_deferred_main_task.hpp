@@ -30,6 +30,7 @@ namespace tasks
 	struct DeferredMainData
 	{
 		std::vector<std::vector<std::uint32_t>> m_material_sets;
+		sg::VisibleInstances m_visible_instances;
 
 		gfx::PipelineState* m_pipeline;
 		gfx::RootSignature* m_root_sig;
@@ -63,28 +64,46 @@ namespace tasks
 
 			auto mesh_node_handles = sg.GetMeshNodeHandles();
 			auto camera_handle = sg.m_camera_cb_handles[0].m_value;
-			for (auto const & batch : sg.GetRenderBatches())
+			sg.CullInstances(sg.m_camera_view_projections[0], data.m_visible_instances);
+
+			auto const & batches = sg.GetRenderBatches();
+			for (std::size_t batch_idx = 0; batch_idx < batches.size(); batch_idx++)
 			{
+				auto const & batch = batches[batch_idx];
+				auto const & ranges = data.m_visible_instances.m_ranges[batch_idx];
+				if (ranges.empty()) continue;
+
 				auto model_handle = batch.m_model_handle;
-				auto cb_handle = batch.m_big_cb;
 				auto const & mat_vec = batch.m_material_handles;
 
 				for (std::size_t i = 0; i < model_handle.m_mesh_handles.size(); i++)
 				{
 					const auto & mesh_handle = model_handle.m_mesh_handles[i];
 
-					std::vector<std::pair<gfx::DescriptorHeap*, std::uint32_t>> sets
-					{
-						{ camera_pool->GetDescriptorHeap(), camera_handle.m_cb_set_id }, // TODO: Shitty naming of set_id. just use a vector in the handle instead probably.
-						{ per_obj_pool->GetDescriptorHeap(), cb_handle.m_cb_set_id }, // TODO: Shitty naming of set_id. just use a vector in the handle instead probably.
-						{ material_pool->GetDescriptorHeap(), material_pool->GetDescriptorSetID(mat_vec[i]) },
-						{ material_pool->GetDescriptorHeap(), material_pool->GetCBDescriptorSetID(mat_vec[i]) }
-					};
-
-					cmd_list->BindDescriptorHeap(data.m_root_sig, sets);
 					cmd_list->BindVertexBuffer(model_pool->m_big_vertex_buffer, mesh_handle.m_offsets.m_vb);
 					cmd_list->BindIndexBuffer(model_pool->m_big_index_buffer, mesh_handle.m_index_stride, mesh_handle.m_offsets.m_ib);
-					cmd_list->DrawIndexed(mesh_handle.m_num_indices, batch.m_num_meshes);
+
+					// One draw per range of visible instances. Ranges don't cross pages, the page only has to be bound when it changes.
+					std::size_t bound_page = batch.m_pages.size();
+					for (auto const & range : ranges)
+					{
+						auto page = range.m_first / gfx::settings::instances_per_page;
+						if (page != bound_page)
+						{
+							std::vector<std::pair<gfx::DescriptorHeap*, std::uint32_t>> sets
+							{
+								{ camera_pool->GetDescriptorHeap(), camera_handle.m_cb_set_id }, // TODO: Shitty naming of set_id. just use a vector in the handle instead probably.
+								{ per_obj_pool->GetDescriptorHeap(), batch.m_pages[page].m_cb_set_id }, // TODO: Shitty naming of set_id. just use a vector in the handle instead probably.
+								{ material_pool->GetDescriptorHeap(), material_pool->GetDescriptorSetID(mat_vec[i]) },
+								{ material_pool->GetDescriptorHeap(), material_pool->GetCBDescriptorSetID(mat_vec[i]) }
+							};
+
+							cmd_list->BindDescriptorHeap(data.m_root_sig, sets);
+							bound_page = page;
+						}
+
+						cmd_list->DrawIndexed(mesh_handle.m_num_indices, range.m_count, 0, 0, range.m_first % gfx::settings::instances_per_page);
+					}
 				}
 			}
 		}
@@ -105,11 +124,10 @@ namespace tasks
 			.m_height = std::nullopt,
 			.m_dsv_format = VK_FORMAT_D32_SFLOAT,
 			.m_rtv_formats = { VK_FORMAT_R32G32B32A32_SFLOAT, VK_FORMAT_R16G16B16A16_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT, VK_FORMAT_R16G16B16A16_SFLOAT, VK_FORMAT_R16G16B16A16_SFLOAT },
-			.m_state_execute = std::nullopt,
-			.m_state_finished = VK_IMAGE_LAYOUT_GENERAL,
 			.m_clear = true,
 			.m_clear_depth = true,
-			.m_allow_direct_access = true
+			.m_allow_direct_access = true,
+			.m_is_transient = true
 		};
 
 		fg::RenderTaskDesc desc;
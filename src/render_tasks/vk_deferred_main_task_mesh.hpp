@@ -30,6 +30,7 @@ namespace tasks
 	struct DeferredMainMeshData
 	{
 		std::vector<std::vector<std::uint32_t>> m_material_sets;
+		sg::VisibleInstances m_visible_instances;
 		
 		gfx::PipelineState* m_pipeline;
 		gfx::RootSignature* m_root_sig;
@@ -68,11 +69,16 @@ namespace tasks
 
 			auto mesh_node_handles = sg.GetMeshNodeHandles();
 			auto camera_handle = sg.m_camera_cb_handles[0].m_value;
+			sg.CullInstances(sg.m_camera_view_projections[0], data.m_visible_instances);
 
-			for (auto const& batch : sg.GetRenderBatches())
+			auto const& batches = sg.GetRenderBatches();
+			for (std::size_t batch_idx = 0; batch_idx < batches.size(); batch_idx++)
 			{
+				auto const& batch = batches[batch_idx];
+				auto const& ranges = data.m_visible_instances.m_ranges[batch_idx];
+				if (ranges.empty()) continue;
+
 				auto model_handle = batch.m_model_handle;
-				auto cb_handle = batch.m_big_cb;
 				auto const& mat_vec = batch.m_material_handles;
 
 				for (std::size_t i = 0; i < model_handle.m_mesh_handles.size(); i++)
@@ -82,40 +88,43 @@ namespace tasks
 					auto vb_ib_pair = model_pool->m_mesh_shading_buffer_descriptor_sets[mesh_handle.m_id];
 					auto meshlets_index_buffer_info = model_pool->m_mesh_shading_index_buffer_descriptor_sets[mesh_handle.m_id];
 
-					std::vector<std::pair<gfx::DescriptorHeap*, std::uint32_t>> sets
-					{
-						{ camera_pool->GetDescriptorHeap(), camera_handle.m_cb_set_id }, // TODO: Shitty naming of set_id. just use a vector in the handle instead probably.
-						{ per_obj_pool->GetDescriptorHeap(), cb_handle.m_cb_set_id }, // TODO: Shitty naming of set_id. just use a vector in the handle instead probably.
-						{ material_pool->GetDescriptorHeap(), material_pool->GetDescriptorSetID(mat_vec[i]) },
-						{ material_pool->GetDescriptorHeap(), material_pool->GetCBDescriptorSetID(mat_vec[i]) },
-						{ model_pool->GetDescriptorHeap(), vb_ib_pair.first }, // vertices
-						{ model_pool->GetDescriptorHeap(), meshlets_index_buffer_info.second }, // indices
-						{ model_pool->GetDescriptorHeap(), meshlets_info.first }, // meshlets
-						{ model_pool->GetDescriptorHeap(), meshlets_index_buffer_info.first }, // vertex indices
-					};
-
-					cmd_list->BindDescriptorHeap(data.m_root_sig, sets);
-
-					const std::uint32_t num_tasks = ComputeTasksCount(meshlets_info.second * batch.m_num_meshes);
-
-					struct PushBlock
+					// One dispatch per range of visible instances. Ranges don't cross pages, the page only has to be bound when it changes.
+					std::size_t bound_page = batch.m_pages.size();
+					for (auto const& range : ranges)
 					{
-						unsigned int batch_size;
-						unsigned int num_meshlets;
-						glm::vec2 viewport;
-						glm::vec4 bbox_min;
-						glm::vec4 bbox_max;
-					} push_data;
-
-					push_data.batch_size = batch.m_num_meshes;
-					push_data.num_meshlets = meshlets_info.second;
-					push_data.bbox_min = glm::vec4(mesh_handle.m_bbox_min, 0);
-					push_data.bbox_max = glm::vec4(mesh_handle.m_bbox_max, 0);
-					push_data.viewport = glm::vec2(fg.GetRenderTarget(handle)->GetWidth(), fg.GetRenderTarget(handle)->GetHeight());
-
-					cmd_list->BindTaskPushConstants(data.m_root_sig, &push_data, sizeof(PushBlock));
-					cmd_list->DrawMesh(num_tasks, 0);
-					//cmd_list->DrawMesh(meshlets_info.second, 0);
+						auto page = range.m_first / gfx::settings::instances_per_page;
+						if (page != bound_page)
+						{
+							std::vector<std::pair<gfx::DescriptorHeap*, std::uint32_t>> sets
+							{
+								{ camera_pool->GetDescriptorHeap(), camera_handle.m_cb_set_id }, // TODO: Shitty naming of set_id. just use a vector in the handle instead probably.
+								{ per_obj_pool->GetDescriptorHeap(), batch.m_pages[page].m_cb_set_id }, // TODO: Shitty naming of set_id. just use a vector in the handle instead probably.
+								{ material_pool->GetDescriptorHeap(), material_pool->GetDescriptorSetID(mat_vec[i]) },
+								{ material_pool->GetDescriptorHeap(), material_pool->GetCBDescriptorSetID(mat_vec[i]) },
+								{ model_pool->GetDescriptorHeap(), vb_ib_pair.first }, // vertices
+								{ model_pool->GetDescriptorHeap(), meshlets_index_buffer_info.second }, // indices
+								{ model_pool->GetDescriptorHeap(), meshlets_info.first }, // meshlets
+								{ model_pool->GetDescriptorHeap(), meshlets_index_buffer_info.first }, // vertex indices
+							};
+
+							cmd_list->BindDescriptorHeap(data.m_root_sig, sets);
+							bound_page = page;
+						}
+
+						const std::uint32_t num_tasks = ComputeTasksCount(meshlets_info.second * range.m_count);
+
+						cb::MeshletDrawInfo push_data;
+						push_data.m_batch_size = range.m_count;
+						push_data.m_first_instance = range.m_first % gfx::settings::instances_per_page;
+						push_data.m_num_meshlets = meshlets_info.second;
+						push_data.m_bbox_min = glm::vec4(mesh_handle.m_bbox_min, 0);
+						push_data.m_bbox_max = glm::vec4(mesh_handle.m_bbox_max, 0);
+						push_data.m_viewport = glm::vec2(fg.GetRenderTarget(handle)->GetWidth(), fg.GetRenderTarget(handle)->GetHeight());
+
+						cmd_list->BindTaskPushConstants(data.m_root_sig, &push_data, sizeof(cb::MeshletDrawInfo));
+						cmd_list->DrawMesh(num_tasks, 0);
+						//cmd_list->DrawMesh(meshlets_info.second, 0);
+					}
 				}
 			}
 		}
@@ -136,11 +145,10 @@ namespace tasks
 			.m_height = std::nullopt,
 			.m_dsv_format = VK_FORMAT_D32_SFLOAT,
 			.m_rtv_formats = { VK_FORMAT_R32G32B32A32_SFLOAT, VK_FORMAT_R16G16B16A16_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT, VK_FORMAT_R16G16B16A16_SFLOAT, VK_FORMAT_R16G16B16A16_SFLOAT },
-			.m_state_execute = std::nullopt,
-			.m_state_finished = VK_IMAGE_LAYOUT_GENERAL,
 			.m_clear = true,
 			.m_clear_depth = true,
-			.m_allow_direct_access = true
+			.m_allow_direct_access = true,
+			.m_is_transient = true
 		};
 
 		fg::RenderTaskDesc desc;
@@ -93,8 +93,6 @@ namespace tasks
 			.m_height = 128,
 			.m_dsv_format = VK_FORMAT_UNDEFINED,
 			.m_rtv_formats = { VK_FORMAT_R16G16B16A16_SFLOAT },
-			.m_state_execute = VK_IMAGE_LAYOUT_GENERAL,
-			.m_state_finished = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
 			.m_clear = false,
 			.m_clear_depth = false,
 			.m_allow_direct_access = false,
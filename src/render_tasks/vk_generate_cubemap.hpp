@@ -45,6 +45,9 @@ namespace tasks
 		{
 			if (resize) return;
 
+			// Generating the mip maps leaves the cube map ready to be sampled.
+			fg.SetRenderTargetLeftAs(handle, fg::ResourceUsage::COPY_DST, fg::ResourceLayout::SHADER_READ_ONLY);
+
 			auto& data = fg.GetData<GenerateCubemapData>(handle);
 			data.m_root_sig = RootSignatureRegistry::SFind(root_signatures::generate_cubemap);
 			auto render_target = fg.GetRenderTarget(handle);
@@ -110,8 +113,6 @@ namespace tasks
 			.m_height = 2048,
 			.m_dsv_format = VK_FORMAT_UNDEFINED,
 			.m_rtv_formats = { VK_FORMAT_R16G16B16A16_SFLOAT },
-			.m_state_execute = VK_IMAGE_LAYOUT_GENERAL,
-			.m_state_finished = std::nullopt,
 			.m_clear = false,
 			.m_clear_depth = false,
 			.m_allow_direct_access = false,
@@ -72,7 +72,7 @@ namespace tasks
 			// Skybox
 			if (fg.HasTask<GenerateCubemapData>())
 			{
-				auto skybox_rt = fg.GetPredecessorRenderTarget<GenerateCubemapData>();
+				auto skybox_rt = fg.GetPredecessorRenderTarget<GenerateCubemapData>(fg::ResourceUsage::SAMPLED);
 				data.m_input_set = data.m_desc_heap->CreateSRVSetFromRT(skybox_rt, data.m_root_sig, 0, 0, false, input_sampler_desc);
 			}
 		}
@@ -137,8 +137,6 @@ namespace tasks
 			.m_height = 512,
 			.m_dsv_format = VK_FORMAT_UNDEFINED,
 			.m_rtv_formats = { VK_FORMAT_R16G16B16A16_SFLOAT },
-			.m_state_execute = VK_IMAGE_LAYOUT_GENERAL,
-			.m_state_finished = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
 			.m_clear = false,
 			.m_clear_depth = false,
 			.m_allow_direct_access = false,
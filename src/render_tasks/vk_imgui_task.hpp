@@ -54,7 +54,7 @@ namespace tasks
 				desc.m_versions = 1;
 				desc.m_num_descriptors = 1;
 				data.m_heap = new gfx::DescriptorHeap(rs.GetContext(), desc);
-				auto predecessor_rt = fg.GetPredecessorRenderTarget<T>();
+				auto predecessor_rt = fg.GetPredecessorRenderTarget<T>(fg::ResourceUsage::SAMPLED);
 				auto texture_desc_set_id = data.m_heap->CreateSRVSetFromRT(predecessor_rt, data.m_imgui_impl->descriptorSetLayout, 0, 0, false);
 				data.m_texture = data.m_heap->GetDescriptorSet(0, texture_desc_set_id);
 
@@ -78,7 +78,7 @@ namespace tasks
 
 			if constexpr (!std::is_same<T, NoTask>::value)
 			{
-				auto predecessor_rt = fg.GetPredecessorRenderTarget<T>();
+				auto predecessor_rt = fg.GetPredecessorRenderTarget<T>(fg::ResourceUsage::SAMPLED);
 				auto texture_desc_set_id = data.m_heap->CreateSRVSetFromRT(predecessor_rt, data.m_imgui_impl->descriptorSetLayout, 0, 0, false);
 				data.m_texture = data.m_heap->GetDescriptorSet(0, texture_desc_set_id);
 			}
@@ -105,21 +105,9 @@ namespace tasks
 
 			data.m_imgui_impl->UpdateBuffers(frame_idx);
 
-			if constexpr (!std::is_same<T, NoTask>::value)
-			{
-				auto predecessor_rt = fg.GetPredecessorRenderTarget<T>();
-				cmd_list->TransitionRenderTarget(predecessor_rt, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-				cmd_list->BindRenderTargetVersioned(rs.GetRenderWindow());
-				data.m_imgui_impl->Draw(cmd_list, frame_idx);
-				cmd_list->UnbindRenderTarget();
-				cmd_list->TransitionRenderTarget(predecessor_rt, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-			}
-			else
-			{
-				cmd_list->BindRenderTargetVersioned(rs.GetRenderWindow());
-				data.m_imgui_impl->Draw(cmd_list, frame_idx);
-				cmd_list->UnbindRenderTarget();
-			}
+			cmd_list->BindRenderTargetVersioned(rs.GetRenderWindow());
+			data.m_imgui_impl->Draw(cmd_list, frame_idx);
+			cmd_list->UnbindRenderTarget();
 #endif
 		}
 
@@ -147,8 +135,6 @@ namespace tasks
 			.m_height = std::nullopt,
 			.m_dsv_format = VK_FORMAT_D32_SFLOAT,
 			.m_rtv_formats = { gfx::settings::swapchain_format },
-			.m_state_execute = std::nullopt,
-			.m_state_finished = std::nullopt,
 			.m_clear = false,
 			.m_clear_depth = false,
 			.m_allow_direct_access = false,
@@ -100,14 +100,14 @@ namespace tasks
 			// Skybox
 			if (fg.HasTask<GenerateCubemapData>())
 			{
-				auto skybox_rt = fg.GetPredecessorRenderTarget<GenerateCubemapData>();
+				auto skybox_rt = fg.GetPredecessorRenderTarget<GenerateCubemapData>(fg::ResourceUsage::SAMPLED);
 				data.m_skybox_set = data.m_gbuffer_heap->CreateSRVSetFromRT(skybox_rt, data.m_root_sig, 9, 0, false, skybox_sampler_desc);
 			}
 
 			// BRDF Lut
 			if (fg.HasTask<GenerateBRDFLutData>())
 			{
-				auto brdf_rt = fg.GetPredecessorRenderTarget<GenerateBRDFLutData>();
+				auto brdf_rt = fg.GetPredecessorRenderTarget<GenerateBRDFLutData>(fg::ResourceUsage::SAMPLED);
 				data.m_brdf_set = data.m_gbuffer_heap->CreateSRVSetFromRT(brdf_rt, data.m_root_sig, 10, 0, false, lut_sampler_desc);
 			}
 
@@ -207,8 +207,6 @@ namespace tasks
 			.m_height = std::nullopt,
 			.m_dsv_format = VK_FORMAT_UNDEFINED,
 			.m_rtv_formats = { VK_FORMAT_R32G32B32A32_SFLOAT },
-			.m_state_execute = VK_IMAGE_LAYOUT_GENERAL,
-			.m_state_finished = std::nullopt,
 			.m_clear = false,
 			.m_clear_depth = false
 		};
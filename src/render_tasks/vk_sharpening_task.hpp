@@ -50,7 +50,7 @@ namespace tasks
 			auto& data = fg.GetData<SharpeningData>(handle);
 			data.m_root_sig = RootSignatureRegistry::SFind(root_signatures::sharpening);
 			auto render_target = fg.GetRenderTarget(handle);
-			auto predecessor_rt = fg.GetPredecessorRenderTarget<T>();
+			auto predecessor_rt = fg.GetPredecessorRenderTarget<T>(fg::ResourceUsage::STORAGE_READ);
 
 			gfx::SamplerDesc input_sampler_desc
 			{
@@ -106,10 +106,9 @@ namespace tasks
 			.m_height = std::nullopt,
 			.m_dsv_format = VK_FORMAT_UNDEFINED,
 			.m_rtv_formats = { VK_FORMAT_B8G8R8A8_UNORM },
-			.m_state_execute = VK_IMAGE_LAYOUT_GENERAL,
-			.m_state_finished = std::nullopt,
 			.m_clear = false,
-			.m_clear_depth = false
+			.m_clear_depth = false,
+			.m_is_transient = true
 		};
 
 		fg::RenderTaskDesc desc;
@@ -46,7 +46,7 @@ namespace tasks
 			auto& data = fg.GetData<TAAData>(handle);
 			data.m_root_sig = RootSignatureRegistry::SFind(root_signatures::taa);
 			auto render_target = fg.GetRenderTarget(handle);
-			auto predecessor_rt = fg.GetPredecessorRenderTarget<T>();
+			auto predecessor_rt = fg.GetPredecessorRenderTarget<T>(fg::ResourceUsage::STORAGE_READ);
 
 			gfx::SamplerDesc input_sampler_desc
 			{
@@ -105,8 +105,6 @@ namespace tasks
 			.m_height = std::nullopt, 
 			.m_dsv_format = VK_FORMAT_UNDEFINED,
 			.m_rtv_formats = { VK_FORMAT_R32G32B32A32_SFLOAT },
-			.m_state_execute = VK_IMAGE_LAYOUT_GENERAL,
-			.m_state_finished = std::nullopt,
 			.m_clear = false,
 			.m_clear_depth = false
 		};
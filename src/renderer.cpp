@@ -31,6 +31,91 @@
 #include "graphics/descriptor_heap.hpp"
 #include "engine_registry.hpp"
 
+namespace internal
+{
+
+	inline VkImageLayout ToVkImageLayout(fg::ResourceLayout layout)
+	{
+		switch (layout)
+		{
+		case fg::ResourceLayout::GENERAL: return VK_IMAGE_LAYOUT_GENERAL;
+		case fg::ResourceLayout::SHADER_READ_ONLY: return VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		case fg::ResourceLayout::COLOR_ATTACHMENT: return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		case fg::ResourceLayout::TRANSFER_SRC: return VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		case fg::ResourceLayout::TRANSFER_DST: return VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		default: return VK_IMAGE_LAYOUT_UNDEFINED;
+		}
+	}
+
+	//! The stages the usages happen in. The frame graph doesn't know which shader stages a task uses, so shader usages cover all of them.
+	inline VkPipelineStageFlags ToVkPipelineStages(fg::ResourceUsageMask usages)
+	{
+		constexpr auto shader_usages = fg::ToMask(fg::ResourceUsage::SAMPLED) | fg::ToMask(fg::ResourceUsage::STORAGE_READ) | fg::ToMask(fg::ResourceUsage::STORAGE_WRITE);
+		constexpr auto copy_usages = fg::ToMask(fg::ResourceUsage::COPY_SRC) | fg::ToMask(fg::ResourceUsage::COPY_DST);
+
+		VkPipelineStageFlags stages = 0;
+		if (usages & shader_usages)
+		{
+			stages |= VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_NV;
+		}
+		if (usages & fg::ToMask(fg::ResourceUsage::ATTACHMENT))
+		{
+			stages |= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		}
+		if (usages & copy_usages)
+		{
+			stages |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+		}
+		return stages;
+	}
+
+	inline VkAccessFlags ToVkAccessFlags(fg::ResourceUsageMask usages)
+	{
+		VkAccessFlags access = 0;
+		if (usages & (fg::ToMask(fg::ResourceUsage::SAMPLED) | fg::ToMask(fg::ResourceUsage::STORAGE_READ)))
+		{
+			access |= VK_ACCESS_SHADER_READ_BIT;
+		}
+		if (usages & fg::ToMask(fg::ResourceUsage::STORAGE_WRITE))
+		{
+			access |= VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		}
+		if (usages & fg::ToMask(fg::ResourceUsage::ATTACHMENT))
+		{
+			access |= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		}
+		if (usages & fg::ToMask(fg::ResourceUsage::COPY_SRC))
+		{
+			access |= VK_ACCESS_TRANSFER_READ_BIT;
+		}
+		if (usages & fg::ToMask(fg::ResourceUsage::COPY_DST))
+		{
+			access |= VK_ACCESS_TRANSFER_WRITE_BIT;
+		}
+		return access;
+	}
+
+	//! Only writes have to be made available. Waiting on reads only needs the stages.
+	inline VkAccessFlags ToVkSrcAccessFlags(fg::ResourceUsageMask usages)
+	{
+		VkAccessFlags access = 0;
+		if (usages & fg::ToMask(fg::ResourceUsage::STORAGE_WRITE))
+		{
+			access |= VK_ACCESS_SHADER_WRITE_BIT;
+		}
+		if (usages & fg::ToMask(fg::ResourceUsage::ATTACHMENT))
+		{
+			access |= VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		}
+		if (usages & fg::ToMask(fg::ResourceUsage::COPY_DST))
+		{
+			access |= VK_ACCESS_TRANSFER_WRITE_BIT;
+		}
+		return access;
+	}
+
+} /* internal */
+
 Renderer::Renderer() : m_application(nullptr), m_context(nullptr), m_direct_queue(nullptr), m_render_window(nullptr), m_direct_cmd_list(nullptr)
 {
 	TexturePool::RegisterLoader<STBImageLoader>();
@@ -294,54 +379,19 @@ void Renderer::ResetCommandList(gfx::CommandList* cmd_list)
 
 void Renderer::StartRenderTask(gfx::CommandList* cmd_list, std::pair<gfx::RenderTarget*, RenderTargetProperties> render_target)
 {
-	auto desc = render_target.second;
-
 	if (render_target.second.m_is_render_window)
 	{
 		cmd_list->BindRenderTargetVersioned(render_target.first);
 	}
 	else
 	{
-		if (!desc.m_is_render_window && desc.m_state_execute.has_value())
-		{
-			cmd_list->TransitionRenderTarget(render_target.first, VK_IMAGE_LAYOUT_UNDEFINED, desc.m_state_execute.value());
-		}
 		cmd_list->BindRenderTarget(render_target.first);
 	}
 }
 
 void Renderer::StopRenderTask(gfx::CommandList* cmd_list, std::pair<gfx::RenderTarget*, RenderTargetProperties> render_target)
 {
-	auto desc = render_target.second;
-
 	cmd_list->UnbindRenderTarget();
-
-	if (!desc.m_is_render_window && desc.m_state_finished.has_value())
-	{
-		auto old = desc.m_state_execute.has_value() ? desc.m_state_execute.value() : VK_IMAGE_LAYOUT_UNDEFINED;
-		cmd_list->TransitionRenderTarget(render_target.first, old, desc.m_state_finished.value());
-	}
-}
-
-void Renderer::StartComputeTask(gfx::CommandList* cmd_list, std::pair<gfx::RenderTarget*, RenderTargetProperties> render_target)
-{
-	auto desc = render_target.second;
-
-	if (!desc.m_is_render_window && desc.m_state_execute.has_value())
-	{
-		cmd_list->TransitionRenderTarget(render_target.first, VK_IMAGE_LAYOUT_UNDEFINED, desc.m_state_execute.value());
-	}
-}
-
-void Renderer::StopComputeTask(gfx::CommandList* cmd_list, std::pair<gfx::RenderTarget*, RenderTargetProperties> render_target)
-{
-	auto desc = render_target.second;
-
-	if (!desc.m_is_render_window && desc.m_state_finished.has_value())
-	{
-		auto old = desc.m_state_execute.has_value() ? desc.m_state_execute.value() : VK_IMAGE_LAYOUT_UNDEFINED;
-		cmd_list->TransitionRenderTarget(render_target.first, old, desc.m_state_finished.value());
-	}
 }
 
 void Renderer::CloseCommandList(gfx::CommandList* cmd_list)
@@ -388,9 +438,71 @@ void Renderer::DestroyRenderTarget(gfx::RenderTarget* render_target)
 	delete render_target;
 }
 
-ConstantBufferPool* Renderer::CreateConstantBufferPool(std::size_t buffer_size, std::size_t num_buffers, std::uint32_t binding, VkShaderStageFlags flags)
+VkMemoryRequirements Renderer::GetRenderTargetMemoryRequirements(gfx::RenderTarget* render_target)
+{
+	return render_target->GetMemoryRequirements();
+}
+
+gfx::RenderTargetHeap* Renderer::CreateRenderTargetHeap(VkMemoryRequirements const & requirements)
+{
+	return new gfx::RenderTargetHeap(m_context, requirements);
+}
+
+void Renderer::DestroyRenderTargetHeap(gfx::RenderTargetHeap* heap)
+{
+	delete heap;
+}
+
+void Renderer::PlaceRenderTarget(gfx::RenderTarget* render_target, gfx::RenderTargetHeap* heap, std::uint64_t offset)
+{
+	render_target->Place(heap, offset);
+}
+
+void Renderer::ResourceBarrier(gfx::CommandList* cmd_list, fg::BarrierBatch const & barriers, std::vector<gfx::RenderTarget*> const & render_targets, bool wait_for_aliased_memory)
+{
+	auto src_stages = internal::ToVkPipelineStages(barriers.m_src_usages);
+	auto dst_stages = internal::ToVkPipelineStages(barriers.m_dst_usages);
+	VkAccessFlags src_access = 0;
+	VkAccessFlags dst_access = 0;
+
+	std::vector<gfx::RenderTargetBarrier> transitions;
+	transitions.reserve(barriers.m_transitions.size());
+	for (auto const & transition : barriers.m_transitions)
+	{
+		// Without a layout change the writes only have to be made visible, that doesn't need a barrier per image.
+		if (transition.m_from == transition.m_to)
+		{
+			src_access |= internal::ToVkSrcAccessFlags(transition.m_src_usages);
+			dst_access |= internal::ToVkAccessFlags(transition.m_dst_usages);
+			continue;
+		}
+
+		transitions.push_back({ render_targets[transition.m_target],
+			internal::ToVkImageLayout(transition.m_from), internal::ToVkImageLayout(transition.m_to),
+			internal::ToVkSrcAccessFlags(transition.m_src_usages), internal::ToVkAccessFlags(transition.m_dst_usages) });
+	}
+
+	// The memory of the render target was used by another render target, everything before has to be done with it.
+	if (wait_for_aliased_memory)
+	{
+		src_stages |= VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		dst_stages |= VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		src_access |= VK_ACCESS_MEMORY_WRITE_BIT;
+		dst_access |= VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+	}
+
+	// Nothing to wait on, like the first use of a render target.
+	if (!src_stages)
+	{
+		src_stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	}
+
+	cmd_list->PipelineBarrier(src_stages, dst_stages, src_access, dst_access, transitions);
+}
+
+ConstantBufferPool* Renderer::CreateConstantBufferPool(std::size_t buffer_size, std::size_t num_buffers, std::uint32_t binding, VkShaderStageFlags flags, gfx::enums::BufferDescType type)
 {
-	return new gfx::VkConstantBufferPool(m_context, buffer_size, num_buffers, binding, flags);
+	return new gfx::VkConstantBufferPool(m_context, buffer_size, num_buffers, binding, flags, type, gfx::settings::suballocate_constant_buffers);
 }
 
 gfx::RenderWindow* Renderer::GetRenderWindow()
@@ -10,6 +10,7 @@
 #include <cstdint>
 
 #include "resource_structs.hpp"
+#include "graphics/gfx_enums.hpp"
 
 class Application;
 struct ModelData;
@@ -30,6 +31,7 @@ namespace fg
 {
 
 	class FrameGraph;
+	struct BarrierBatch;
 
 } /* fg */
 
@@ -44,6 +46,7 @@ namespace gfx
 	class PipelineState;
 	class RootSignature;
 	class RenderTarget;
+	class RenderTargetHeap;
 	class CommandList;
 	class GPUBuffer;
 	class StagingBuffer;
@@ -87,16 +90,20 @@ public:
 	void ResetCommandList(gfx::CommandList* cmd_list);
 	void StartRenderTask(gfx::CommandList* cmd_list, std::pair<gfx::RenderTarget*, RenderTargetProperties> render_target);
 	void StopRenderTask(gfx::CommandList* cmd_list, std::pair<gfx::RenderTarget*, RenderTargetProperties> render_target);
-	void StartComputeTask(gfx::CommandList* cmd_list, std::pair<gfx::RenderTarget*, RenderTargetProperties> render_target);
-	void StopComputeTask(gfx::CommandList* cmd_list, std::pair<gfx::RenderTarget*, RenderTargetProperties> render_target);
 	void CloseCommandList(gfx::CommandList* cmd_list);
 	void DestroyCommandList(gfx::CommandList* cmd_list);
 
-	ConstantBufferPool* CreateConstantBufferPool(std::size_t buffer_size, std::size_t num_buffers, std::uint32_t binding, VkShaderStageFlags flags = VK_SHADER_STAGE_VERTEX_BIT);
+	ConstantBufferPool* CreateConstantBufferPool(std::size_t buffer_size, std::size_t num_buffers, std::uint32_t binding, VkShaderStageFlags flags = VK_SHADER_STAGE_VERTEX_BIT,
+		gfx::enums::BufferDescType type = gfx::enums::BufferDescType::UNIFORM);
 
 	gfx::RenderTarget* CreateRenderTarget(RenderTargetProperties const & properties, bool compute);
 	void ResizeRenderTarget(gfx::RenderTarget* render_target, std::uint32_t width, std::uint32_t height);
 	void DestroyRenderTarget(gfx::RenderTarget* render_target);
+	VkMemoryRequirements GetRenderTargetMemoryRequirements(gfx::RenderTarget* render_target);
+	gfx::RenderTargetHeap* CreateRenderTargetHeap(VkMemoryRequirements const & requirements);
+	void DestroyRenderTargetHeap(gfx::RenderTargetHeap* heap);
+	void PlaceRenderTarget(gfx::RenderTarget* render_target, gfx::RenderTargetHeap* heap, std::uint64_t offset);
+	void ResourceBarrier(gfx::CommandList* cmd_list, fg::BarrierBatch const & barriers, std::vector<gfx::RenderTarget*> const & render_targets, bool wait_for_aliased_memory);
 	gfx::RenderWindow* GetRenderWindow();
 
 	// TODO: These need to be destroyed
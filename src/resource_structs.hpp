@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <string>
 #include <vector>
 #include <vec2.hpp>
 #include <vec3.hpp>
@@ -19,6 +20,7 @@ struct TextureData
 	std::uint32_t m_channels = -1;
 	bool m_is_hdr = false;
 	void* m_pixels = nullptr;
+	std::string m_path; // Empty when the texture didn't come from a file.
 };
 
 struct MaterialData
@@ -68,10 +70,21 @@ struct MeshData
 	std::uint32_t m_material_id;
 };
 
+//! Node of the source hierarchy of a model. Only loaders that preserve the hierarchy fill these in.
+struct ModelNodeData
+{
+	std::int32_t m_parent = -1; // Index into `ModelData::m_nodes`. Parents always come before their children.
+	glm::vec3 m_position = { 0, 0, 0 };
+	glm::vec3 m_rotation = { 0, 0, 0 }; // Euler angles in radians.
+	glm::vec3 m_scale = { 1, 1, 1 };
+	std::vector<std::uint32_t> m_meshes; // Indices into `ModelData::m_meshes`. Meshes can be shared by multiple nodes.
+};
+
 struct ModelData
 {
 	std::vector<MeshData> m_meshes;
 	std::vector<MaterialData> m_materials;
+	std::vector<ModelNodeData> m_nodes; // Empty when the hierarchy is baked into the vertex positions.
 };
 
 struct RenderTargetProperties
@@ -93,8 +106,6 @@ struct RenderTargetProperties
 	//CreateDSVBuffer m_create_dsv_buffer;
 	VkFormat m_dsv_format;
 	std::vector<VkFormat> m_rtv_formats;
-	std::optional<VkImageLayout> m_state_execute;
-	std::optional<VkImageLayout> m_state_finished;
 
 	bool m_clear = false;
 	bool m_clear_depth = false;
@@ -105,4 +116,6 @@ struct RenderTargetProperties
 	float m_resolution_scale = 1;
 
 	bool m_bind_by_default = true;
+
+	bool m_is_transient = false; // Only read in the frame it is written in, so the frame graph can share its memory with targets that aren't alive at the same time.
 };
\ No newline at end of file
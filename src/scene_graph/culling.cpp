@@ -0,0 +1,425 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include "culling.hpp"
+
+#include <cmath>
+#include <utility>
+#include <algorithm>
+
+#ifdef SG_CULLING_SSE
+#include <emmintrin.h>
+#endif
+
+namespace internal
+{
+
+	inline float SurfaceArea(sg::AABB const & aabb)
+	{
+		auto size = aabb.m_max - aabb.m_min;
+		return 2.f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+} /* internal */
+
+sg::AABB sg::Union(AABB const & a, AABB const & b)
+{
+	return AABB{ glm::min(a.m_min, b.m_min), glm::max(a.m_max, b.m_max) };
+}
+
+bool sg::Contains(AABB const & outer, AABB const & inner)
+{
+	return outer.m_min.x <= inner.m_min.x && outer.m_min.y <= inner.m_min.y && outer.m_min.z <= inner.m_min.z
+		&& outer.m_max.x >= inner.m_max.x && outer.m_max.y >= inner.m_max.y && outer.m_max.z >= inner.m_max.z;
+}
+
+sg::AABB sg::TransformAABB(AABB const & aabb, glm::mat4 const & transform)
+{
+	// Transform the center and project the extents on every axis (Arvo).
+	auto center = (aabb.m_min + aabb.m_max) * 0.5f;
+	auto extents = (aabb.m_max - aabb.m_min) * 0.5f;
+
+	auto new_center = glm::vec3(transform * glm::vec4(center, 1));
+	glm::vec3 new_extents;
+	for (auto r = 0; r < 3; r++)
+	{
+		new_extents[r] = std::abs(transform[0][r]) * extents.x + std::abs(transform[1][r]) * extents.y + std::abs(transform[2][r]) * extents.z;
+	}
+
+	return AABB{ new_center - new_extents, new_center + new_extents };
+}
+
+sg::Frustum sg::ExtractFrustum(glm::mat4 const & view_projection)
+{
+	auto row = [&view_projection](int r)
+	{
+		return glm::vec4(view_projection[0][r], view_projection[1][r], view_projection[2][r], view_projection[3][r]);
+	};
+
+	glm::vec4 planes[6] = {
+		row(3) + row(0), // left
+		row(3) - row(0), // right
+		row(3) + row(1), // bottom
+		row(3) - row(1), // top
+		row(3) + row(2), // near
+		row(3) - row(2), // far
+	};
+
+	Frustum frustum;
+	for (auto i = 0; i < 8; i++)
+	{
+		auto plane = planes[i % 6];
+		plane = plane / glm::length(glm::vec3(plane));
+
+		frustum.m_normal_x[i] = plane.x;
+		frustum.m_normal_y[i] = plane.y;
+		frustum.m_normal_z[i] = plane.z;
+		frustum.m_distance[i] = plane.w;
+	}
+
+	return frustum;
+}
+
+sg::CullResult sg::TestAABB(Frustum const & frustum, AABB const & aabb)
+{
+	auto center = (aabb.m_min + aabb.m_max) * 0.5f;
+	auto extents = (aabb.m_max - aabb.m_min) * 0.5f;
+
+#ifdef SG_CULLING_SSE
+	__m128 cx = _mm_set1_ps(center.x), cy = _mm_set1_ps(center.y), cz = _mm_set1_ps(center.z);
+	__m128 ex = _mm_set1_ps(extents.x), ey = _mm_set1_ps(extents.y), ez = _mm_set1_ps(extents.z);
+	__m128 sign_mask = _mm_set1_ps(-0.f);
+
+	int intersecting = 0;
+	for (auto i = 0; i < 8; i += 4)
+	{
+		__m128 nx = _mm_load_ps(frustum.m_normal_x + i);
+		__m128 ny = _mm_load_ps(frustum.m_normal_y + i);
+		__m128 nz = _mm_load_ps(frustum.m_normal_z + i);
+
+		// Signed distance of the center and the projected radius of the box on the plane normals.
+		__m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)), _mm_add_ps(_mm_mul_ps(nz, cz), _mm_load_ps(frustum.m_distance + i)));
+		__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(sign_mask, nx), ex), _mm_mul_ps(_mm_andnot_ps(sign_mask, ny), ey)), _mm_mul_ps(_mm_andnot_ps(sign_mask, nz), ez));
+
+		if (_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(dist, radius), _mm_setzero_ps())))
+		{
+			return CullResult::OUTSIDE;
+		}
+		intersecting |= _mm_movemask_ps(_mm_cmplt_ps(dist, radius));
+	}
+
+	return intersecting ? CullResult::INTERSECTING : CullResult::INSIDE;
+#else
+	auto result = CullResult::INSIDE;
+	for (auto i = 0; i < 6; i++)
+	{
+		auto dist = frustum.m_normal_x[i] * center.x + frustum.m_normal_y[i] * center.y + frustum.m_normal_z[i] * center.z + frustum.m_distance[i];
+		auto radius = std::abs(frustum.m_normal_x[i]) * extents.x + std::abs(frustum.m_normal_y[i]) * extents.y + std::abs(frustum.m_normal_z[i]) * extents.z;
+
+		if (dist + radius < 0) return CullResult::OUTSIDE;
+		if (dist < radius) result = CullResult::INTERSECTING;
+	}
+
+	return result;
+#endif
+}
+
+sg::AABBTree::AABBTree(float margin)
+	: m_root(-1), m_free_list(-1), m_num_proxies(0), m_margin(margin)
+{
+}
+
+std::int32_t sg::AABBTree::CreateProxy(AABB const & aabb, std::uint32_t user_data)
+{
+	auto proxy = AllocateNode();
+	m_nodes[proxy].m_aabb = Fatten(aabb);
+	m_nodes[proxy].m_user_data = user_data;
+	m_nodes[proxy].m_height = 0;
+
+	InsertLeaf(proxy);
+	m_num_proxies++;
+
+	return proxy;
+}
+
+void sg::AABBTree::DestroyProxy(std::int32_t proxy)
+{
+	RemoveLeaf(proxy);
+	FreeNode(proxy);
+	m_num_proxies--;
+}
+
+bool sg::AABBTree::MoveProxy(std::int32_t proxy, AABB const & aabb)
+{
+	// Keep the proxy when it still fits and the grown box didn't become much larger than needed, for example after scaling down.
+	auto const & fat_aabb = m_nodes[proxy].m_aabb;
+	if (Contains(fat_aabb, aabb))
+	{
+		auto huge_aabb = AABB{ aabb.m_min - glm::vec3(4.f * m_margin), aabb.m_max + glm::vec3(4.f * m_margin) };
+		if (Contains(huge_aabb, fat_aabb)) return false;
+	}
+
+	RemoveLeaf(proxy);
+	m_nodes[proxy].m_aabb = Fatten(aabb);
+	InsertLeaf(proxy);
+
+	return true;
+}
+
+void sg::AABBTree::SetUserData(std::int32_t proxy, std::uint32_t user_data)
+{
+	m_nodes[proxy].m_user_data = user_data;
+}
+
+std::uint32_t sg::AABBTree::GetUserData(std::int32_t proxy) const
+{
+	return m_nodes[proxy].m_user_data;
+}
+
+sg::AABB const & sg::AABBTree::GetFatAABB(std::int32_t proxy) const
+{
+	return m_nodes[proxy].m_aabb;
+}
+
+std::size_t sg::AABBTree::GetNumProxies() const
+{
+	return m_num_proxies;
+}
+
+std::uint32_t sg::AABBTree::GetHeight() const
+{
+	return m_root == -1 ? 0 : static_cast<std::uint32_t>(m_nodes[m_root].m_height);
+}
+
+void sg::AABBTree::Query(Frustum const & frustum, std::vector<std::uint32_t>& out) const
+{
+	if (m_root == -1) return;
+
+	// The flag tells whether the node still needs to be tested. Children of nodes inside the frustum don't.
+	std::vector<std::pair<std::int32_t, bool>> stack;
+	stack.reserve(64);
+	stack.emplace_back(m_root, true);
+
+	while (!stack.empty())
+	{
+		auto [node_idx, test] = stack.back();
+		stack.pop_back();
+
+		auto const & node = m_nodes[node_idx];
+		if (test)
+		{
+			auto result = TestAABB(frustum, node.m_aabb);
+			if (result == CullResult::OUTSIDE) continue;
+			test = result == CullResult::INTERSECTING;
+		}
+
+		if (node.IsLeaf())
+		{
+			out.push_back(node.m_user_data);
+			continue;
+		}
+
+		stack.emplace_back(node.m_left, test);
+		stack.emplace_back(node.m_right, test);
+	}
+}
+
+std::int32_t sg::AABBTree::AllocateNode()
+{
+	std::int32_t node;
+	if (m_free_list != -1)
+	{
+		node = m_free_list;
+		m_free_list = m_nodes[node].m_parent;
+	}
+	else
+	{
+		node = static_cast<std::int32_t>(m_nodes.size());
+		m_nodes.emplace_back();
+	}
+
+	m_nodes[node].m_parent = -1;
+	m_nodes[node].m_left = -1;
+	m_nodes[node].m_right = -1;
+	m_nodes[node].m_height = 0;
+	m_nodes[node].m_user_data = 0;
+
+	return node;
+}
+
+void sg::AABBTree::FreeNode(std::int32_t node)
+{
+	m_nodes[node].m_parent = m_free_list;
+	m_nodes[node].m_height = -1;
+	m_free_list = node;
+}
+
+void sg::AABBTree::InsertLeaf(std::int32_t leaf)
+{
+	if (m_root == -1)
+	{
+		m_root = leaf;
+		m_nodes[leaf].m_parent = -1;
+		return;
+	}
+
+	// Walk down to the sibling with the lowest cost. The cost of a node is the area it adds to the tree,
+	// including the area its ancestors grow by.
+	auto leaf_aabb = m_nodes[leaf].m_aabb;
+	auto sibling = m_root;
+	while (!m_nodes[sibling].IsLeaf())
+	{
+		auto const & node = m_nodes[sibling];
+		auto area = internal::SurfaceArea(node.m_aabb);
+		auto combined_area = internal::SurfaceArea(Union(node.m_aabb, leaf_aabb));
+
+		auto cost = 2.f * combined_area;
+		auto inheritance_cost = 2.f * (combined_area - area);
+
+		auto child_cost = [&](std::int32_t child)
+		{
+			auto const & child_aabb = m_nodes[child].m_aabb;
+			auto new_area = internal::SurfaceArea(Union(child_aabb, leaf_aabb));
+			return m_nodes[child].IsLeaf() ? new_area + inheritance_cost : new_area - internal::SurfaceArea(child_aabb) + inheritance_cost;
+		};
+		auto left_cost = child_cost(node.m_left);
+		auto right_cost = child_cost(node.m_right);
+
+		if (cost < left_cost && cost < right_cost) break;
+
+		sibling = left_cost < right_cost ? node.m_left : node.m_right;
+	}
+
+	auto old_parent = m_nodes[sibling].m_parent;
+	auto new_parent = AllocateNode();
+	m_nodes[new_parent].m_parent = old_parent;
+	m_nodes[new_parent].m_aabb = Union(leaf_aabb, m_nodes[sibling].m_aabb);
+	m_nodes[new_parent].m_height = m_nodes[sibling].m_height + 1;
+	m_nodes[new_parent].m_left = sibling;
+	m_nodes[new_parent].m_right = leaf;
+	m_nodes[sibling].m_parent = new_parent;
+	m_nodes[leaf].m_parent = new_parent;
+
+	if (old_parent == -1)
+	{
+		m_root = new_parent;
+	}
+	else if (m_nodes[old_parent].m_left == sibling)
+	{
+		m_nodes[old_parent].m_left = new_parent;
+	}
+	else
+	{
+		m_nodes[old_parent].m_right = new_parent;
+	}
+
+	Refit(new_parent);
+}
+
+void sg::AABBTree::RemoveLeaf(std::int32_t leaf)
+{
+	if (leaf == m_root)
+	{
+		m_root = -1;
+		return;
+	}
+
+	auto parent = m_nodes[leaf].m_parent;
+	auto grand_parent = m_nodes[parent].m_parent;
+	auto sibling = m_nodes[parent].m_left == leaf ? m_nodes[parent].m_right : m_nodes[parent].m_left;
+
+	// The sibling takes the place of the parent.
+	m_nodes[sibling].m_parent = grand_parent;
+	FreeNode(parent);
+
+	if (grand_parent == -1)
+	{
+		m_root = sibling;
+		return;
+	}
+
+	if (m_nodes[grand_parent].m_left == parent)
+	{
+		m_nodes[grand_parent].m_left = sibling;
+	}
+	else
+	{
+		m_nodes[grand_parent].m_right = sibling;
+	}
+
+	Refit(grand_parent);
+}
+
+void sg::AABBTree::Refit(std::int32_t node)
+{
+	while (node != -1)
+	{
+		node = Balance(node);
+
+		auto& n = m_nodes[node];
+		auto const & left = m_nodes[n.m_left];
+		auto const & right = m_nodes[n.m_right];
+		n.m_height = 1 + std::max(left.m_height, right.m_height);
+		n.m_aabb = Union(left.m_aabb, right.m_aabb);
+
+		node = n.m_parent;
+	}
+}
+
+std::int32_t sg::AABBTree::Balance(std::int32_t a)
+{
+	auto& node_a = m_nodes[a];
+	if (node_a.IsLeaf() || node_a.m_height < 2) return a;
+
+	auto b = node_a.m_left;
+	auto c = node_a.m_right;
+	auto balance = m_nodes[c].m_height - m_nodes[b].m_height;
+	if (balance >= -1 && balance <= 1) return a;
+
+	// Rotate the higher child up. `up` takes the place of `a` and `a` adopts the lower grandchild.
+	auto up = balance > 1 ? c : b;
+	auto other = balance > 1 ? b : c;
+	auto& node_up = m_nodes[up];
+	auto f = node_up.m_left;
+	auto g = node_up.m_right;
+
+	node_up.m_left = a;
+	node_up.m_parent = node_a.m_parent;
+	node_a.m_parent = up;
+
+	if (node_up.m_parent == -1)
+	{
+		m_root = up;
+	}
+	else if (m_nodes[node_up.m_parent].m_left == a)
+	{
+		m_nodes[node_up.m_parent].m_left = up;
+	}
+	else
+	{
+		m_nodes[node_up.m_parent].m_right = up;
+	}
+
+	auto keep = m_nodes[f].m_height > m_nodes[g].m_height ? f : g;
+	auto move = keep == f ? g : f;
+
+	node_up.m_right = keep;
+	if (balance > 1) node_a.m_right = move;
+	else node_a.m_left = move;
+	m_nodes[move].m_parent = a;
+
+	node_a.m_aabb = Union(m_nodes[other].m_aabb, m_nodes[move].m_aabb);
+	node_a.m_height = 1 + std::max(m_nodes[other].m_height, m_nodes[move].m_height);
+	node_up.m_aabb = Union(node_a.m_aabb, m_nodes[keep].m_aabb);
+	node_up.m_height = 1 + std::max(node_a.m_height, m_nodes[keep].m_height);
+
+	return up;
+}
+
+sg::AABB sg::AABBTree::Fatten(AABB const & aabb) const
+{
+	return AABB{ aabb.m_min - glm::vec3(m_margin), aabb.m_max + glm::vec3(m_margin) };
+}
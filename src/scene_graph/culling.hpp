@@ -0,0 +1,121 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SG_CULLING_SSE
+#endif
+
+namespace sg
+{
+
+	class SceneGraph;
+
+	struct AABB
+	{
+		glm::vec3 m_min;
+		glm::vec3 m_max;
+	};
+
+	AABB Union(AABB const & a, AABB const & b);
+	bool Contains(AABB const & outer, AABB const & inner);
+	//! Bounding box of `aabb` after transforming it with the affine matrix `transform`.
+	AABB TransformAABB(AABB const & aabb, glm::mat4 const & transform);
+
+	//! The 6 planes of a view frustum, pointing inwards.
+	/*!
+		Stored as structure of arrays padded to 8 planes so they can be tested 4 at a time.
+		The padding repeats the first planes, which doesn't change the result.
+	*/
+	struct Frustum
+	{
+		alignas(16) float m_normal_x[8];
+		alignas(16) float m_normal_y[8];
+		alignas(16) float m_normal_z[8];
+		alignas(16) float m_distance[8];
+	};
+
+	//! Extracts the frustum planes of `projection * view` with the OpenGL depth range of -1 to 1 that `glm::perspective` produces.
+	Frustum ExtractFrustum(glm::mat4 const & view_projection);
+
+	enum class CullResult
+	{
+		OUTSIDE,
+		INTERSECTING,
+		INSIDE
+	};
+
+	//! Tests a box against all planes of the frustum. Uses SSE when available.
+	CullResult TestAABB(Frustum const & frustum, AABB const & aabb);
+
+	//! Dynamic bounding volume hierarchy over boxes that move every now and then.
+	/*!
+		Leaves store a box grown by `margin` so small movements don't change the tree. A leaf only gets reinserted
+		once its box leaves the grown box. Inserts pick the sibling with the lowest surface area cost and rotations keep
+		the tree balanced, like the dynamic tree of Box2D. Proxy ids stay valid until the proxy gets destroyed.
+	*/
+	class AABBTree
+	{
+		friend class SceneGraph; // Snapshots store the nodes as they are.
+	public:
+		explicit AABBTree(float margin = 0.1f);
+
+		std::int32_t CreateProxy(AABB const & aabb, std::uint32_t user_data);
+		void DestroyProxy(std::int32_t proxy);
+		//! Returns true when the proxy had to be reinserted.
+		bool MoveProxy(std::int32_t proxy, AABB const & aabb);
+		void SetUserData(std::int32_t proxy, std::uint32_t user_data);
+		std::uint32_t GetUserData(std::int32_t proxy) const;
+		AABB const & GetFatAABB(std::int32_t proxy) const;
+		std::size_t GetNumProxies() const;
+		//! Longest path from the root to a leaf. 0 for an empty tree or a single proxy.
+		std::uint32_t GetHeight() const;
+
+		//! Appends the user data of every proxy whose grown box is at least partially inside the frustum.
+		/*!
+			Subtrees that are completely inside the frustum are appended without testing their children.
+		*/
+		void Query(Frustum const & frustum, std::vector<std::uint32_t>& out) const;
+
+	private:
+		struct Node
+		{
+			AABB m_aabb;
+			std::int32_t m_parent; // Next free node while the node is unused.
+			std::int32_t m_left;
+			std::int32_t m_right;
+			std::int32_t m_height; // 0 for leaves, -1 for free nodes.
+			std::uint32_t m_user_data;
+
+			bool IsLeaf() const
+			{
+				return m_left == -1;
+			}
+		};
+
+		std::int32_t AllocateNode();
+		void FreeNode(std::int32_t node);
+		void InsertLeaf(std::int32_t leaf);
+		void RemoveLeaf(std::int32_t leaf);
+		//! Rotates the subtree at `a` when its children differ more than one in height. Returns the new root of the subtree.
+		std::int32_t Balance(std::int32_t a);
+		//! Recomputes the boxes and heights from `node` up to the root, balancing on the way.
+		void Refit(std::int32_t node);
+		AABB Fatten(AABB const & aabb) const;
+
+		std::vector<Node> m_nodes;
+		std::int32_t m_root;
+		std::int32_t m_free_list;
+		std::size_t m_num_proxies;
+		float m_margin;
+	};
+
+} /* sg */
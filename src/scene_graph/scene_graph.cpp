@@ -6,25 +6,56 @@
 
 #include "scene_graph.hpp"
 
+#include <algorithm>
+#include <bit>
+
 #include "../util/bitfield.hpp"
 #include "../renderer.hpp"
+#include "../host_constant_buffer_pool.hpp"
 
 sg::SceneGraph::SceneGraph(Renderer* renderer)
+	: SceneGraph(
+		renderer->CreateConstantBufferPool(sizeof(Matrix3x4) * gfx::settings::instances_per_page, gfx::settings::max_instance_pages, 1,
+			VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_MESH_BIT_NV | VK_SHADER_STAGE_TASK_BIT_NV, gfx::enums::BufferDescType::STORAGE),
+		renderer->CreateConstantBufferPool(sizeof(cb::Camera), 1, 0, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_MESH_BIT_NV | VK_SHADER_STAGE_TASK_BIT_NV),
+		renderer->CreateConstantBufferPool(sizeof(cb::RaytracingCamera), 1, 2, VK_SHADER_STAGE_RAYGEN_BIT_NV),
+		renderer->CreateConstantBufferPool(internal::light_stride * gfx::settings::max_lights, 1, 3, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_CLOSEST_HIT_BIT_NV | VK_SHADER_STAGE_MISS_BIT_NV))
 {
-	m_meshes_require_batching.resize(gfx::settings::num_back_buffers);
-	m_batch_requires_update.resize(gfx::settings::num_back_buffers);
-	m_num_lights.resize(gfx::settings::num_back_buffers, 0);
+}
+
+sg::SceneGraph::SceneGraph()
+	: SceneGraph(
+		new HostConstantBufferPool(sizeof(Matrix3x4) * gfx::settings::instances_per_page, gfx::settings::max_instance_pages),
+		new HostConstantBufferPool(sizeof(cb::Camera), 1),
+		new HostConstantBufferPool(sizeof(cb::RaytracingCamera), 1),
+		new HostConstantBufferPool(internal::light_stride * gfx::settings::max_lights, 1))
+{
+}
+
+sg::SceneGraph::SceneGraph(ConstantBufferPool* per_object_buffer_pool, ConstantBufferPool* camera_buffer_pool,
+	ConstantBufferPool* inverse_camera_buffer_pool, ConstantBufferPool* light_buffer_pool)
+	: m_culling_tree(settings::culling_aabb_margin), m_per_object_buffer_pool(per_object_buffer_pool), m_camera_buffer_pool(camera_buffer_pool),
+	m_inverse_camera_buffer_pool(inverse_camera_buffer_pool), m_light_buffer_pool(light_buffer_pool), m_job_system(nullptr)
+{
+	if (settings::use_parallel_transform_update)
+	{
+		auto num_threads = settings::num_transform_update_threads;
+		if (num_threads == 0)
+		{
+			num_threads = std::max(1u, std::thread::hardware_concurrency());
+		}
 
-	m_per_object_buffer_pool = renderer->CreateConstantBufferPool(sizeof(cb::Basic) * gfx::settings::max_render_batch_size, 100, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_MESH_BIT_NV | VK_SHADER_STAGE_TASK_BIT_NV);
-	m_camera_buffer_pool = renderer->CreateConstantBufferPool(sizeof(cb::Camera), 1, 0, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_MESH_BIT_NV | VK_SHADER_STAGE_TASK_BIT_NV);
-	m_inverse_camera_buffer_pool = renderer->CreateConstantBufferPool(sizeof(cb::RaytracingCamera), 1, 2, VK_SHADER_STAGE_RAYGEN_BIT_NV);
-	m_light_buffer_pool = renderer->CreateConstantBufferPool(sizeof(cb::Light) * gfx::settings::max_lights, 1, 3, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_CLOSEST_HIT_BIT_NV | VK_SHADER_STAGE_MISS_BIT_NV);
+		// The thread waiting for the jobs runs them as well.
+		m_job_system = new util::JobSystem(num_threads - 1);
+	}
+
+	m_num_lights.resize(gfx::settings::num_back_buffers, 0);
 
 	// Initialize the light buffer as empty.
 	cb::Light light = {};
 	light.m_type &= 3;
 	light.m_type |= 0 << 2;
-	m_light_buffer_handle = m_light_buffer_pool->Allocate(sizeof(cb::Light) * gfx::settings::max_lights);
+	m_light_buffer_handle = m_light_buffer_pool->Allocate(internal::light_stride * gfx::settings::max_lights);
 	for (std::uint32_t i = 0; i < gfx::settings::num_back_buffers; i++)
 	{
 		m_light_buffer_pool->Update(m_light_buffer_handle, sizeof(cb::Light), &light, i);
@@ -37,72 +68,255 @@ sg::SceneGraph::~SceneGraph()
 	delete m_camera_buffer_pool;
 	delete m_inverse_camera_buffer_pool;
 	delete m_light_buffer_pool;
+	delete m_job_system;
 }
 
 sg::NodeHandle sg::SceneGraph::CreateNode()
 {
-	NodeHandle new_node_handle = m_nodes.size();
-
-	m_nodes.emplace_back(Node{
+	Node new_node = {
 		.m_transform_component = -1,
 		.m_mesh_component = -1,
 		.m_camera_component = -1,
 		.m_light_component = -1
-	});
+	};
+
+	std::uint32_t node_idx;
+	if (!m_free_nodes.empty())
+	{
+		node_idx = m_free_nodes.back();
+		m_free_nodes.pop_back();
+		m_nodes[node_idx] = new_node;
+	}
+	else
+	{
+		if (m_nodes.size() >= internal::max_nodes)
+		{
+			LOGC("Can't create more than {} nodes.", internal::max_nodes);
+		}
 
+		node_idx = m_nodes.size();
+		m_nodes.push_back(new_node);
+		m_node_generations.push_back(0);
+		m_node_handle_positions.push_back(internal::free_node_position);
+	}
+
+	auto new_node_handle = internal::MakeNodeHandle(node_idx, m_node_generations[node_idx]);
+	m_node_handle_positions[node_idx] = m_node_handles.size();
 	m_node_handles.push_back(new_node_handle);
 	return new_node_handle;
 }
 
-void sg::SceneGraph::Update(std::uint32_t frame_idx)
+void sg::SceneGraph::DestroyNode(NodeHandle handle)
 {
-	// Transform Component
-	for (std::size_t i = 0; i < m_requires_update.size(); i++) // TODO: Using I is not safe. Should use the node handle component from compenent data.
+	if (!IsAlive(handle))
+	{
+		LOGW("Tried to destroy node {} which was already destroyed.", handle);
+		return;
+	}
+
+	auto transform_handle = m_nodes[internal::GetNodeIndex(handle)].m_transform_component;
+	if (transform_handle != -1 && m_first_children[transform_handle] != -1)
 	{
-		if (!m_requires_update[i]) continue;
+		// Deepest nodes first, so every transform is a leaf by the time it gets removed.
+		auto descendants = GetDescendants(transform_handle);
+		for (auto it = descendants.rbegin(); it != descendants.rend(); it++)
+		{
+			ReleaseNode(*it);
+		}
+	}
 
-		auto& model = m_models[i].m_value;
+	ReleaseNode(handle);
+}
 
-		auto const & scale = m_scales[i].m_value;
+bool sg::SceneGraph::IsAlive(NodeHandle handle) const
+{
+	auto node_idx = internal::GetNodeIndex(handle);
+	return node_idx < m_nodes.size()
+		&& m_node_handle_positions[node_idx] != internal::free_node_position
+		&& internal::MakeNodeHandle(node_idx, m_node_generations[node_idx]) == handle;
+}
+
+void sg::SceneGraph::ReleaseNode(NodeHandle handle)
+{
+	auto node_idx = internal::GetNodeIndex(handle);
+	auto const & node = m_nodes[node_idx];
 
-		model = glm::mat4(scale.x, 0, 0, 0,
-		                  0, scale.y, 0, 0,
-		                  0, 0, scale.z, 0,
-		                  0, 0, 0, 1);
+	if (node.m_mesh_component != -1) RemoveMeshComponent(handle);
+	if (node.m_camera_component != -1) RemoveCameraComponent(handle);
+	if (node.m_light_component != -1) RemoveLightComponent(handle);
+	if (node.m_transform_component != -1) RemoveTransformComponent(handle);
 
-		model = glm::mat4_cast(glm::quat(m_rotations[i].m_value)) * model;
+	auto position = m_node_handle_positions[node_idx];
+	internal::SwapAndPop(m_node_handles, position);
+	if (position < m_node_handles.size())
+	{
+		m_node_handle_positions[internal::GetNodeIndex(m_node_handles[position])] = position;
+	}
 
-		auto const & pos = m_positions[i].m_value;
+	// Bumping the generation invalidates all copies of the handle.
+	m_node_handle_positions[node_idx] = internal::free_node_position;
+	m_node_generations[node_idx] = (m_node_generations[node_idx] + 1) & internal::node_generation_mask;
+	m_free_nodes.push_back(node_idx);
+}
 
-		model = glm::mat4(1, 0, 0, 0,
-		                  0, 1, 0, 0,
-		                  0, 0, 1, 0,
-		                  pos.x, pos.y, pos.z, 1) * model;
+void sg::SceneGraph::RemoveTransformComponent(NodeHandle handle)
+{
+	auto& node = m_nodes[internal::GetNodeIndex(handle)];
+	auto transform_handle = node.m_transform_component;
+	auto last = static_cast<ComponentHandle>(m_positions.size() - 1);
 
-		m_requires_update[i] = false;
+	// Removed transforms are always leafs, see `DestroyNode` and `DemoteNode`.
+	if (m_parents[transform_handle].m_value != -1)
+	{
+		UnlinkChild(transform_handle);
+		m_num_parented_transforms--;
+	}
 
-		// If this transform has a mesh component make sure it updates the constant buffers
-		auto parent_node = m_nodes[m_requires_update[i].m_node_handle];
-		if (parent_node.m_mesh_component != -1)
-		{
-			m_requires_buffer_update[parent_node.m_mesh_component] = std::vector<bool>(gfx::settings::num_back_buffers,true);
-		}
-		if (parent_node.m_camera_component != -1)
+	// Drop the pending update of the removed transform and redirect the one of the transform taking its place.
+	if (m_requires_update[transform_handle].m_value)
+	{
+		auto position = m_dirty_transform_positions[transform_handle];
+		internal::SwapAndPop(m_dirty_transforms, position);
+		if (position < m_dirty_transforms.size())
 		{
-			m_requires_camera_buffer_update[parent_node.m_camera_component] = std::vector<bool>(gfx::settings::num_back_buffers, true);
+			m_dirty_transform_positions[m_dirty_transforms[position]] = position;
 		}
-		if (parent_node.m_light_component != -1)
+	}
+	if (last != transform_handle && m_requires_update[last].m_value)
+	{
+		m_dirty_transforms[m_dirty_transform_positions[last]] = transform_handle;
+	}
+
+	// Everything referring to the last transform by component handle has to follow it.
+	if (last != transform_handle)
+	{
+		for (auto child = m_first_children[last]; child != -1; child = m_next_siblings[child])
 		{
-			m_requires_light_buffer_update[parent_node.m_light_component] = std::vector<bool>(gfx::settings::num_back_buffers, true);
+			m_parents[child] = transform_handle;
 		}
+
+		auto prev = m_prev_siblings[last];
+		auto next = m_next_siblings[last];
+		if (prev != -1) m_next_siblings[prev] = transform_handle;
+		else if (m_parents[last].m_value != -1) m_first_children[m_parents[last].m_value] = transform_handle;
+		if (next != -1) m_prev_siblings[next] = transform_handle;
 	}
 
-	// Update constant bufffers for cameras
-	for (auto& requires_update : m_requires_camera_buffer_update)
+	internal::SwapAndPop(m_positions, transform_handle);
+	internal::SwapAndPop(m_rotations, transform_handle);
+	internal::SwapAndPop(m_scales, transform_handle);
+	internal::SwapAndPop(m_models, transform_handle);
+	internal::SwapAndPop(m_requires_update, transform_handle);
+	internal::SwapAndPop(m_parents, transform_handle);
+	internal::SwapAndPop(m_first_children, transform_handle);
+	internal::SwapAndPop(m_next_siblings, transform_handle);
+	internal::SwapAndPop(m_prev_siblings, transform_handle);
+	internal::SwapAndPop(m_dirty_transform_positions, transform_handle);
+	internal::SwapAndPop(m_local_transforms, transform_handle);
+	internal::SwapAndPop(m_world_dirty, transform_handle);
+
+	if (last != transform_handle)
+	{
+		m_nodes[internal::GetNodeIndex(m_positions[transform_handle].m_node_handle)].m_transform_component = transform_handle;
+	}
+	node.m_transform_component = -1;
+
+	// The order gets rebuilt before it is used again.
+	m_transform_order.pop_back();
+	m_transform_order_index.pop_back();
+	m_transform_order_dirty = true;
+}
+
+void sg::SceneGraph::RemoveMeshComponent(NodeHandle handle)
+{
+	auto& node = m_nodes[internal::GetNodeIndex(handle)];
+	auto mesh_component = node.m_mesh_component;
+	auto last = static_cast<ComponentHandle>(m_model_handles.size() - 1);
+
+	auto slot = m_batch_slots[mesh_component].m_value;
+	if (slot.m_batch != -1)
+	{
+		RemoveFromBatch(slot);
+	}
+	else
+	{
+		std::erase(m_meshes_require_batching, handle);
+	}
+
+	m_culling_tree.DestroyProxy(m_cull_proxies[mesh_component]);
+
+	internal::SwapAndPop(m_model_handles, mesh_component);
+	internal::SwapAndPop(m_model_material_handles, mesh_component);
+	internal::SwapAndPop(m_batch_slots, mesh_component);
+	internal::SwapAndPop(m_local_bounds, mesh_component);
+	internal::SwapAndPop(m_cull_proxies, mesh_component);
+	internal::SwapAndPop(m_mesh_node_handles, mesh_component);
+	m_requires_buffer_update.SwapAndPop(mesh_component);
+
+	if (last != mesh_component)
+	{
+		m_nodes[internal::GetNodeIndex(m_model_handles[mesh_component].m_node_handle)].m_mesh_component = mesh_component;
+		m_culling_tree.SetUserData(m_cull_proxies[mesh_component], mesh_component);
+	}
+	node.m_mesh_component = -1;
+}
+
+void sg::SceneGraph::RemoveCameraComponent(NodeHandle handle)
+{
+	auto& node = m_nodes[internal::GetNodeIndex(handle)];
+	auto camera_component = node.m_camera_component;
+	auto last = static_cast<ComponentHandle>(m_camera_cb_handles.size() - 1);
+
+	m_camera_buffer_pool->Deallocate(m_camera_cb_handles[camera_component]);
+	m_inverse_camera_buffer_pool->Deallocate(m_inverse_camera_cb_handles[camera_component]);
+
+	internal::SwapAndPop(m_camera_cb_handles, camera_component);
+	internal::SwapAndPop(m_inverse_camera_cb_handles, camera_component);
+	internal::SwapAndPop(m_camera_lens_properties, camera_component);
+	internal::SwapAndPop(m_camera_aspect_ratios, camera_component);
+	internal::SwapAndPop(m_camera_view_projections, camera_component);
+	internal::SwapAndPop(m_camera_node_handles, camera_component);
+	m_requires_camera_buffer_update.SwapAndPop(camera_component);
+
+	if (last != camera_component)
+	{
+		m_nodes[internal::GetNodeIndex(m_camera_cb_handles[camera_component].m_node_handle)].m_camera_component = camera_component;
+	}
+	node.m_camera_component = -1;
+}
+
+void sg::SceneGraph::RemoveLightComponent(NodeHandle handle)
+{
+	auto& node = m_nodes[internal::GetNodeIndex(handle)];
+	auto light_component = node.m_light_component;
+	auto last = static_cast<ComponentHandle>(m_colors.size() - 1);
+
+	internal::SwapAndPop(m_colors, light_component);
+	internal::SwapAndPop(m_light_types, light_component);
+	internal::SwapAndPop(m_radius, light_component);
+	internal::SwapAndPop(m_light_physical_size, light_component);
+	internal::SwapAndPop(m_light_angles, light_component);
+	internal::SwapAndPop(m_light_node_handles, light_component);
+	m_requires_light_buffer_update.SwapAndPop(light_component);
+
+	// The light id is the offset into the light buffer, so the moved light has to be written again.
+	// The changed light count gets picked up by `Update`.
+	if (last != light_component)
 	{
-		if (!requires_update.m_value[frame_idx]) continue;
+		m_nodes[internal::GetNodeIndex(m_colors[light_component].m_node_handle)].m_light_component = light_component;
+		m_requires_light_buffer_update.MarkDirty(light_component);
+	}
+	node.m_light_component = -1;
+}
+
+void sg::SceneGraph::Update(std::uint32_t frame_idx)
+{
+	UpdateTransforms();
 
-		auto node = m_nodes[requires_update.m_node_handle];
+	// Update constant bufffers for cameras
+	m_requires_camera_buffer_update.ConsumeDirty(frame_idx, [&](std::size_t camera_component)
+	{
+		auto node = m_nodes[internal::GetNodeIndex(m_camera_cb_handles[camera_component].m_node_handle)];
 
 		glm::vec3 cam_pos = m_positions[node.m_transform_component].m_value;
 		glm::vec3 cam_rot = m_rotations[node.m_transform_component].m_value;
@@ -130,6 +344,7 @@ void sg::SceneGraph::Update(std::uint32_t frame_idx)
 		data.m_view = glm::lookAt(cam_pos, cam_pos + forward, up);
 		data.m_proj = glm::perspective(glm::radians(fov), aspect_ratio, 0.01f, 1000.0f);
 		data.m_proj[1][1] *= -1;
+		m_camera_view_projections[node.m_camera_component] = data.m_proj * data.m_view;
 
 		// TODO: In theory right now the cb handle and the mesh component will always have the same value.
 		m_camera_buffer_pool->Update(m_camera_cb_handles[node.m_camera_component], sizeof(cb::Camera), &data, frame_idx);
@@ -160,16 +375,12 @@ void sg::SceneGraph::Update(std::uint32_t frame_idx)
 		inv_data.cameraForwardVectorLensF.a = lens_properties.m_focal_dist;
 
 		m_inverse_camera_buffer_pool->Update(m_inverse_camera_cb_handles[node.m_camera_component], sizeof(cb::RaytracingCamera), &inv_data, frame_idx);
-
-		m_requires_camera_buffer_update[node.m_camera_component].m_value[frame_idx] = false;
-	}
+	});
 
 	// Update constant bufffer for lights
-	for (auto& requires_update : m_requires_light_buffer_update)
+	m_requires_light_buffer_update.ConsumeDirty(frame_idx, [&](std::size_t light_component)
 	{
-		if (!requires_update.m_value[frame_idx]) continue;
-
-		auto node = m_nodes[requires_update.m_node_handle];
+		auto node = m_nodes[internal::GetNodeIndex(m_colors[light_component].m_node_handle)];
 
 		auto pos = m_positions[node.m_transform_component].m_value;
 		auto rot = m_rotations[node.m_transform_component].m_value;
@@ -203,12 +414,10 @@ void sg::SceneGraph::Update(std::uint32_t frame_idx)
 		light.m_color = color;
 
 		auto light_id = node.m_light_component;
-		auto offset = light_id * (sizeof(cb::Light) + sizeof(glm::vec4)); // TODO: fix this random padding?
+		auto offset = light_id * internal::light_stride;
 
 		m_light_buffer_pool->Update(m_light_buffer_handle, sizeof(cb::Light), &light, frame_idx, offset);
-
-		m_requires_light_buffer_update[node.m_light_component].m_value[frame_idx] = false;
-	}
+	});
 
 	// A light was added or removed
 	if (m_num_lights[frame_idx] != m_light_node_handles.size())
@@ -216,7 +425,7 @@ void sg::SceneGraph::Update(std::uint32_t frame_idx)
 		cb::Light light{};
 		if (!m_light_node_handles.empty())
 		{
-			auto node = m_nodes[m_light_node_handles[0]];
+			auto node = m_nodes[internal::GetNodeIndex(m_light_node_handles[0])];
 
 			auto pos = m_positions[node.m_transform_component].m_value;
 			auto rot = m_rotations[node.m_transform_component].m_value;
@@ -250,129 +459,559 @@ void sg::SceneGraph::Update(std::uint32_t frame_idx)
 		m_num_lights[frame_idx] = m_light_node_handles.size();
 	}
 
-	// Generate Batches
-	for (auto& node_handle : m_meshes_require_batching[0])
+	// Generate Batches. New meshes are still marked dirty for every frame, so their slots get written below.
+	for (auto& node_handle : m_meshes_require_batching)
 	{
-		auto node = m_nodes[node_handle];
-		auto model_handle = m_model_handles[node.m_mesh_component].m_value;
-		auto material_handles = m_model_material_handles[node.m_mesh_component].m_value;
+		auto slot = AddToBatch(node_handle);
+		if (slot.m_batch == -1) continue;
 
-		bool batch_available = false;
-		std::size_t batch_idx = 0;
-		for (auto& batch : m_render_batches)
+		m_batch_slots[m_nodes[internal::GetNodeIndex(node_handle)].m_mesh_component].m_value = slot;
+	}
+	m_meshes_require_batching.clear();
+
+	// Update batch cb for meshes that moved, got added or changed slot
+	m_requires_buffer_update.ConsumeDirty(frame_idx, [&](std::size_t mesh_component)
+	{
+		auto const & node = m_nodes[internal::GetNodeIndex(m_model_handles[mesh_component].m_node_handle)];
+		auto slot = m_batch_slots[mesh_component].m_value;
+
+		// Meshes that didn't fit in any batch aren't rendered. `AddToBatch` already warned about them.
+		if (slot.m_batch != -1)
 		{
-			if (FitsInBatch(batch, node))
-			{
-				batch_available = true;
-				batch.m_num_meshes++;
-				batch.m_nodes.push_back(node_handle);
+			UpdateBatchSlot(slot, node, frame_idx);
+		}
+	});
 
-				for (auto idx = 0; idx < gfx::settings::num_back_buffers; idx++)
-				{
-					m_batch_requires_update[idx].push_back({ batch_idx, node_handle });
-				}
+	// Make the writes of this frame visible to the device.
+	m_per_object_buffer_pool->Flush(frame_idx);
+	m_camera_buffer_pool->Flush(frame_idx);
+	m_inverse_camera_buffer_pool->Flush(frame_idx);
+	m_light_buffer_pool->Flush(frame_idx);
+}
 
-				break;
-			}
+void sg::SceneGraph::UpdateTransforms()
+{
+	if (m_dirty_transforms.empty()) return;
 
-			batch_idx++;
-		}
+	auto num_dirty = m_dirty_transforms.size();
+	m_dirty_transform_data.Resize(num_dirty);
+	m_dirty_transform_results.resize(num_dirty);
+
+	// Without parents the local transform is the world transform, so it can be written directly.
+	auto is_flat = m_num_parented_transforms == 0;
 
-		if (!batch_available)
+	// Gather into SoA, compose and scatter back in chunks so large updates can be split over threads.
+	auto update_chunk = [&](std::size_t chunk)
+	{
+		auto begin = chunk * settings::transform_update_chunk_size;
+		auto end = std::min<std::size_t>(begin + settings::transform_update_chunk_size, num_dirty);
+
+		for (auto i = begin; i < end; i++)
 		{
-			RenderBatch new_batch;
-			new_batch.m_model_handle = model_handle;
-			new_batch.m_material_handles = material_handles;
-			new_batch.m_num_meshes = 1;
-			new_batch.m_nodes.push_back(node_handle);
-			new_batch.m_big_cb = m_per_object_buffer_pool->Allocate(sizeof(cb::Basic) * gfx::settings::max_render_batch_size);
+			auto transform_handle = m_dirty_transforms[i];
+			m_dirty_transform_data.Set(i, m_positions[transform_handle].m_value, m_rotations[transform_handle].m_value, m_scales[transform_handle].m_value);
+		}
 
-			m_render_batches.push_back(new_batch);
+		ComposeTransforms(m_dirty_transform_data, begin, end, m_dirty_transform_results.data());
 
-			for (auto idx = 0; idx < gfx::settings::num_back_buffers; idx++)
+		for (auto i = begin; i < end; i++)
+		{
+			auto transform_handle = m_dirty_transforms[i];
+			m_local_transforms[transform_handle] = m_dirty_transform_results[i];
+			if (is_flat)
 			{
-				m_batch_requires_update[idx].push_back({ m_render_batches.size() - 1, node_handle });
+				m_models[transform_handle].m_value = ToMat4(m_dirty_transform_results[i]);
 			}
 		}
+	};
+
+	auto num_chunks = (num_dirty + settings::transform_update_chunk_size - 1) / settings::transform_update_chunk_size;
+	util::ParallelFor(m_job_system, num_chunks, update_chunk);
+
+	if (!is_flat)
+	{
+		PropagateTransforms();
+		return;
+	}
+
+	for (auto transform_handle : m_dirty_transforms)
+	{
+		m_requires_update[transform_handle] = false;
+		MarkTransformUsersDirty(transform_handle);
+	}
+	m_dirty_transforms.clear();
+}
+
+void sg::SceneGraph::PropagateTransforms()
+{
+	if (m_transform_order_dirty)
+	{
+		RebuildTransformOrder();
+	}
+
+	auto first = m_transform_order.size();
+	for (auto transform_handle : m_dirty_transforms)
+	{
+		m_requires_update[transform_handle] = false;
+		m_world_dirty[transform_handle] = true;
+		first = std::min(first, m_transform_order_index[transform_handle]);
+	}
+	m_dirty_transforms.clear();
+
+	// Parents come before their children, so a single pass starting at the first dirty transform reaches every dirty subtree.
+	// The transforms that got recomputed are collected in `m_dirty_transforms` since it is empty until the next frame.
+	for (auto i = first; i < m_transform_order.size(); i++)
+	{
+		auto transform_handle = m_transform_order[i];
+		auto parent = m_parents[transform_handle].m_value;
+		if (parent != -1 && m_world_dirty[parent])
+		{
+			m_world_dirty[transform_handle] = true;
+		}
+
+		if (!m_world_dirty[transform_handle]) continue;
+
+		auto local = ToMat4(m_local_transforms[transform_handle]);
+		m_models[transform_handle].m_value = parent == -1 ? local : m_models[parent].m_value * local;
+		m_dirty_transforms.push_back(transform_handle);
 	}
-	m_meshes_require_batching[0].clear();
 
-	// Efficient batch update. (new/delete)
-	for (auto& batch_handle_pair : m_batch_requires_update[frame_idx])
+	for (auto transform_handle : m_dirty_transforms)
+	{
+		m_world_dirty[transform_handle] = false;
+		MarkTransformUsersDirty(transform_handle);
+	}
+	m_dirty_transforms.clear();
+}
+
+void sg::SceneGraph::RebuildTransformOrder()
+{
+	auto num_transforms = m_parents.size();
+	constexpr std::uint32_t unknown_depth = ~0u;
+
+	// Resolve the depth of every transform, walking up until a transform with a known depth or a root.
+	std::vector<std::uint32_t> depths(num_transforms, unknown_depth);
+	std::vector<ComponentHandle> stack;
+	std::uint32_t max_depth = 0;
+	for (std::size_t i = 0; i < num_transforms; i++)
 	{
-		auto node = m_nodes[batch_handle_pair.second];
-		auto batch = m_render_batches[batch_handle_pair.first];
+		ComponentHandle transform_handle = i;
+		while (depths[transform_handle] == unknown_depth && m_parents[transform_handle].m_value != -1)
+		{
+			stack.push_back(transform_handle);
+			transform_handle = m_parents[transform_handle].m_value;
+		}
 
-		cb::Basic data;
-		data.m_model = m_models[node.m_transform_component].m_value;
+		if (depths[transform_handle] == unknown_depth)
+		{
+			depths[transform_handle] = 0;
+		}
 
-		// Find the position of the mesh that requires a update inside of the constant buffer.
-		int update_offset = 0;
-		for (auto batch_node_handle : batch.m_nodes)
+		while (!stack.empty())
 		{
-			if (batch_node_handle == batch_handle_pair.second)
+			auto child = stack.back();
+			stack.pop_back();
+			depths[child] = depths[m_parents[child].m_value] + 1;
+		}
+
+		max_depth = std::max(max_depth, depths[i]);
+	}
+
+	// Counting sort on depth. Transforms of the same depth keep their creation order.
+	std::vector<std::size_t> offsets(max_depth + 2, 0);
+	for (auto depth : depths)
+	{
+		offsets[depth + 1]++;
+	}
+	for (std::size_t depth = 1; depth < offsets.size(); depth++)
+	{
+		offsets[depth] += offsets[depth - 1];
+	}
+
+	m_transform_order.resize(num_transforms);
+	m_transform_order_index.resize(num_transforms);
+	for (std::size_t i = 0; i < num_transforms; i++)
+	{
+		auto position = offsets[depths[i]]++;
+		m_transform_order[position] = i;
+		m_transform_order_index[i] = position;
+	}
+
+	m_transform_order_dirty = false;
+}
+
+void sg::SceneGraph::MarkTransformUsersDirty(ComponentHandle transform_handle)
+{
+	// If this transform has a mesh component make sure it updates the constant buffers
+	auto const & parent_node = m_nodes[internal::GetNodeIndex(m_requires_update[transform_handle].m_node_handle)];
+	if (parent_node.m_mesh_component != -1)
+	{
+		m_requires_buffer_update.MarkDirty(parent_node.m_mesh_component);
+
+		auto bounds = TransformAABB(m_local_bounds[parent_node.m_mesh_component], m_models[transform_handle]);
+		m_culling_tree.MoveProxy(m_cull_proxies[parent_node.m_mesh_component], bounds);
+	}
+	if (parent_node.m_camera_component != -1)
+	{
+		m_requires_camera_buffer_update.MarkDirty(parent_node.m_camera_component);
+	}
+	if (parent_node.m_light_component != -1)
+	{
+		m_requires_light_buffer_update.MarkDirty(parent_node.m_light_component);
+	}
+}
+
+void sg::SceneGraph::SetParent(NodeHandle child, std::optional<NodeHandle> parent)
+{
+	if (m_nodes[internal::GetNodeIndex(child)].m_transform_component == -1)
+	{
+		PromoteNode<TransformComponent>(child);
+	}
+	auto child_transform = m_nodes[internal::GetNodeIndex(child)].m_transform_component;
+
+	ComponentHandle parent_transform = -1;
+	if (parent.has_value())
+	{
+		if (m_nodes[internal::GetNodeIndex(parent.value())].m_transform_component == -1)
+		{
+			PromoteNode<TransformComponent>(parent.value());
+		}
+		parent_transform = m_nodes[internal::GetNodeIndex(parent.value())].m_transform_component;
+
+		for (auto ancestor = parent_transform; ancestor != -1; ancestor = m_parents[ancestor].m_value)
+		{
+			if (ancestor == child_transform)
 			{
-				break;
+				LOGW("Can't parent node {} to node {} since it is one of its descendants.", child, parent.value());
+				return;
 			}
+		}
+	}
+
+	auto old_parent_transform = m_parents[child_transform].m_value;
+	if (old_parent_transform == parent_transform) return;
+
+	if (old_parent_transform == -1) m_num_parented_transforms++;
+	else UnlinkChild(child_transform);
+	if (parent_transform == -1) m_num_parented_transforms--;
+	else LinkChild(parent_transform, child_transform);
+
+	m_parents[child_transform] = parent_transform;
+	m_transform_order_dirty = true;
+	MarkTransformDirty(child_transform);
+}
+
+void sg::SceneGraph::LinkChild(ComponentHandle parent, ComponentHandle child)
+{
+	auto first = m_first_children[parent];
+	m_prev_siblings[child] = -1;
+	m_next_siblings[child] = first;
+	if (first != -1)
+	{
+		m_prev_siblings[first] = child;
+	}
+	m_first_children[parent] = child;
+}
 
-			update_offset++;
+void sg::SceneGraph::UnlinkChild(ComponentHandle child)
+{
+	auto prev = m_prev_siblings[child];
+	auto next = m_next_siblings[child];
+	if (prev != -1) m_next_siblings[prev] = next;
+	else m_first_children[m_parents[child].m_value] = next;
+	if (next != -1) m_prev_siblings[next] = prev;
+
+	m_prev_siblings[child] = -1;
+	m_next_siblings[child] = -1;
+}
+
+void sg::SceneGraph::RebuildTransformLinks()
+{
+	auto num_transforms = m_parents.size();
+	m_first_children.assign(num_transforms, -1);
+	m_next_siblings.assign(num_transforms, -1);
+	m_prev_siblings.assign(num_transforms, -1);
+	for (std::size_t i = 0; i < num_transforms; i++)
+	{
+		if (m_parents[i].m_value != -1)
+		{
+			LinkChild(m_parents[i].m_value, static_cast<ComponentHandle>(i));
 		}
+	}
 
-		// TODO: In theory right now the cb handle and the mesh component will always have the same value.
-		m_per_object_buffer_pool->Update(batch.m_big_cb, sizeof(cb::Basic), &data, frame_idx, update_offset * sizeof(cb::Basic));
+	m_dirty_transform_positions.assign(num_transforms, 0);
+	for (std::size_t i = 0; i < m_dirty_transforms.size(); i++)
+	{
+		m_dirty_transform_positions[m_dirty_transforms[i]] = static_cast<std::uint32_t>(i);
+	}
+}
+
+std::optional<sg::NodeHandle> sg::SceneGraph::GetParent(NodeHandle handle) const
+{
+	auto transform_handle = m_nodes[internal::GetNodeIndex(handle)].m_transform_component;
+	if (transform_handle == -1 || m_parents[transform_handle].m_value == -1)
+	{
+		return std::nullopt;
+	}
 
-		m_requires_buffer_update[node.m_mesh_component].m_value[frame_idx] = false;
+	return m_parents[m_parents[transform_handle].m_value].m_node_handle;
+}
+
+std::vector<sg::NodeHandle> sg::SceneGraph::GetDescendants(ComponentHandle transform_handle)
+{
+	if (m_transform_order_dirty)
+	{
+		RebuildTransformOrder();
+	}
+
+	// Same walk as `PropagateTransforms`, with the flags marking the subtree instead of dirty transforms.
+	std::vector<NodeHandle> descendants;
+	m_world_dirty[transform_handle] = true;
+	for (auto i = m_transform_order_index[transform_handle] + 1; i < m_transform_order.size(); i++)
+	{
+		auto descendant = m_transform_order[i];
+		auto parent = m_parents[descendant].m_value;
+		if (parent != -1 && m_world_dirty[parent])
+		{
+			m_world_dirty[descendant] = true;
+			descendants.push_back(m_parents[descendant].m_node_handle);
+		}
 	}
-	m_batch_requires_update[frame_idx].clear();
 
-	// Update batch cb in case a mesh was moved
-	for (auto& requires_update : m_requires_buffer_update)
+	m_world_dirty[transform_handle] = false;
+	for (auto descendant : descendants)
 	{
-		if (!requires_update.m_value[frame_idx]) continue;
+		m_world_dirty[m_nodes[internal::GetNodeIndex(descendant)].m_transform_component] = false;
+	}
 
-		auto node_handle = requires_update.m_node_handle;
-		auto node = m_nodes[node_handle];
-		auto model_mat = m_models[node.m_transform_component].m_value;
-		auto model_handle = m_model_handles[node.m_mesh_component].m_value;
+	return descendants;
+}
 
-		// find appropriate batch
-		bool updated_batch = false;
-		for (auto& batch : m_render_batches)
+void sg::SceneGraph::SetMaterials(NodeHandle handle, std::vector<MaterialHandle> const & materials)
+{
+	auto mesh_component = m_nodes[internal::GetNodeIndex(handle)].m_mesh_component;
+	auto& current_materials = m_model_material_handles[mesh_component].m_value;
+	auto num_materials = std::min(materials.size(), current_materials.size());
+	if (std::equal(materials.begin(), materials.begin() + num_materials, current_materials.begin())) return;
+
+	// The materials are part of the batch key, so the mesh leaves its batch now and gets batched again on the next `Update`.
+	auto& slot = m_batch_slots[mesh_component].m_value;
+	if (slot.m_batch != -1)
+	{
+		RemoveFromBatch(slot);
+		slot = BatchSlot();
+		m_meshes_require_batching.push_back(handle);
+	}
+	else if (std::find(m_meshes_require_batching.begin(), m_meshes_require_batching.end(), handle) == m_meshes_require_batching.end())
+	{
+		// Meshes that didn't fit in a batch before get another chance.
+		m_meshes_require_batching.push_back(handle);
+	}
+
+	std::copy(materials.begin(), materials.begin() + num_materials, current_materials.begin());
+	m_requires_buffer_update.MarkDirty(mesh_component);
+}
+
+sg::BatchSlot sg::SceneGraph::AddToBatch(NodeHandle node_handle)
+{
+	auto const & node = m_nodes[internal::GetNodeIndex(node_handle)];
+	internal::BatchKey key = {
+		.m_model_handle = m_model_handles[node.m_mesh_component].m_value,
+		.m_material_handles = m_model_material_handles[node.m_mesh_component].m_value
+	};
+
+	auto batch_it = m_batches_by_key.find(key);
+	auto batch_idx = batch_it != m_batches_by_key.end() ? batch_it->second : static_cast<std::uint32_t>(m_render_batches.size());
+	auto num_meshes = batch_it != m_batches_by_key.end() ? m_render_batches[batch_idx].m_num_meshes : 0;
+
+	// Every page is a separate buffer, so growing a batch never moves the instances it already has.
+	if (num_meshes % gfx::settings::instances_per_page == 0)
+	{
+		if (m_num_instance_pages >= gfx::settings::max_instance_pages)
 		{
-			if (FitsInBatch(batch, node))
-			{
-				// Find the position of the mesh that requires a update inside of the constant buffer.
-				int update_offset = 0;
-				for (auto batch_node_handle : batch.m_nodes)
-				{
-					if (batch_node_handle == node_handle)
-					{
-						break;
-					}
+			LOGW("Ran out of instance pages. Mesh node {} won't be rendered.", node_handle);
+			return BatchSlot();
+		}
 
-					update_offset++;
-				}
+		if (batch_it == m_batches_by_key.end())
+		{
+			RenderBatch new_batch;
+			new_batch.m_model_handle = key.m_model_handle;
+			new_batch.m_material_handles = key.m_material_handles;
+			new_batch.m_num_meshes = 0;
+			m_render_batches.push_back(std::move(new_batch));
+
+			m_batches_by_key[key] = batch_idx;
+		}
+
+		m_render_batches[batch_idx].m_pages.push_back(m_per_object_buffer_pool->Allocate(sizeof(Matrix3x4) * gfx::settings::instances_per_page));
+		m_num_instance_pages++;
+	}
+
+	auto& batch = m_render_batches[batch_idx];
+	BatchSlot slot = {
+		.m_batch = static_cast<std::int32_t>(batch_idx),
+		.m_slot = batch.m_num_meshes
+	};
+
+	batch.m_num_meshes++;
+	batch.m_nodes.push_back(node_handle);
+
+	return slot;
+}
+
+void sg::SceneGraph::RemoveFromBatch(BatchSlot slot)
+{
+	auto& batch = m_render_batches[slot.m_batch];
+
+	// Keep the batch dense, the renderer draws `GetNumInstances` instances per page.
+	auto last_slot = batch.m_num_meshes - 1;
+	if (slot.m_slot != last_slot)
+	{
+		auto moved_node_handle = batch.m_nodes[last_slot];
+		auto moved_mesh_component = m_nodes[internal::GetNodeIndex(moved_node_handle)].m_mesh_component;
+
+		batch.m_nodes[slot.m_slot] = moved_node_handle;
+		m_batch_slots[moved_mesh_component].m_value.m_slot = slot.m_slot;
+		m_requires_buffer_update.MarkDirty(moved_mesh_component);
+	}
+	batch.m_nodes.pop_back();
+	batch.m_num_meshes--;
+
+	if (batch.m_num_meshes % gfx::settings::instances_per_page == 0)
+	{
+		m_per_object_buffer_pool->Deallocate(batch.m_pages.back());
+		batch.m_pages.pop_back();
+		m_num_instance_pages--;
+	}
+
+	if (batch.m_num_meshes > 0) return;
 
-				cb::Basic data;
-				data.m_model = model_mat;
-				m_per_object_buffer_pool->Update(batch.m_big_cb, sizeof(cb::Basic), &data, frame_idx, update_offset * sizeof(cb::Basic));
+	internal::BatchKey key = {
+		.m_model_handle = batch.m_model_handle,
+		.m_material_handles = batch.m_material_handles
+	};
+	m_batches_by_key.erase(key);
 
-				updated_batch = true;
-				requires_update.m_value[frame_idx] = false;
-				break;
+	// Move the last batch into the released spot.
+	auto batch_idx = static_cast<std::uint32_t>(slot.m_batch);
+	if (batch_idx != m_render_batches.size() - 1)
+	{
+		auto& moved_batch = m_render_batches[batch_idx];
+		moved_batch = std::move(m_render_batches.back());
+
+		for (auto node_handle : moved_batch.m_nodes)
+		{
+			m_batch_slots[m_nodes[internal::GetNodeIndex(node_handle)].m_mesh_component].m_value.m_batch = slot.m_batch;
+		}
+
+		internal::BatchKey moved_key = {
+			.m_model_handle = moved_batch.m_model_handle,
+			.m_material_handles = moved_batch.m_material_handles
+		};
+		m_batches_by_key[moved_key] = batch_idx;
+	}
+	m_render_batches.pop_back();
+}
+
+void sg::SceneGraph::UpdateBatchSlot(BatchSlot slot, Node const & node, std::uint32_t frame_idx)
+{
+	auto data = ToMatrix3x4(m_models[node.m_transform_component].m_value);
+
+	auto const & page = m_render_batches[slot.m_batch].m_pages[slot.m_slot / gfx::settings::instances_per_page];
+	auto instance = slot.m_slot % gfx::settings::instances_per_page;
+	m_per_object_buffer_pool->Update(page, sizeof(Matrix3x4), &data, frame_idx, instance * sizeof(Matrix3x4));
+}
+
+sg::AABB sg::SceneGraph::CalculateModelBounds(ModelHandle const & model_handle)
+{
+	if (model_handle.m_mesh_handles.empty())
+	{
+		return AABB{ glm::vec3(0), glm::vec3(0) };
+	}
+
+	AABB bounds = { model_handle.m_mesh_handles[0].m_bbox_min, model_handle.m_mesh_handles[0].m_bbox_max };
+	for (auto const & mesh_handle : model_handle.m_mesh_handles)
+	{
+		bounds = Union(bounds, AABB{ mesh_handle.m_bbox_min, mesh_handle.m_bbox_max });
+	}
+
+	return bounds;
+}
+
+void sg::SceneGraph::CullInstances(glm::mat4 const & view_projection, VisibleInstances& out) const
+{
+	auto num_batches = m_render_batches.size();
+	out.m_ranges.resize(num_batches);
+	out.m_visible_slots.resize(num_batches);
+	out.m_num_visible = 0;
+
+	if (!settings::use_frustum_culling)
+	{
+		for (std::size_t batch_idx = 0; batch_idx < num_batches; batch_idx++)
+		{
+			auto const & batch = m_render_batches[batch_idx];
+			auto& ranges = out.m_ranges[batch_idx];
+			ranges.clear();
+			for (std::size_t page = 0; page < batch.m_pages.size(); page++)
+			{
+				ranges.push_back({ static_cast<std::uint32_t>(page) * gfx::settings::instances_per_page, batch.GetNumInstances(page) });
 			}
+			out.m_num_visible += batch.m_num_meshes;
 		}
 
-		if (!updated_batch)
+		return;
+	}
+
+	out.m_visible_meshes.clear();
+	m_culling_tree.Query(ExtractFrustum(view_projection), out.m_visible_meshes);
+
+	// Mark the slots of the visible meshes so the ranges come out sorted without sorting the meshes.
+	for (std::size_t batch_idx = 0; batch_idx < num_batches; batch_idx++)
+	{
+		out.m_visible_slots[batch_idx].assign((m_render_batches[batch_idx].m_num_meshes + 63) / 64, 0);
+	}
+	for (auto mesh_component : out.m_visible_meshes)
+	{
+		auto slot = m_batch_slots[mesh_component].m_value;
+		if (slot.m_batch == -1) continue;
+
+		out.m_visible_slots[slot.m_batch][slot.m_slot / 64] |= std::uint64_t(1) << (slot.m_slot % 64);
+	}
+
+	for (std::size_t batch_idx = 0; batch_idx < num_batches; batch_idx++)
+	{
+		auto const & words = out.m_visible_slots[batch_idx];
+		auto& ranges = out.m_ranges[batch_idx];
+		ranges.clear();
+
+		for (std::size_t word_idx = 0; word_idx < words.size(); word_idx++)
 		{
-			LOGW("Mesh required update but failed to update it...");
+			auto bits = words[word_idx];
+			while (bits)
+			{
+				auto slot = static_cast<std::uint32_t>(word_idx * 64 + std::countr_zero(bits));
+				bits &= bits - 1;
+
+				auto extends_last = !ranges.empty() && ranges.back().m_first + ranges.back().m_count == slot
+					&& slot % gfx::settings::instances_per_page != 0;
+				if (extends_last)
+				{
+					ranges.back().m_count++;
+				}
+				else
+				{
+					ranges.push_back({ slot, 1 });
+				}
+				out.m_num_visible++;
+			}
 		}
 	}
 }
 
 sg::Node sg::SceneGraph::GetActiveCamera()
 {
-	return m_nodes[m_camera_node_handles[0]];
+	return m_nodes[internal::GetNodeIndex(m_camera_node_handles[0])];
 }
 
 ConstantBufferPool* sg::SceneGraph::GetPOConstantBufferPool()
@@ -402,7 +1041,7 @@ ConstantBufferHandle sg::SceneGraph::GetLightBufferHandle()
 
 sg::Node sg::SceneGraph::GetNode(sg::NodeHandle handle)
 {
-	return m_nodes[handle];
+	return m_nodes[internal::GetNodeIndex(handle)];
 }
 
 std::vector<sg::Node> const& sg::SceneGraph::GetNodes() const
@@ -8,8 +8,12 @@
 
 #include <vector>
 #include <cstdint>
+#include <algorithm>
+#include <optional>
+#include <string>
 #include <functional>
 #include <typeindex>
+#include <unordered_map>
 #define GLM_FORCE_RADIANS
 #include <glm.hpp>
 #include <gtc/quaternion.hpp>
@@ -17,15 +21,20 @@
 
 #include "../model_pool.hpp"
 #include "../util/delegate.hpp"
+#include "../util/job_system.hpp"
+#include "../util/frame_bitset.hpp"
 #include "../buffer_definitions.hpp"
 #include "../constant_buffer_pool.hpp"
 #include "../graphics/gfx_settings.hpp"
+#include "transform_kernel.hpp"
+#include "culling.hpp"
 
 class Renderer;
 
 namespace sg
 {
 
+	//! Index of the node in the lower bits and the generation of that index in the upper bits. See `SceneGraph::IsAlive`.
 	using NodeHandle = std::uint32_t;
 	using ComponentHandle = std::int32_t;
 
@@ -54,7 +63,49 @@ namespace sg
 		ModelHandle m_model_handle;
 		std::vector<MaterialHandle> m_material_handles;
 		std::vector<NodeHandle> m_nodes;
-		ConstantBufferHandle m_big_cb;
+		//! Storage buffers with the packed 3x4 model matrices. Page `i` holds slots `i * instances_per_page` and up.
+		std::vector<ConstantBufferHandle> m_pages;
+
+		//! Number of instances in `page`. Only the last page can be partially filled.
+		std::uint32_t GetNumInstances(std::size_t page) const
+		{
+			auto first = static_cast<std::uint32_t>(page) * gfx::settings::instances_per_page;
+			return std::min(m_num_meshes - first, gfx::settings::instances_per_page);
+		}
+	};
+
+	//! Position of a mesh component inside `SceneGraph::m_render_batches`.
+	struct BatchSlot
+	{
+		std::int32_t m_batch = -1; // -1 until the mesh got batched.
+		std::uint32_t m_slot = 0; // Index into `RenderBatch::m_nodes`. Also selects the page and the instance in that page.
+	};
+
+	//! Consecutive slots of a render batch. Never crosses a page, so it can be drawn with a single draw call.
+	struct InstanceRange
+	{
+		std::uint32_t m_first;
+		std::uint32_t m_count;
+	};
+
+	//! Result of `SceneGraph::CullInstances` for a single view.
+	struct VisibleInstances
+	{
+		std::vector<std::vector<InstanceRange>> m_ranges; // Indexed like `SceneGraph::GetRenderBatches`.
+		std::size_t m_num_visible = 0;
+
+		// Reused between queries.
+		std::vector<std::uint32_t> m_visible_meshes;
+		std::vector<std::vector<std::uint64_t>> m_visible_slots;
+	};
+
+	//! Assets and nodes a scene snapshot refers to by name. See `SceneGraph::SaveSnapshot`.
+	struct SnapshotReferences
+	{
+		std::vector<std::pair<std::string, ModelHandle>> m_models; // Usually named after the file the model got loaded from.
+		std::vector<std::pair<std::string, MaterialHandle>> m_materials; // Materials that aren't the material of a mesh in `m_models`.
+		std::vector<std::pair<std::string, NodeHandle>> m_nodes; // Nodes the application keeps handles of. Updated by `LoadSnapshot`.
+		std::uint32_t m_scene_version = 0; // Increment after changing how the scene gets built so old snapshots are rejected.
 	};
 
 	struct Node
@@ -78,11 +129,65 @@ namespace sg
 	namespace internal
 	{
 
+		static const std::uint32_t node_index_bits = 20;
+		static const std::uint32_t node_index_mask = (1u << node_index_bits) - 1;
+		static const std::uint32_t node_generation_mask = ~0u >> node_index_bits;
+		static const std::uint32_t max_nodes = node_index_mask + 1;
+		static const std::uint32_t free_node_position = ~0u;
+		static const std::size_t light_stride = sizeof(cb::Light) + sizeof(glm::vec4); // The shaders pad `cb::Light::m_padding` to a vec4.
+
+		inline std::uint32_t GetNodeIndex(NodeHandle handle)
+		{
+			return handle & node_index_mask;
+		}
+
+		inline NodeHandle MakeNodeHandle(std::uint32_t index, std::uint32_t generation)
+		{
+			return (generation << node_index_bits) | index;
+		}
+
+		//! Removes `vec[idx]` by moving the last element into its place.
+		template<typename T>
+		inline void SwapAndPop(std::vector<T>& vec, std::size_t idx)
+		{
+			if (idx != vec.size() - 1)
+			{
+				vec[idx] = std::move(vec.back());
+			}
+			vec.pop_back();
+		}
+
 		struct BaseComponentData
 		{
 			NodeHandle m_node_handle;
 		};
 
+		//! Meshes can only share a render batch when both the model and the materials match.
+		struct BatchKey
+		{
+			ModelHandle m_model_handle;
+			std::vector<MaterialHandle> m_material_handles;
+
+			bool operator==(BatchKey const & other) const
+			{
+				return m_model_handle == other.m_model_handle && m_material_handles == other.m_material_handles;
+			}
+		};
+
+		struct BatchKeyHash
+		{
+			std::size_t operator()(BatchKey const & key) const
+			{
+				std::size_t hash = std::hash<ModelHandle>()(key.m_model_handle);
+				for (auto const & material_handle : key.m_material_handles)
+				{
+					hash = hash * 31 + std::hash<std::uint32_t>()(material_handle.m_material_id);
+				}
+
+				return hash;
+			}
+		};
+
 	} /* internal */
 
 	template<typename T>
@@ -102,6 +207,8 @@ namespace sg
 	{
 	public:
 		SceneGraph(Renderer* renderer);
+		//! Keeps all constant buffers in host memory (`HostConstantBufferPool`), so no device is required.
+		SceneGraph();
 		~SceneGraph();
 
 		NodeHandle CreateNode();
@@ -128,7 +235,7 @@ namespace sg
 		template<typename T>
 		typename Void_IsComponent<T, MeshComponent>::type PromoteNode(NodeHandle handle, ModelHandle model_handle)
 		{
-			auto& node = m_nodes[handle];
+			auto& node = m_nodes[internal::GetNodeIndex(handle)];
 			node.m_mesh_component = m_model_handles.size();
 
 			if (node.m_transform_component == -1)
@@ -141,10 +248,7 @@ namespace sg
 				handle
 			));
 
-			m_requires_buffer_update.emplace_back(ComponentData<std::vector<bool>>(
-				std::vector<bool>(gfx::settings::num_back_buffers, true),
-				handle
-			));
+			m_requires_buffer_update.PushBack(true);
 
 			// TODO: Simplify this by moving the material handle from the mesh to the model.
 			std::vector<MaterialHandle> mats;
@@ -160,29 +264,47 @@ namespace sg
 				handle
 			));
 
+			m_batch_slots.emplace_back(ComponentData<BatchSlot>(
+				BatchSlot(),
+				handle
+			));
+
+			auto local_bounds = CalculateModelBounds(model_handle);
+			auto proxy = m_culling_tree.CreateProxy(TransformAABB(local_bounds, m_models[node.m_transform_component].m_value), node.m_mesh_component);
+			m_local_bounds.emplace_back(ComponentData<AABB>(local_bounds, handle));
+			m_cull_proxies.emplace_back(ComponentData<std::int32_t>(proxy, handle));
+
 			m_mesh_node_handles.push_back(handle);
-			for (auto& meshes_require_batching : m_meshes_require_batching)
-			{
-				meshes_require_batching.push_back(handle);
-			}
+			m_meshes_require_batching.push_back(handle);
 		}
 
 		template<typename T>
 		typename Void_IsComponent<T, TransformComponent>::type PromoteNode(NodeHandle handle)
 		{
-			auto& node = m_nodes[handle];
+			auto& node = m_nodes[internal::GetNodeIndex(handle)];
 			node.m_transform_component = m_positions.size();
 			m_positions.emplace_back(glm::vec3(0, 0, 0), handle);
 			m_rotations.emplace_back(glm::vec3(0, 0, 0), handle);
 			m_scales.emplace_back(glm::vec3(1, 1, 1), handle);
 			m_models.emplace_back(glm::mat4(1), handle);
 			m_requires_update.emplace_back(false, handle);
+			m_parents.emplace_back(-1, handle);
+			m_first_children.push_back(-1);
+			m_next_siblings.push_back(-1);
+			m_prev_siblings.push_back(-1);
+			m_dirty_transform_positions.push_back(0);
+
+			m_local_transforms.push_back(Matrix3x4{ { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 } } });
+			m_world_dirty.push_back(false);
+			// A new transform is a root, so appending it keeps parents ordered before their children.
+			m_transform_order_index.push_back(m_transform_order.size());
+			m_transform_order.push_back(node.m_transform_component);
 		}
 
 		template<typename T>
 		typename Void_IsComponent<T, CameraComponent>::type PromoteNode(NodeHandle handle)
 		{
-			auto& node = m_nodes[handle];
+			auto& node = m_nodes[internal::GetNodeIndex(handle)];
 			node.m_camera_component = m_camera_cb_handles.size();
 
 			// A camera requires a transform.
@@ -214,18 +336,20 @@ namespace sg
 				handle
 			));
 
-			m_requires_camera_buffer_update.emplace_back(ComponentData<std::vector<bool>>(
-				std::vector<bool>(gfx::settings::num_back_buffers, true),
+			m_camera_view_projections.emplace_back(ComponentData<glm::mat4>(
+				glm::mat4(1),
 				handle
 			));
 
+			m_requires_camera_buffer_update.PushBack(true);
+
 			m_camera_node_handles.push_back(handle);
 		}
 
 		template<typename T>
 		typename Void_IsComponent<T, LightComponent>::type PromoteNode(NodeHandle handle, cb::LightType type, glm::vec3 color = { 1, 1, 1 })
 		{
-			auto& node = m_nodes[handle];
+			auto& node = m_nodes[internal::GetNodeIndex(handle)];
 			node.m_light_component = m_light_node_handles.size();
 
 			// A light requires a transform.
@@ -234,10 +358,7 @@ namespace sg
 				PromoteNode<TransformComponent>(handle);
 			}
 
-			m_requires_light_buffer_update.emplace_back(ComponentData<std::vector<bool>>(
-					std::vector<bool>(gfx::settings::num_back_buffers, true),
-					handle
-			));
+			m_requires_light_buffer_update.PushBack(true);
 
 			m_colors.emplace_back(ComponentData<glm::vec3>{color, handle});
 			m_light_types.emplace_back(ComponentData<cb::LightType>{type, handle});
@@ -248,10 +369,107 @@ namespace sg
 			m_light_node_handles.push_back(handle);
 		}
 
+		//! Removes component `T` from a node. Other components and child nodes keep the transform component alive.
+		template<typename T>
+		typename Void_IsComponent<T, MeshComponent>::type DemoteNode(NodeHandle handle)
+		{
+			if (m_nodes[internal::GetNodeIndex(handle)].m_mesh_component != -1)
+			{
+				RemoveMeshComponent(handle);
+			}
+		}
+
+		template<typename T>
+		typename Void_IsComponent<T, TransformComponent>::type DemoteNode(NodeHandle handle)
+		{
+			auto const & node = m_nodes[internal::GetNodeIndex(handle)];
+			if (node.m_transform_component == -1) return;
+
+			if (node.m_mesh_component != -1 || node.m_camera_component != -1 || node.m_light_component != -1
+				|| m_first_children[node.m_transform_component] != -1)
+			{
+				LOGW("Can't remove the transform of node {} while other components or child nodes depend on it.", handle);
+				return;
+			}
+
+			RemoveTransformComponent(handle);
+		}
+
+		template<typename T>
+		typename Void_IsComponent<T, CameraComponent>::type DemoteNode(NodeHandle handle)
+		{
+			if (m_nodes[internal::GetNodeIndex(handle)].m_camera_component != -1)
+			{
+				RemoveCameraComponent(handle);
+			}
+		}
+
+		template<typename T>
+		typename Void_IsComponent<T, LightComponent>::type DemoteNode(NodeHandle handle)
+		{
+			if (m_nodes[internal::GetNodeIndex(handle)].m_light_component != -1)
+			{
+				RemoveLightComponent(handle);
+			}
+		}
+
+		//! Removes a node, its components and all of its descendants. The handle and the handles of the descendants become invalid.
+		/*!
+			Component arrays are kept dense by moving the last component into the freed spot, so component handles
+			of other nodes can change. Node indices are reused, but with a new generation so old handles fail `IsAlive`.
+		*/
+		void DestroyNode(NodeHandle handle);
+		//! Returns false for handles of destroyed nodes, even when the index got reused.
+		bool IsAlive(NodeHandle handle) const;
+
+		//! Writes everything that changed to the constant buffers of `frame_idx` and flushes them.
 		void Update(std::uint32_t frame_idx);
 
+		//! Queues a transform for the next `Update`. Marking a transform multiple times before it got updated is a no-op.
+		inline void MarkTransformDirty(ComponentHandle transform_handle)
+		{
+			if (m_requires_update[transform_handle].m_value) return;
+
+			m_requires_update[transform_handle] = true;
+			m_dirty_transform_positions[transform_handle] = m_dirty_transforms.size();
+			m_dirty_transforms.push_back(transform_handle);
+		}
+
+		//! Makes the transform of `child` relative to `parent`. Passing no parent makes it a root again.
+		/*!
+			Nodes without a transform component get one. Parenting a node to one of its own descendants is refused.
+			Only `m_models` is affected, cameras and lights keep using their local position and rotation.
+		*/
+		void SetParent(NodeHandle child, std::optional<NodeHandle> parent);
+		std::optional<NodeHandle> GetParent(NodeHandle handle) const;
+
+		//! Replaces the first `materials.size()` materials of a mesh node, extra materials are ignored. The mesh moves to the batch of its new materials on the next `Update`.
+		void SetMaterials(NodeHandle handle, std::vector<MaterialHandle> const & materials);
+
 		Node GetActiveCamera();
 
+		//! Collects the batched instances whose bounds intersect the frustum of `view_projection`.
+		/*!
+			The visible slots of every batch are sorted and merged into ranges. Uses the bounding volume hierarchy
+			that `Update` keeps up to date, so it only sees transforms of the last `Update`. Without
+			`settings::use_frustum_culling` every instance is returned. Safe to call from multiple render tasks at once.
+		*/
+		void CullInstances(glm::mat4 const & view_projection, VisibleInstances& out) const;
+
+		//! Writes the nodes, components and render batches to a binary snapshot. See `scene_snapshot.hpp` for the format.
+		/*!
+			Every model and material of a mesh component has to be in `references`, either directly or as a mesh of one of
+			the models there. Returns false when something can't be referenced or the file can't be written.
+		*/
+		bool SaveSnapshot(std::string const & path, SnapshotReferences const & references) const;
+		//! Restores a snapshot written by `SaveSnapshot` into this scene graph, which has to be empty.
+		/*!
+			Models and materials are looked up by name in `references` and the handles in `references.m_nodes` get replaced
+			by the stored ones. Returns false without touching the scene graph when the file is invalid or doesn't match `references`,
+			which includes snapshots of a different scene version or of models that changed since the snapshot was saved.
+		*/
+		bool LoadSnapshot(std::string const & path, SnapshotReferences& references);
+
 		ConstantBufferPool* GetPOConstantBufferPool();
 		ConstantBufferPool* GetCameraConstantBufferPool();
 		ConstantBufferPool* GetInverseCameraConstantBufferPool();
@@ -263,22 +481,27 @@ namespace sg
 		std::vector<ComponentData<glm::vec3>> m_rotations;
 		std::vector<ComponentData<glm::vec3>> m_scales;
 		std::vector<ComponentData<glm::mat4>> m_models;
-		std::vector<ComponentData<bool>> m_requires_update;
+		std::vector<ComponentData<bool>> m_requires_update; // Use `MarkTransformDirty` to set this.
+		std::vector<ComponentData<ComponentHandle>> m_parents; // Transform component of the parent or -1. Use `SetParent` to set this.
 
 		// Mesh Component
 		std::vector<ComponentData<ModelHandle>> m_model_handles;
 		std::vector<ComponentData<std::vector<MaterialHandle>>> m_model_material_handles;
-		std::vector<ComponentData<std::vector<bool>>> m_requires_buffer_update;
+		util::FrameBitset<gfx::settings::num_back_buffers> m_requires_buffer_update;
+		std::vector<ComponentData<BatchSlot>> m_batch_slots;
+		std::vector<ComponentData<AABB>> m_local_bounds; // Bounds of all meshes of the model.
+		std::vector<ComponentData<std::int32_t>> m_cull_proxies; // Proxy in `m_culling_tree`. The user data is the mesh component.
 
 		// Camera Component
 		std::vector<ComponentData<ConstantBufferHandle>> m_camera_cb_handles;
 		std::vector<ComponentData<ConstantBufferHandle>> m_inverse_camera_cb_handles;
 		std::vector<ComponentData<LensProperties>> m_camera_lens_properties;
 		std::vector<ComponentData<float>> m_camera_aspect_ratios;
-		std::vector<ComponentData<std::vector<bool>>> m_requires_camera_buffer_update;
+		std::vector<ComponentData<glm::mat4>> m_camera_view_projections; // `proj * view` of the last `Update`.
+		util::FrameBitset<gfx::settings::num_back_buffers> m_requires_camera_buffer_update;
 
 		// Light Component
-		std::vector<ComponentData<std::vector<bool>>> m_requires_light_buffer_update;
+		util::FrameBitset<gfx::settings::num_back_buffers> m_requires_light_buffer_update;
 		std::vector<ComponentData<glm::vec3>> m_colors;
 		std::vector<ComponentData<cb::LightType>> m_light_types;
 		std::vector<ComponentData<float>> m_radius;
@@ -287,21 +510,52 @@ namespace sg
 		std::vector<std::size_t> m_num_lights;
 
 		// Batching
-		std::vector<std::vector<NodeHandle>> m_meshes_require_batching;
-		std::vector<std::vector<std::pair<std::uint32_t, std::uint32_t>>> m_batch_requires_update;
+		std::vector<NodeHandle> m_meshes_require_batching;
 		std::vector<RenderBatch> m_render_batches;
+		//! The batch of every model and materials combination. Batches grow a page at a time so there is only ever one per key.
+		std::unordered_map<internal::BatchKey, std::uint32_t, internal::BatchKeyHash> m_batches_by_key;
+		std::uint32_t m_num_instance_pages = 0;
 
-
-		inline bool FitsInBatch(RenderBatch const & batch, Node const & node) const
-		{
-			auto model_handle = m_model_handles[node.m_mesh_component].m_value;
-			auto material_handles = m_model_material_handles[node.m_mesh_component].m_value;
-
-			return batch.m_model_handle == model_handle && batch.m_material_handles == material_handles;
-		}
+		// Culling
+		AABBTree m_culling_tree;
 
 	private:
+		//! Takes ownership of the pools.
+		SceneGraph(ConstantBufferPool* per_object_buffer_pool, ConstantBufferPool* camera_buffer_pool,
+			ConstantBufferPool* inverse_camera_buffer_pool, ConstantBufferPool* light_buffer_pool);
+
+		void UpdateTransforms();
+		//! Recomputes the world matrices of the dirty transforms and all their descendants in one pass over `m_transform_order`.
+		void PropagateTransforms();
+		//! Sorts the transforms breadth first so every parent comes before its children.
+		void RebuildTransformOrder();
+		void MarkTransformUsersDirty(ComponentHandle transform_handle);
+		//! Adds `child` to the child list of `parent`. `child` may not be in a child list already.
+		void LinkChild(ComponentHandle parent, ComponentHandle child);
+		//! Removes `child` from the child list of its parent.
+		void UnlinkChild(ComponentHandle child);
+		//! Rebuilds the child lists and dirty positions from `m_parents` and `m_dirty_transforms`.
+		void RebuildTransformLinks();
+		//! Returns the nodes below a transform sorted by depth.
+		std::vector<NodeHandle> GetDescendants(ComponentHandle transform_handle);
+
+		void ReleaseNode(NodeHandle handle);
+		void RemoveTransformComponent(NodeHandle handle);
+		void RemoveMeshComponent(NodeHandle handle);
+		void RemoveCameraComponent(NodeHandle handle);
+		void RemoveLightComponent(NodeHandle handle);
+
+		//! Adds a mesh component to the batch of its model and materials. Returns the slot it got.
+		BatchSlot AddToBatch(NodeHandle node_handle);
+		//! Moves the last mesh of the batch into the slot. Releases the last page once it is empty and the batch once it has no meshes left.
+		void RemoveFromBatch(BatchSlot slot);
+		void UpdateBatchSlot(BatchSlot slot, Node const & node, std::uint32_t frame_idx);
+		static AABB CalculateModelBounds(ModelHandle const & model_handle);
+
 		std::vector<Node> m_nodes;
+		std::vector<std::uint32_t> m_node_generations; // Indexed by node index.
+		std::vector<std::uint32_t> m_node_handle_positions; // Position in `m_node_handles` per node index. `internal::free_node_position` for free indices.
+		std::vector<std::uint32_t> m_free_nodes;
 		std::vector<NodeHandle> m_node_handles;
 		std::vector<NodeHandle> m_mesh_node_handles;
 		std::vector<NodeHandle> m_camera_node_handles;
@@ -312,6 +566,24 @@ namespace sg
 		ConstantBufferPool* m_light_buffer_pool;
 		ConstantBufferHandle m_light_buffer_handle;
 
+		std::vector<ComponentHandle> m_dirty_transforms;
+		std::vector<std::uint32_t> m_dirty_transform_positions; // Position in `m_dirty_transforms` per transform component, valid while `m_requires_update` is set.
+		TransformSoA m_dirty_transform_data;
+		std::vector<Matrix3x4> m_dirty_transform_results;
+		util::JobSystem* m_job_system;
+
+		// Hierarchy
+		std::vector<Matrix3x4> m_local_transforms; // Indexed by transform component.
+		// Children are a doubly linked list per parent so they can be found and removed without scanning `m_parents`.
+		std::vector<ComponentHandle> m_first_children; // Indexed by transform component, -1 for leafs.
+		std::vector<ComponentHandle> m_next_siblings; // Indexed by transform component, -1 for the last child.
+		std::vector<ComponentHandle> m_prev_siblings; // Indexed by transform component, -1 for the first child.
+		std::vector<ComponentHandle> m_transform_order;
+		std::vector<std::size_t> m_transform_order_index; // Position of a transform component in `m_transform_order`.
+		std::vector<bool> m_world_dirty; // Set during `PropagateTransforms` and `GetDescendants`, always clear in between.
+		std::size_t m_num_parented_transforms = 0; // While 0 world matrices are written directly and propagation is skipped.
+		bool m_transform_order_dirty = false;
+
 	};
 
 	namespace helper
@@ -334,40 +606,35 @@ namespace sg
 
 		inline void SetMaterial(SceneGraph* sg, NodeHandle handle, std::vector<MaterialHandle> mats)
 		{
-			auto model_handle = sg->GetNode(handle).m_mesh_component;
-
-			for (auto i = 0; i < mats.size(); i++)
-			{
-				sg->m_model_material_handles[model_handle].m_value[i] = mats[i];
-			}
+			sg->SetMaterials(handle, mats);
 		}
 
 		inline void Translate(SceneGraph* sg, NodeHandle handle, glm::vec3 value)
 		{
 			auto transform_handle = sg->GetNode(handle).m_transform_component;
 			sg->m_positions[transform_handle].m_value += value;
-			sg->m_requires_update[transform_handle] = true;
+			sg->MarkTransformDirty(transform_handle);
 		}
 
 		inline void SetPosition(SceneGraph* sg, NodeHandle handle, glm::vec3 value)
 		{
 			auto transform_handle = sg->GetNode(handle).m_transform_component;
 			sg->m_positions[transform_handle].m_value = value;
-			sg->m_requires_update[transform_handle] = true;
+			sg->MarkTransformDirty(transform_handle);
 		}
 
 		inline void SetScale(SceneGraph* sg, NodeHandle handle, glm::vec3 value)
 		{
 			auto transform_handle = sg->GetNode(handle).m_transform_component;
 			sg->m_scales[transform_handle].m_value = value;
-			sg->m_requires_update[transform_handle] = true;
+			sg->MarkTransformDirty(transform_handle);
 		}
 
 		inline void SetRotation(SceneGraph* sg, NodeHandle handle, glm::vec3 euler)
 		{
 			auto transform_handle = sg->GetNode(handle).m_transform_component;
 			sg->m_rotations[transform_handle].m_value = euler;
-			sg->m_requires_update[transform_handle] = true;
+			sg->MarkTransformDirty(transform_handle);
 		}
 
 		inline glm::vec3 GetRotation(SceneGraph* sg, NodeHandle handle)
@@ -380,49 +647,49 @@ namespace sg
 		{
 			auto transform_handle = sg->GetNode(handle).m_transform_component;
 			sg->m_rotations[transform_handle].m_value += euler;
-			sg->m_requires_update[transform_handle] = true;
+			sg->MarkTransformDirty(transform_handle);
 		}
 
 		inline void SetRadius(SceneGraph* sg, NodeHandle handle, float radius)
 		{
 			auto light_handle = sg->GetNode(handle).m_light_component;
 			sg->m_radius[light_handle].m_value = radius;
-			sg->m_requires_light_buffer_update[light_handle] = { true, true, true };
+			sg->m_requires_light_buffer_update.MarkDirty(light_handle);
 		}
 
 		inline void SetPhysicalSize(SceneGraph* sg, NodeHandle handle, float size)
 		{
 			auto light_handle = sg->GetNode(handle).m_light_component;
 			sg->m_light_physical_size[light_handle].m_value = size;
-			sg->m_requires_light_buffer_update[light_handle] = { true, true, true };
+			sg->m_requires_light_buffer_update.MarkDirty(light_handle);
 		}
 
 		inline void SetAspectRatio(SceneGraph* sg, NodeHandle handle, float ratio)
 		{
 			auto camera_handle = sg->GetNode(handle).m_camera_component;
 			sg->m_camera_aspect_ratios[camera_handle].m_value = ratio;
-			sg->m_requires_camera_buffer_update[camera_handle] = { true, true, true };
+			sg->m_requires_camera_buffer_update.MarkDirty(camera_handle);
 		}
 
 		inline void SetLensDiameter(SceneGraph* sg, NodeHandle handle, float diameter)
 		{
 			auto camera_handle = sg->GetNode(handle).m_camera_component;
 			sg->m_camera_lens_properties[camera_handle].m_value.m_diameter = diameter;
-			sg->m_requires_camera_buffer_update[camera_handle] = { true, true, true };
+			sg->m_requires_camera_buffer_update.MarkDirty(camera_handle);
 		}
 
 		inline void SetFieldOfView(SceneGraph* sg, NodeHandle handle, float fov)
 		{
 			auto camera_handle = sg->GetNode(handle).m_camera_component;
 			sg->m_camera_lens_properties[camera_handle].m_value.m_fov = fov;
-			sg->m_requires_camera_buffer_update[camera_handle] = { true, true, true };
+			sg->m_requires_camera_buffer_update.MarkDirty(camera_handle);
 		}
 
 		inline void SetFocalDistance(SceneGraph* sg, NodeHandle handle, float dist)
 		{
 			auto camera_handle = sg->GetNode(handle).m_camera_component;
 			sg->m_camera_lens_properties[camera_handle].m_value.m_focal_dist = dist;
-			sg->m_requires_camera_buffer_update[camera_handle] = { true, true, true };
+			sg->m_requires_camera_buffer_update.MarkDirty(camera_handle);
 		}
 
 	} /* helper */
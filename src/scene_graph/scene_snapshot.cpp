@@ -0,0 +1,852 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include "scene_graph.hpp"
+#include "scene_snapshot.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <type_traits>
+
+#include "../util/hash.hpp"
+#include "../util/mapped_file.hpp"
+
+namespace sg::internal
+{
+
+	inline std::size_t AlignSnapshotSize(std::size_t size)
+	{
+		return (size + scene_snapshot::alignment - 1) & ~(scene_snapshot::alignment - 1);
+	}
+
+	//! Hashes the names of the references and what is known about the meshes of the models. References are looked up by name,
+	//! so their order doesn't change the hash. A model that got re-exported or processed differently changes its mesh counts
+	//! or bounds and with that the hash.
+	inline std::uint64_t HashSnapshotReferences(SnapshotReferences const & references)
+	{
+		std::vector<std::pair<std::string, std::uint64_t>> hashes;
+		for (auto const & [name, model] : references.m_models)
+		{
+			auto hash = util::FNV1aValue(static_cast<std::uint64_t>(model.m_mesh_handles.size()));
+			for (auto const & mesh : model.m_mesh_handles)
+			{
+				hash = util::FNV1aValue(mesh.m_num_indices, hash);
+				hash = util::FNV1aValue(mesh.m_num_vertices, hash);
+				hash = util::FNV1aValue(mesh.m_bbox_min, hash);
+				hash = util::FNV1aValue(mesh.m_bbox_max, hash);
+				hash = util::FNV1aValue(static_cast<std::uint64_t>(mesh.m_lods.size()), hash);
+			}
+			hashes.emplace_back("model:" + name, hash);
+		}
+
+		for (auto const & [name, material] : references.m_materials)
+		{
+			hashes.emplace_back("material:" + name, 0);
+		}
+
+		std::sort(hashes.begin(), hashes.end());
+
+		auto hash = util::fnv_offset_basis;
+		for (auto const & [name, reference_hash] : hashes)
+		{
+			hash = util::FNV1a(name.data(), name.size() + 1, hash); // Includes the terminator to separate the names.
+			hash = util::FNV1aValue(reference_hash, hash);
+		}
+
+		return hash;
+	}
+
+	//! Collects the sections of a snapshot and writes them to disc.
+	class SnapshotWriter
+	{
+	public:
+		explicit SnapshotWriter(SnapshotReferences const & references)
+			: m_header()
+		{
+			m_header.m_magic = scene_snapshot::magic;
+			m_header.m_version = scene_snapshot::version;
+			m_header.m_node_index_bits = node_index_bits;
+			m_header.m_instances_per_page = gfx::settings::instances_per_page;
+			m_header.m_scene_version = references.m_scene_version;
+			m_header.m_references_hash = HashSnapshotReferences(references);
+		}
+
+		template<typename T>
+		void AddSection(SceneSnapshotSectionType type, std::vector<T> const & data)
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "Sections are loaded with memcpy.");
+
+			auto& section = m_header.m_sections[static_cast<std::size_t>(type)];
+			section.m_offset = m_data.size(); // Relative to the first section until `Write`.
+			section.m_size = data.size() * sizeof(T);
+
+			auto bytes = reinterpret_cast<std::uint8_t const *>(data.data());
+			m_data.insert(m_data.end(), bytes, bytes + section.m_size);
+			m_data.resize(AlignSnapshotSize(m_data.size()), 0);
+		}
+
+		bool Write(std::string const & path) const
+		{
+			auto sections_start = AlignSnapshotSize(sizeof(SceneSnapshotHeader));
+
+			auto header = m_header;
+			for (auto& section : header.m_sections)
+			{
+				section.m_offset += sections_start;
+			}
+
+			return util::WriteFileAtomic(path, [&](std::ostream& file)
+			{
+				std::vector<char> padding(sections_start - sizeof(SceneSnapshotHeader), 0);
+
+				file.write(reinterpret_cast<char const *>(&header), sizeof(header));
+				file.write(padding.data(), padding.size());
+				file.write(reinterpret_cast<char const *>(m_data.data()), m_data.size());
+			});
+		}
+
+	private:
+		SceneSnapshotHeader m_header;
+		std::vector<std::uint8_t> m_data;
+	};
+
+	//! Memory mapped, read only view of a snapshot.
+	class SnapshotReader
+	{
+	public:
+		explicit SnapshotReader(std::string const & path)
+			: m_file(path), m_intact(false)
+		{
+			if (!m_file.IsValid() || m_file.GetSize() < sizeof(SceneSnapshotHeader))
+			{
+				return;
+			}
+
+			auto const & header = GetHeader();
+			if (header.m_magic != scene_snapshot::magic || header.m_version != scene_snapshot::version
+				|| header.m_node_index_bits != node_index_bits || header.m_instances_per_page != gfx::settings::instances_per_page)
+			{
+				return;
+			}
+
+			for (auto const & section : header.m_sections)
+			{
+				if (section.m_offset > m_file.GetSize() || section.m_size > m_file.GetSize() - section.m_offset)
+				{
+					return;
+				}
+			}
+
+			m_intact = true;
+		}
+
+		bool IsIntact() const
+		{
+			return m_intact;
+		}
+
+		SceneSnapshotHeader const & GetHeader() const
+		{
+			return *reinterpret_cast<SceneSnapshotHeader const *>(m_file.GetData());
+		}
+
+		//! Number of `T`'s in the section or `std::nullopt` when the size isn't a multiple of `T`.
+		template<typename T>
+		std::optional<std::size_t> GetCount(SceneSnapshotSectionType type) const
+		{
+			auto size = GetSection(type).m_size;
+			if (size % sizeof(T) != 0)
+			{
+				return std::nullopt;
+			}
+
+			return size / sizeof(T);
+		}
+
+		template<typename T>
+		bool HasCount(SceneSnapshotSectionType type, std::size_t count) const
+		{
+			return GetCount<T>(type) == count;
+		}
+
+		template<typename T>
+		bool IsArrayOf(SceneSnapshotSectionType type) const
+		{
+			return GetCount<T>(type).has_value();
+		}
+
+		template<typename T>
+		std::vector<T> GetVector(SceneSnapshotSectionType type) const
+		{
+			std::vector<T> data;
+			Read(type, data);
+			return data;
+		}
+
+		//! Replaces the contents of `out` with the section. The section size has to be validated with `GetCount` first.
+		template<typename T>
+		void Read(SceneSnapshotSectionType type, std::vector<T>& out) const
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "Sections are loaded with memcpy.");
+
+			out.resize(GetSection(type).m_size / sizeof(T));
+			if (!out.empty())
+			{
+				memcpy(out.data(), m_file.GetData() + GetSection(type).m_offset, out.size() * sizeof(T));
+			}
+		}
+
+		std::optional<std::string> GetString(SceneSnapshotString const & str) const
+		{
+			auto const & section = GetSection(SceneSnapshotSectionType::STRINGS);
+			if (str.m_offset > section.m_size || str.m_size > section.m_size - str.m_offset)
+			{
+				return std::nullopt;
+			}
+
+			return std::string(reinterpret_cast<char const *>(m_file.GetData() + section.m_offset + str.m_offset), str.m_size);
+		}
+
+	private:
+		SceneSnapshotSection const & GetSection(SceneSnapshotSectionType type) const
+		{
+			return GetHeader().m_sections[static_cast<std::size_t>(type)];
+		}
+
+		util::MappedFile m_file;
+		bool m_intact;
+	};
+
+	template<typename T>
+	inline std::optional<std::size_t> FindByName(std::vector<std::pair<std::string, T>> const & named, std::string const & name)
+	{
+		auto it = std::find_if(named.begin(), named.end(), [&name](auto const & entry) { return entry.first == name; });
+		if (it == named.end())
+		{
+			return std::nullopt;
+		}
+
+		return static_cast<std::size_t>(it - named.begin());
+	}
+
+} /* sg::internal */
+
+bool sg::SceneGraph::SaveSnapshot(std::string const & path, SnapshotReferences const & references) const
+{
+	using Type = SceneSnapshotSectionType;
+
+	std::vector<char> strings;
+	auto add_string = [&strings](std::string const & str)
+	{
+		SceneSnapshotString result = { static_cast<std::uint32_t>(strings.size()), static_cast<std::uint32_t>(str.size()) };
+		strings.insert(strings.end(), str.begin(), str.end());
+		return result;
+	};
+
+	std::vector<SceneSnapshotString> asset_names;
+	std::vector<SceneSnapshotString> material_names;
+	for (auto const & [name, model_handle] : references.m_models)
+	{
+		asset_names.push_back(add_string(name));
+	}
+	for (auto const & [name, material_handle] : references.m_materials)
+	{
+		material_names.push_back(add_string(name));
+	}
+
+	// Meshes by id. Levels of detail have ids of their own, so they point to the mesh they belong to.
+	std::unordered_map<std::uint32_t, SceneSnapshotModelMesh> asset_meshes;
+	// Named materials take precedence over the materials of the meshes.
+	std::unordered_map<std::uint32_t, SceneSnapshotMaterial> known_materials;
+	for (std::size_t i = 0; i < references.m_materials.size(); i++)
+	{
+		known_materials.try_emplace(references.m_materials[i].second.m_material_id, SceneSnapshotMaterial{ static_cast<std::int32_t>(i), 0, 0 });
+	}
+	for (std::uint32_t asset = 0; asset < references.m_models.size(); asset++)
+	{
+		auto const & mesh_handles = references.m_models[asset].second.m_mesh_handles;
+		for (std::uint32_t mesh = 0; mesh < mesh_handles.size(); mesh++)
+		{
+			asset_meshes.try_emplace(mesh_handles[mesh].m_id, SceneSnapshotModelMesh{ asset, mesh, 0 });
+			for (std::uint32_t lod = 0; lod < mesh_handles[mesh].m_lods.size(); lod++)
+			{
+				asset_meshes.try_emplace(mesh_handles[mesh].m_lods[lod].m_id, SceneSnapshotModelMesh{ asset, mesh, lod + 1 });
+			}
+
+			if (mesh_handles[mesh].m_material_handle.has_value())
+			{
+				known_materials.try_emplace(mesh_handles[mesh].m_material_handle->m_material_id, SceneSnapshotMaterial{ -1, asset, mesh });
+			}
+		}
+	}
+
+	std::vector<SceneSnapshotModel> models;
+	std::vector<SceneSnapshotModelMesh> model_meshes;
+	// Keyed by the flattened meshes, `ModelHandle::operator==` ignores the levels of detail.
+	std::map<std::vector<std::uint32_t>, std::uint32_t> model_indices;
+	auto add_model = [&](ModelHandle const & model_handle) -> std::optional<std::uint32_t>
+	{
+		std::vector<std::uint32_t> key;
+		for (auto const & mesh_handle : model_handle.m_mesh_handles)
+		{
+			auto it = asset_meshes.find(mesh_handle.m_id);
+			if (it == asset_meshes.end())
+			{
+				return std::nullopt;
+			}
+
+			// `GetLod(0)` drops the levels of detail, so only keep them when the mesh still has them.
+			auto model_mesh = it->second;
+			auto const & asset_mesh = references.m_models[model_mesh.m_asset].second.m_mesh_handles[model_mesh.m_mesh];
+			if (model_mesh.m_lod == 0 && mesh_handle.m_lods.size() == asset_mesh.m_lods.size())
+			{
+				model_mesh.m_lod = SceneSnapshotModelMesh::all_lods;
+			}
+			key.insert(key.end(), { model_mesh.m_asset, model_mesh.m_mesh, model_mesh.m_lod });
+		}
+
+		auto [it, inserted] = model_indices.try_emplace(key, static_cast<std::uint32_t>(models.size()));
+		if (inserted)
+		{
+			models.push_back({ static_cast<std::uint32_t>(model_meshes.size()), static_cast<std::uint32_t>(model_handle.m_mesh_handles.size()) });
+			for (std::size_t i = 0; i < key.size(); i += 3)
+			{
+				model_meshes.push_back({ key[i], key[i + 1], key[i + 2] });
+			}
+		}
+
+		return it->second;
+	};
+
+	std::vector<SceneSnapshotMaterial> materials;
+	std::vector<std::uint32_t> material_lists;
+	std::unordered_map<std::uint32_t, std::uint32_t> material_indices;
+	auto add_materials = [&](std::vector<MaterialHandle> const & material_handles) -> std::optional<std::uint32_t>
+	{
+		auto first = static_cast<std::uint32_t>(material_lists.size());
+		for (auto const & material_handle : material_handles)
+		{
+			auto idx_it = material_indices.find(material_handle.m_material_id);
+			if (idx_it == material_indices.end())
+			{
+				auto known_it = known_materials.find(material_handle.m_material_id);
+				if (known_it == known_materials.end())
+				{
+					material_lists.resize(first);
+					return std::nullopt;
+				}
+
+				idx_it = material_indices.emplace(material_handle.m_material_id, static_cast<std::uint32_t>(materials.size())).first;
+				materials.push_back(known_it->second);
+			}
+
+			material_lists.push_back(idx_it->second);
+		}
+
+		return first;
+	};
+
+	std::vector<SceneSnapshotMeshComponent> mesh_components;
+	for (std::size_t i = 0; i < m_model_handles.size(); i++)
+	{
+		auto model = add_model(m_model_handles[i].m_value);
+		auto first_material = add_materials(m_model_material_handles[i].m_value);
+		if (!model.has_value() || !first_material.has_value())
+		{
+			LOGW("Can't save a snapshot, the model or materials of mesh node {} aren't in the snapshot references.", m_model_handles[i].m_node_handle);
+			return false;
+		}
+
+		mesh_components.push_back({ m_model_handles[i].m_node_handle, model.value(), first_material.value(),
+			static_cast<std::uint32_t>(m_model_material_handles[i].m_value.size()) });
+	}
+
+	// Batches use the models and materials of their mesh components, so they can always be referenced.
+	std::vector<SceneSnapshotBatch> batches;
+	std::vector<NodeHandle> batch_nodes;
+	for (auto const & batch : m_render_batches)
+	{
+		batches.push_back({ add_model(batch.m_model_handle).value(), add_materials(batch.m_material_handles).value(),
+			static_cast<std::uint32_t>(batch.m_material_handles.size()), static_cast<std::uint32_t>(batch_nodes.size()), batch.m_num_meshes });
+		batch_nodes.insert(batch_nodes.end(), batch.m_nodes.begin(), batch.m_nodes.end());
+	}
+
+	std::vector<SceneSnapshotLightAngles> light_angles;
+	for (auto const & angles : m_light_angles)
+	{
+		light_angles.push_back({ angles.m_node_handle, angles.m_value.first, angles.m_value.second });
+	}
+
+	std::vector<SceneSnapshotNamedNode> named_nodes;
+	for (auto const & [name, node_handle] : references.m_nodes)
+	{
+		named_nodes.push_back({ add_string(name), node_handle });
+	}
+
+	std::vector<SceneSnapshotCullingTree> culling_tree = { {
+		m_culling_tree.m_root, m_culling_tree.m_free_list, m_culling_tree.m_num_proxies, m_culling_tree.m_margin
+	} };
+
+	internal::SnapshotWriter writer(references);
+
+	writer.AddSection(Type::NODES, m_nodes);
+	writer.AddSection(Type::NODE_GENERATIONS, m_node_generations);
+	writer.AddSection(Type::NODE_HANDLE_POSITIONS, m_node_handle_positions);
+	writer.AddSection(Type::FREE_NODES, m_free_nodes);
+	writer.AddSection(Type::NODE_HANDLES, m_node_handles);
+	writer.AddSection(Type::MESH_NODE_HANDLES, m_mesh_node_handles);
+	writer.AddSection(Type::CAMERA_NODE_HANDLES, m_camera_node_handles);
+	writer.AddSection(Type::LIGHT_NODE_HANDLES, m_light_node_handles);
+	writer.AddSection(Type::NAMED_NODES, named_nodes);
+
+	writer.AddSection(Type::POSITIONS, m_positions);
+	writer.AddSection(Type::ROTATIONS, m_rotations);
+	writer.AddSection(Type::SCALES, m_scales);
+	writer.AddSection(Type::MODELS, m_models);
+	writer.AddSection(Type::REQUIRES_UPDATE, m_requires_update);
+	writer.AddSection(Type::PARENTS, m_parents);
+	writer.AddSection(Type::LOCAL_TRANSFORMS, m_local_transforms);
+	writer.AddSection(Type::TRANSFORM_ORDER, m_transform_order);
+	writer.AddSection(Type::TRANSFORM_ORDER_INDEX, m_transform_order_index);
+	writer.AddSection(Type::DIRTY_TRANSFORMS, m_dirty_transforms);
+
+	writer.AddSection(Type::MESH_COMPONENTS, mesh_components);
+	writer.AddSection(Type::BATCH_SLOTS, m_batch_slots);
+	writer.AddSection(Type::LOCAL_BOUNDS, m_local_bounds);
+	writer.AddSection(Type::MESHES_REQUIRE_BATCHING, m_meshes_require_batching);
+	writer.AddSection(Type::CULL_PROXIES, m_cull_proxies);
+	writer.AddSection(Type::CULLING_TREE, culling_tree);
+	writer.AddSection(Type::CULLING_TREE_NODES, m_culling_tree.m_nodes);
+	writer.AddSection(Type::BATCHES, batches);
+	writer.AddSection(Type::BATCH_NODES, batch_nodes);
+
+	writer.AddSection(Type::LENS_PROPERTIES, m_camera_lens_properties);
+	writer.AddSection(Type::ASPECT_RATIOS, m_camera_aspect_ratios);
+	writer.AddSection(Type::VIEW_PROJECTIONS, m_camera_view_projections);
+
+	writer.AddSection(Type::LIGHT_COLORS, m_colors);
+	writer.AddSection(Type::LIGHT_TYPES, m_light_types);
+	writer.AddSection(Type::LIGHT_RADIUS, m_radius);
+	writer.AddSection(Type::LIGHT_PHYSICAL_SIZE, m_light_physical_size);
+	writer.AddSection(Type::LIGHT_ANGLES, light_angles);
+
+	writer.AddSection(Type::ASSET_NAMES, asset_names);
+	writer.AddSection(Type::MATERIAL_NAMES, material_names);
+	writer.AddSection(Type::MODEL_REFERENCES, models);
+	writer.AddSection(Type::MODEL_MESHES, model_meshes);
+	writer.AddSection(Type::MATERIAL_REFERENCES, materials);
+	writer.AddSection(Type::MATERIAL_LISTS, material_lists);
+	writer.AddSection(Type::STRINGS, strings);
+
+	return writer.Write(path);
+}
+
+bool sg::SceneGraph::LoadSnapshot(std::string const & path, SnapshotReferences& references)
+{
+	using Type = SceneSnapshotSectionType;
+
+	if (!m_nodes.empty())
+	{
+		LOGW("Snapshots can only be loaded into a empty scene graph.");
+		return false;
+	}
+
+	internal::SnapshotReader reader(path);
+	if (!reader.IsIntact())
+	{
+		return false;
+	}
+
+	auto const & header = reader.GetHeader();
+	if (header.m_scene_version != references.m_scene_version || header.m_references_hash != internal::HashSnapshotReferences(references))
+	{
+		LOGW("Scene snapshot `{}` is out of date.", path);
+		return false;
+	}
+
+	auto invalid = [&path]()
+	{
+		LOGW("Scene snapshot `{}` is corrupt.", path);
+		return false;
+	};
+
+	// Validate the section sizes and resolve every reference before anything gets changed.
+	auto num_nodes = reader.GetCount<Node>(Type::NODES);
+	auto num_transforms = reader.GetCount<ComponentData<glm::vec3>>(Type::POSITIONS);
+	auto num_meshes = reader.GetCount<SceneSnapshotMeshComponent>(Type::MESH_COMPONENTS);
+	auto num_cameras = reader.GetCount<ComponentData<LensProperties>>(Type::LENS_PROPERTIES);
+	auto num_lights = reader.GetCount<ComponentData<glm::vec3>>(Type::LIGHT_COLORS);
+	if (!num_nodes || !num_transforms || !num_meshes || !num_cameras || !num_lights)
+	{
+		return invalid();
+	}
+
+	if (!reader.HasCount<std::uint32_t>(Type::NODE_GENERATIONS, *num_nodes)
+		|| !reader.HasCount<std::uint32_t>(Type::NODE_HANDLE_POSITIONS, *num_nodes)
+		|| !reader.IsArrayOf<std::uint32_t>(Type::FREE_NODES)
+		|| !reader.IsArrayOf<NodeHandle>(Type::NODE_HANDLES)
+		|| !reader.IsArrayOf<SceneSnapshotNamedNode>(Type::NAMED_NODES)
+		|| !reader.HasCount<ComponentData<glm::vec3>>(Type::ROTATIONS, *num_transforms)
+		|| !reader.HasCount<ComponentData<glm::vec3>>(Type::SCALES, *num_transforms)
+		|| !reader.HasCount<ComponentData<glm::mat4>>(Type::MODELS, *num_transforms)
+		|| !reader.HasCount<ComponentData<bool>>(Type::REQUIRES_UPDATE, *num_transforms)
+		|| !reader.HasCount<ComponentData<ComponentHandle>>(Type::PARENTS, *num_transforms)
+		|| !reader.HasCount<Matrix3x4>(Type::LOCAL_TRANSFORMS, *num_transforms)
+		|| !reader.HasCount<ComponentHandle>(Type::TRANSFORM_ORDER, *num_transforms)
+		|| !reader.HasCount<std::size_t>(Type::TRANSFORM_ORDER_INDEX, *num_transforms)
+		|| !reader.IsArrayOf<ComponentHandle>(Type::DIRTY_TRANSFORMS)
+		|| !reader.HasCount<NodeHandle>(Type::MESH_NODE_HANDLES, *num_meshes)
+		|| !reader.HasCount<ComponentData<BatchSlot>>(Type::BATCH_SLOTS, *num_meshes)
+		|| !reader.HasCount<ComponentData<AABB>>(Type::LOCAL_BOUNDS, *num_meshes)
+		|| !reader.IsArrayOf<NodeHandle>(Type::MESHES_REQUIRE_BATCHING)
+		|| !reader.HasCount<ComponentData<std::int32_t>>(Type::CULL_PROXIES, *num_meshes)
+		|| !reader.HasCount<SceneSnapshotCullingTree>(Type::CULLING_TREE, 1)
+		|| !reader.IsArrayOf<AABBTree::Node>(Type::CULLING_TREE_NODES)
+		|| !reader.IsArrayOf<SceneSnapshotBatch>(Type::BATCHES)
+		|| !reader.IsArrayOf<NodeHandle>(Type::BATCH_NODES)
+		|| !reader.HasCount<NodeHandle>(Type::CAMERA_NODE_HANDLES, *num_cameras)
+		|| !reader.HasCount<ComponentData<float>>(Type::ASPECT_RATIOS, *num_cameras)
+		|| !reader.HasCount<ComponentData<glm::mat4>>(Type::VIEW_PROJECTIONS, *num_cameras)
+		|| !reader.HasCount<NodeHandle>(Type::LIGHT_NODE_HANDLES, *num_lights)
+		|| !reader.HasCount<ComponentData<cb::LightType>>(Type::LIGHT_TYPES, *num_lights)
+		|| !reader.HasCount<ComponentData<float>>(Type::LIGHT_RADIUS, *num_lights)
+		|| !reader.HasCount<ComponentData<float>>(Type::LIGHT_PHYSICAL_SIZE, *num_lights)
+		|| !reader.HasCount<SceneSnapshotLightAngles>(Type::LIGHT_ANGLES, *num_lights)
+		|| !reader.IsArrayOf<SceneSnapshotString>(Type::ASSET_NAMES)
+		|| !reader.IsArrayOf<SceneSnapshotString>(Type::MATERIAL_NAMES)
+		|| !reader.IsArrayOf<SceneSnapshotModel>(Type::MODEL_REFERENCES)
+		|| !reader.IsArrayOf<SceneSnapshotModelMesh>(Type::MODEL_MESHES)
+		|| !reader.IsArrayOf<SceneSnapshotMaterial>(Type::MATERIAL_REFERENCES)
+		|| !reader.IsArrayOf<std::uint32_t>(Type::MATERIAL_LISTS))
+	{
+		return invalid();
+	}
+
+	auto nodes = reader.GetVector<Node>(Type::NODES);
+	for (auto const & node : nodes)
+	{
+		if (node.m_transform_component >= static_cast<ComponentHandle>(*num_transforms)
+			|| node.m_mesh_component >= static_cast<ComponentHandle>(*num_meshes)
+			|| node.m_camera_component >= static_cast<ComponentHandle>(*num_cameras)
+			|| node.m_light_component >= static_cast<ComponentHandle>(*num_lights))
+		{
+			return invalid();
+		}
+	}
+
+	// The child lists and dirty positions are rebuilt from these, so they have to point at existing transforms.
+	auto is_transform = [&num_transforms](ComponentHandle transform) { return transform >= 0 && transform < static_cast<ComponentHandle>(*num_transforms); };
+	for (auto const & parent : reader.GetVector<ComponentData<ComponentHandle>>(Type::PARENTS))
+	{
+		if (parent.m_value != -1 && !is_transform(parent.m_value))
+		{
+			return invalid();
+		}
+	}
+	for (auto transform : reader.GetVector<ComponentHandle>(Type::DIRTY_TRANSFORMS))
+	{
+		if (!is_transform(transform))
+		{
+			return invalid();
+		}
+	}
+
+	// The tree is only restored as it is when it uses the same margin, it's build again otherwise.
+	auto culling_tree = reader.GetVector<SceneSnapshotCullingTree>(Type::CULLING_TREE)[0];
+	auto culling_tree_nodes = reader.GetVector<AABBTree::Node>(Type::CULLING_TREE_NODES);
+	auto cull_proxies = reader.GetVector<ComponentData<std::int32_t>>(Type::CULL_PROXIES);
+	auto restore_culling_tree = culling_tree.m_margin == m_culling_tree.m_margin;
+	if (restore_culling_tree)
+	{
+		auto is_node = [&culling_tree_nodes](std::int32_t node) { return node >= -1 && node < static_cast<std::int32_t>(culling_tree_nodes.size()); };
+		if (!is_node(culling_tree.m_root) || !is_node(culling_tree.m_free_list) || culling_tree.m_num_proxies != *num_meshes)
+		{
+			return invalid();
+		}
+
+		for (auto const & node : culling_tree_nodes)
+		{
+			if (!is_node(node.m_parent) || !is_node(node.m_left) || !is_node(node.m_right))
+			{
+				return invalid();
+			}
+		}
+
+		for (auto const & proxy : cull_proxies)
+		{
+			if (proxy.m_value < 0 || !is_node(proxy.m_value) || !culling_tree_nodes[proxy.m_value].IsLeaf())
+			{
+				return invalid();
+			}
+		}
+	}
+
+	auto resolve_name = [&reader](SceneSnapshotString const & name, auto const & named) -> std::optional<std::size_t>
+	{
+		auto str = reader.GetString(name);
+		return str.has_value() ? internal::FindByName(named, str.value()) : std::nullopt;
+	};
+
+	auto asset_names = reader.GetVector<SceneSnapshotString>(Type::ASSET_NAMES);
+	std::vector<ModelHandle const *> assets;
+	for (auto const & name : asset_names)
+	{
+		auto idx = resolve_name(name, references.m_models);
+		if (!idx.has_value())
+		{
+			LOGW("Scene snapshot `{}` uses model `{}` which isn't loaded.", path, reader.GetString(name).value_or(""));
+			return false;
+		}
+		assets.push_back(&references.m_models[idx.value()].second);
+	}
+
+	auto material_names = reader.GetVector<SceneSnapshotString>(Type::MATERIAL_NAMES);
+	std::vector<MaterialHandle> named_materials;
+	for (auto const & name : material_names)
+	{
+		auto idx = resolve_name(name, references.m_materials);
+		if (!idx.has_value())
+		{
+			LOGW("Scene snapshot `{}` uses material `{}` which isn't loaded.", path, reader.GetString(name).value_or(""));
+			return false;
+		}
+		named_materials.push_back(references.m_materials[idx.value()].second);
+	}
+
+	std::vector<MaterialHandle> materials;
+	for (auto const & material : reader.GetVector<SceneSnapshotMaterial>(Type::MATERIAL_REFERENCES))
+	{
+		if (material.m_name >= 0 && material.m_name < static_cast<std::int32_t>(named_materials.size()))
+		{
+			materials.push_back(named_materials[material.m_name]);
+		}
+		else if (material.m_name < 0 && material.m_asset < assets.size() && material.m_mesh < assets[material.m_asset]->m_mesh_handles.size()
+			&& assets[material.m_asset]->m_mesh_handles[material.m_mesh].m_material_handle.has_value())
+		{
+			materials.push_back(assets[material.m_asset]->m_mesh_handles[material.m_mesh].m_material_handle.value());
+		}
+		else
+		{
+			LOGW("Scene snapshot `{}` doesn't match the materials of the loaded models.", path);
+			return false;
+		}
+	}
+
+	auto model_meshes = reader.GetVector<SceneSnapshotModelMesh>(Type::MODEL_MESHES);
+	std::vector<ModelHandle> models;
+	for (auto const & model : reader.GetVector<SceneSnapshotModel>(Type::MODEL_REFERENCES))
+	{
+		if (model.m_first_mesh > model_meshes.size() || model.m_num_meshes > model_meshes.size() - model.m_first_mesh)
+		{
+			return invalid();
+		}
+
+		ModelHandle model_handle;
+		for (std::uint32_t i = model.m_first_mesh; i < model.m_first_mesh + model.m_num_meshes; i++)
+		{
+			auto const & model_mesh = model_meshes[i];
+			if (model_mesh.m_asset >= assets.size() || model_mesh.m_mesh >= assets[model_mesh.m_asset]->m_mesh_handles.size())
+			{
+				LOGW("Scene snapshot `{}` doesn't match the meshes of the loaded models.", path);
+				return false;
+			}
+
+			auto const & mesh_handle = assets[model_mesh.m_asset]->m_mesh_handles[model_mesh.m_mesh];
+			if (model_mesh.m_lod == SceneSnapshotModelMesh::all_lods)
+			{
+				model_handle.m_mesh_handles.push_back(mesh_handle);
+			}
+			else if (model_mesh.m_lod <= mesh_handle.m_lods.size())
+			{
+				model_handle.m_mesh_handles.push_back(mesh_handle.GetLod(model_mesh.m_lod));
+			}
+			else
+			{
+				LOGW("Scene snapshot `{}` doesn't match the levels of detail of the loaded models.", path);
+				return false;
+			}
+		}
+		models.push_back(std::move(model_handle));
+	}
+
+	auto material_lists = reader.GetVector<std::uint32_t>(Type::MATERIAL_LISTS);
+	auto get_materials = [&](std::uint32_t first, std::uint32_t count) -> std::optional<std::vector<MaterialHandle>>
+	{
+		if (first > material_lists.size() || count > material_lists.size() - first)
+		{
+			return std::nullopt;
+		}
+
+		std::vector<MaterialHandle> result;
+		for (std::uint32_t i = first; i < first + count; i++)
+		{
+			if (material_lists[i] >= materials.size())
+			{
+				return std::nullopt;
+			}
+			result.push_back(materials[material_lists[i]]);
+		}
+
+		return result;
+	};
+
+	auto mesh_components = reader.GetVector<SceneSnapshotMeshComponent>(Type::MESH_COMPONENTS);
+	std::vector<std::vector<MaterialHandle>> mesh_materials;
+	for (auto const & mesh_component : mesh_components)
+	{
+		auto mesh_material_handles = get_materials(mesh_component.m_first_material, mesh_component.m_num_materials);
+		if (mesh_component.m_model >= models.size() || !mesh_material_handles.has_value())
+		{
+			return invalid();
+		}
+		mesh_materials.push_back(std::move(mesh_material_handles.value()));
+	}
+
+	auto snapshot_batches = reader.GetVector<SceneSnapshotBatch>(Type::BATCHES);
+	auto batch_nodes = reader.GetVector<NodeHandle>(Type::BATCH_NODES);
+	std::vector<std::vector<MaterialHandle>> batch_materials;
+	std::size_t num_pages = 0;
+	for (auto const & batch : snapshot_batches)
+	{
+		auto batch_material_handles = get_materials(batch.m_first_material, batch.m_num_materials);
+		if (batch.m_model >= models.size() || !batch_material_handles.has_value() || batch.m_num_meshes == 0
+			|| batch.m_first_node > batch_nodes.size() || batch.m_num_meshes > batch_nodes.size() - batch.m_first_node)
+		{
+			return invalid();
+		}
+		batch_materials.push_back(std::move(batch_material_handles.value()));
+		num_pages += (batch.m_num_meshes + gfx::settings::instances_per_page - 1) / gfx::settings::instances_per_page;
+	}
+
+	if (num_pages > gfx::settings::max_instance_pages)
+	{
+		LOGW("Scene snapshot `{}` needs {} instance pages, only {} are available.", path, num_pages, gfx::settings::max_instance_pages);
+		return false;
+	}
+
+	auto named_nodes = reader.GetVector<SceneSnapshotNamedNode>(Type::NAMED_NODES);
+	std::vector<NodeHandle> named_node_handles;
+	for (auto const & [name, node_handle] : references.m_nodes)
+	{
+		auto it = std::find_if(named_nodes.begin(), named_nodes.end(), [&](auto const & named_node) { return reader.GetString(named_node.m_name) == name; });
+		if (it == named_nodes.end())
+		{
+			LOGW("Scene snapshot `{}` doesn't contain node `{}`.", path, name);
+			return false;
+		}
+		named_node_handles.push_back(it->m_node_handle);
+	}
+
+	// Nodes
+	m_nodes = std::move(nodes);
+	reader.Read(Type::NODE_GENERATIONS, m_node_generations);
+	reader.Read(Type::NODE_HANDLE_POSITIONS, m_node_handle_positions);
+	reader.Read(Type::FREE_NODES, m_free_nodes);
+	reader.Read(Type::NODE_HANDLES, m_node_handles);
+	reader.Read(Type::MESH_NODE_HANDLES, m_mesh_node_handles);
+	reader.Read(Type::CAMERA_NODE_HANDLES, m_camera_node_handles);
+	reader.Read(Type::LIGHT_NODE_HANDLES, m_light_node_handles);
+
+	// Transform component
+	reader.Read(Type::POSITIONS, m_positions);
+	reader.Read(Type::ROTATIONS, m_rotations);
+	reader.Read(Type::SCALES, m_scales);
+	reader.Read(Type::MODELS, m_models);
+	reader.Read(Type::REQUIRES_UPDATE, m_requires_update);
+	reader.Read(Type::PARENTS, m_parents);
+	reader.Read(Type::LOCAL_TRANSFORMS, m_local_transforms);
+	reader.Read(Type::TRANSFORM_ORDER, m_transform_order);
+	reader.Read(Type::TRANSFORM_ORDER_INDEX, m_transform_order_index);
+	reader.Read(Type::DIRTY_TRANSFORMS, m_dirty_transforms);
+	RebuildTransformLinks();
+	m_world_dirty.assign(m_positions.size(), false);
+	m_num_parented_transforms = std::count_if(m_parents.begin(), m_parents.end(), [](auto const & parent) { return parent.m_value != -1; });
+	m_transform_order_dirty = false;
+
+	// Mesh component. The instance pages are new, so every mesh gets written again.
+	reader.Read(Type::BATCH_SLOTS, m_batch_slots);
+	reader.Read(Type::LOCAL_BOUNDS, m_local_bounds);
+	reader.Read(Type::MESHES_REQUIRE_BATCHING, m_meshes_require_batching);
+	for (std::size_t i = 0; i < mesh_components.size(); i++)
+	{
+		auto node_handle = mesh_components[i].m_node_handle;
+		auto const & node = m_nodes[internal::GetNodeIndex(node_handle)];
+
+		m_model_handles.emplace_back(ComponentData<ModelHandle>(models[mesh_components[i].m_model], node_handle));
+		m_model_material_handles.emplace_back(ComponentData<std::vector<MaterialHandle>>(std::move(mesh_materials[i]), node_handle));
+		m_requires_buffer_update.PushBack(true);
+
+		if (!restore_culling_tree)
+		{
+			auto proxy = m_culling_tree.CreateProxy(TransformAABB(m_local_bounds[i].m_value, m_models[node.m_transform_component].m_value), static_cast<std::uint32_t>(i));
+			m_cull_proxies.emplace_back(ComponentData<std::int32_t>(proxy, node_handle));
+		}
+	}
+
+	if (restore_culling_tree)
+	{
+		m_cull_proxies = std::move(cull_proxies);
+		m_culling_tree.m_nodes = std::move(culling_tree_nodes);
+		m_culling_tree.m_root = culling_tree.m_root;
+		m_culling_tree.m_free_list = culling_tree.m_free_list;
+		m_culling_tree.m_num_proxies = culling_tree.m_num_proxies;
+	}
+
+	for (std::size_t i = 0; i < snapshot_batches.size(); i++)
+	{
+		auto const & snapshot_batch = snapshot_batches[i];
+
+		RenderBatch batch;
+		batch.m_num_meshes = snapshot_batch.m_num_meshes;
+		batch.m_model_handle = models[snapshot_batch.m_model];
+		batch.m_material_handles = std::move(batch_materials[i]);
+		batch.m_nodes.assign(batch_nodes.begin() + snapshot_batch.m_first_node, batch_nodes.begin() + snapshot_batch.m_first_node + snapshot_batch.m_num_meshes);
+		for (std::uint32_t first = 0; first < batch.m_num_meshes; first += gfx::settings::instances_per_page)
+		{
+			batch.m_pages.push_back(m_per_object_buffer_pool->Allocate(sizeof(Matrix3x4) * gfx::settings::instances_per_page));
+			m_num_instance_pages++;
+		}
+
+		m_batches_by_key[internal::BatchKey{ batch.m_model_handle, batch.m_material_handles }] = static_cast<std::uint32_t>(i);
+		m_render_batches.push_back(std::move(batch));
+	}
+
+	// Camera component
+	reader.Read(Type::LENS_PROPERTIES, m_camera_lens_properties);
+	reader.Read(Type::ASPECT_RATIOS, m_camera_aspect_ratios);
+	reader.Read(Type::VIEW_PROJECTIONS, m_camera_view_projections);
+	for (auto const & lens_properties : m_camera_lens_properties)
+	{
+		m_camera_cb_handles.emplace_back(ComponentData<ConstantBufferHandle>(
+			m_camera_buffer_pool->Allocate(sizeof(cb::Camera)),
+			lens_properties.m_node_handle
+		));
+		m_inverse_camera_cb_handles.emplace_back(ComponentData<ConstantBufferHandle>(
+			m_inverse_camera_buffer_pool->Allocate(sizeof(cb::RaytracingCamera)),
+			lens_properties.m_node_handle
+		));
+		m_requires_camera_buffer_update.PushBack(true);
+	}
+
+	// Light component. The light count differs from `m_num_lights`, so `Update` writes the light buffer header as well.
+	reader.Read(Type::LIGHT_COLORS, m_colors);
+	reader.Read(Type::LIGHT_TYPES, m_light_types);
+	reader.Read(Type::LIGHT_RADIUS, m_radius);
+	reader.Read(Type::LIGHT_PHYSICAL_SIZE, m_light_physical_size);
+	for (auto const & angles : reader.GetVector<SceneSnapshotLightAngles>(Type::LIGHT_ANGLES))
+	{
+		m_light_angles.emplace_back(ComponentData<std::pair<float, float>>{ { angles.m_inner, angles.m_outer }, angles.m_node_handle });
+		m_requires_light_buffer_update.PushBack(true);
+	}
+
+	for (std::size_t i = 0; i < named_node_handles.size(); i++)
+	{
+		references.m_nodes[i].second = named_node_handles[i];
+	}
+
+	return true;
+}
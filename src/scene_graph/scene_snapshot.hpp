@@ -0,0 +1,178 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+	Binary scene snapshot.
+
+	A snapshot contains the state of a `SceneGraph` so a scene can be restored without building it again:
+
+	| SceneSnapshotHeader
+	| sections aligned to `scene_snapshot::alignment`, located with `SceneSnapshotHeader::m_sections`
+
+	Most sections are component arrays stored exactly like they are in memory, so loading them is a single memcpy each.
+	Models, materials and GPU buffers can't be stored. Models and materials are stored as references to the named assets
+	of `SnapshotReferences` and buffers are allocated again on load. Node handles stay the same.
+*/
+
+struct SceneSnapshotSection
+{
+	std::uint64_t m_offset;
+	std::uint64_t m_size; // In bytes.
+};
+
+enum class SceneSnapshotSectionType : std::uint32_t
+{
+	// Nodes
+	NODES,
+	NODE_GENERATIONS,
+	NODE_HANDLE_POSITIONS,
+	FREE_NODES,
+	NODE_HANDLES,
+	MESH_NODE_HANDLES,
+	CAMERA_NODE_HANDLES,
+	LIGHT_NODE_HANDLES,
+	NAMED_NODES, // SceneSnapshotNamedNode
+
+	// Transform component
+	POSITIONS,
+	ROTATIONS,
+	SCALES,
+	MODELS,
+	REQUIRES_UPDATE,
+	PARENTS, // The child lists are rebuilt from the parents.
+	LOCAL_TRANSFORMS,
+	TRANSFORM_ORDER,
+	TRANSFORM_ORDER_INDEX,
+	DIRTY_TRANSFORMS,
+
+	// Mesh component
+	MESH_COMPONENTS, // SceneSnapshotMeshComponent
+	BATCH_SLOTS,
+	LOCAL_BOUNDS,
+	MESHES_REQUIRE_BATCHING,
+	CULL_PROXIES,
+	CULLING_TREE, // A single SceneSnapshotCullingTree
+	CULLING_TREE_NODES,
+	BATCHES, // SceneSnapshotBatch
+	BATCH_NODES,
+
+	// Camera component
+	LENS_PROPERTIES,
+	ASPECT_RATIOS,
+	VIEW_PROJECTIONS,
+
+	// Light component
+	LIGHT_COLORS,
+	LIGHT_TYPES,
+	LIGHT_RADIUS,
+	LIGHT_PHYSICAL_SIZE,
+	LIGHT_ANGLES, // SceneSnapshotLightAngles
+
+	// References
+	ASSET_NAMES, // SceneSnapshotString, one per referenced model asset.
+	MATERIAL_NAMES, // SceneSnapshotString, one per referenced named material.
+	MODEL_REFERENCES, // SceneSnapshotModel
+	MODEL_MESHES, // SceneSnapshotModelMesh
+	MATERIAL_REFERENCES, // SceneSnapshotMaterial
+	MATERIAL_LISTS, // std::uint32_t indices into `MATERIAL_REFERENCES`.
+	STRINGS,
+
+	COUNT
+};
+
+struct SceneSnapshotHeader
+{
+	std::uint32_t m_magic;
+	std::uint32_t m_version;
+	std::uint32_t m_node_index_bits;
+	std::uint32_t m_instances_per_page;
+	std::uint32_t m_scene_version; // `SnapshotReferences::m_scene_version`
+	std::uint64_t m_references_hash; // Identifies the referenced models and materials, see `SaveSnapshot`.
+	SceneSnapshotSection m_sections[static_cast<std::size_t>(SceneSnapshotSectionType::COUNT)];
+};
+
+//! Characters in the `STRINGS` section.
+struct SceneSnapshotString
+{
+	std::uint32_t m_offset;
+	std::uint32_t m_size;
+};
+
+struct SceneSnapshotNamedNode
+{
+	SceneSnapshotString m_name;
+	std::uint32_t m_node_handle;
+};
+
+//! A model made out of meshes of the referenced assets. Its meshes are `MODEL_MESHES[m_first_mesh]` and up.
+struct SceneSnapshotModel
+{
+	std::uint32_t m_first_mesh;
+	std::uint32_t m_num_meshes;
+};
+
+struct SceneSnapshotModelMesh
+{
+	static inline const std::uint32_t all_lods = ~0u;
+
+	std::uint32_t m_asset;
+	std::uint32_t m_mesh; // Index into `ModelHandle::m_mesh_handles` of the asset.
+	std::uint32_t m_lod; // `MeshHandle::GetLod(m_lod)` or `all_lods` for the mesh as it is.
+};
+
+//! Either a named material or the material of a mesh of a model asset.
+struct SceneSnapshotMaterial
+{
+	std::int32_t m_name; // Index into `MATERIAL_NAMES` or -1.
+	std::uint32_t m_asset;
+	std::uint32_t m_mesh;
+};
+
+struct SceneSnapshotMeshComponent
+{
+	std::uint32_t m_node_handle;
+	std::uint32_t m_model;
+	std::uint32_t m_first_material; // Index into `MATERIAL_LISTS`.
+	std::uint32_t m_num_materials;
+};
+
+struct SceneSnapshotBatch
+{
+	std::uint32_t m_model;
+	std::uint32_t m_first_material; // Index into `MATERIAL_LISTS`.
+	std::uint32_t m_num_materials;
+	std::uint32_t m_first_node; // Index into `BATCH_NODES`.
+	std::uint32_t m_num_meshes;
+};
+
+struct SceneSnapshotCullingTree
+{
+	std::int32_t m_root;
+	std::int32_t m_free_list;
+	std::uint64_t m_num_proxies;
+	float m_margin; // The tree gets build again when the margin changed.
+};
+
+struct SceneSnapshotLightAngles
+{
+	std::uint32_t m_node_handle;
+	float m_inner;
+	float m_outer;
+};
+
+namespace scene_snapshot
+{
+
+	static inline const std::uint32_t magic = 0x53534B53; // "SKSS"
+	static inline const std::uint32_t version = 3; // Increment when the layout or any of the stored component types change.
+	static inline const std::size_t alignment = 16;
+
+} /* scene_snapshot */
@@ -0,0 +1,231 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include "transform_kernel.hpp"
+
+#include <cmath>
+#define GLM_FORCE_RADIANS
+#include <gtc/quaternion.hpp>
+
+#ifdef SG_TRANSFORM_KERNEL_SSE
+#include <emmintrin.h>
+#endif
+
+namespace internal
+{
+
+	// Cody-Waite reduction of pi/2 and the minimax polynomials of the Cephes sinf/cosf implementation.
+	constexpr float two_over_pi = 0.636619772367581343f;
+	constexpr float half_pi_a = 1.5703125f;
+	constexpr float half_pi_b = 4.837512969970703125e-4f;
+	constexpr float half_pi_c = 7.54978995489188216e-8f;
+	constexpr float sin_c1 = -1.6666654611e-1f;
+	constexpr float sin_c2 = 8.3321608736e-3f;
+	constexpr float sin_c3 = -1.9515295891e-4f;
+	constexpr float cos_c1 = 4.166664568298827e-2f;
+	constexpr float cos_c2 = -1.388731625493765e-3f;
+	constexpr float cos_c3 = 2.443315711809948e-5f;
+
+	inline void SinCos(float x, float& out_sin, float& out_cos)
+	{
+		auto quadrant = static_cast<std::int32_t>(std::nearbyint(x * two_over_pi));
+		float q = float(quadrant);
+		float r = ((x - q * half_pi_a) - q * half_pi_b) - q * half_pi_c;
+		float r2 = r * r;
+
+		float s = r + r * r2 * (sin_c1 + r2 * (sin_c2 + r2 * sin_c3));
+		float c = 1.f - 0.5f * r2 + r2 * r2 * (cos_c1 + r2 * (cos_c2 + r2 * cos_c3));
+
+		out_sin = (quadrant & 1) ? c : s;
+		out_cos = (quadrant & 1) ? s : c;
+		if (quadrant & 2) out_sin = -out_sin;
+		if ((quadrant + 1) & 2) out_cos = -out_cos;
+	}
+
+	//! Same math as `glm::mat3_cast(glm::quat(euler))` with the scale applied to the columns and the translation appended.
+	inline void ComposeTransform(float px, float py, float pz, float rx, float ry, float rz, float sx, float sy, float sz, sg::Matrix3x4& out)
+	{
+		float sin_x, cos_x, sin_y, cos_y, sin_z, cos_z;
+		SinCos(rx * 0.5f, sin_x, cos_x);
+		SinCos(ry * 0.5f, sin_y, cos_y);
+		SinCos(rz * 0.5f, sin_z, cos_z);
+
+		float qw = cos_x * cos_y * cos_z + sin_x * sin_y * sin_z;
+		float qx = sin_x * cos_y * cos_z - cos_x * sin_y * sin_z;
+		float qy = cos_x * sin_y * cos_z + sin_x * cos_y * sin_z;
+		float qz = cos_x * cos_y * sin_z - sin_x * sin_y * cos_z;
+
+		float xx = qx * qx, yy = qy * qy, zz = qz * qz;
+		float xy = qx * qy, xz = qx * qz, yz = qy * qz;
+		float wx = qw * qx, wy = qw * qy, wz = qw * qz;
+
+		out.m_rows[0][0] = (1.f - 2.f * (yy + zz)) * sx;
+		out.m_rows[0][1] = (2.f * (xy - wz)) * sy;
+		out.m_rows[0][2] = (2.f * (xz + wy)) * sz;
+		out.m_rows[0][3] = px;
+
+		out.m_rows[1][0] = (2.f * (xy + wz)) * sx;
+		out.m_rows[1][1] = (1.f - 2.f * (xx + zz)) * sy;
+		out.m_rows[1][2] = (2.f * (yz - wx)) * sz;
+		out.m_rows[1][3] = py;
+
+		out.m_rows[2][0] = (2.f * (xz - wy)) * sx;
+		out.m_rows[2][1] = (2.f * (yz + wx)) * sy;
+		out.m_rows[2][2] = (1.f - 2.f * (xx + yy)) * sz;
+		out.m_rows[2][3] = pz;
+	}
+
+#ifdef SG_TRANSFORM_KERNEL_SSE
+	inline void SinCos(__m128 x, __m128& out_sin, __m128& out_cos)
+	{
+		// Rounds to nearest with the default rounding mode.
+		__m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(two_over_pi)));
+		__m128 q = _mm_cvtepi32_ps(quadrant);
+
+		__m128 r = _mm_sub_ps(x, _mm_mul_ps(q, _mm_set1_ps(half_pi_a)));
+		r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(half_pi_b)));
+		r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(half_pi_c)));
+		__m128 r2 = _mm_mul_ps(r, r);
+
+		__m128 s = _mm_add_ps(_mm_mul_ps(r2, _mm_set1_ps(sin_c3)), _mm_set1_ps(sin_c2));
+		s = _mm_add_ps(_mm_mul_ps(r2, s), _mm_set1_ps(sin_c1));
+		s = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, r2), s));
+
+		__m128 c = _mm_add_ps(_mm_mul_ps(r2, _mm_set1_ps(cos_c3)), _mm_set1_ps(cos_c2));
+		c = _mm_add_ps(_mm_mul_ps(r2, c), _mm_set1_ps(cos_c1));
+		c = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.f), _mm_mul_ps(r2, _mm_set1_ps(0.5f))), _mm_mul_ps(_mm_mul_ps(r2, r2), c));
+
+		__m128i one = _mm_set1_epi32(1);
+		__m128i two = _mm_set1_epi32(2);
+		__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, one), one));
+		__m128 sin_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, two), 30));
+		__m128 cos_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, one), two), 30));
+
+		out_sin = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s)), sin_sign);
+		out_cos = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c)), cos_sign);
+	}
+
+	//! Composes 4 consecutive transforms starting at `idx`.
+	inline void ComposeTransforms4(sg::TransformSoA const & in, std::size_t idx, sg::Matrix3x4* out)
+	{
+		auto load = [idx](std::vector<float> const & v) { return _mm_loadu_ps(v.data() + idx); };
+		__m128 half = _mm_set1_ps(0.5f);
+		__m128 one = _mm_set1_ps(1.f);
+		__m128 two = _mm_set1_ps(2.f);
+
+		__m128 sin_x, cos_x, sin_y, cos_y, sin_z, cos_z;
+		SinCos(_mm_mul_ps(load(in.m_rotation_x), half), sin_x, cos_x);
+		SinCos(_mm_mul_ps(load(in.m_rotation_y), half), sin_y, cos_y);
+		SinCos(_mm_mul_ps(load(in.m_rotation_z), half), sin_z, cos_z);
+
+		__m128 cc = _mm_mul_ps(cos_x, cos_y);
+		__m128 ss = _mm_mul_ps(sin_x, sin_y);
+		__m128 sc = _mm_mul_ps(sin_x, cos_y);
+		__m128 cs = _mm_mul_ps(cos_x, sin_y);
+
+		__m128 qw = _mm_add_ps(_mm_mul_ps(cc, cos_z), _mm_mul_ps(ss, sin_z));
+		__m128 qx = _mm_sub_ps(_mm_mul_ps(sc, cos_z), _mm_mul_ps(cs, sin_z));
+		__m128 qy = _mm_add_ps(_mm_mul_ps(cs, cos_z), _mm_mul_ps(sc, sin_z));
+		__m128 qz = _mm_sub_ps(_mm_mul_ps(cc, sin_z), _mm_mul_ps(ss, cos_z));
+
+		__m128 xx = _mm_mul_ps(qx, qx), yy = _mm_mul_ps(qy, qy), zz = _mm_mul_ps(qz, qz);
+		__m128 xy = _mm_mul_ps(qx, qy), xz = _mm_mul_ps(qx, qz), yz = _mm_mul_ps(qy, qz);
+		__m128 wx = _mm_mul_ps(qw, qx), wy = _mm_mul_ps(qw, qy), wz = _mm_mul_ps(qw, qz);
+
+		__m128 sx = load(in.m_scale_x);
+		__m128 sy = load(in.m_scale_y);
+		__m128 sz = load(in.m_scale_z);
+
+		__m128 row0[4] = {
+			_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx),
+			_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy),
+			_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz),
+			load(in.m_position_x)
+		};
+		__m128 row1[4] = {
+			_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx),
+			_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy),
+			_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz),
+			load(in.m_position_y)
+		};
+		__m128 row2[4] = {
+			_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx),
+			_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy),
+			_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz),
+			load(in.m_position_z)
+		};
+
+		// Lanes hold different transforms. Transpose so every register holds one row of one transform.
+		_MM_TRANSPOSE4_PS(row0[0], row0[1], row0[2], row0[3]);
+		_MM_TRANSPOSE4_PS(row1[0], row1[1], row1[2], row1[3]);
+		_MM_TRANSPOSE4_PS(row2[0], row2[1], row2[2], row2[3]);
+
+		for (auto k = 0; k < 4; k++)
+		{
+			_mm_storeu_ps(out[k].m_rows[0], row0[k]);
+			_mm_storeu_ps(out[k].m_rows[1], row1[k]);
+			_mm_storeu_ps(out[k].m_rows[2], row2[k]);
+		}
+	}
+#endif
+
+} /* internal */
+
+void sg::TransformSoA::Resize(std::size_t size)
+{
+	for (auto v : { &m_position_x, &m_position_y, &m_position_z, &m_rotation_x, &m_rotation_y, &m_rotation_z, &m_scale_x, &m_scale_y, &m_scale_z })
+	{
+		v->resize(size);
+	}
+}
+
+void sg::TransformSoA::Set(std::size_t idx, glm::vec3 const & position, glm::vec3 const & rotation, glm::vec3 const & scale)
+{
+	m_position_x[idx] = position.x;
+	m_position_y[idx] = position.y;
+	m_position_z[idx] = position.z;
+	m_rotation_x[idx] = rotation.x;
+	m_rotation_y[idx] = rotation.y;
+	m_rotation_z[idx] = rotation.z;
+	m_scale_x[idx] = scale.x;
+	m_scale_y[idx] = scale.y;
+	m_scale_z[idx] = scale.z;
+}
+
+void sg::ComposeTransforms(TransformSoA const & transforms, std::size_t begin, std::size_t end, Matrix3x4* out)
+{
+	auto i = begin;
+
+#ifdef SG_TRANSFORM_KERNEL_SSE
+	for (; i + 4 <= end; i += 4)
+	{
+		internal::ComposeTransforms4(transforms, i, out + i);
+	}
+#endif
+
+	for (; i < end; i++)
+	{
+		internal::ComposeTransform(transforms.m_position_x[i], transforms.m_position_y[i], transforms.m_position_z[i],
+			transforms.m_rotation_x[i], transforms.m_rotation_y[i], transforms.m_rotation_z[i],
+			transforms.m_scale_x[i], transforms.m_scale_y[i], transforms.m_scale_z[i],
+			out[i]);
+	}
+}
+
+glm::mat4 sg::ComposeTransformReference(glm::vec3 const & position, glm::vec3 const & rotation, glm::vec3 const & scale)
+{
+	glm::mat4 model = glm::mat4(scale.x, 0, 0, 0,
+	                            0, scale.y, 0, 0,
+	                            0, 0, scale.z, 0,
+	                            0, 0, 0, 1);
+
+	model = glm::mat4_cast(glm::quat(rotation)) * model;
+
+	return glm::mat4(1, 0, 0, 0,
+	                 0, 1, 0, 0,
+	                 0, 0, 1, 0,
+	                 position.x, position.y, position.z, 1) * model;
+}
@@ -0,0 +1,73 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SG_TRANSFORM_KERNEL_SSE
+#endif
+
+namespace sg
+{
+
+	//! Affine transform stored as the first three rows of a 4x4 matrix. The last column holds the translation.
+	struct Matrix3x4
+	{
+		float m_rows[3][4];
+	};
+
+	//! Structure of arrays input of `ComposeTransforms`.
+	/*!
+		Rotations are euler angles in radians, interpreted the same way as `glm::quat(glm::vec3)`.
+	*/
+	struct TransformSoA
+	{
+		std::vector<float> m_position_x, m_position_y, m_position_z;
+		std::vector<float> m_rotation_x, m_rotation_y, m_rotation_z;
+		std::vector<float> m_scale_x, m_scale_y, m_scale_z;
+
+		void Resize(std::size_t size);
+		void Set(std::size_t idx, glm::vec3 const & position, glm::vec3 const & rotation, glm::vec3 const & scale);
+	};
+
+	//! Composes `translation * rotation * scale` of the entries in `[begin, end)` into `out[begin, end)`.
+	/*!
+		Processes 4 transforms at a time with SSE when available. Sine and cosine use a polynomial approximation
+		with a maximum error of about 1e-7 for angles up to a few thousand radians.
+	*/
+	void ComposeTransforms(TransformSoA const & transforms, std::size_t begin, std::size_t end, Matrix3x4* out);
+
+	//! Reference implementation of a single transform. Matches the math the scene graph used before `ComposeTransforms`.
+	glm::mat4 ComposeTransformReference(glm::vec3 const & position, glm::vec3 const & rotation, glm::vec3 const & scale);
+
+	inline glm::mat4 ToMat4(Matrix3x4 const & m)
+	{
+		return glm::mat4(m.m_rows[0][0], m.m_rows[1][0], m.m_rows[2][0], 0,
+		                 m.m_rows[0][1], m.m_rows[1][1], m.m_rows[2][1], 0,
+		                 m.m_rows[0][2], m.m_rows[1][2], m.m_rows[2][2], 0,
+		                 m.m_rows[0][3], m.m_rows[1][3], m.m_rows[2][3], 1);
+	}
+
+	//! Drops the last row of an affine matrix. This is the layout the shaders read instance data in.
+	inline Matrix3x4 ToMatrix3x4(glm::mat4 const & m)
+	{
+		Matrix3x4 retval;
+		for (auto r = 0; r < 3; r++)
+		{
+			for (auto c = 0; c < 4; c++)
+			{
+				retval.m_rows[r][c] = m[c][r];
+			}
+		}
+
+		return retval;
+	}
+
+} /* sg */
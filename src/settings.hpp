@@ -18,5 +18,23 @@ namespace settings
 	static const std::optional<float> m_imgui_font_size = 13;
 	static const bool use_multithreading = false;
 	static const std::uint32_t num_frame_graph_threads = 4;
+	static const bool alias_transient_render_targets = true; // Let transient render targets of a frame graph share memory when their lifetimes don't overlap.
+	static const bool use_parallel_model_loading = true;
+	static const std::uint32_t num_model_loading_threads = 0; // 0 uses all hardware threads.
+	static const std::uint32_t model_loading_chunk_size = 262144; // Meshes with more triangles get their meshlets build in chunks of this many triangles.
+	static const bool optimize_meshes = true; // Vertex cache, overdraw and vertex fetch optimization before meshlets are build.
+	static const std::uint32_t num_mesh_lods = 3; // Simplified levels generated per mesh on top of the original. 0 disables LOD generation. See `ModelHandle::SelectLod`.
+	static const float mesh_lod_reduction = 0.5f; // Triangle count of a level relative to the previous level.
+	static const float mesh_lod_max_error = 0.05f; // Maximum simplification error relative to the size of the mesh.
+	static const bool preserve_model_hierarchy = false; // Load the node hierarchy of models instead of baking it into the vertices. See `sg::helper::CreateModelHierarchy`.
+	static const bool use_model_cache = true;
+	static const char* model_cache_directory = "cache/";
+	static const bool use_parallel_transform_update = true;
+	static const std::uint32_t num_transform_update_threads = 0; // 0 uses all hardware threads.
+	static const std::uint32_t transform_update_chunk_size = 4096; // Dirty transforms per task. Smaller updates run on the calling thread.
+	static const bool use_frustum_culling = true; // Cull instances on the CPU before they are drawn. See `sg::SceneGraph::CullInstances`.
+	static const float culling_aabb_margin = 0.1f; // Movement allowed before a mesh gets reinserted in the culling tree.
+	static const bool use_scene_snapshots = true; // Restore scenes from a binary snapshot instead of building them. Snapshots of an older scene version or of changed models are rebuilt.
+	static const char* scene_snapshot_directory = "cache/";
 
 } /* settings */
@@ -14,9 +14,7 @@ layout(location = 3) out vec3 g_tangent;
 layout(location = 4) out vec3 g_bitangent;
 
 // Uniforms
-layout(set = 1, binding = 1) uniform UniformBufferObject {
-    mat4 model[100];
-} ubo;
+#include "instance_data.glsl"
 
 layout(set = 0, binding = 0) uniform UniformBufferCameraObject {
     mat4 view;
@@ -25,7 +23,7 @@ layout(set = 0, binding = 0) uniform UniformBufferCameraObject {
 
 void main()
 {
-    mat4 model = ubo.model[gl_InstanceIndex];
+    mat4 model = LoadInstanceModel(gl_InstanceIndex);
     g_tangent = normalize(model * vec4(tangent, 0)).xyz;
     g_bitangent = normalize(model * vec4(bitangent, 0)).xyz;
     g_normal = normalize(model * vec4(normal, 0)).xyz;
@@ -0,0 +1,15 @@
+#ifndef INSTANCE_DATA_GLSL
+#define INSTANCE_DATA_GLSL
+
+// One page of a render batch. Every instance is a row major 3x4 model matrix (`sg::Matrix3x4`).
+layout(set = 1, binding = 1) readonly buffer InstanceBufferObject {
+    vec4 rows[];
+} instances;
+
+mat4 LoadInstanceModel(uint instance_id)
+{
+    uint base = instance_id * 3;
+    return transpose(mat4(instances.rows[base], instances.rows[base + 1], instances.rows[base + 2], vec4(0, 0, 0, 1)));
+}
+
+#endif // INSTANCE_DATA_GLSL
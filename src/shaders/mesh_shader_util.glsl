@@ -7,7 +7,7 @@
 
 #define GROUP_SIZE 32
 #define NVMESHLET_VERTEX_COUNT      64
-#define NVMESHLET_PRIMITIVE_COUNT   21
+#define NVMESHLET_PRIMITIVE_COUNT   126
 #define NVMESHLET_PRIM_ALIGNMENT        1
 #define NVMESHLET_VERTEX_ALIGNMENT      16
 
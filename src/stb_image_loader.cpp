@@ -38,6 +38,7 @@ STBImageLoader::AnonResource STBImageLoader::LoadFromDisc(std::string const & pa
 	texture->m_height = static_cast<std::uint32_t>(height);
 	texture->m_channels = static_cast<std::uint32_t>(channels);
 	texture->m_is_hdr = false;
+	texture->m_path = path;
 
 	return texture;
 }
@@ -67,6 +68,7 @@ STBHDRImageLoader::AnonResource STBHDRImageLoader::LoadFromDisc(std::string cons
 	texture->m_height = static_cast<std::uint32_t>(height);
 	texture->m_channels = static_cast<std::uint32_t>(channels);
 	texture->m_is_hdr = true;
+	texture->m_path = path;
 
 	return texture;
 }
@@ -17,10 +17,13 @@
 #include <vec2.hpp>
 #include <gtc/quaternion.hpp>
 #include <gtc/matrix_transform.hpp>
+#include <optional>
+#include <unordered_map>
 #include <utility>
 
 #include <gtx/matrix_decompose.hpp>
 
+#include "settings.hpp"
 #include "util/log.hpp"
 #include "resource_structs.hpp"
 
@@ -187,14 +190,10 @@ inline void LoadMaterial(ModelData* model, tinygltf::Model tg_model, tinygltf::M
 	model->m_materials.push_back(mat_data);
 }
 
-inline void LoadMesh(ModelData* model, tinygltf::Model const & tg_model, tinygltf::Node const & node, glm::mat4 parent_transform)
+//! Adds every primitive of the mesh as a separate mesh. Positions are only transformed when `transform` is set.
+inline void LoadMesh(ModelData* model, tinygltf::Model const & tg_model, int mesh_id, std::optional<glm::mat4> transform)
 {
-	auto mesh = tg_model.meshes[node.mesh];
-
-	auto translation = node.translation;
-	auto rotation = node.rotation;
-	auto scale = node.scale;
-	auto matrix = node.matrix;
+	auto mesh = tg_model.meshes[mesh_id];
 
 	for (auto const & primitive : mesh.primitives)
 	{
@@ -263,9 +262,12 @@ inline void LoadMesh(ModelData* model, tinygltf::Model const & tg_model, tinyglt
 		}
 
 		// Apply Transformation
-		for (auto& position : mesh_data.m_positions)
+		if (transform.has_value())
 		{
-			position = parent_transform * glm::vec4(position, 1);
+			for (auto& position : mesh_data.m_positions)
+			{
+				position = transform.value() * glm::vec4(position, 1);
+			}
 		}
 
 		auto tangent_bitangent = ComputeTangents(mesh_data);
@@ -278,6 +280,89 @@ inline void LoadMesh(ModelData* model, tinygltf::Model const & tg_model, tinyglt
 	}
 }
 
+//! Local transform of a glTF node as translation, euler angles and scale.
+inline void GetNodeTransform(tinygltf::Node const & node, ModelNodeData& node_data)
+{
+	glm::quat orientation = glm::quat(1, 0, 0, 0);
+
+	if (node.matrix.size() == 16)
+	{
+		glm::mat4 matrix;
+		for (auto i = 0; i < 16; i++)
+		{
+			matrix[i / 4][i % 4] = static_cast<float>(node.matrix[i]);
+		}
+
+		glm::vec3 skew;
+		glm::vec4 perspective;
+		glm::decompose(matrix, node_data.m_scale, orientation, node_data.m_position, skew, perspective);
+	}
+	else
+	{
+		if (node.translation.size() == 3)
+		{
+			node_data.m_position = { (float)node.translation[0], (float)node.translation[1], (float)node.translation[2] };
+		}
+		if (node.rotation.size() == 4)
+		{
+			orientation = glm::quat((float)node.rotation[3], (float)node.rotation[0], (float)node.rotation[1], (float)node.rotation[2]);
+		}
+		if (node.scale.size() == 3)
+		{
+			node_data.m_scale = { (float)node.scale[0], (float)node.scale[1], (float)node.scale[2] };
+		}
+	}
+
+	node_data.m_rotation = glm::eulerAngles(orientation);
+}
+
+//! Fills `ModelData::m_nodes` with the node hierarchy of the default scene. Meshes are loaded once, no matter how many nodes use them.
+inline void LoadHierarchy(ModelData* model, tinygltf::Model const & tg_model)
+{
+	std::unordered_map<int, std::vector<std::uint32_t>> loaded_meshes; // glTF mesh -> primitives in `model->m_meshes`.
+
+	std::function<void(int, std::int32_t)> add_node = [&](int node_id, std::int32_t parent)
+	{
+		auto const & node = tg_model.nodes[node_id];
+
+		ModelNodeData node_data = {};
+		node_data.m_parent = parent;
+		GetNodeTransform(node, node_data);
+
+		if (node.mesh > -1)
+		{
+			auto it = loaded_meshes.find(node.mesh);
+			if (it == loaded_meshes.end())
+			{
+				auto first_mesh = static_cast<std::uint32_t>(model->m_meshes.size());
+				LoadMesh(model, tg_model, node.mesh, std::nullopt);
+
+				std::vector<std::uint32_t> meshes;
+				for (auto i = first_mesh; i < model->m_meshes.size(); i++)
+				{
+					meshes.push_back(i);
+				}
+				it = loaded_meshes.insert({ node.mesh, meshes }).first;
+			}
+
+			node_data.m_meshes = it->second;
+		}
+
+		auto node_idx = static_cast<std::int32_t>(model->m_nodes.size());
+		model->m_nodes.push_back(node_data);
+
+		for (auto child_id : node.children)
+		{
+			add_node(child_id, node_idx);
+		}
+	};
+
+	for (auto node_id : tg_model.scenes[tg_model.defaultScene].nodes)
+	{
+		add_node(node_id, -1);
+	}
+}
+
 TinyGLTFModelLoader::AnonResource TinyGLTFModelLoader::LoadFromDisc(std::string const & path)
 {
 	tinygltf::Model tg_model;
@@ -390,7 +475,7 @@ TinyGLTFModelLoader::AnonResource TinyGLTFModelLoader::LoadFromDisc(std::string
 
 		if (node.mesh > -1)
 		{
-			LoadMesh(model.get(), tg_model, node, parent_transform);
+			LoadMesh(model.get(), tg_model, node.mesh, parent_transform);
 		}
 
 		for (auto child_id : node.children)
@@ -399,6 +484,12 @@ TinyGLTFModelLoader::AnonResource TinyGLTFModelLoader::LoadFromDisc(std::string
 		}
 	};
 
+	if (settings::preserve_model_hierarchy)
+	{
+		LoadHierarchy(model.get(), tg_model);
+		return model;
+	}
+
 	glm::mat4 parent_transform(1);
 	for (auto node_id : tg_model.scenes[tg_model.defaultScene].nodes)
 	{
@@ -0,0 +1,133 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <vector>
+#include <cstdint>
+
+namespace util
+{
+
+	//! Byte ranges of a buffer that got written since the buffer was last flushed.
+	/*!
+		Writes mark blocks of `granularity` bytes dirty in a bitset, so recording a write is constant time no matter
+		the order writes come in. `GetRanges` turns the runs of dirty blocks into sorted, merged ranges by only
+		scanning the words between the first and last write.
+	*/
+	class DirtyRanges
+	{
+	public:
+		struct Range
+		{
+			std::uint64_t m_offset;
+			std::uint64_t m_size;
+		};
+
+		explicit DirtyRanges(std::uint64_t granularity = 64)
+			: m_granularity(granularity), m_first_word(std::numeric_limits<std::size_t>::max()), m_end_word(0)
+		{
+		}
+
+		void Add(std::uint64_t offset, std::uint64_t size)
+		{
+			if (size == 0) return;
+
+			auto first_block = offset / m_granularity;
+			auto last_block = (offset + size - 1) / m_granularity;
+			if (last_block / 64 >= m_words.size())
+			{
+				m_words.resize(last_block / 64 + 1, 0);
+			}
+
+			m_first_word = std::min<std::size_t>(m_first_word, first_block / 64);
+			m_end_word = std::max<std::size_t>(m_end_word, last_block / 64 + 1);
+			for (auto block = first_block; block <= last_block; block++)
+			{
+				m_words[block / 64] |= std::uint64_t(1) << (block % 64);
+			}
+		}
+
+		//! Returns the dirty blocks as sorted ranges. Adjacent dirty blocks become a single range.
+		std::vector<Range> const & GetRanges()
+		{
+			m_ranges.clear();
+
+			bool in_run = false;
+			std::uint64_t run_start = 0;
+			auto end_run = [&](std::uint64_t block)
+			{
+				m_ranges.push_back({ run_start * m_granularity, (block - run_start) * m_granularity });
+				in_run = false;
+			};
+
+			for (auto word_idx = m_first_word; word_idx < m_end_word; word_idx++)
+			{
+				auto word = m_words[word_idx];
+				std::uint32_t bit = 0;
+				while (bit < 64)
+				{
+					auto bits = word >> bit;
+					if (in_run)
+					{
+						auto ones = static_cast<std::uint32_t>(std::countr_one(bits));
+						if (bit + ones >= 64) break; // The run continues in the next word.
+
+						bit += ones;
+						end_run(word_idx * 64 + bit);
+					}
+					else
+					{
+						if (bits == 0) break;
+
+						bit += static_cast<std::uint32_t>(std::countr_zero(bits));
+						run_start = word_idx * 64 + bit;
+						in_run = true;
+					}
+				}
+			}
+
+			if (in_run)
+			{
+				end_run(m_end_word * 64);
+			}
+
+			return m_ranges;
+		}
+
+		void Clear()
+		{
+			for (auto word_idx = m_first_word; word_idx < m_end_word; word_idx++)
+			{
+				m_words[word_idx] = 0;
+			}
+
+			m_first_word = std::numeric_limits<std::size_t>::max();
+			m_end_word = 0;
+		}
+
+		bool IsEmpty() const
+		{
+			return m_first_word >= m_end_word;
+		}
+
+		std::uint64_t GetGranularity() const
+		{
+			return m_granularity;
+		}
+
+	private:
+		std::uint64_t m_granularity;
+		std::vector<std::uint64_t> m_words; // A bit per block.
+		std::size_t m_first_word;
+		std::size_t m_end_word;
+		std::vector<Range> m_ranges;
+	};
+
+} /* util */
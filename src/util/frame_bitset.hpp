@@ -0,0 +1,113 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <bit>
+#include <vector>
+#include <cstdint>
+
+namespace util
+{
+
+	//! Dirty bit per element for each of `N` frames in flight.
+	/*!
+		Marking a element sets its bit for every frame. Every frame clears its own bits once it updated its copy,
+		so a element stays dirty until all frames caught up. The bits of all frames for 64 elements are stored next to each other.
+	*/
+	template<std::size_t N>
+	class FrameBitset
+	{
+	public:
+		//! Adds a element at the end. New elements are usually dirty since no frame has seen them yet.
+		void PushBack(bool dirty)
+		{
+			if (m_size % 64 == 0)
+			{
+				m_words.resize(m_words.size() + N, 0);
+			}
+
+			m_size++;
+			if (dirty)
+			{
+				MarkDirty(m_size - 1);
+			}
+		}
+
+		//! Moves the bits of the last element to `idx` and removes the last element. Mirrors a swap and pop on the array the bits belong to.
+		void SwapAndPop(std::size_t idx)
+		{
+			auto last = m_size - 1;
+			for (std::size_t frame = 0; frame < N; frame++)
+			{
+				auto dirty = IsDirty(last, frame);
+				Clear(last, frame);
+				Clear(idx, frame);
+				if (dirty && idx != last)
+				{
+					m_words[(idx / 64) * N + frame] |= std::uint64_t(1) << (idx % 64);
+				}
+			}
+
+			m_size--;
+			if (m_size % 64 == 0)
+			{
+				m_words.resize(m_words.size() - N);
+			}
+		}
+
+		std::size_t Size() const
+		{
+			return m_size;
+		}
+
+		void MarkDirty(std::size_t idx)
+		{
+			auto bit = std::uint64_t(1) << (idx % 64);
+			auto words = &m_words[(idx / 64) * N];
+			for (std::size_t frame = 0; frame < N; frame++)
+			{
+				words[frame] |= bit;
+			}
+		}
+
+		bool IsDirty(std::size_t idx, std::size_t frame) const
+		{
+			return m_words[(idx / 64) * N + frame] & (std::uint64_t(1) << (idx % 64));
+		}
+
+		void Clear(std::size_t idx, std::size_t frame)
+		{
+			m_words[(idx / 64) * N + frame] &= ~(std::uint64_t(1) << (idx % 64));
+		}
+
+		//! Calls `func(idx)` for every element that is dirty in `frame` and clears it. Clean ranges are skipped 64 elements at a time.
+		/*!
+			The bits of a word are cleared before `func` is called, so `func` may mark elements dirty again but must not add elements.
+		*/
+		template<typename F>
+		void ConsumeDirty(std::size_t frame, F&& func)
+		{
+			for (std::size_t word_idx = 0; word_idx * N < m_words.size(); word_idx++)
+			{
+				auto& word = m_words[word_idx * N + frame];
+				auto bits = word;
+				word = 0;
+
+				while (bits)
+				{
+					func(word_idx * 64 + std::countr_zero(bits));
+					bits &= bits - 1;
+				}
+			}
+		}
+
+	private:
+		std::vector<std::uint64_t> m_words;
+		std::size_t m_size = 0;
+	};
+
+} /* util */
@@ -0,0 +1,39 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace util
+{
+
+	static inline const std::uint64_t fnv_offset_basis = 14695981039346656037ull;
+	static inline const std::uint64_t fnv_prime = 1099511628211ull;
+
+	//! FNV-1a hash of `size` bytes. Pass the result of a previous call as `hash` to continue hashing.
+	inline std::uint64_t FNV1a(void const * data, std::size_t size, std::uint64_t hash = fnv_offset_basis)
+	{
+		auto bytes = static_cast<std::uint8_t const *>(data);
+		for (std::size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= fnv_prime;
+		}
+		return hash;
+	}
+
+	//! FNV-1a hash of the bytes of a value. Mind the padding of structures.
+	template<typename T>
+	inline std::uint64_t FNV1aValue(T const & value, std::uint64_t hash = fnv_offset_basis)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Only the bytes of the value are hashed.");
+		return FNV1a(&value, sizeof(T), hash);
+	}
+
+} /* util */
@@ -0,0 +1,277 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include "job_system.hpp"
+
+#include <cassert>
+#include <functional>
+
+namespace util
+{
+
+	namespace internal
+	{
+
+		static const std::uint32_t job_mask = max_jobs_per_thread - 1;
+		static const std::uint32_t num_idle_spins = 64; // Failed attempts to find a job before a worker goes to sleep.
+		static const std::uint32_t num_job_probes = 16; // Busy jobs skipped before a job runs inline instead.
+
+		JobDeque::JobDeque()
+			: m_top(0), m_bottom(0), m_jobs(std::make_unique<std::atomic<Job*>[]>(max_jobs_per_thread))
+		{
+		}
+
+		void JobDeque::Push(Job* job)
+		{
+			auto bottom = m_bottom.load(std::memory_order_relaxed);
+			assert(bottom - m_top.load(std::memory_order_acquire) < max_jobs_per_thread);
+
+			m_jobs[bottom & job_mask].store(job, std::memory_order_relaxed);
+			m_bottom.store(bottom + 1, std::memory_order_release);
+		}
+
+		Job* JobDeque::Pop()
+		{
+			auto bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+			m_bottom.store(bottom, std::memory_order_seq_cst);
+			auto top = m_top.load(std::memory_order_seq_cst);
+
+			if (top > bottom)
+			{
+				// Empty.
+				m_bottom.store(bottom + 1, std::memory_order_relaxed);
+				return nullptr;
+			}
+
+			auto job = m_jobs[bottom & job_mask].load(std::memory_order_relaxed);
+			if (top == bottom)
+			{
+				// The last job, race the thieves for it.
+				if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				{
+					job = nullptr;
+				}
+				m_bottom.store(bottom + 1, std::memory_order_relaxed);
+			}
+
+			return job;
+		}
+
+		Job* JobDeque::Steal()
+		{
+			auto top = m_top.load(std::memory_order_seq_cst);
+			auto bottom = m_bottom.load(std::memory_order_seq_cst);
+			if (top >= bottom)
+			{
+				return nullptr;
+			}
+
+			auto job = m_jobs[top & job_mask].load(std::memory_order_relaxed);
+			if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				return nullptr; // Lost to the owner or another thief.
+			}
+
+			return job;
+		}
+
+	} /* internal */
+
+	JobSystem::JobSystem(std::uint32_t num_workers)
+		: m_num_workers(num_workers), m_worker_states(std::make_unique<Worker[]>(num_workers)),
+		m_jobs(std::make_unique<internal::Job[]>((num_workers + 1ull) * internal::max_jobs_per_thread)),
+		m_num_external_jobs(0), m_next_external_job(0), m_stop(false), m_epoch(0), m_num_sleeping(0)
+	{
+		m_workers.reserve(num_workers);
+		for (std::uint32_t i = 0; i < num_workers; i++)
+		{
+			m_workers.emplace_back([this, i] { WorkerLoop(i); });
+		}
+	}
+
+	JobSystem::~JobSystem()
+	{
+		m_stop.store(true);
+		m_epoch.fetch_add(1);
+		m_epoch.notify_all();
+
+		for (auto& worker : m_workers)
+		{
+			worker.join();
+		}
+	}
+
+	void JobSystem::Wait(JobCounter& counter)
+	{
+		while (counter.m_value.load(std::memory_order_acquire) != 0)
+		{
+			if (!TryRunJob())
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	bool JobSystem::TryRunJob()
+	{
+		if (auto job = FindJob())
+		{
+			RunJob(job);
+			return true;
+		}
+
+		return false;
+	}
+
+	std::uint32_t JobSystem::GetNumWorkers() const
+	{
+		return m_num_workers;
+	}
+
+	internal::Job* JobSystem::AllocateJob()
+	{
+		// Jobs are handed out round robin, skipping the ones that didn't finish yet.
+		// Waiting for a busy job instead could wait for a job further up the stack of this thread.
+		auto find_free_job = [this](std::uint32_t first_job, std::uint32_t& next_job) -> internal::Job*
+		{
+			for (std::uint32_t i = 0; i < internal::num_job_probes; i++)
+			{
+				auto& job = m_jobs[first_job + (next_job++ & internal::job_mask)];
+				if (job.m_free.load(std::memory_order_acquire))
+				{
+					job.m_free.store(false, std::memory_order_relaxed);
+					return &job;
+				}
+			}
+
+			return nullptr;
+		};
+
+		if (m_current_system == this)
+		{
+			return find_free_job(m_current_worker * internal::max_jobs_per_thread, m_worker_states[m_current_worker].m_next_job);
+		}
+
+		std::lock_guard<std::mutex> lock(m_external_mutex);
+		return find_free_job(m_num_workers * internal::max_jobs_per_thread, m_next_external_job);
+	}
+
+	void JobSystem::Submit(internal::Job* job)
+	{
+		if (m_current_system == this)
+		{
+			m_worker_states[m_current_worker].m_deque.Push(job);
+		}
+		else
+		{
+			std::lock_guard<std::mutex> lock(m_external_mutex);
+			m_external_queue.push_back(job);
+			m_num_external_jobs.fetch_add(1, std::memory_order_release);
+		}
+
+		m_epoch.fetch_add(1);
+		if (m_num_sleeping.load() > 0)
+		{
+			m_epoch.notify_all();
+		}
+	}
+
+	internal::Job* JobSystem::FindJob()
+	{
+		if (m_current_system == this)
+		{
+			if (auto job = m_worker_states[m_current_worker].m_deque.Pop())
+			{
+				return job;
+			}
+		}
+
+		// Workers take the oldest job like thieves do. Other threads take the newest one like the owner of a deque,
+		// so splitting a range on them stays depth first instead of queueing up every piece.
+		if (m_num_external_jobs.load(std::memory_order_acquire) > 0)
+		{
+			std::lock_guard<std::mutex> lock(m_external_mutex);
+			if (!m_external_queue.empty())
+			{
+				internal::Job* job = nullptr;
+				if (m_current_system == this)
+				{
+					job = m_external_queue.front();
+					m_external_queue.pop_front();
+				}
+				else
+				{
+					job = m_external_queue.back();
+					m_external_queue.pop_back();
+				}
+				m_num_external_jobs.fetch_sub(1, std::memory_order_relaxed);
+				return job;
+			}
+		}
+
+		// Start stealing at a random worker so thieves don't all go after the same one.
+		static thread_local std::uint32_t rng = 0x9e3779b9u ^ static_cast<std::uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id()));
+		rng ^= rng << 13;
+		rng ^= rng >> 17;
+		rng ^= rng << 5;
+
+		for (std::uint32_t i = 0; i < m_num_workers; i++)
+		{
+			auto victim = (rng + i) % m_num_workers;
+			if (m_current_system == this && victim == m_current_worker) continue;
+
+			if (auto job = m_worker_states[victim].m_deque.Steal())
+			{
+				return job;
+			}
+		}
+
+		return nullptr;
+	}
+
+	void JobSystem::RunJob(internal::Job* job)
+	{
+		job->m_func(*job);
+
+		// The counter is the last thing touched. Once it reaches zero the waiting thread may free everything the job referenced.
+		auto counter = job->m_counter;
+		job->m_free.store(true, std::memory_order_release);
+		counter->m_value.fetch_sub(1, std::memory_order_release);
+	}
+
+	void JobSystem::WorkerLoop(std::uint32_t worker_idx)
+	{
+		m_current_system = this;
+		m_current_worker = worker_idx;
+
+		std::uint32_t num_idle = 0;
+		while (!m_stop.load(std::memory_order_relaxed))
+		{
+			if (TryRunJob())
+			{
+				num_idle = 0;
+				continue;
+			}
+
+			if (++num_idle < internal::num_idle_spins)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			// Read the epoch before looking for work one last time, a submit after that changes it and wakes this worker up.
+			m_num_sleeping.fetch_add(1);
+			auto epoch = m_epoch.load();
+			if (!TryRunJob() && !m_stop.load())
+			{
+				m_epoch.wait(epoch);
+			}
+			m_num_sleeping.fetch_sub(1);
+			num_idle = 0;
+		}
+	}
+
+} /* util */
@@ -0,0 +1,242 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
+
+namespace util
+{
+
+	//! Number of unfinished jobs of a group. Pass it to `JobSystem::Run` and wait for it with `JobSystem::Wait`.
+	struct JobCounter
+	{
+		std::atomic<std::uint32_t> m_value = 0;
+	};
+
+	namespace internal
+	{
+
+		static const std::size_t job_storage_size = 80;
+		static const std::uint32_t max_jobs_per_thread = 1024; // Has to be a power of two.
+
+		//! A job with the functor it calls stored inline, so submitting a job doesn't allocate.
+		struct alignas(64) Job
+		{
+			void (*m_func)(Job&) = nullptr; // Calls and destroys the functor.
+			JobCounter* m_counter = nullptr;
+			std::atomic<bool> m_free = true;
+			alignas(std::max_align_t) unsigned char m_storage[job_storage_size];
+		};
+
+		//! Chase-Lev work stealing deque with a fixed capacity.
+		/*!
+			Only the thread owning the deque pushes and pops, at the bottom. Other threads steal the oldest jobs from the top.
+			The jobs in a deque come from the job ring of the same thread, so it can't hold more than `max_jobs_per_thread`.
+		*/
+		class JobDeque
+		{
+		public:
+			JobDeque();
+
+			void Push(Job* job);
+			Job* Pop();
+			Job* Steal();
+
+		private:
+			alignas(64) std::atomic<std::int64_t> m_top;
+			alignas(64) std::atomic<std::int64_t> m_bottom;
+			std::unique_ptr<std::atomic<Job*>[]> m_jobs;
+		};
+
+	} /* internal */
+
+	//! Work stealing job system.
+	/*!
+		Every worker has its own deque. Jobs submitted by a worker go to its own deque and idle workers steal from the others.
+		Jobs submitted by other threads go to a shared queue. Threads waiting for a counter run jobs until it reaches zero
+		instead of blocking, so jobs can wait on the jobs they spawn and the thread starting work helps finishing it.
+		Jobs shouldn't throw.
+	*/
+	class JobSystem
+	{
+	public:
+		//! Starts `num_workers` threads. With 0 workers all jobs run on the threads waiting for them.
+		explicit JobSystem(std::uint32_t num_workers);
+		~JobSystem();
+
+		JobSystem(const JobSystem&) = delete;
+		JobSystem(JobSystem&&) = delete;
+
+		JobSystem& operator=(const JobSystem&) = delete;
+		JobSystem& operator=(JobSystem&&) = delete;
+
+		//! Queues `func` and counts it in `counter` until it finished.
+		/*!
+			`func` gets copied into the job and has to fit in `internal::job_storage_size` bytes. Capture large state by reference.
+			When the jobs of the calling thread are all in flight `func` runs on the calling thread before `Run` returns.
+		*/
+		template<typename F>
+		void Run(F&& func, JobCounter& counter);
+
+		//! Runs jobs until `counter` reaches zero.
+		void Wait(JobCounter& counter);
+
+		//! Runs a single queued job. Returns false when there was nothing to run.
+		/*! Meant for threads waiting on something else than a counter. */
+		bool TryRunJob();
+
+		//! Calls `func(i)` for every index in `[0, count)` with `grain_size` indices per job and returns when all calls finished.
+		template<typename F>
+		void ParallelFor(std::size_t count, std::size_t grain_size, F const & func);
+
+		//! Maps ranges of at most `grain_size` indices with `map(begin, end)` and combines the results with `reduce`.
+		/*! The results are combined in index order on the calling thread, so the result doesn't depend on the scheduling. */
+		template<typename T, typename M, typename R>
+		T ParallelReduce(std::size_t count, std::size_t grain_size, T identity, M const & map, R const & reduce);
+
+		std::uint32_t GetNumWorkers() const;
+
+	private:
+		struct alignas(64) Worker
+		{
+			internal::JobDeque m_deque;
+			std::uint32_t m_next_job = 0;
+		};
+
+		internal::Job* AllocateJob();
+		void Submit(internal::Job* job);
+		internal::Job* FindJob();
+		void RunJob(internal::Job* job);
+		void WorkerLoop(std::uint32_t worker_idx);
+
+		template<typename F>
+		void SplitFor(std::size_t begin, std::size_t end, std::size_t grain_size, F const & func, JobCounter& counter);
+
+		std::uint32_t m_num_workers;
+		std::unique_ptr<Worker[]> m_worker_states;
+		std::vector<std::thread> m_workers;
+		// `max_jobs_per_thread` per worker, followed by the jobs of the other threads.
+		std::unique_ptr<internal::Job[]> m_jobs;
+
+		// Jobs submitted by threads that aren't workers.
+		std::mutex m_external_mutex;
+		std::deque<internal::Job*> m_external_queue;
+		std::atomic<std::uint32_t> m_num_external_jobs;
+		std::uint32_t m_next_external_job;
+
+		std::atomic<bool> m_stop;
+		std::atomic<std::uint32_t> m_epoch; // Incremented on every submit to wake up sleeping workers.
+		std::atomic<std::uint32_t> m_num_sleeping;
+
+		static inline thread_local JobSystem* m_current_system = nullptr;
+		static inline thread_local std::uint32_t m_current_worker = 0;
+	};
+
+	template<typename F>
+	void JobSystem::Run(F&& func, JobCounter& counter)
+	{
+		using functor_t = std::decay_t<F>;
+		static_assert(sizeof(functor_t) <= internal::job_storage_size, "The functor doesn't fit in a job. Capture by reference instead.");
+		static_assert(alignof(functor_t) <= alignof(std::max_align_t), "The functor is over aligned.");
+
+		auto job = AllocateJob();
+		if (!job)
+		{
+			// Too many jobs in flight, running it right away keeps the amount of queued work bounded.
+			func();
+			return;
+		}
+
+		new (job->m_storage) functor_t(std::forward<F>(func));
+		job->m_func = [](internal::Job& job)
+		{
+			auto functor = std::launder(reinterpret_cast<functor_t*>(job.m_storage));
+			(*functor)();
+			functor->~functor_t();
+		};
+		job->m_counter = &counter;
+
+		counter.m_value.fetch_add(1, std::memory_order_relaxed);
+		Submit(job);
+	}
+
+	template<typename F>
+	void JobSystem::ParallelFor(std::size_t count, std::size_t grain_size, F const & func)
+	{
+		grain_size = std::max<std::size_t>(grain_size, 1);
+
+		JobCounter counter;
+		SplitFor(0, count, grain_size, func, counter);
+		Wait(counter);
+	}
+
+	template<typename F>
+	void JobSystem::SplitFor(std::size_t begin, std::size_t end, std::size_t grain_size, F const & func, JobCounter& counter)
+	{
+		// Hand off the upper half and keep splitting the lower one, so thieves take the largest ranges.
+		while (end - begin > grain_size)
+		{
+			auto mid = begin + (end - begin) / 2;
+			Run([this, mid, end, grain_size, &func, &counter] { SplitFor(mid, end, grain_size, func, counter); }, counter);
+			end = mid;
+		}
+
+		for (auto i = begin; i < end; i++)
+		{
+			func(i);
+		}
+	}
+
+	template<typename T, typename M, typename R>
+	T JobSystem::ParallelReduce(std::size_t count, std::size_t grain_size, T identity, M const & map, R const & reduce)
+	{
+		grain_size = std::max<std::size_t>(grain_size, 1);
+
+		auto num_chunks = (count + grain_size - 1) / grain_size;
+		std::vector<T> results(num_chunks, identity);
+		ParallelFor(num_chunks, 1, [&](std::size_t chunk)
+		{
+			auto begin = chunk * grain_size;
+			results[chunk] = map(begin, std::min(begin + grain_size, count));
+		});
+
+		T result = identity;
+		for (auto const & chunk_result : results)
+		{
+			result = reduce(result, chunk_result);
+		}
+
+		return result;
+	}
+
+	//! Calls `func` for every index in `[0, count)` on `job_system` and blocks until all calls finished. Runs on the calling thread when `job_system` is null.
+	template<typename F>
+	inline void ParallelFor(JobSystem* job_system, std::size_t count, F const & func)
+	{
+		if (!job_system || count < 2)
+		{
+			for (std::size_t i = 0; i < count; i++)
+			{
+				func(i);
+			}
+			return;
+		}
+
+		job_system->ParallelFor(count, 1, func);
+	}
+
+} /* util */
@@ -0,0 +1,94 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include "mapped_file.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+util::MappedFile::MappedFile(std::string const & path)
+	: m_data(nullptr),
+	m_size(0),
+#ifdef _WIN32
+	m_file(INVALID_HANDLE_VALUE),
+	m_mapping(nullptr)
+#else
+	m_fd(-1)
+#endif
+{
+#ifdef _WIN32
+	m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE) return;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0) return;
+
+	m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m_mapping) return;
+
+	m_data = static_cast<std::uint8_t const *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	m_size = m_data ? static_cast<std::size_t>(size.QuadPart) : 0;
+#else
+	m_fd = open(path.c_str(), O_RDONLY);
+	if (m_fd == -1) return;
+
+	struct stat info;
+	if (fstat(m_fd, &info) != 0 || info.st_size == 0) return;
+
+	auto data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+	if (data == MAP_FAILED) return;
+
+	m_data = static_cast<std::uint8_t const *>(data);
+	m_size = static_cast<std::size_t>(info.st_size);
+#endif
+}
+
+util::MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+	if (m_data) UnmapViewOfFile(m_data);
+	if (m_mapping) CloseHandle(m_mapping);
+	if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+#else
+	if (m_data) munmap(const_cast<std::uint8_t*>(m_data), m_size);
+	if (m_fd != -1) close(m_fd);
+#endif
+}
+
+bool util::WriteFileAtomic(std::string const & path, std::function<void(std::ostream&)> const & write)
+{
+	std::error_code ec;
+	std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+
+	auto tmp_path = path + ".tmp";
+	{
+		std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			return false;
+		}
+
+		write(file);
+
+		if (!file)
+		{
+			return false;
+		}
+	}
+
+	std::filesystem::rename(tmp_path, path, ec);
+	return !ec;
+}
@@ -0,0 +1,54 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+
+namespace util
+{
+
+	//! Read only memory mapped file.
+	/*!
+		The file stays mapped for the lifetime of the object.
+		Empty or missing files result in a invalid mapping.
+	*/
+	class MappedFile
+	{
+	public:
+		explicit MappedFile(std::string const & path);
+		~MappedFile();
+
+		MappedFile(MappedFile const &) = delete;
+		MappedFile& operator=(MappedFile const &) = delete;
+
+		bool IsValid() const { return m_data != nullptr; }
+		std::uint8_t const * GetData() const { return m_data; }
+		std::size_t GetSize() const { return m_size; }
+
+	private:
+		std::uint8_t const * m_data;
+		std::size_t m_size;
+
+#ifdef _WIN32
+		void* m_file;
+		void* m_mapping;
+#else
+		int m_fd;
+#endif
+	};
+
+	//! Writes a file with `write` and replaces `path` with it once everything was written.
+	/*!
+		The data goes to a temporary file first so a crash never leaves a half written file behind.
+		Missing parent directories are created. Returns false when the stream failed or the file couldn't be replaced.
+	*/
+	bool WriteFileAtomic(std::string const & path, std::function<void(std::ostream&)> const & write);
+
+} /* util */
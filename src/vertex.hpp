@@ -11,9 +11,14 @@
 
 #include <vulkan/vulkan.h>
 #include <vector>
+#include <type_traits>
 #include <vec2.hpp>
 #include <vec3.hpp>
 
+//! Whether a pipeline can read `V_T` from the vertex buffer. `ModelPool` only loads models with these vertices.
+template<typename V_T>
+struct IsGPUVertex : std::true_type {};
+
 struct Vertex2D
 {
 	glm::vec2 m_pos;
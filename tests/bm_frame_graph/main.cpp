@@ -0,0 +1,619 @@
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <numeric>
+#include <algorithm>
+#include <atomic>
+#include <frame_graph/task_graph.hpp>
+#include <frame_graph/render_target_aliasing.hpp>
+#include <frame_graph/barrier_planner.hpp>
+#include <frame_graph/frame_graph.hpp>
+#include <settings.hpp>
+
+#include "../bm_job_system/thread_pool.hpp"
+
+/*
+	Scheduling overhead of the frame graph without a device. The tasks don't record anything, so the time is what the scheduler costs.
+	Every synthetic task depends on 1 to 3 of the 16 tasks added before it, like the passes of a real frame graph.
+	Every 8th task doesn't allow multithreading and has to run on the thread calling `Execute`.
+*/
+
+struct SyntheticGraph
+{
+	std::vector<std::vector<fg::RenderTaskHandle>> m_predecessors;
+	std::vector<bool> m_allow_multithreading;
+	std::vector<bool> m_should_execute;
+};
+
+static SyntheticGraph CreateSyntheticGraph(std::uint32_t num_tasks)
+{
+	std::mt19937 rng(1337);
+
+	SyntheticGraph graph;
+	graph.m_predecessors.resize(num_tasks);
+	graph.m_allow_multithreading.resize(num_tasks);
+	graph.m_should_execute.resize(num_tasks, true);
+	for (std::uint32_t handle = 0; handle < num_tasks; handle++)
+	{
+		graph.m_allow_multithreading[handle] = handle % 8 != 7;
+
+		// The first tasks don't have anything to depend on, like the tasks generating the environment maps.
+		if (handle < 4) continue;
+
+		auto num_predecessors = std::uniform_int_distribution<std::uint32_t>(1, 3)(rng);
+		auto first = handle > 16 ? handle - 16 : 0;
+		for (std::uint32_t i = 0; i < num_predecessors; i++)
+		{
+			graph.m_predecessors[handle].push_back(std::uniform_int_distribution<std::uint32_t>(first, handle - 1)(rng));
+		}
+	}
+
+	return graph;
+}
+
+static void BM_TaskGraphCompile(benchmark::State& state)
+{
+	auto graph = CreateSyntheticGraph(static_cast<std::uint32_t>(state.range(0)));
+
+	fg::TaskGraph task_graph;
+	for (auto _ : state)
+	{
+		task_graph.Compile(graph.m_predecessors, graph.m_allow_multithreading);
+	}
+
+	state.counters["levels"] = task_graph.GetNumLevels();
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+
+	// The compiled order has to be topological.
+	std::vector<std::uint32_t> position(task_graph.GetNumTasks());
+	for (std::uint32_t i = 0; i < task_graph.GetNumTasks(); i++)
+	{
+		position[task_graph.GetOrder()[i]] = i;
+	}
+	for (std::uint32_t handle = 0; handle < task_graph.GetNumTasks(); handle++)
+	{
+		for (auto predecessor : graph.m_predecessors[handle])
+		{
+			if (position[predecessor] >= position[handle] || task_graph.GetLevel(predecessor) >= task_graph.GetLevel(handle))
+			{
+				state.SkipWithError("A task is ordered before one of its predecessors");
+				return;
+			}
+		}
+	}
+}
+
+//! Executes the graph on a job system like the frame graph's (or on the calling thread when `threaded` is false) and checks every task ran after its predecessors.
+static void ExecuteSyntheticGraph(benchmark::State& state, bool threaded)
+{
+	auto graph = CreateSyntheticGraph(static_cast<std::uint32_t>(state.range(0)));
+
+	// Skip a few tasks every frame, their successors should still run.
+	for (std::size_t handle = 5; handle < graph.m_should_execute.size(); handle += 25)
+	{
+		graph.m_should_execute[handle] = false;
+	}
+
+	fg::TaskGraph task_graph;
+	task_graph.Compile(graph.m_predecessors, graph.m_allow_multithreading);
+
+	util::JobSystem* job_system = threaded ? new util::JobSystem(settings::num_frame_graph_threads) : nullptr;
+
+	std::atomic<std::uint32_t> next_sequence = 0;
+	std::vector<std::uint32_t> sequence(graph.m_predecessors.size(), 0);
+	fg::TaskGraph::run_func_t run = [&](fg::RenderTaskHandle handle)
+	{
+		sequence[handle] = next_sequence.fetch_add(1, std::memory_order_relaxed) + 1;
+	};
+
+	bool ordered = true;
+	for (auto _ : state)
+	{
+		task_graph.Execute(job_system, graph.m_should_execute, run);
+
+		state.PauseTiming();
+		for (std::size_t handle = 0; handle < sequence.size(); handle++)
+		{
+			ordered &= (sequence[handle] != 0) == graph.m_should_execute[handle];
+			for (auto predecessor : graph.m_predecessors[handle])
+			{
+				ordered &= !graph.m_should_execute[handle] || !graph.m_should_execute[predecessor] || sequence[predecessor] < sequence[handle];
+			}
+		}
+		std::fill(sequence.begin(), sequence.end(), 0);
+		next_sequence = 0;
+		state.ResumeTiming();
+	}
+
+	state.counters["levels"] = task_graph.GetNumLevels();
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+
+	delete job_system;
+
+	if (!ordered)
+	{
+		state.SkipWithError("A task didn't run or ran before one of its predecessors");
+	}
+}
+
+static void BM_TaskGraphExecute(benchmark::State& state)
+{
+	ExecuteSyntheticGraph(state, true);
+}
+
+static void BM_TaskGraphExecuteSingleThreaded(benchmark::State& state)
+{
+	ExecuteSyntheticGraph(state, false);
+}
+
+// What the frame graph did before the task graph: enqueue every task at once on a thread pool without any ordering and wait on all futures.
+static void BM_ThreadPoolEnqueueAll(benchmark::State& state)
+{
+	util::ThreadPool pool(settings::num_frame_graph_threads);
+	std::vector<std::future<void>> futures(state.range(0));
+	std::atomic<std::uint32_t> num_ran = 0;
+
+	for (auto _ : state)
+	{
+		for (auto& future : futures)
+		{
+			future = pool.Enqueue([&num_ran] { num_ran.fetch_add(1, std::memory_order_relaxed); });
+		}
+		for (auto& future : futures)
+		{
+			future.wait();
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+//! Random render targets for the synthetic graph. Every 4th task has none, like compute and copy tasks.
+static std::vector<std::optional<fg::RenderTargetMemoryRequirements>> CreateSyntheticRenderTargets(std::uint32_t num_tasks)
+{
+	std::mt19937 rng(7331);
+
+	std::vector<std::optional<fg::RenderTargetMemoryRequirements>> requirements(num_tasks, std::nullopt);
+	for (std::uint32_t handle = 0; handle < num_tasks; handle++)
+	{
+		if (handle % 4 == 3) continue;
+
+		auto size = std::uniform_int_distribution<std::uint64_t>(1, 64)(rng) * 1024 * 1024;
+		requirements[handle] = fg::RenderTargetMemoryRequirements{ size, 64 * 1024, ~0u };
+	}
+
+	return requirements;
+}
+
+static void BM_RenderTargetAliasingCompile(benchmark::State& state)
+{
+	auto graph = CreateSyntheticGraph(static_cast<std::uint32_t>(state.range(0)));
+	auto requirements = CreateSyntheticRenderTargets(static_cast<std::uint32_t>(state.range(0)));
+
+	fg::TaskGraph task_graph;
+	task_graph.Compile(graph.m_predecessors, graph.m_allow_multithreading);
+
+	fg::RenderTargetAliasing aliasing;
+	for (auto _ : state)
+	{
+		aliasing.Compile(task_graph.GetOrder(), graph.m_predecessors, requirements);
+	}
+
+	state.counters["heaps"] = static_cast<double>(aliasing.GetHeaps().size());
+	state.counters["unaliased_mb"] = static_cast<double>(aliasing.GetUnaliasedSize()) / (1024.0 * 1024.0);
+	state.counters["aliased_mb"] = static_cast<double>(aliasing.GetAliasedSize()) / (1024.0 * 1024.0);
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+
+	// Render targets alive at the same time can't share memory, and every target has to fit its heap.
+	for (std::uint32_t a = 0; a < requirements.size(); a++)
+	{
+		auto const & placement_a = aliasing.GetPlacement(a);
+		if (!placement_a.has_value()) continue;
+
+		auto const & heap = aliasing.GetHeaps()[placement_a->m_heap];
+		if (placement_a->m_offset + requirements[a]->m_size > heap.m_size || placement_a->m_offset % requirements[a]->m_alignment != 0)
+		{
+			state.SkipWithError("A render target doesn't fit its heap");
+			return;
+		}
+
+		for (std::uint32_t b = a + 1; b < requirements.size(); b++)
+		{
+			auto const & placement_b = aliasing.GetPlacement(b);
+			if (!placement_b.has_value() || placement_a->m_heap != placement_b->m_heap) continue;
+
+			bool alive_together = aliasing.GetFirstUse(a) <= aliasing.GetLastUse(b) && aliasing.GetFirstUse(b) <= aliasing.GetLastUse(a);
+			bool share_memory = placement_a->m_offset < placement_b->m_offset + requirements[b]->m_size && placement_b->m_offset < placement_a->m_offset + requirements[a]->m_size;
+			if (alive_together && share_memory)
+			{
+				state.SkipWithError("Two render targets alive at the same time share memory");
+				return;
+			}
+			if (share_memory && !(placement_a->m_aliased && placement_b->m_aliased))
+			{
+				state.SkipWithError("Render targets sharing memory aren't marked as aliased");
+				return;
+			}
+		}
+	}
+
+	if (aliasing.GetAliasedSize() > aliasing.GetUnaliasedSize())
+	{
+		state.SkipWithError("Aliasing used more memory than it saved");
+	}
+}
+
+/*
+	The deferred PBR frame graph at 4K: environment maps, G-buffer, composition, post-processing and ImGui.
+	Reports how much memory the transient render targets save. The numbers are the sizes of the targets without padding.
+*/
+static void BM_RenderTargetAliasingPBR(benchmark::State& state)
+{
+	constexpr std::uint64_t pixels = 3840 * 2160;
+	enum Task : fg::RenderTaskHandle { BRDF_LUT, CUBEMAP, IRRADIANCE, ENVIRONMENT, DEFERRED_MAIN, COMPOSITION, POST_PROCESSING, IMGUI, NUM_TASKS };
+
+	std::vector<std::vector<fg::RenderTaskHandle>> predecessors(NUM_TASKS);
+	predecessors[IRRADIANCE] = { CUBEMAP };
+	predecessors[ENVIRONMENT] = { CUBEMAP };
+	predecessors[COMPOSITION] = { DEFERRED_MAIN, CUBEMAP, IRRADIANCE, ENVIRONMENT, BRDF_LUT };
+	predecessors[POST_PROCESSING] = { COMPOSITION };
+	predecessors[IMGUI] = { POST_PROCESSING };
+
+	std::vector<bool> allow_multithreading(NUM_TASKS, true);
+	allow_multithreading[IMGUI] = false;
+
+	// 3 RGBA32F and 2 RGBA16F color attachments and a D32 depth buffer, RGBA32F composition and BGRA8 post-processing.
+	std::vector<std::optional<fg::RenderTargetMemoryRequirements>> requirements(NUM_TASKS, std::nullopt);
+	requirements[DEFERRED_MAIN] = fg::RenderTargetMemoryRequirements{ pixels * (3 * 16 + 2 * 8 + 4), 64 * 1024, ~0u };
+	requirements[COMPOSITION] = fg::RenderTargetMemoryRequirements{ pixels * 16, 64 * 1024, ~0u };
+	requirements[POST_PROCESSING] = fg::RenderTargetMemoryRequirements{ pixels * 4, 64 * 1024, ~0u };
+
+	fg::TaskGraph task_graph;
+	task_graph.Compile(predecessors, allow_multithreading);
+
+	fg::RenderTargetAliasing aliasing;
+	for (auto _ : state)
+	{
+		aliasing.Compile(task_graph.GetOrder(), predecessors, requirements);
+	}
+
+	state.counters["unaliased_mb"] = static_cast<double>(aliasing.GetUnaliasedSize()) / (1024.0 * 1024.0);
+	state.counters["aliased_mb"] = static_cast<double>(aliasing.GetAliasedSize()) / (1024.0 * 1024.0);
+	state.counters["saved_mb"] = static_cast<double>(aliasing.GetUnaliasedSize() - aliasing.GetAliasedSize()) / (1024.0 * 1024.0);
+
+	// Post-processing only starts after the G-buffer is done with, so it can reuse that memory.
+	if (!aliasing.IsAliased(POST_PROCESSING) || !aliasing.IsAliased(DEFERRED_MAIN) || aliasing.IsAliased(COMPOSITION))
+	{
+		state.SkipWithError("The post-processing target doesn't reuse the memory of the G-buffer");
+	}
+}
+
+//! Random render target usages for the synthetic graph. Tasks write their own render target and read the ones of their predecessors.
+static std::vector<std::vector<fg::ResourceAccess>> CreateSyntheticAccesses(SyntheticGraph const & graph)
+{
+	std::mt19937 rng(4242);
+
+	auto num_tasks = static_cast<std::uint32_t>(graph.m_predecessors.size());
+	auto has_render_target = [](fg::RenderTaskHandle handle) { return handle % 4 != 3; };
+
+	std::vector<std::vector<fg::ResourceAccess>> accesses(num_tasks);
+	for (fg::RenderTaskHandle handle = 0; handle < num_tasks; handle++)
+	{
+		if (has_render_target(handle))
+		{
+			accesses[handle].push_back({ handle, handle % 2 ? fg::ResourceUsage::ATTACHMENT : fg::ResourceUsage::STORAGE_WRITE });
+		}
+
+		for (auto predecessor : graph.m_predecessors[handle])
+		{
+			// A task can only use a render target in one layout.
+			auto used = std::find_if(accesses[handle].begin(), accesses[handle].end(), [&](fg::ResourceAccess const & access) { return access.m_target == predecessor; });
+			if (!has_render_target(predecessor) || used != accesses[handle].end()) continue;
+
+			static constexpr fg::ResourceUsage reads[] = { fg::ResourceUsage::SAMPLED, fg::ResourceUsage::STORAGE_READ, fg::ResourceUsage::COPY_SRC };
+			accesses[handle].push_back({ predecessor, reads[std::uniform_int_distribution<std::uint32_t>(0, 2)(rng)] });
+		}
+	}
+
+	return accesses;
+}
+
+/*
+	Replays a frame with the planned barriers and checks every access happens in the right layout and waits on the last write.
+	Returns the error or `nullptr` when the barriers are correct.
+*/
+static char const * ValidateBarriers(fg::BarrierPlanner const & planner, std::vector<fg::RenderTaskHandle> const & order,
+	std::vector<std::vector<fg::ResourceAccess>> const & accesses, std::vector<bool> const & should_execute, std::vector<bool> const & discard,
+	std::vector<fg::ResourceState> const & initial_states)
+{
+	struct Target
+	{
+		fg::ResourceLayout m_layout;
+		fg::ResourceUsageMask m_visible_to; // The reads the last write was made visible to.
+		bool m_accessed; // Accessed since the last barrier, a write has to wait on it.
+		bool m_used;
+	};
+
+	std::vector<Target> targets(accesses.size());
+	for (std::size_t i = 0; i < targets.size(); i++)
+	{
+		auto const & state = initial_states[i];
+		targets[i] = { state.m_layout, state.m_writes ? state.m_reads : ~0u, state.m_writes || state.m_reads, false };
+	}
+
+	for (auto task : order)
+	{
+		if (!should_execute[task]) continue;
+
+		auto const & barriers = planner.GetBarriers(task);
+		for (auto const & transition : barriers.m_transitions)
+		{
+			auto& target = targets[transition.m_target];
+			auto discarded = !target.m_used && discard[transition.m_target];
+			if (transition.m_from != target.m_layout && !(discarded && transition.m_from == fg::ResourceLayout::UNDEFINED))
+			{
+				return "A transition starts from the wrong layout";
+			}
+
+			target.m_layout = transition.m_to;
+			target.m_visible_to |= transition.m_dst_usages;
+			target.m_accessed = false;
+		}
+
+		for (auto const & access : accesses[task])
+		{
+			auto& target = targets[access.m_target];
+			if (target.m_layout != fg::GetLayout(access.m_usage))
+			{
+				return "A render target is used in the wrong layout";
+			}
+			if (fg::IsWrite(access.m_usage) ? target.m_accessed : !(target.m_visible_to & fg::ToMask(access.m_usage)))
+			{
+				return "An access doesn't wait on the previous ones";
+			}
+
+			target.m_visible_to = fg::IsWrite(access.m_usage) ? 0 : target.m_visible_to;
+			target.m_accessed = true;
+			target.m_used = true;
+
+			if (access.m_left_as.has_value())
+			{
+				target.m_layout = access.m_left_as->second;
+				target.m_visible_to = fg::IsWrite(access.m_left_as->first) ? 0 : target.m_visible_to;
+			}
+		}
+	}
+
+	return nullptr;
+}
+
+static void BM_BarrierPlannerCompile(benchmark::State& state)
+{
+	auto graph = CreateSyntheticGraph(static_cast<std::uint32_t>(state.range(0)));
+	auto accesses = CreateSyntheticAccesses(graph);
+	std::vector<bool> discard(graph.m_predecessors.size());
+	for (std::size_t i = 0; i < discard.size(); i++)
+	{
+		discard[i] = i % 3 == 0;
+	}
+
+	fg::TaskGraph task_graph;
+	task_graph.Compile(graph.m_predecessors, graph.m_allow_multithreading);
+
+	// The first frame starts without contents, the second one from the states the first one left.
+	fg::BarrierPlanner planner;
+	planner.Compile(task_graph.GetOrder(), accesses, graph.m_should_execute, discard, {});
+	auto states = planner.GetFinalStates();
+
+	for (auto _ : state)
+	{
+		planner.Compile(task_graph.GetOrder(), accesses, graph.m_should_execute, discard, states);
+	}
+
+	state.counters["barriers"] = planner.GetNumBarriers();
+	state.counters["transitions"] = planner.GetNumTransitions();
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+
+	if (auto error = ValidateBarriers(planner, task_graph.GetOrder(), accesses, graph.m_should_execute, discard, states))
+	{
+		state.SkipWithError(error);
+		return;
+	}
+	if (!planner.IsSteady())
+	{
+		state.SkipWithError("The frames don't end in the states they start in");
+	}
+}
+
+/*
+	The barriers of the deferred PBR frame graph once the environment maps are generated.
+	Before, every task transitioned its own render target before and after running, separately and from `UNDEFINED`:
+	the G-buffer after rendering, composition before, post-processing before and after and ImGui around sampling it. 6 barriers.
+*/
+static void BM_BarrierPlannerPBR(benchmark::State& state)
+{
+	enum Task : fg::RenderTaskHandle { BRDF_LUT, CUBEMAP, IRRADIANCE, ENVIRONMENT, DEFERRED_MAIN, COMPOSITION, POST_PROCESSING, COPY_TO_BACK_BUFFER, IMGUI, NUM_TASKS };
+
+	std::vector<std::vector<fg::ResourceAccess>> accesses(NUM_TASKS);
+	accesses[BRDF_LUT] = { { BRDF_LUT, fg::ResourceUsage::STORAGE_WRITE } };
+	accesses[CUBEMAP] = { { CUBEMAP, fg::ResourceUsage::STORAGE_WRITE, std::make_pair(fg::ResourceUsage::COPY_DST, fg::ResourceLayout::SHADER_READ_ONLY) } };
+	accesses[IRRADIANCE] = { { IRRADIANCE, fg::ResourceUsage::STORAGE_WRITE }, { CUBEMAP, fg::ResourceUsage::SAMPLED } };
+	accesses[ENVIRONMENT] = { { ENVIRONMENT, fg::ResourceUsage::STORAGE_WRITE }, { CUBEMAP, fg::ResourceUsage::SAMPLED } };
+	accesses[DEFERRED_MAIN] = { { DEFERRED_MAIN, fg::ResourceUsage::ATTACHMENT } };
+	accesses[COMPOSITION] = { { COMPOSITION, fg::ResourceUsage::STORAGE_WRITE }, { DEFERRED_MAIN, fg::ResourceUsage::STORAGE_READ },
+		{ CUBEMAP, fg::ResourceUsage::SAMPLED }, { IRRADIANCE, fg::ResourceUsage::SAMPLED }, { ENVIRONMENT, fg::ResourceUsage::SAMPLED }, { BRDF_LUT, fg::ResourceUsage::SAMPLED } };
+	accesses[POST_PROCESSING] = { { POST_PROCESSING, fg::ResourceUsage::STORAGE_WRITE }, { COMPOSITION, fg::ResourceUsage::STORAGE_READ } };
+	accesses[COPY_TO_BACK_BUFFER] = { { POST_PROCESSING, fg::ResourceUsage::COPY_SRC } };
+	accesses[IMGUI] = { { POST_PROCESSING, fg::ResourceUsage::SAMPLED } };
+
+	std::vector<bool> discard(NUM_TASKS, false);
+	discard[DEFERRED_MAIN] = discard[COMPOSITION] = discard[POST_PROCESSING] = true;
+
+	std::vector<fg::RenderTaskHandle> order(NUM_TASKS);
+	std::iota(order.begin(), order.end(), 0);
+
+	// The environment maps get generated in the first frame, after that the planning has to settle.
+	std::vector<bool> should_execute(NUM_TASKS, true);
+	fg::BarrierPlanner planner;
+	planner.Compile(order, accesses, should_execute, discard, {});
+	if (auto error = ValidateBarriers(planner, order, accesses, should_execute, discard, std::vector<fg::ResourceState>(NUM_TASKS)))
+	{
+		state.SkipWithError(error);
+		return;
+	}
+
+	should_execute[BRDF_LUT] = should_execute[CUBEMAP] = should_execute[IRRADIANCE] = should_execute[ENVIRONMENT] = false;
+	auto states = planner.GetFinalStates();
+	for (int frame = 0; frame < 4; frame++)
+	{
+		planner.Compile(order, accesses, should_execute, discard, states);
+		if (planner.IsSteady()) break;
+		states = planner.GetFinalStates();
+	}
+
+	for (auto _ : state)
+	{
+		planner.Compile(order, accesses, should_execute, discard, states);
+	}
+
+	state.counters["barriers"] = planner.GetNumBarriers();
+	state.counters["transitions"] = planner.GetNumTransitions();
+	state.counters["legacy_barriers"] = 6;
+
+	if (auto error = ValidateBarriers(planner, order, accesses, should_execute, discard, states))
+	{
+		state.SkipWithError(error);
+		return;
+	}
+	if (!planner.IsSteady())
+	{
+		state.SkipWithError("The planning didn't settle after generating the environment maps");
+	}
+}
+
+/*
+	Per-frame overhead of the task lookups on a frame graph of `N` tasks.
+	Every frame each task looks up its settings, the render target properties of the task before it and whether the task after it exists,
+	like the passes do while executing. The frame graph isn't set up, so only the lookups are measured.
+*/
+template<std::uint32_t I>
+struct LookupTaskData
+{
+	std::uint32_t m_value = I;
+};
+
+struct LookupTaskSettings
+{
+	float m_strength = 0;
+};
+
+template<std::uint32_t I>
+static void AddLookupTask(fg::FrameGraph& fg)
+{
+	fg::RenderTaskDesc desc;
+	desc.m_setup_func = [](Renderer&, fg::FrameGraph&, fg::RenderTaskHandle, bool) {};
+	desc.m_execute_func = [](Renderer&, fg::FrameGraph&, sg::SceneGraph&, fg::RenderTaskHandle) {};
+	desc.m_destroy_func = [](fg::FrameGraph&, fg::RenderTaskHandle, bool) {};
+	if (I % 2 == 0)
+	{
+		desc.m_properties = RenderTargetProperties{};
+	}
+
+	fg.AddTask<LookupTaskData<I>>(desc, "Lookup Task");
+	fg.UpdateSettings<LookupTaskData<I>>(LookupTaskSettings{ static_cast<float>(I) });
+}
+
+template<std::uint32_t I>
+static float LookUpTask(fg::FrameGraph& fg)
+{
+	auto settings = fg.GetSettings<LookupTaskData<I>, LookupTaskSettings>();
+	auto const & properties = fg.GetRenderTargetProperties<LookupTaskData<I == 0 ? 0 : I - 1>>();
+	return settings.m_strength + (properties.has_value() ? 1.f : 0.f) + (fg.HasTask<LookupTaskData<I + 1>>() ? 1.f : 0.f);
+}
+
+template<std::uint32_t... Is>
+static void AddLookupTasks(fg::FrameGraph& fg, std::integer_sequence<std::uint32_t, Is...>)
+{
+	(AddLookupTask<Is>(fg), ...);
+}
+
+template<std::uint32_t... Is>
+static float LookUpFrame(fg::FrameGraph& fg, std::integer_sequence<std::uint32_t, Is...>)
+{
+	return (LookUpTask<Is>(fg) + ...);
+}
+
+template<std::uint32_t N>
+static void BM_FrameGraphTaskLookups(benchmark::State& state)
+{
+	fg::FrameGraph fg(N);
+	AddLookupTasks(fg, std::make_integer_sequence<std::uint32_t, N>());
+
+	float sum = 0;
+	for (auto _ : state)
+	{
+		sum = LookUpFrame(fg, std::make_integer_sequence<std::uint32_t, N>());
+		benchmark::DoNotOptimize(sum);
+	}
+
+	state.SetItemsProcessed(state.iterations() * N * 3);
+
+	float expected = 0;
+	for (std::uint32_t i = 0; i < N; i++)
+	{
+		auto previous = i == 0 ? 0 : i - 1;
+		expected += static_cast<float>(i) + (previous % 2 == 0 ? 1.f : 0.f) + (i + 1 < N ? 1.f : 0.f);
+	}
+	if (sum != expected)
+	{
+		state.SkipWithError("A lookup found the wrong task");
+	}
+}
+
+//! The same lookups done by comparing the type information of every task, like the frame graph used to. For reference.
+template<std::uint32_t N>
+static void BM_FrameGraphTaskLookupsTypeidScan(benchmark::State& state)
+{
+	std::vector<std::reference_wrapper<const std::type_info>> type_info;
+	[&]<std::uint32_t... Is>(std::integer_sequence<std::uint32_t, Is...>)
+	{
+		(type_info.emplace_back(typeid(LookupTaskData<Is>)), ...);
+	}(std::make_integer_sequence<std::uint32_t, N>());
+
+	auto find = [&](std::type_info const & type) -> std::optional<fg::RenderTaskHandle>
+	{
+		for (fg::RenderTaskHandle i = 0; i < type_info.size(); i++)
+		{
+			if (type_info[i].get() == type) return i;
+		}
+		return std::nullopt;
+	};
+
+	for (auto _ : state)
+	{
+		std::uint32_t found = 0;
+		[&]<std::uint32_t... Is>(std::integer_sequence<std::uint32_t, Is...>)
+		{
+			((found += find(typeid(LookupTaskData<Is>)).has_value() + find(typeid(LookupTaskData<Is == 0 ? 0 : Is - 1>)).has_value()
+				+ find(typeid(LookupTaskData<Is + 1>)).has_value()), ...);
+		}(std::make_integer_sequence<std::uint32_t, N>());
+		benchmark::DoNotOptimize(found);
+	}
+
+	state.SetItemsProcessed(state.iterations() * N * 3);
+}
+
+BENCHMARK(BM_TaskGraphCompile)->Arg(50)->Arg(100)->Arg(250)->Arg(500)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_TaskGraphExecute)->Arg(50)->Arg(100)->Arg(250)->Arg(500)->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK(BM_TaskGraphExecuteSingleThreaded)->Arg(50)->Arg(100)->Arg(250)->Arg(500)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ThreadPoolEnqueueAll)->Arg(50)->Arg(100)->Arg(250)->Arg(500)->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK(BM_RenderTargetAliasingCompile)->Arg(50)->Arg(100)->Arg(250)->Arg(500)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_RenderTargetAliasingPBR)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_BarrierPlannerCompile)->Arg(50)->Arg(100)->Arg(250)->Arg(500)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_BarrierPlannerPBR)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_FrameGraphTaskLookups, 32)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_FrameGraphTaskLookups, 64)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_FrameGraphTaskLookupsTypeidScan, 32)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_FrameGraphTaskLookupsTypeidScan, 64)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,190 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <numeric>
+#include <thread>
+#include <util/job_system.hpp>
+
+#include "thread_pool.hpp"
+
+/*
+	Fine grained task throughput of `util::JobSystem` against `util::ThreadPool`, which it replaced.
+	Both get all hardware threads. The job system uses one less worker because the waiting thread runs jobs too.
+	Every task does a small, fixed amount of work so the results are about the scheduling.
+*/
+
+static std::uint32_t GetNumThreads()
+{
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+//! Roughly 50ns of work that the compiler can't remove.
+static std::uint32_t SmallWork(std::uint32_t seed)
+{
+	for (std::uint32_t i = 0; i < 32; i++)
+	{
+		seed = seed * 1664525u + 1013904223u;
+	}
+	return seed;
+}
+
+static void JobCounts(benchmark::internal::Benchmark* benchmark)
+{
+	benchmark->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond)->UseRealTime();
+}
+
+static void BM_ThreadPoolTasks(benchmark::State& state)
+{
+	util::ThreadPool pool(GetNumThreads());
+	std::vector<std::future<void>> futures(state.range(0));
+	std::atomic<std::uint32_t> result = 0;
+
+	for (auto _ : state)
+	{
+		for (std::size_t i = 0; i < futures.size(); i++)
+		{
+			futures[i] = pool.Enqueue([&result, i] { result.fetch_add(SmallWork(static_cast<std::uint32_t>(i)), std::memory_order_relaxed); });
+		}
+		for (auto& future : futures)
+		{
+			future.wait();
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_JobSystemTasks(benchmark::State& state)
+{
+	util::JobSystem job_system(GetNumThreads() - 1);
+	std::atomic<std::uint32_t> num_ran = 0;
+	std::atomic<std::uint32_t> result = 0;
+
+	for (auto _ : state)
+	{
+		util::JobCounter counter;
+		for (std::int64_t i = 0; i < state.range(0); i++)
+		{
+			job_system.Run([&result, &num_ran, i]
+			{
+				result.fetch_add(SmallWork(static_cast<std::uint32_t>(i)), std::memory_order_relaxed);
+				num_ran.fetch_add(1, std::memory_order_relaxed);
+			}, counter);
+		}
+		job_system.Wait(counter);
+	}
+
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+
+	if (num_ran != state.iterations() * state.range(0))
+	{
+		state.SkipWithError("Not every job ran exactly once");
+	}
+}
+
+// Jobs spawned from jobs go to the deque of the worker spawning them instead of the shared queue.
+static void BM_JobSystemNestedTasks(benchmark::State& state)
+{
+	util::JobSystem job_system(GetNumThreads() - 1);
+	std::atomic<std::uint32_t> num_ran = 0;
+	std::atomic<std::uint32_t> result = 0;
+
+	auto num_spawners = std::max(1u, job_system.GetNumWorkers());
+	auto jobs_per_spawner = state.range(0) / num_spawners;
+
+	for (auto _ : state)
+	{
+		util::JobCounter counter;
+		for (std::uint32_t spawner = 0; spawner < num_spawners; spawner++)
+		{
+			job_system.Run([&, spawner]
+			{
+				util::JobCounter spawned;
+				for (std::int64_t i = 0; i < jobs_per_spawner; i++)
+				{
+					job_system.Run([&result, &num_ran, i]
+					{
+						result.fetch_add(SmallWork(static_cast<std::uint32_t>(i)), std::memory_order_relaxed);
+						num_ran.fetch_add(1, std::memory_order_relaxed);
+					}, spawned);
+				}
+				job_system.Wait(spawned);
+			}, counter);
+		}
+		job_system.Wait(counter);
+	}
+
+	state.SetItemsProcessed(state.iterations() * jobs_per_spawner * num_spawners);
+
+	if (num_ran != state.iterations() * jobs_per_spawner * num_spawners)
+	{
+		state.SkipWithError("Not every nested job ran exactly once");
+	}
+}
+
+static void BM_ThreadPoolParallelFor(benchmark::State& state)
+{
+	util::ThreadPool pool(GetNumThreads());
+	std::vector<std::uint32_t> results(state.range(0));
+
+	for (auto _ : state)
+	{
+		util::ParallelFor(&pool, results.size(), [&](std::size_t i) { results[i] = SmallWork(static_cast<std::uint32_t>(i)); });
+	}
+
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_JobSystemParallelFor(benchmark::State& state)
+{
+	util::JobSystem job_system(GetNumThreads() - 1);
+	std::vector<std::uint32_t> results(state.range(0));
+
+	for (auto _ : state)
+	{
+		util::ParallelFor(&job_system, results.size(), [&](std::size_t i) { results[i] = SmallWork(static_cast<std::uint32_t>(i)); });
+	}
+
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+
+	for (std::size_t i = 0; i < results.size(); i++)
+	{
+		if (results[i] != SmallWork(static_cast<std::uint32_t>(i)))
+		{
+			state.SkipWithError("ParallelFor skipped an index");
+			break;
+		}
+	}
+}
+
+static void BM_JobSystemParallelReduce(benchmark::State& state)
+{
+	util::JobSystem job_system(GetNumThreads() - 1);
+	std::vector<std::uint64_t> values(state.range(0));
+	std::iota(values.begin(), values.end(), 0);
+
+	std::uint64_t sum = 0;
+	for (auto _ : state)
+	{
+		sum = job_system.ParallelReduce<std::uint64_t>(values.size(), 1024, 0,
+			[&](std::size_t begin, std::size_t end) { return std::accumulate(values.begin() + begin, values.begin() + end, std::uint64_t(0)); },
+			[](std::uint64_t a, std::uint64_t b) { return a + b; });
+	}
+
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+
+	auto count = static_cast<std::uint64_t>(state.range(0));
+	if (sum != count * (count - 1) / 2)
+	{
+		state.SkipWithError("ParallelReduce returned the wrong sum");
+	}
+}
+
+BENCHMARK(BM_ThreadPoolTasks)->Apply(JobCounts);
+BENCHMARK(BM_JobSystemTasks)->Apply(JobCounts);
+BENCHMARK(BM_JobSystemNestedTasks)->Apply(JobCounts);
+BENCHMARK(BM_ThreadPoolParallelFor)->Apply(JobCounts);
+BENCHMARK(BM_JobSystemParallelFor)->Apply(JobCounts);
+BENCHMARK(BM_JobSystemParallelReduce)->RangeMultiplier(10)->Range(10000, 10000000)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+BENCHMARK_MAIN();
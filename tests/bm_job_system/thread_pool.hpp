@@ -5,6 +5,8 @@
  */
 
 /*
+The thread pool the frame graph used before `util::JobSystem` replaced it. Only kept as the baseline of the benchmarks.
+
 This thread pool is a modified version of https://github.com/progschj/ThreadPool.
 It is adjusted to fit our project structure better.
 
@@ -43,7 +45,7 @@ freely, subject to the following restrictions:
 #include <functional>
 #include <stdexcept>
 
-#include "delegate.hpp"
+#include <util/delegate.hpp>
 
 namespace util
 {
@@ -136,4 +138,34 @@ namespace util
 		}
 	}
 
+	//! Calls `func` for every index in `[0, count)` on `pool` and blocks until all calls finished. Runs on the calling thread when `pool` is null.
+	inline void ParallelFor(ThreadPool* pool, std::size_t count, std::function<void(std::size_t)> const & func)
+	{
+		if (!pool || count < 2)
+		{
+			for (std::size_t i = 0; i < count; i++)
+			{
+				func(i);
+			}
+			return;
+		}
+
+		std::vector<std::future<void>> futures;
+		futures.reserve(count);
+		for (std::size_t i = 0; i < count; i++)
+		{
+			futures.push_back(pool->Enqueue(func, i));
+		}
+
+		// Wait for everything before rethrowing so no task outlives the data it references.
+		for (auto& future : futures)
+		{
+			future.wait();
+		}
+		for (auto& future : futures)
+		{
+			future.get();
+		}
+	}
+
 }
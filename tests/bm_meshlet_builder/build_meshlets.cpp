@@ -0,0 +1,241 @@
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <filesystem>
+#include <memory>
+
+#include <meshlet_builder.hpp>
+#include <mesh_optimizer.hpp>
+#include <tinygltf_model_loader.hpp>
+
+#include "test_meshes.hpp"
+
+/*
+	Runs the meshlet generation path of `ModelPool` (`BuildMeshlets` + `FinalizeMeshlets`) without a GPU.
+	Throughput is reported as triangles per second (items_per_second), quality as meshlet count, average vertices and primitives
+	per meshlet and the fraction of meshlets the normal cone test culls from a fixed set of view directions.
+*/
+
+enum class TestMesh
+{
+	GRID,
+	SPHERE,
+	SHUFFLED_SPHERE,
+	SOUP,
+	RANDOM_INDEXED_SOUP
+};
+
+//! Every mesh type has `2 * size^2` triangles.
+static void CreateTestMesh(TestMesh type, std::uint32_t size, std::vector<glm::vec3>& positions, std::vector<std::uint32_t>& indices)
+{
+	switch (type)
+	{
+	case TestMesh::GRID:
+		CreateGrid(size, positions, indices);
+		break;
+	case TestMesh::SPHERE:
+		CreateSphere(size, size, positions, indices);
+		break;
+	case TestMesh::SHUFFLED_SPHERE:
+		CreateSphere(size, size, positions, indices);
+		ShuffleTriangles(indices);
+		break;
+	case TestMesh::SOUP:
+		CreateTriangleSoup(size * size * 2, positions, indices);
+		break;
+	case TestMesh::RANDOM_INDEXED_SOUP:
+		CreateRandomIndexedSoup(size * size, size * size * 2, positions, indices);
+		break;
+	}
+}
+
+//! The 26 directions from the center of a cube to its faces, edges and corners.
+static std::vector<glm::vec3> GetViewDirections()
+{
+	std::vector<glm::vec3> directions;
+	for (auto x = -1; x <= 1; x++)
+	{
+		for (auto y = -1; y <= 1; y++)
+		{
+			for (auto z = -1; z <= 1; z++)
+			{
+				if (x != 0 || y != 0 || z != 0)
+				{
+					directions.push_back(glm::normalize(glm::vec3(x, y, z)));
+				}
+			}
+		}
+	}
+	return directions;
+}
+
+static void ReportQuality(benchmark::State& state,
+	std::vector<MeshletCluster> const & clusters,
+	std::vector<glm::vec3> const & positions,
+	std::vector<std::uint32_t> const & indices)
+{
+	auto stats = MeshletBuilder::CalculateStats(clusters, positions, indices);
+	static const auto view_directions = GetViewDirections();
+
+	// Same test as the task shader: culled when the direction to the camera is outside of the cone widened by 90 degrees.
+	std::size_t num_culled = 0;
+	for (auto const & cluster : clusters)
+	{
+		auto bounds = MeshletBuilder::CalculateBounds(cluster, positions, indices);
+		if (!bounds.IsBackfaceCullable())
+		{
+			continue;
+		}
+
+		for (auto const & to_camera : view_directions)
+		{
+			num_culled += glm::dot(to_camera, bounds.m_cone_axis) < float(bounds.m_cone_angle) / 127.f ? 1 : 0;
+		}
+	}
+
+	auto num_meshlets = std::max<std::size_t>(1, stats.m_num_meshlets);
+	state.counters["meshlets"] = static_cast<double>(stats.m_num_meshlets);
+	state.counters["vertices_per_meshlet"] = double(stats.m_num_vertex_references) / num_meshlets;
+	state.counters["primitives_per_meshlet"] = double(stats.m_num_triangles) / num_meshlets;
+	state.counters["cone_cull_rate"] = double(num_culled) / double(num_meshlets * view_directions.size());
+}
+
+//! Builds and finalizes the meshlets of a single mesh the way `ModelPool` does.
+static void BuildMeshletData(std::vector<glm::vec3> const & positions, std::vector<std::uint32_t> const & indices,
+	MeshBoundingBox const & bbox, std::vector<MeshletCluster>& clusters)
+{
+	std::vector<MeshletDesc> meshlet_data;
+	std::vector<std::uint32_t> vertex_indices;
+	std::vector<std::uint8_t> index_indices;
+	MeshletStats stats = {};
+
+	clusters = MeshletBuilder::BuildMeshlets(positions, indices);
+	MeshletBuilder::FinalizeMeshlets(clusters, positions, indices, bbox, meshlet_data, vertex_indices, index_indices, stats);
+
+	benchmark::DoNotOptimize(meshlet_data.data());
+	benchmark::DoNotOptimize(index_indices.data());
+}
+
+template<TestMesh T>
+static void BM_BuildMeshlets(benchmark::State& state)
+{
+	std::vector<glm::vec3> positions;
+	std::vector<std::uint32_t> indices;
+	CreateTestMesh(T, static_cast<std::uint32_t>(state.range(0)), positions, indices);
+
+	MeshBoundingBox bbox;
+	for (auto const & p : positions)
+	{
+		bbox.m_min = glm::min(bbox.m_min, p);
+		bbox.m_max = glm::max(bbox.m_max, p);
+	}
+
+	std::vector<MeshletCluster> clusters;
+	for (auto _ : state)
+	{
+		BuildMeshletData(positions, indices, bbox, clusters);
+	}
+
+	ReportQuality(state, clusters, positions, indices);
+	state.counters["triangles"] = static_cast<double>(indices.size() / 3);
+	state.SetItemsProcessed(state.iterations() * (indices.size() / 3));
+}
+
+// 8k, 131k and 1M triangles. The soups are a lot slower to build so they skip the largest size.
+BENCHMARK_TEMPLATE(BM_BuildMeshlets, TestMesh::GRID)->Arg(64)->Arg(256)->Arg(724)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_BuildMeshlets, TestMesh::SPHERE)->Arg(64)->Arg(256)->Arg(724)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_BuildMeshlets, TestMesh::SHUFFLED_SPHERE)->Arg(64)->Arg(256)->Arg(724)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_BuildMeshlets, TestMesh::SOUP)->Arg(64)->Arg(256)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_BuildMeshlets, TestMesh::RANDOM_INDEXED_SOUP)->Arg(64)->Arg(256)->Unit(benchmark::kMillisecond);
+
+//! A mesh of a model from the resources directory prepared like `ModelPool` prepares it before building meshlets.
+struct ResourceMesh
+{
+	std::vector<glm::vec3> m_positions;
+	std::vector<std::uint32_t> m_indices;
+	MeshBoundingBox m_bbox;
+};
+
+static void BM_BuildMeshletsResource(benchmark::State& state, std::string const & path)
+{
+	TinyGLTFModelLoader loader;
+	auto model = loader.LoadFromDisc(path);
+	if (!model || model->m_meshes.empty())
+	{
+		state.SkipWithError("Failed to load the model");
+		return;
+	}
+
+	std::vector<ResourceMesh> meshes;
+	std::size_t num_triangles = 0;
+	for (auto& mesh_data : model->m_meshes)
+	{
+		auto& mesh = meshes.emplace_back();
+		mesh.m_indices = MeshOptimizer::Optimize(mesh_data);
+		mesh.m_positions = mesh_data.m_positions;
+		mesh.m_bbox = MeshletBuilder::CalculateBoundingBox<Vertex>(mesh_data);
+		num_triangles += mesh.m_indices.size() / 3;
+	}
+
+	std::vector<std::vector<MeshletCluster>> clusters(meshes.size());
+	for (auto _ : state)
+	{
+		for (std::size_t i = 0; i < meshes.size(); i++)
+		{
+			BuildMeshletData(meshes[i].m_positions, meshes[i].m_indices, meshes[i].m_bbox, clusters[i]);
+		}
+	}
+
+	// Report the quality of the model as a whole.
+	std::vector<MeshletCluster> all_clusters;
+	std::vector<glm::vec3> all_positions;
+	std::vector<std::uint32_t> all_indices;
+	for (std::size_t i = 0; i < meshes.size(); i++)
+	{
+		auto first_vertex = static_cast<std::uint32_t>(all_positions.size());
+		auto first_triangle = static_cast<std::uint32_t>(all_indices.size() / 3);
+
+		all_positions.insert(all_positions.end(), meshes[i].m_positions.begin(), meshes[i].m_positions.end());
+		for (auto index : meshes[i].m_indices)
+		{
+			all_indices.push_back(index + first_vertex);
+		}
+		for (auto cluster : clusters[i])
+		{
+			for (auto& v : cluster.m_vertices) v += first_vertex;
+			for (auto& t : cluster.m_triangles) t += first_triangle;
+			all_clusters.push_back(std::move(cluster));
+		}
+	}
+
+	ReportQuality(state, all_clusters, all_positions, all_indices);
+	state.counters["triangles"] = static_cast<double>(num_triangles);
+	state.SetItemsProcessed(state.iterations() * num_triangles);
+}
+
+//! Registers a benchmark for every model found in the resources directory. Models that aren't present are skipped.
+static bool RegisterResourceBenchmarks()
+{
+	static const std::array<const char*, 3> search_directories = { "", "resources/", "../resources/" };
+	static const std::array<const char*, 6> models = {
+		"grass/scene.gltf", "small_grass/scene.gltf", "tree/scene.gltf", "robot/scene.gltf", "baby_robot/scene.gltf", "tie/scene.gltf"
+	};
+
+	for (auto model : models)
+	{
+		for (auto directory : search_directories)
+		{
+			auto path = std::string(directory) + model;
+			if (std::filesystem::exists(path))
+			{
+				benchmark::RegisterBenchmark(("BM_BuildMeshletsResource/" + std::string(model)).c_str(), BM_BuildMeshletsResource, path)
+					->Unit(benchmark::kMillisecond);
+				break;
+			}
+		}
+	}
+
+	return true;
+}
+
+static const bool resource_benchmarks_registered = RegisterResourceBenchmarks();
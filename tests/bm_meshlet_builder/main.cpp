@@ -0,0 +1,149 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <meshlet_builder.hpp>
+
+#include "test_meshes.hpp"
+
+//! The flattening code `ModelPool::LoadWithMaterials` used before `MeshletBuilder::FlattenMeshlets`. Kept as a baseline.
+static void FlattenMeshletsReference(std::vector<MeshletCluster> const & meshlets,
+	std::vector<std::uint32_t> const & indices,
+	std::vector<MeshletDesc>& meshlet_data,
+	std::vector<std::uint32_t>& vertex_indices,
+	std::vector<std::uint8_t>& index_indices)
+{
+	meshlet_data.clear();
+	vertex_indices.clear();
+	index_indices.clear();
+
+	int vertices_start = 0;
+	int prim_begin = 0;
+
+	for (auto const & cluster : meshlets)
+	{
+		MeshletDesc meshlet = {};
+
+		std::vector<std::uint32_t> meshlet_vertex_indices;
+		std::vector<std::uint32_t> meshlet_indices;
+
+		for (auto t : cluster.m_triangles)
+		{
+			for (auto k = 0; k < 3; k++)
+			{
+				meshlet_indices.push_back(indices[t * 3 + k]);
+			}
+		}
+
+		std::vector<std::uint8_t> flat_meshlet_indices(meshlet_indices.size());
+		std::vector<std::pair<std::uint32_t, std::uint8_t>> flat_helper; // first = original, second = flat
+
+		for (std::size_t i = 0; i < meshlet_indices.size(); i++)
+		{
+			auto index = meshlet_indices[i];
+
+			if (std::find(meshlet_vertex_indices.begin(), meshlet_vertex_indices.end(), index) == meshlet_vertex_indices.end())
+			{
+				meshlet_vertex_indices.push_back(index);
+				auto new_flat_idx = static_cast<std::uint8_t>(meshlet_vertex_indices.size() - 1);
+				flat_meshlet_indices[i] = new_flat_idx;
+				flat_helper.push_back({ index, new_flat_idx });
+			}
+			else
+			{
+				for (auto const & pair : flat_helper)
+				{
+					if (pair.first == index)
+					{
+						flat_meshlet_indices[i] = pair.second;
+						break;
+					}
+				}
+			}
+		}
+
+		auto alligned_vertices_start = SizeAlignTwoPower(vertices_start, vertex_packing_alignment);
+		for (auto i = 0; i < alligned_vertices_start - vertices_start; i++)
+		{
+			vertex_indices.push_back(0);
+		}
+
+		vertices_start = alligned_vertices_start;
+
+		meshlet.SetNumVertices(meshlet_vertex_indices.size());
+		meshlet.SetVertexBegin(vertices_start);
+		meshlet.SetNumPrims(cluster.m_triangles.size());
+		meshlet.SetPrimBegin(prim_begin);
+
+		vertices_start += meshlet_vertex_indices.size();
+		prim_begin += flat_meshlet_indices.size() / 3;
+
+		vertex_indices.insert(vertex_indices.end(), meshlet_vertex_indices.begin(), meshlet_vertex_indices.end());
+		index_indices.insert(index_indices.end(), flat_meshlet_indices.begin(), flat_meshlet_indices.end());
+		meshlet_data.push_back(meshlet);
+	}
+}
+
+// 708 * 708 * 2 = 1,002,528 triangles
+static std::uint32_t grid_quads_per_side = 708;
+
+static void BM_FlattenMeshletsReference(benchmark::State& state)
+{
+	std::vector<glm::vec3> positions;
+	std::vector<std::uint32_t> indices;
+	CreateGrid(grid_quads_per_side, positions, indices);
+	auto meshlets = MeshletBuilder::BuildMeshlets(positions, indices);
+
+	std::vector<MeshletDesc> descs;
+	std::vector<std::uint32_t> vertex_indices;
+	std::vector<std::uint8_t> flat_indices;
+
+	for (auto _ : state)
+	{
+		FlattenMeshletsReference(meshlets, indices, descs, vertex_indices, flat_indices);
+		benchmark::DoNotOptimize(flat_indices.data());
+	}
+
+	state.SetItemsProcessed(state.iterations() * (indices.size() / 3));
+}
+
+static void BM_FlattenMeshlets(benchmark::State& state)
+{
+	std::vector<glm::vec3> positions;
+	std::vector<std::uint32_t> indices;
+	CreateGrid(grid_quads_per_side, positions, indices);
+	auto meshlets = MeshletBuilder::BuildMeshlets(positions, indices);
+
+	std::vector<MeshletDesc> descs;
+	std::vector<std::uint32_t> vertex_indices;
+	std::vector<std::uint8_t> flat_indices;
+
+	// Make sure the fast path produces the same buffers as the reference.
+	{
+		std::vector<MeshletDesc> ref_descs;
+		std::vector<std::uint32_t> ref_vertex_indices;
+		std::vector<std::uint8_t> ref_flat_indices;
+		FlattenMeshletsReference(meshlets, indices, ref_descs, ref_vertex_indices, ref_flat_indices);
+		MeshletBuilder::FlattenMeshlets(meshlets, indices, positions.size(), descs, vertex_indices, flat_indices);
+
+		bool descs_match = descs.size() == ref_descs.size() && std::equal(descs.begin(), descs.end(), ref_descs.begin(),
+			[](MeshletDesc const & a, MeshletDesc const & b) { return a.m_x == b.m_x && a.m_y == b.m_y && a.m_z == b.m_z && a.m_w == b.m_w; });
+
+		if (!descs_match || vertex_indices != ref_vertex_indices || flat_indices != ref_flat_indices)
+		{
+			state.SkipWithError("FlattenMeshlets output differs from the reference implementation");
+			return;
+		}
+	}
+
+	for (auto _ : state)
+	{
+		MeshletBuilder::FlattenMeshlets(meshlets, indices, positions.size(), descs, vertex_indices, flat_indices);
+		benchmark::DoNotOptimize(flat_indices.data());
+	}
+
+	state.SetItemsProcessed(state.iterations() * (indices.size() / 3));
+}
+
+BENCHMARK(BM_FlattenMeshletsReference)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_FlattenMeshlets)->Unit(benchmark::kMillisecond);
+BENCHMARK_MAIN();
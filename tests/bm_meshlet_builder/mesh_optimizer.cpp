@@ -0,0 +1,98 @@
+#include <benchmark/benchmark.h>
+
+#include <mesh_optimizer.hpp>
+#include <meshlet_builder.hpp>
+
+#include "test_meshes.hpp"
+
+static void ReportVertexCache(benchmark::State& state, std::string const & prefix, std::vector<std::uint32_t> const & indices, std::size_t num_vertices)
+{
+	auto stats = MeshOptimizer::AnalyzeVertexCache(indices, num_vertices);
+	state.counters[prefix + "_acmr"] = stats.m_acmr;
+	state.counters[prefix + "_atvr"] = stats.m_atvr;
+}
+
+static void ReportMeshlets(benchmark::State& state, std::string const & prefix, std::vector<glm::vec3> const & positions, std::vector<std::uint32_t> const & indices)
+{
+	auto meshlets = MeshletBuilder::BuildMeshlets(positions, indices);
+	auto stats = MeshletBuilder::CalculateStats(meshlets, positions, indices);
+	state.counters[prefix + "_meshlets"] = static_cast<double>(stats.m_num_meshlets);
+	state.counters[prefix + "_vpt"] = stats.m_vertices_per_triangle;
+}
+
+// Shuffled sphere of 2 * 256 * 512 = 262,144 triangles. Reports ACMR/ATVR of the input and of every pass.
+static void BM_OptimizeVertexCache(benchmark::State& state)
+{
+	std::vector<glm::vec3> positions;
+	std::vector<std::uint32_t> indices;
+	CreateSphere(256, 512, positions, indices);
+	ShuffleTriangles(indices);
+
+	std::vector<std::uint32_t> optimized;
+	for (auto _ : state)
+	{
+		optimized = MeshOptimizer::OptimizeVertexCache(indices, positions.size());
+		benchmark::DoNotOptimize(optimized.data());
+	}
+
+	ReportVertexCache(state, "input", indices, positions.size());
+	ReportVertexCache(state, "output", optimized, positions.size());
+	state.SetItemsProcessed(state.iterations() * (indices.size() / 3));
+}
+
+static void BM_OptimizeOverdraw(benchmark::State& state)
+{
+	std::vector<glm::vec3> positions;
+	std::vector<std::uint32_t> indices;
+	CreateSphere(256, 512, positions, indices);
+	ShuffleTriangles(indices);
+	indices = MeshOptimizer::OptimizeVertexCache(indices, positions.size());
+
+	std::vector<std::uint32_t> optimized;
+	for (auto _ : state)
+	{
+		optimized = MeshOptimizer::OptimizeOverdraw(indices, positions);
+		benchmark::DoNotOptimize(optimized.data());
+	}
+
+	// The overdraw pass is allowed to trade a bit of cache efficiency for draw order.
+	ReportVertexCache(state, "input", indices, positions.size());
+	ReportVertexCache(state, "output", optimized, positions.size());
+	state.SetItemsProcessed(state.iterations() * (indices.size() / 3));
+}
+
+static void BM_OptimizeMesh(benchmark::State& state)
+{
+	std::vector<glm::vec3> positions;
+	std::vector<std::uint32_t> indices;
+	CreateSphere(256, 512, positions, indices);
+	ShuffleTriangles(indices);
+
+	MeshData mesh_data = {};
+	mesh_data.m_positions = positions;
+	mesh_data.m_num_indices = indices.size();
+	mesh_data.m_indices_stride = sizeof(std::uint32_t);
+	mesh_data.m_indices.resize(indices.size() * sizeof(std::uint32_t));
+
+	std::vector<std::uint32_t> optimized;
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		mesh_data.m_positions = positions;
+		memcpy(mesh_data.m_indices.data(), indices.data(), mesh_data.m_indices.size());
+		state.ResumeTiming();
+
+		optimized = MeshOptimizer::Optimize(mesh_data);
+		benchmark::DoNotOptimize(optimized.data());
+	}
+
+	ReportVertexCache(state, "input", indices, positions.size());
+	ReportVertexCache(state, "output", optimized, positions.size());
+	ReportMeshlets(state, "input", positions, indices);
+	ReportMeshlets(state, "output", mesh_data.m_positions, optimized);
+	state.SetItemsProcessed(state.iterations() * (indices.size() / 3));
+}
+
+BENCHMARK(BM_OptimizeVertexCache)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_OptimizeOverdraw)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_OptimizeMesh)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,34 @@
+#include <benchmark/benchmark.h>
+
+#include <mesh_simplifier.hpp>
+
+#include "test_meshes.hpp"
+
+// Sphere of 2 * 128 * 256 = 65,536 triangles. Reports the triangle count and relative error of every level.
+static void BM_GenerateLods(benchmark::State& state)
+{
+	std::vector<glm::vec3> positions;
+	std::vector<std::uint32_t> indices;
+	CreateSphere(128, 256, positions, indices);
+
+	std::vector<MeshLodData> lods;
+	for (auto _ : state)
+	{
+		lods = MeshSimplifier::GenerateLods(indices, positions, 4);
+		benchmark::DoNotOptimize(lods.data());
+	}
+
+	for (std::size_t i = 0; i < lods.size(); i++)
+	{
+		state.counters["lod" + std::to_string(i + 1) + "_triangles"] = static_cast<double>(lods[i].m_indices.size() / 3);
+		state.counters["lod" + std::to_string(i + 1) + "_error"] = lods[i].m_error;
+	}
+	state.SetItemsProcessed(state.iterations() * (indices.size() / 3));
+
+	if (lods.empty() || lods.back().m_error > default_lod_max_error)
+	{
+		state.SkipWithError("Simplification failed or exceeded the error bound");
+	}
+}
+
+BENCHMARK(BM_GenerateLods)->Unit(benchmark::kMillisecond);
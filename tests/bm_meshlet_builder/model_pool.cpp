@@ -0,0 +1,208 @@
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <memory>
+#include <host_model_pool.hpp>
+#include <compressed_vertex.hpp>
+#include <vertex.hpp>
+
+#include "test_meshes.hpp"
+
+//! Sphere with all attributes filled in and 32 bit indices.
+static ModelData CreateSphereModel(std::uint32_t size)
+{
+	std::vector<glm::vec3> positions;
+	std::vector<std::uint32_t> indices;
+	CreateSphere(size, size * 2, positions, indices);
+
+	MeshData mesh = {};
+	mesh.m_positions = positions;
+	mesh.m_normals = positions;
+	mesh.m_uvw.resize(positions.size(), glm::vec3(0.5f, 0.5f, 0));
+	mesh.m_tangents.resize(positions.size(), glm::vec3(1, 0, 0));
+	mesh.m_bitangents.resize(positions.size(), glm::vec3(0, 1, 0));
+	mesh.m_indices.resize(indices.size() * sizeof(std::uint32_t));
+	std::memcpy(mesh.m_indices.data(), indices.data(), mesh.m_indices.size());
+	mesh.m_num_indices = indices.size();
+	mesh.m_indices_stride = sizeof(std::uint32_t);
+	mesh.m_material_id = 0;
+
+	ModelData model = {};
+	model.m_meshes.push_back(std::move(mesh));
+	model.m_materials.resize(1);
+	return model;
+}
+
+//! Checks that every meshlet of every level only references data inside the buffers of its mesh.
+static bool ValidateMeshlets(HostModelPool const & pool, ModelHandle const & model)
+{
+	for (auto const & mesh_handle : model.m_mesh_handles)
+	{
+		for (std::size_t lod = 0; lod < mesh_handle.GetNumLods(); lod++)
+		{
+			auto handle = mesh_handle.GetLod(lod);
+			auto const & mesh = pool.GetMesh(handle.m_id);
+			if (mesh.m_num_vertices != handle.m_num_vertices || mesh.m_num_indices != handle.m_num_indices)
+			{
+				return false;
+			}
+
+			std::uint32_t num_prims = 0;
+			for (auto const & meshlet : mesh.m_meshlets)
+			{
+				auto vertex_begin = meshlet.GetVertexBegin();
+				auto prim_begin = meshlet.GetPrimBegin();
+				if (vertex_begin + meshlet.GetNumVertices() > mesh.m_vertex_indices.size()
+					|| (prim_begin + meshlet.GetNumPrims()) * 3 > mesh.m_flat_indices.size())
+				{
+					return false;
+				}
+
+				for (auto v = vertex_begin; v < vertex_begin + meshlet.GetNumVertices(); v++)
+				{
+					if (mesh.m_vertex_indices[v] >= mesh.m_num_vertices) return false;
+				}
+				for (auto i = prim_begin * 3; i < (prim_begin + meshlet.GetNumPrims()) * 3; i++)
+				{
+					if (mesh.m_flat_indices[i] >= meshlet.GetNumVertices()) return false;
+				}
+
+				num_prims += meshlet.GetNumPrims();
+			}
+
+			if (num_prims * 3 != mesh.m_num_indices)
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+// Runs the complete load pipeline (optimization, meshlets, levels of detail) on a sphere of 4 * size^2 triangles.
+template<typename V_T>
+static void BM_LoadModel(benchmark::State& state)
+{
+	auto source = CreateSphereModel(static_cast<std::uint32_t>(state.range(0)));
+
+	std::unique_ptr<HostModelPool> pool;
+	ModelHandle handle;
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		auto data = source;
+		pool = std::make_unique<HostModelPool>();
+		state.ResumeTiming();
+
+		handle = pool->Load<V_T>(&data);
+		benchmark::DoNotOptimize(handle.m_mesh_handles.data());
+	}
+
+	auto const & stats = pool->GetStats();
+	auto num_triangles = source.m_meshes[0].m_num_indices / 3;
+	state.counters["meshes"] = stats.m_num_meshes;
+	state.counters["meshlets"] = stats.m_num_meshlets;
+	state.counters["bytes_per_triangle"] = double(stats.GetTotalBytes()) / double(num_triangles);
+	state.SetItemsProcessed(state.iterations() * num_triangles);
+
+	if (!ValidateMeshlets(*pool, handle))
+	{
+		state.SkipWithError("Loaded meshlets reference data outside of their mesh");
+	}
+}
+
+BENCHMARK_TEMPLATE(BM_LoadModel, Vertex)->Arg(64)->Arg(256)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_LoadModel, CompressedVertex)->Arg(64)->Arg(256)->Unit(benchmark::kMillisecond);
+
+// Fills a pool with small meshes until it is exhausted, frees every other mesh and fills the freed ranges again.
+static void BM_HostModelPoolAllocation(benchmark::State& state)
+{
+	const auto num_meshes = static_cast<std::uint32_t>(state.range(0));
+	const std::uint32_t num_vertices = 64;
+	const std::uint32_t num_indices = 96;
+	const std::uint64_t capacity = std::uint64_t(num_meshes) * num_vertices * sizeof(Vertex);
+
+	std::vector<Vertex> vertices(num_vertices);
+	std::vector<std::uint32_t> indices(num_indices);
+	MeshletDesc meshlet = {};
+
+	std::uint32_t num_reused = 0;
+	for (auto _ : state)
+	{
+		HostModelPool pool(256, capacity);
+
+		// Tags the vertices with the id the mesh will get so overlapping allocations show up as corrupted meshes.
+		auto allocate = [&]()
+		{
+			auto id = static_cast<std::uint32_t>(pool.GetNumMeshes());
+			vertices[0].m_pos.x = float(id);
+			vertices[num_vertices - 1].m_pos.x = float(id);
+			pool.AllocateMeshShadingBuffers({ 0 }, { 0, 0, 0 });
+			return pool.AllocateMesh(vertices.data(), num_vertices, sizeof(Vertex), indices.data(), num_indices, sizeof(std::uint32_t), &meshlet, 1);
+		};
+
+		for (std::uint32_t i = 0; i < num_meshes; i++)
+		{
+			if (allocate().m_vb == HostModelPool::invalid_offset)
+			{
+				state.SkipWithError("Allocation failed before the pool was full");
+				return;
+			}
+		}
+
+		if (allocate().m_vb != HostModelPool::invalid_offset)
+		{
+			state.SkipWithError("Allocation succeeded in a full pool");
+			return;
+		}
+
+		auto vb_size = pool.GetVertexBufferSize();
+		auto ib_size = pool.GetIndexBufferSize();
+
+		for (std::uint32_t i = 0; i < num_meshes; i += 2)
+		{
+			pool.FreeMesh(i);
+		}
+
+		num_reused = 0;
+		while (allocate().m_vb != HostModelPool::invalid_offset)
+		{
+			num_reused++;
+		}
+
+		if (num_reused != (num_meshes + 1) / 2 || pool.GetVertexBufferSize() != vb_size || pool.GetIndexBufferSize() != ib_size)
+		{
+			state.SkipWithError("Freed ranges weren't reused");
+			return;
+		}
+
+		for (std::uint32_t id = 0; id < pool.GetNumMeshes(); id++)
+		{
+			auto const & mesh = pool.GetMesh(id);
+			if (!mesh.m_allocated)
+			{
+				continue;
+			}
+
+			auto mesh_vertices = pool.GetVertices<Vertex>(id);
+			if (mesh_vertices[0].m_pos.x != float(id) || mesh_vertices[num_vertices - 1].m_pos.x != float(id) || mesh.m_meshlets.size() != 1)
+			{
+				state.SkipWithError("Mesh data was overwritten by another allocation");
+				return;
+			}
+		}
+
+		auto const & stats = pool.GetStats();
+		if (stats.m_num_freed_meshes != (num_meshes + 1) / 2 || stats.m_num_failed_allocations != 2)
+		{
+			state.SkipWithError("Statistics don't match the allocations");
+			return;
+		}
+	}
+
+	state.counters["reused"] = num_reused;
+	state.SetItemsProcessed(state.iterations() * (num_meshes + num_reused));
+}
+
+BENCHMARK(BM_HostModelPoolAllocation)->Arg(64)->Arg(1024);
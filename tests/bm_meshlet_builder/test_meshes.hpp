@@ -0,0 +1,133 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <glm.hpp>
+
+//! Creates a regular grid of `2 * quads_per_side^2` triangles in the XY plane.
+inline void CreateGrid(std::uint32_t quads_per_side, std::vector<glm::vec3>& positions, std::vector<std::uint32_t>& indices)
+{
+	positions.clear();
+	indices.clear();
+
+	auto verts_per_side = quads_per_side + 1;
+	positions.reserve(verts_per_side * verts_per_side);
+	indices.reserve(quads_per_side * quads_per_side * 6);
+
+	for (std::uint32_t y = 0; y < verts_per_side; y++)
+	{
+		for (std::uint32_t x = 0; x < verts_per_side; x++)
+		{
+			positions.emplace_back(float(x), float(y), 0.f);
+		}
+	}
+
+	for (std::uint32_t y = 0; y < quads_per_side; y++)
+	{
+		for (std::uint32_t x = 0; x < quads_per_side; x++)
+		{
+			auto a = y * verts_per_side + x;
+			auto b = a + 1;
+			auto c = a + verts_per_side;
+			auto d = c + 1;
+			indices.insert(indices.end(), { a, b, c, b, d, c });
+		}
+	}
+}
+
+//! Creates a UV sphere with outward facing triangles.
+inline void CreateSphere(std::uint32_t rings, std::uint32_t segments, std::vector<glm::vec3>& positions, std::vector<std::uint32_t>& indices)
+{
+	positions.clear();
+	indices.clear();
+
+	for (std::uint32_t r = 0; r <= rings; r++)
+	{
+		for (std::uint32_t s = 0; s <= segments; s++)
+		{
+			float theta = 3.14159265f * float(r) / float(rings);
+			float phi = 6.28318531f * float(s) / float(segments);
+			positions.emplace_back(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+		}
+	}
+
+	for (std::uint32_t r = 0; r < rings; r++)
+	{
+		for (std::uint32_t s = 0; s < segments; s++)
+		{
+			auto a = r * (segments + 1) + s;
+			auto b = a + 1;
+			auto c = a + segments + 1;
+			auto d = c + 1;
+			indices.insert(indices.end(), { a, c, b, b, c, d });
+		}
+	}
+}
+
+//! Creates disconnected triangles with random positions inside a unit cube.
+inline void CreateTriangleSoup(std::uint32_t num_triangles, std::vector<glm::vec3>& positions, std::vector<std::uint32_t>& indices)
+{
+	positions.clear();
+	indices.clear();
+
+	std::mt19937 rng(1337);
+	std::uniform_real_distribution<float> dist(0.f, 1.f);
+
+	for (std::uint32_t t = 0; t < num_triangles; t++)
+	{
+		glm::vec3 center(dist(rng), dist(rng), dist(rng));
+		for (auto k = 0; k < 3; k++)
+		{
+			positions.push_back(center + glm::vec3(dist(rng), dist(rng), dist(rng)) * 0.01f);
+			indices.push_back(static_cast<std::uint32_t>(positions.size() - 1));
+		}
+	}
+}
+
+//! Creates triangles that index random vertices of a shared pool of `num_vertices` random positions. Worst case for vertex reuse.
+inline void CreateRandomIndexedSoup(std::uint32_t num_vertices, std::uint32_t num_triangles, std::vector<glm::vec3>& positions, std::vector<std::uint32_t>& indices)
+{
+	positions.clear();
+	indices.clear();
+
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> dist(0.f, 1.f);
+	std::uniform_int_distribution<std::uint32_t> vertex_dist(0, num_vertices - 1);
+
+	for (std::uint32_t v = 0; v < num_vertices; v++)
+	{
+		positions.emplace_back(dist(rng), dist(rng), dist(rng));
+	}
+
+	for (std::uint32_t t = 0; t < num_triangles; t++)
+	{
+		std::uint32_t a = vertex_dist(rng), b, c;
+		do { b = vertex_dist(rng); } while (b == a);
+		do { c = vertex_dist(rng); } while (c == a || c == b);
+		indices.insert(indices.end(), { a, b, c });
+	}
+}
+
+//! Randomizes the triangle order to simulate a index buffer without any locality.
+inline void ShuffleTriangles(std::vector<std::uint32_t>& indices)
+{
+	std::vector<std::uint32_t> order(indices.size() / 3);
+	for (std::size_t i = 0; i < order.size(); i++)
+	{
+		order[i] = static_cast<std::uint32_t>(i);
+	}
+	std::shuffle(order.begin(), order.end(), std::mt19937(42));
+
+	std::vector<std::uint32_t> shuffled(indices.size());
+	for (std::size_t i = 0; i < order.size(); i++)
+	{
+		for (auto k = 0; k < 3; k++)
+		{
+			shuffled[i * 3 + k] = indices[order[i] * 3 + k];
+		}
+	}
+	indices = std::move(shuffled);
+}
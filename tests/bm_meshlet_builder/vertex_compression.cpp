@@ -0,0 +1,92 @@
+#include <benchmark/benchmark.h>
+
+#include <compressed_vertex.hpp>
+
+#include "test_meshes.hpp"
+
+// Sphere scaled to 100 units with a tangent frame and uvs in [0, 4] so the half precision uvs get exercised.
+static MeshData CreateSphereMeshData()
+{
+	MeshData mesh_data = {};
+
+	std::vector<std::uint32_t> indices;
+	CreateSphere(128, 256, mesh_data.m_positions, indices);
+
+	for (std::size_t i = 0; i < mesh_data.m_positions.size(); i++)
+	{
+		auto& pos = mesh_data.m_positions[i];
+		glm::vec3 normal = glm::normalize(pos);
+		glm::vec3 tangent = glm::cross(glm::vec3(0, 1, 0), normal);
+		tangent = glm::length(tangent) > 0.001f ? glm::normalize(tangent) : glm::vec3(1, 0, 0);
+		// Mirror every other vertex to cover both bitangent signs.
+		float sign = (i % 2) ? -1.f : 1.f;
+
+		mesh_data.m_normals.push_back(normal);
+		mesh_data.m_tangents.push_back(tangent);
+		mesh_data.m_bitangents.push_back(glm::cross(normal, tangent) * sign);
+		mesh_data.m_uvw.push_back(glm::vec3(normal.x * 2.f + 2.f, normal.y * 2.f + 2.f, 0));
+		pos *= 100.f;
+	}
+
+	return mesh_data;
+}
+
+static float AngleDegrees(glm::vec3 a, glm::vec3 b)
+{
+	return glm::degrees(std::acos(std::clamp(glm::dot(glm::normalize(a), glm::normalize(b)), -1.f, 1.f)));
+}
+
+// Encodes every vertex, decodes it again and reports the worst error per attribute.
+template<typename V_T>
+static void BM_VertexCompression(benchmark::State& state)
+{
+	auto mesh_data = CreateSphereMeshData();
+	auto bbox = MeshletBuilder::CalculateBoundingBox<V_T>(mesh_data);
+	auto num_vertices = mesh_data.m_positions.size();
+
+	std::vector<V_T> vertices(num_vertices);
+	for (auto _ : state)
+	{
+		for (std::size_t i = 0; i < num_vertices; i++)
+		{
+			vertices[i] = V_T::Encode(mesh_data, i, bbox);
+		}
+		benchmark::DoNotOptimize(vertices.data());
+	}
+
+	float max_position_error = 0;
+	float max_uv_error = 0;
+	float max_normal_error = 0;
+	float max_tangent_error = 0;
+	float max_bitangent_error = 0;
+	for (std::size_t i = 0; i < num_vertices; i++)
+	{
+		auto vertex = vertices[i].Decode(bbox);
+		max_position_error = std::max(max_position_error, glm::length(vertex.m_pos - mesh_data.m_positions[i]));
+		max_uv_error = std::max(max_uv_error, glm::length(vertex.m_uv - glm::vec2(mesh_data.m_uvw[i].x, mesh_data.m_uvw[i].y)));
+		max_normal_error = std::max(max_normal_error, AngleDegrees(vertex.m_normal, mesh_data.m_normals[i]));
+		max_tangent_error = std::max(max_tangent_error, AngleDegrees(vertex.m_tangent, mesh_data.m_tangents[i]));
+		max_bitangent_error = std::max(max_bitangent_error, AngleDegrees(vertex.m_bitangent, mesh_data.m_bitangents[i]));
+	}
+
+	state.counters["bytes_per_vertex"] = static_cast<double>(sizeof(V_T));
+	state.counters["compression_ratio"] = static_cast<double>(sizeof(Vertex)) / sizeof(V_T);
+	state.counters["max_position_error"] = max_position_error;
+	state.counters["max_uv_error"] = max_uv_error;
+	state.counters["max_normal_error_deg"] = max_normal_error;
+	state.counters["max_tangent_error_deg"] = max_tangent_error;
+	state.counters["max_bitangent_error_deg"] = max_bitangent_error;
+	state.SetItemsProcessed(state.iterations() * num_vertices);
+
+	// A flipped bitangent shows up as a 180 degree error.
+	glm::vec3 extent = bbox.m_max - bbox.m_min;
+	float position_tolerance = glm::length(extent) / 65535.f;
+	if (max_position_error > position_tolerance || max_uv_error > 0.005f
+		|| max_normal_error > 0.05f || max_tangent_error > 0.1f || max_bitangent_error > 0.2f)
+	{
+		state.SkipWithError("Round trip error exceeds the tolerance");
+	}
+}
+
+BENCHMARK_TEMPLATE(BM_VertexCompression, CompressedVertex)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_VertexCompression, QuantizedVertex)->Unit(benchmark::kMillisecond);
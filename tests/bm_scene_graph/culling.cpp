@@ -0,0 +1,125 @@
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <algorithm>
+#define GLM_FORCE_RADIANS
+#include <gtc/matrix_transform.hpp>
+#include <scene_graph/culling.hpp>
+
+static std::uint32_t num_instances = 100000;
+
+static std::vector<sg::AABB> CreateRandomBounds(std::mt19937& rng)
+{
+	std::uniform_real_distribution<float> position_dist(-500.f, 500.f);
+	std::uniform_real_distribution<float> size_dist(0.5f, 4.f);
+
+	std::vector<sg::AABB> bounds;
+	for (std::uint32_t i = 0; i < num_instances; i++)
+	{
+		glm::vec3 position(position_dist(rng), position_dist(rng), position_dist(rng));
+		glm::vec3 size(size_dist(rng), size_dist(rng), size_dist(rng));
+		bounds.push_back({ position, position + size });
+	}
+
+	return bounds;
+}
+
+static glm::mat4 CreateViewProjection()
+{
+	auto proj = glm::perspective(glm::radians(60.f), 16.f / 9.f, 0.01f, 1000.0f);
+	proj[1][1] *= -1;
+	return proj * glm::lookAt(glm::vec3(0, 0, 0), glm::vec3(1, 0.2f, 0.5f), glm::vec3(0, 1, 0));
+}
+
+// Tests every box, the cost without a hierarchy.
+static void BM_FrustumCullBruteForce(benchmark::State& state)
+{
+	std::mt19937 rng(1337);
+	auto bounds = CreateRandomBounds(rng);
+	auto frustum = sg::ExtractFrustum(CreateViewProjection());
+
+	std::vector<std::uint32_t> visible;
+	for (auto _ : state)
+	{
+		visible.clear();
+		for (std::uint32_t i = 0; i < num_instances; i++)
+		{
+			if (sg::TestAABB(frustum, bounds[i]) != sg::CullResult::OUTSIDE)
+			{
+				visible.push_back(i);
+			}
+		}
+		benchmark::DoNotOptimize(visible.data());
+	}
+
+	state.counters["visible"] = visible.size();
+	state.SetItemsProcessed(state.iterations() * num_instances);
+}
+
+// Moves `state.range(0)` percent of the proxies each iteration before querying, like a scene with moving objects.
+static void BM_FrustumCullTree(benchmark::State& state)
+{
+	std::mt19937 rng(1337);
+	auto bounds = CreateRandomBounds(rng);
+	auto frustum = sg::ExtractFrustum(CreateViewProjection());
+
+	sg::AABBTree tree;
+	std::vector<std::int32_t> proxies;
+	for (std::uint32_t i = 0; i < num_instances; i++)
+	{
+		proxies.push_back(tree.CreateProxy(bounds[i], i));
+	}
+
+	std::uniform_int_distribution<std::uint32_t> instance_dist(0, num_instances - 1);
+	std::uniform_real_distribution<float> offset_dist(-0.05f, 0.05f);
+	auto num_moved = num_instances * state.range(0) / 100;
+
+	std::vector<std::uint32_t> visible;
+	for (auto _ : state)
+	{
+		for (std::uint32_t i = 0; i < num_moved; i++)
+		{
+			auto instance = instance_dist(rng);
+			glm::vec3 offset(offset_dist(rng), offset_dist(rng), offset_dist(rng));
+			bounds[instance] = { bounds[instance].m_min + offset, bounds[instance].m_max + offset };
+			tree.MoveProxy(proxies[instance], bounds[instance]);
+		}
+
+		visible.clear();
+		tree.Query(frustum, visible);
+		benchmark::DoNotOptimize(visible.data());
+	}
+
+	// The tree works on the grown boxes, so compare against testing all of them one by one.
+	std::vector<std::uint32_t> expected;
+	bool contains_bounds = true;
+	for (std::uint32_t i = 0; i < num_instances; i++)
+	{
+		contains_bounds &= sg::Contains(tree.GetFatAABB(proxies[i]), bounds[i]);
+		if (sg::TestAABB(frustum, tree.GetFatAABB(proxies[i])) != sg::CullResult::OUTSIDE)
+		{
+			expected.push_back(i);
+		}
+	}
+	std::sort(visible.begin(), visible.end());
+
+	state.counters["visible"] = visible.size();
+	state.counters["height"] = tree.GetHeight();
+	state.SetItemsProcessed(state.iterations() * num_instances);
+
+	if (!contains_bounds)
+	{
+		state.SkipWithError("A proxy doesn't contain the box it got moved to");
+	}
+	else if (visible != expected)
+	{
+		state.SkipWithError("The tree query differs from testing every proxy");
+	}
+	else if (tree.GetHeight() > 4 * std::log2(num_instances))
+	{
+		state.SkipWithError("The tree is out of balance");
+	}
+}
+
+BENCHMARK(BM_FrustumCullBruteForce)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_FrustumCullTree)->Arg(0)->Arg(10)->Unit(benchmark::kMicrosecond);
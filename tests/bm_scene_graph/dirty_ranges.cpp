@@ -0,0 +1,84 @@
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <algorithm>
+#include <host_constant_buffer_pool.hpp>
+#include <scene_graph/scene_graph.hpp>
+
+// Writes `state.range(1)` random instances into each of `state.range(0)` pages per frame and flushes, like the scene graph does with moving batches.
+static void BM_ConstantBufferPoolFlush(benchmark::State& state)
+{
+	auto page_size = sizeof(sg::Matrix3x4) * gfx::settings::instances_per_page;
+	HostConstantBufferPool pool(page_size, gfx::settings::max_instance_pages);
+
+	std::vector<ConstantBufferHandle> pages(state.range(0));
+	for (auto& page : pages)
+	{
+		page = pool.Allocate(page_size);
+	}
+
+	std::mt19937 rng(1337);
+	std::uniform_int_distribution<std::uint32_t> instance_dist(0, gfx::settings::instances_per_page - 1);
+	sg::Matrix3x4 data = {};
+
+	std::vector<std::uint8_t> written(pool.GetOffset(pages.back()) + page_size);
+	bool covered = true;
+	bool disjoint = true;
+
+	std::uint32_t frame_idx = 0;
+	for (auto _ : state)
+	{
+		for (auto const & page : pages)
+		{
+			for (std::int64_t i = 0; i < state.range(1); i++)
+			{
+				auto offset = instance_dist(rng) * sizeof(sg::Matrix3x4);
+				pool.Update(page, sizeof(sg::Matrix3x4), &data, frame_idx, offset);
+
+				if (state.iterations() == 0 && frame_idx == 0)
+				{
+					std::fill_n(written.begin() + pool.GetOffset(page) + offset, sizeof(sg::Matrix3x4), 1);
+				}
+			}
+		}
+
+		// Check the merged ranges of the first frame against the bytes that got written.
+		if (state.iterations() == 0 && frame_idx == 0)
+		{
+			state.PauseTiming();
+			auto dirty_ranges = pool.GetDirtyRanges(frame_idx);
+			auto const & ranges = dirty_ranges.GetRanges();
+			for (std::size_t i = 0; i < ranges.size(); i++)
+			{
+				disjoint &= i == 0 || ranges[i].m_offset > ranges[i - 1].m_offset + ranges[i - 1].m_size;
+				std::fill_n(written.begin() + ranges[i].m_offset, ranges[i].m_size, 0);
+			}
+			covered = std::find(written.begin(), written.end(), 1) == written.end();
+			state.ResumeTiming();
+		}
+
+		pool.Flush(frame_idx);
+		frame_idx = (frame_idx + 1) % gfx::settings::num_back_buffers;
+	}
+
+	auto const & stats = pool.GetStats();
+	state.counters["flushed_ranges"] = benchmark::Counter(static_cast<double>(stats.m_num_flushed_ranges), benchmark::Counter::kAvgIterations);
+	state.counters["flushed_bytes"] = benchmark::Counter(static_cast<double>(stats.m_flushed_bytes), benchmark::Counter::kAvgIterations);
+	state.counters["buffers"] = pages.size();
+	state.SetItemsProcessed(state.iterations() * pages.size() * state.range(1));
+
+	if (!covered)
+	{
+		state.SkipWithError("The dirty ranges don't cover every write");
+	}
+	else if (!disjoint)
+	{
+		state.SkipWithError("The dirty ranges aren't sorted and merged");
+	}
+	else if (stats.m_num_flushed_ranges > stats.m_num_updates)
+	{
+		state.SkipWithError("Flushed more ranges than there were writes");
+	}
+}
+
+BENCHMARK(BM_ConstantBufferPoolFlush)->ArgNames({ "pages", "writes_per_page" })->ArgsProduct({ { 16, 1024 }, { 1, 64, 1024 } })->Unit(benchmark::kMicrosecond);
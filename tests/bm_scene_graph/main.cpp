@@ -1,34 +1,17 @@
 #include <benchmark/benchmark.h>
 
-#include <renderer.hpp>
+#include <random>
+#include <cstdio>
+#include <string>
 #include <scene_graph/scene_graph.hpp>
-#include <application.hpp>
 #include <vertex.hpp>
 
-static std::uint32_t num_mesh_nodes = 100;
-
-class EmptyApp : public Application
-{
-public:
-	EmptyApp()
-		: Application("PBR Test")
-	{
-	}
-
-protected:
-	void Init() final {	}
-	void Loop() final {	}
+#include "test_scenes.hpp"
 
-};
+static std::uint32_t num_mesh_nodes = 100;
 
 static void BM_SceneGraphMeshNode(benchmark::State& state) {
-	auto app = new EmptyApp();
-	app->Create(100, 100);
-
-	auto renderer = new Renderer();
-	renderer->Init(app);
-
-	auto sg = new sg::SceneGraph(renderer);
+	auto sg = new sg::SceneGraph();
 
 	std::vector<sg::NodeHandle> nodes(num_mesh_nodes);
 	for (auto& node : nodes)
@@ -45,12 +28,329 @@ static void BM_SceneGraphMeshNode(benchmark::State& state) {
 		sg->Update(0);
 	}
 
-	app->Close();
+	delete sg;
+}
+
+// Creates `state.range(0)` mesh nodes spread over 4 models, batches them and moves every node each iteration.
+static void BM_SceneGraphMeshNodes(benchmark::State& state) {
+	auto sg = new sg::SceneGraph();
+
+	auto models = CreateFakeModels(4);
+
+	std::vector<sg::NodeHandle> nodes(state.range(0));
+	for (std::size_t i = 0; i < nodes.size(); i++)
+	{
+		nodes[i] = sg->CreateNode<sg::MeshComponent>(models[i % models.size()]);
+	}
+	sg->Update(0);
+
+	std::uint32_t frame_idx = 0;
+	for (auto _ : state)
+	{
+		for (auto& node : nodes)
+		{
+			sg::helper::Translate(sg, node, { 0, 0.01f, 0 });
+		}
+		sg->Update(frame_idx);
+		frame_idx = (frame_idx + 1) % gfx::settings::num_back_buffers;
+	}
+
+	// Batches page their instances, so every model needs exactly one batch no matter the instance count.
+	std::size_t num_batched = 0;
+	for (auto const & batch : sg->GetRenderBatches())
+	{
+		num_batched += batch.m_num_meshes;
+	}
+	state.counters["batches"] = sg->GetRenderBatches().size();
+	state.SetItemsProcessed(state.iterations() * nodes.size());
+
+	auto split = sg->GetRenderBatches().size() != models.size() || num_batched != nodes.size();
+
+	delete sg;
+
+	if (split)
+	{
+		state.SkipWithError("Meshes of a model didn't end up in a single batch");
+	}
+}
+
+// Creates `state.range(0)` roots with 8 children of 4 mesh nodes each and moves only the roots each iteration.
+static void BM_SceneGraphHierarchy(benchmark::State& state) {
+	auto sg = new sg::SceneGraph();
+
+	auto model = CreateFakeModel(0);
+
+	std::vector<sg::NodeHandle> roots(state.range(0));
+	sg::NodeHandle last_leaf = 0;
+	for (auto& root : roots)
+	{
+		root = sg->CreateNode<sg::TransformComponent>();
+		for (std::uint32_t i = 0; i < 8; i++)
+		{
+			auto child = sg->CreateNode<sg::TransformComponent>();
+			sg::helper::SetPosition(sg, child, { 1, 0, 0 });
+			sg->SetParent(child, root);
+
+			for (std::uint32_t j = 0; j < 4; j++)
+			{
+				last_leaf = sg->CreateNode<sg::MeshComponent>(model);
+				sg::helper::SetPosition(sg, last_leaf, { 0, 1, 0 });
+				sg->SetParent(last_leaf, child);
+			}
+		}
+	}
+	sg->Update(0);
+
+	std::uint32_t frame_idx = 0;
+	for (auto _ : state)
+	{
+		for (auto& root : roots)
+		{
+			sg::helper::Translate(sg, root, { 0, 0, 0.01f });
+		}
+		sg->Update(frame_idx);
+		frame_idx = (frame_idx + 1) % gfx::settings::num_back_buffers;
+	}
+
+	// The leaf should have moved along with its root.
+	auto root_position = sg->m_positions[sg->GetNode(roots.back()).m_transform_component].m_value;
+	auto leaf_position = glm::vec3(sg->m_models[sg->GetNode(last_leaf).m_transform_component].m_value[3]);
+	auto error = glm::length(leaf_position - (root_position + glm::vec3(1, 1, 0)));
+
+	state.counters["nodes"] = sg->GetNodes().size();
+	state.SetItemsProcessed(state.iterations() * sg->GetNodes().size());
+
+	delete sg;
+
+	if (error > 1e-3f)
+	{
+		state.SkipWithError("Child transforms didn't follow their parent");
+	}
+}
+
+// Keeps `state.range(0)` mesh nodes alive while replacing a tenth of them every iteration, like a streaming world.
+static void BM_SceneGraphChurn(benchmark::State& state) {
+	auto sg = new sg::SceneGraph();
+
+	auto models = CreateFakeModels(4);
+
+	std::vector<sg::NodeHandle> nodes(state.range(0));
+	for (std::size_t i = 0; i < nodes.size(); i++)
+	{
+		nodes[i] = sg->CreateNode<sg::MeshComponent>(models[i % models.size()]);
+	}
+	sg->Update(0);
+
+	std::mt19937 rng(1337);
+	std::uniform_int_distribution<std::size_t> node_dist(0, nodes.size() - 1);
+	auto num_replaced = nodes.size() / 10;
+	std::size_t num_stale_handles = 0;
+
+	std::uint32_t frame_idx = 0;
+	for (auto _ : state)
+	{
+		for (std::size_t i = 0; i < num_replaced; i++)
+		{
+			auto& node = nodes[node_dist(rng)];
+			auto old_handle = node;
+			sg->DestroyNode(node);
+			node = sg->CreateNode<sg::MeshComponent>(models[i % models.size()]);
+
+			num_stale_handles += sg->IsAlive(old_handle);
+		}
+		sg->Update(frame_idx);
+		frame_idx = (frame_idx + 1) % gfx::settings::num_back_buffers;
+	}
+
+	// Indices, batches and pages get reused, so none of them should grow past what the live nodes need.
+	std::size_t num_pages = 0, min_pages = 0;
+	for (auto const & batch : sg->GetRenderBatches())
+	{
+		num_pages += batch.m_pages.size();
+		min_pages += (batch.m_num_meshes + gfx::settings::instances_per_page - 1) / gfx::settings::instances_per_page;
+	}
+	state.counters["batches"] = sg->GetRenderBatches().size();
+	state.counters["pages"] = num_pages;
+	state.counters["node_capacity"] = sg->GetNodes().size();
+	state.SetItemsProcessed(state.iterations() * num_replaced);
+
+	auto grew = sg->GetNodes().size() > nodes.size() + num_replaced || sg->GetRenderBatches().size() > models.size() || num_pages > min_pages;
+
+	delete sg;
+
+	if (num_stale_handles > 0)
+	{
+		state.SkipWithError("Handles of destroyed nodes are still alive");
+	}
+	else if (grew)
+	{
+		state.SkipWithError("Destroyed nodes or batches didn't get reused");
+	}
+}
+
+// Swaps the material of a hundredth of `state.range(0)` mesh nodes every iteration, which moves them to another batch.
+static void BM_SceneGraphSetMaterial(benchmark::State& state) {
+	auto sg = new sg::SceneGraph();
+
+	MaterialHandle materials[2] = {};
+	materials[1].m_material_id = 1;
+
+	auto model = CreateFakeModel(0);
+	model.m_mesh_handles[0].m_material_handle = materials[0];
+
+	std::vector<sg::NodeHandle> nodes(state.range(0));
+	for (std::size_t i = 0; i < nodes.size(); i++)
+	{
+		nodes[i] = sg->CreateNode<sg::MeshComponent>(model);
+	}
+	sg->Update(0);
+
+	std::mt19937 rng(1337);
+	std::uniform_int_distribution<std::size_t> node_dist(0, nodes.size() - 1);
+	auto num_changed = nodes.size() / 100;
+
+	std::uint32_t frame_idx = 0;
+	for (auto _ : state)
+	{
+		for (std::size_t i = 0; i < num_changed; i++)
+		{
+			sg::helper::SetMaterial(sg, nodes[node_dist(rng)], { materials[i % 2] });
+		}
+		sg->Update(frame_idx);
+		frame_idx = (frame_idx + 1) % gfx::settings::num_back_buffers;
+	}
+
+	// Every mesh has to be in the batch of the materials it has now.
+	bool batched_correctly = sg->GetRenderBatches().size() <= 2;
+	std::size_t num_batched = 0;
+	for (auto const & batch : sg->GetRenderBatches())
+	{
+		for (auto node_handle : batch.m_nodes)
+		{
+			batched_correctly &= sg->m_model_material_handles[sg->GetNode(node_handle).m_mesh_component].m_value == batch.m_material_handles;
+		}
+		num_batched += batch.m_num_meshes;
+	}
+	batched_correctly &= num_batched == nodes.size();
+
+	state.counters["batches"] = sg->GetRenderBatches().size();
+	state.SetItemsProcessed(state.iterations() * num_changed);
 
 	delete sg;
-	delete renderer;
-	delete app;
+
+	if (!batched_correctly)
+	{
+		state.SkipWithError("A mesh is drawn with the materials of its old batch");
+	}
+}
+
+// Scatters `state.range(0)` mesh nodes through a 1000 unit cube and culls them against a camera looking into it.
+static void BM_SceneGraphCulling(benchmark::State& state) {
+	auto sg = new sg::SceneGraph();
+
+	auto models = CreateFakeModels(4);
+
+	std::mt19937 rng(1337);
+	std::uniform_real_distribution<float> position_dist(-500.f, 500.f);
+	for (std::int64_t i = 0; i < state.range(0); i++)
+	{
+		auto node = sg->CreateNode<sg::MeshComponent>(models[i % models.size()]);
+		sg::helper::SetPosition(sg, node, { position_dist(rng), position_dist(rng), position_dist(rng) });
+	}
+	sg->Update(0);
+
+	auto proj = glm::perspective(glm::radians(60.f), 16.f / 9.f, 0.01f, 1000.0f);
+	proj[1][1] *= -1;
+	auto view_projection = proj * glm::lookAt(glm::vec3(0, 0, 0), glm::vec3(1, 0.2f, 0.5f), glm::vec3(0, 1, 0));
+
+	sg::VisibleInstances visible;
+	for (auto _ : state)
+	{
+		sg->CullInstances(view_projection, visible);
+		benchmark::DoNotOptimize(visible.m_num_visible);
+	}
+
+	std::size_t num_ranges = 0;
+	for (auto const & ranges : visible.m_ranges)
+	{
+		num_ranges += ranges.size();
+	}
+	state.counters["visible"] = visible.m_num_visible;
+	state.counters["ranges"] = num_ranges;
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+
+	auto num_visible = visible.m_num_visible;
+
+	delete sg;
+
+	if (num_visible == 0 || num_visible == static_cast<std::size_t>(state.range(0)))
+	{
+		state.SkipWithError("The camera should see some but not all of the meshes");
+	}
+}
+
+// Builds a scene of `state.range(0)` mesh nodes every iteration. `state.range(1)` restores it from a snapshot instead.
+static void BM_SceneGraphStartup(benchmark::State& state) {
+	sg::SnapshotReferences references;
+	std::vector<ModelHandle> models;
+	for (std::uint32_t i = 0; i < 4; i++)
+	{
+		models.push_back(CreateFakeModel(i));
+		references.m_models.emplace_back("model_" + std::to_string(i), models.back());
+	}
+
+	auto snapshot_path = "bm_scene_graph_" + std::to_string(state.range(0)) + ".skss";
+	auto reference_sg = new sg::SceneGraph();
+	BuildMeshScene(reference_sg, models, state.range(0));
+	reference_sg->Update(0);
+	auto saved = reference_sg->SaveSnapshot(snapshot_path, references);
+
+	bool loaded = true;
+	bool identical = true;
+	for (auto _ : state)
+	{
+		auto sg = new sg::SceneGraph();
+		if (state.range(1))
+		{
+			loaded &= sg->LoadSnapshot(snapshot_path, references);
+		}
+		else
+		{
+			BuildMeshScene(sg, models, state.range(0));
+		}
+		sg->Update(0);
+
+		state.PauseTiming();
+		identical &= sg->GetNodeHandles() == reference_sg->GetNodeHandles() && sg->GetRenderBatches().size() == reference_sg->GetRenderBatches().size();
+		for (std::size_t i = 0; identical && i < sg->m_models.size(); i++)
+		{
+			identical = sg->m_models[i].m_value == reference_sg->m_models[i].m_value;
+		}
+		delete sg;
+		state.ResumeTiming();
+	}
+
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+
+	delete reference_sg;
+
+	std::remove(snapshot_path.c_str());
+
+	if (!saved || !loaded)
+	{
+		state.SkipWithError("Failed to save or load the snapshot");
+	}
+	else if (!identical)
+	{
+		state.SkipWithError("The scene graph differs from the one the snapshot got saved from");
+	}
 }
 
 BENCHMARK(BM_SceneGraphMeshNode);
+BENCHMARK(BM_SceneGraphMeshNodes)->RangeMultiplier(10)->Range(1000, 100000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SceneGraphHierarchy)->Arg(100)->Arg(1000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SceneGraphChurn)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SceneGraphSetMaterial)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SceneGraphCulling)->Arg(100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_SceneGraphStartup)->ArgsProduct({ { 10000, 100000 }, { 0, 1 } })->Unit(benchmark::kMillisecond);
 BENCHMARK_MAIN();
\ No newline at end of file
@@ -0,0 +1,254 @@
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <host_constant_buffer_pool.hpp>
+#include <scene_graph/scene_graph.hpp>
+
+#include "test_scenes.hpp"
+
+/*
+	Scene graph scenarios from 1k up to 1M mesh nodes. The scene graph keeps its buffers in host memory, so these run without a device.
+	Every scenario reports the bytes it would have uploaded per frame as `upload_bytes`.
+	Run with `--benchmark_out=<file> --benchmark_out_format=json` (or build the `run_BM_SceneGraph` target) to track them over time.
+*/
+
+static void ScenarioSizes(benchmark::internal::Benchmark* benchmark)
+{
+	benchmark->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMillisecond);
+}
+
+static std::uint64_t GetUploadedBytes(sg::SceneGraph* sg)
+{
+	std::uint64_t retval = 0;
+	for (auto pool : { sg->GetPOConstantBufferPool(), sg->GetCameraConstantBufferPool(), sg->GetInverseCameraConstantBufferPool(), sg->GetLightConstantBufferPool() })
+	{
+		retval += static_cast<HostConstantBufferPool*>(pool)->GetStats().m_updated_bytes;
+	}
+
+	return retval;
+}
+
+//! Updates every back buffer once so the frames that get measured only upload what changed.
+static void Settle(sg::SceneGraph* sg)
+{
+	for (std::uint32_t i = 0; i < gfx::settings::num_back_buffers; i++)
+	{
+		sg->Update(i);
+	}
+}
+
+static void SetUploadCounter(benchmark::State& state, std::uint64_t bytes)
+{
+	state.counters["upload_bytes"] = benchmark::Counter(static_cast<double>(bytes), benchmark::Counter::kAvgIterations);
+}
+
+// Nothing changes, the cost of a frame of a scene that is only being looked at.
+static void BM_SceneStatic(benchmark::State& state)
+{
+	auto sg = new sg::SceneGraph();
+	BuildMeshScene(sg, CreateFakeModels(4), state.range(0));
+	Settle(sg);
+
+	auto uploaded = GetUploadedBytes(sg);
+	std::uint32_t frame_idx = 0;
+	for (auto _ : state)
+	{
+		sg->Update(frame_idx);
+		frame_idx = (frame_idx + 1) % gfx::settings::num_back_buffers;
+	}
+	uploaded = GetUploadedBytes(sg) - uploaded;
+
+	SetUploadCounter(state, uploaded);
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+
+	delete sg;
+
+	if (uploaded != 0)
+	{
+		state.SkipWithError("A static scene shouldn't upload anything");
+	}
+}
+
+// Moves `state.range(1)` percent of the nodes each frame. Parents drag their 7 children along.
+static void BM_SceneMoving(benchmark::State& state)
+{
+	auto sg = new sg::SceneGraph();
+	auto nodes = BuildMeshScene(sg, CreateFakeModels(4), state.range(0));
+	Settle(sg);
+
+	auto stride = 100 / state.range(1);
+
+	auto uploaded = GetUploadedBytes(sg);
+	std::uint32_t frame_idx = 0;
+	for (auto _ : state)
+	{
+		for (std::size_t i = 0; i < nodes.size(); i += stride)
+		{
+			sg::helper::Translate(sg, nodes[i], { 0, 0.01f, 0 });
+		}
+		sg->Update(frame_idx);
+		frame_idx = (frame_idx + 1) % gfx::settings::num_back_buffers;
+	}
+	uploaded = GetUploadedBytes(sg) - uploaded;
+
+	SetUploadCounter(state, uploaded);
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+
+	// At least every moved node has to upload its instance data.
+	auto min_uploaded = state.iterations() * (nodes.size() / stride) * sizeof(sg::Matrix3x4);
+
+	delete sg;
+
+	if (uploaded < min_uploaded)
+	{
+		state.SkipWithError("Moved nodes didn't upload their instance data");
+	}
+}
+
+// Spawns `state.range(0)` nodes into an empty scene and updates it once.
+static void BM_SceneMassSpawn(benchmark::State& state)
+{
+	auto models = CreateFakeModels(4);
+
+	bool batched = true;
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		auto sg = new sg::SceneGraph();
+		state.ResumeTiming();
+
+		BuildMeshScene(sg, models, state.range(0));
+		sg->Update(0);
+
+		state.PauseTiming();
+		std::size_t num_batched = 0;
+		for (auto const & batch : sg->GetRenderBatches())
+		{
+			num_batched += batch.m_num_meshes;
+		}
+		batched &= num_batched == static_cast<std::size_t>(state.range(0));
+		delete sg;
+		state.ResumeTiming();
+	}
+
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+
+	if (!batched)
+	{
+		state.SkipWithError("Not every spawned node got batched");
+	}
+}
+
+// Destroys all `state.range(0)` nodes of a scene, children before their parents, and updates it once.
+static void BM_SceneMassDespawn(benchmark::State& state)
+{
+	auto models = CreateFakeModels(4);
+
+	bool empty = true;
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		auto sg = new sg::SceneGraph();
+		auto nodes = BuildMeshScene(sg, models, state.range(0));
+		sg->Update(0);
+		state.ResumeTiming();
+
+		for (auto it = nodes.rbegin(); it != nodes.rend(); it++)
+		{
+			sg->DestroyNode(*it);
+		}
+		sg->Update(1);
+
+		state.PauseTiming();
+		empty &= sg->GetNodeHandles().empty() && sg->GetRenderBatches().empty();
+		delete sg;
+		state.ResumeTiming();
+	}
+
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+
+	if (!empty)
+	{
+		state.SkipWithError("Nodes or batches survived despawning everything");
+	}
+}
+
+// Only the camera moves through a static scene, like a fly through.
+static void BM_SceneCameraOnly(benchmark::State& state)
+{
+	auto sg = new sg::SceneGraph();
+	BuildMeshScene(sg, CreateFakeModels(4), state.range(0));
+	auto camera = sg->CreateNode<sg::CameraComponent>();
+	Settle(sg);
+
+	auto uploaded = GetUploadedBytes(sg);
+	std::uint32_t frame_idx = 0;
+	for (auto _ : state)
+	{
+		sg::helper::Translate(sg, camera, { 0, 0, 0.1f });
+		sg::helper::Rotate(sg, camera, { 0, 0.01f, 0 });
+		sg->Update(frame_idx);
+		frame_idx = (frame_idx + 1) % gfx::settings::num_back_buffers;
+	}
+	uploaded = GetUploadedBytes(sg) - uploaded;
+
+	SetUploadCounter(state, uploaded);
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+
+	delete sg;
+
+	// Only the camera buffers should have been written.
+	if (uploaded != state.iterations() * (sizeof(cb::Camera) + sizeof(cb::RaytracingCamera)))
+	{
+		state.SkipWithError("Moving only the camera uploaded more than the camera");
+	}
+}
+
+// Moves the maximum amount of lights through a static scene every frame.
+static void BM_SceneManyLights(benchmark::State& state)
+{
+	auto sg = new sg::SceneGraph();
+	BuildMeshScene(sg, CreateFakeModels(4), state.range(0));
+
+	std::mt19937 rng(1337);
+	std::uniform_real_distribution<float> position_dist(-500.f, 500.f);
+
+	std::vector<sg::NodeHandle> lights(gfx::settings::max_lights);
+	for (auto& light : lights)
+	{
+		light = sg->CreateNode<sg::LightComponent>(cb::LightType::POINT);
+		sg::helper::SetPosition(sg, light, { position_dist(rng), position_dist(rng), position_dist(rng) });
+	}
+	Settle(sg);
+
+	auto uploaded = GetUploadedBytes(sg);
+	std::uint32_t frame_idx = 0;
+	for (auto _ : state)
+	{
+		for (auto& light : lights)
+		{
+			sg::helper::Translate(sg, light, { 0, 0.01f, 0 });
+		}
+		sg->Update(frame_idx);
+		frame_idx = (frame_idx + 1) % gfx::settings::num_back_buffers;
+	}
+	uploaded = GetUploadedBytes(sg) - uploaded;
+
+	SetUploadCounter(state, uploaded);
+	state.counters["lights"] = lights.size();
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+
+	delete sg;
+
+	if (uploaded != state.iterations() * lights.size() * sizeof(cb::Light))
+	{
+		state.SkipWithError("Every moved light should upload exactly once per frame");
+	}
+}
+
+BENCHMARK(BM_SceneStatic)->Apply(ScenarioSizes);
+BENCHMARK(BM_SceneMoving)->ArgNames({ "nodes", "percent_moving" })->ArgsProduct({ { 1000, 10000, 100000, 1000000 }, { 1, 100 } })->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SceneMassSpawn)->Apply(ScenarioSizes);
+BENCHMARK(BM_SceneMassDespawn)->Apply(ScenarioSizes);
+BENCHMARK(BM_SceneCameraOnly)->Apply(ScenarioSizes);
+BENCHMARK(BM_SceneManyLights)->Apply(ScenarioSizes);
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <scene_graph/scene_graph.hpp>
+
+//! Handle of a model that was never loaded. The scene graph only uses it to batch meshes.
+inline ModelHandle CreateFakeModel(std::uint32_t id)
+{
+	ModelHandle::MeshHandle mesh_handle = {};
+	mesh_handle.m_id = id;
+	mesh_handle.m_num_indices = 3;
+	mesh_handle.m_num_vertices = 3;
+	mesh_handle.m_bbox_min = glm::vec3(-0.5f);
+	mesh_handle.m_bbox_max = glm::vec3(0.5f);
+
+	ModelHandle model_handle;
+	model_handle.m_mesh_handles.push_back(mesh_handle);
+	return model_handle;
+}
+
+inline std::vector<ModelHandle> CreateFakeModels(std::uint32_t count)
+{
+	std::vector<ModelHandle> models;
+	for (std::uint32_t i = 0; i < count; i++)
+	{
+		models.push_back(CreateFakeModel(i));
+	}
+
+	return models;
+}
+
+//! Creates `count` mesh nodes scattered through a 1000 unit cube with a parent every 8 nodes, like a scene would in `BuildScene`.
+inline std::vector<sg::NodeHandle> BuildMeshScene(sg::SceneGraph* sg, std::vector<ModelHandle> const & models, std::size_t count)
+{
+	std::mt19937 rng(1337);
+	std::uniform_real_distribution<float> position_dist(-500.f, 500.f);
+
+	std::vector<sg::NodeHandle> nodes(count);
+	sg::NodeHandle parent = 0;
+	for (std::size_t i = 0; i < count; i++)
+	{
+		auto node = sg->CreateNode<sg::MeshComponent>(models[i % models.size()]);
+		sg::helper::SetPosition(sg, node, { position_dist(rng), position_dist(rng), position_dist(rng) });
+		sg::helper::SetRotation(sg, node, { 0, position_dist(rng), 0 });
+
+		if (i % 8 == 0)
+		{
+			parent = node;
+		}
+		else
+		{
+			sg->SetParent(node, parent);
+		}
+		nodes[i] = node;
+	}
+
+	return nodes;
+}
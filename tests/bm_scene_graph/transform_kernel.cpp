@@ -0,0 +1,92 @@
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <random>
+#include <scene_graph/transform_kernel.hpp>
+
+static std::uint32_t num_transforms = 20000;
+
+static void CreateRandomTransforms(std::vector<glm::vec3>& positions, std::vector<glm::vec3>& rotations, std::vector<glm::vec3>& scales)
+{
+	std::mt19937 rng(1337);
+	std::uniform_real_distribution<float> position_dist(-100.f, 100.f);
+	std::uniform_real_distribution<float> rotation_dist(-20.f, 20.f);
+	std::uniform_real_distribution<float> scale_dist(0.1f, 4.f);
+
+	for (std::uint32_t i = 0; i < num_transforms; i++)
+	{
+		positions.emplace_back(position_dist(rng), position_dist(rng), position_dist(rng));
+		rotations.emplace_back(rotation_dist(rng), rotation_dist(rng), rotation_dist(rng));
+		scales.emplace_back(scale_dist(rng), scale_dist(rng), scale_dist(rng));
+	}
+}
+
+static void BM_ComposeTransformsReference(benchmark::State& state)
+{
+	std::vector<glm::vec3> positions, rotations, scales;
+	CreateRandomTransforms(positions, rotations, scales);
+
+	std::vector<glm::mat4> models(num_transforms);
+	for (auto _ : state)
+	{
+		for (std::uint32_t i = 0; i < num_transforms; i++)
+		{
+			models[i] = sg::ComposeTransformReference(positions[i], rotations[i], scales[i]);
+		}
+		benchmark::DoNotOptimize(models.data());
+	}
+
+	state.SetItemsProcessed(state.iterations() * num_transforms);
+}
+
+// Includes gathering into SoA and expanding to 4x4 like `SceneGraph::Update` does.
+static void BM_ComposeTransforms(benchmark::State& state)
+{
+	std::vector<glm::vec3> positions, rotations, scales;
+	CreateRandomTransforms(positions, rotations, scales);
+
+	sg::TransformSoA soa;
+	std::vector<sg::Matrix3x4> results(num_transforms);
+	std::vector<glm::mat4> models(num_transforms);
+	for (auto _ : state)
+	{
+		soa.Resize(num_transforms);
+		for (std::uint32_t i = 0; i < num_transforms; i++)
+		{
+			soa.Set(i, positions[i], rotations[i], scales[i]);
+		}
+
+		sg::ComposeTransforms(soa, 0, num_transforms, results.data());
+
+		for (std::uint32_t i = 0; i < num_transforms; i++)
+		{
+			models[i] = sg::ToMat4(results[i]);
+		}
+		benchmark::DoNotOptimize(models.data());
+	}
+
+	// Compare against glm. The translation column is exact, the rotation part depends on the sine approximation.
+	float max_error = 0;
+	for (std::uint32_t i = 0; i < num_transforms; i++)
+	{
+		auto reference = sg::ComposeTransformReference(positions[i], rotations[i], scales[i]);
+		for (auto c = 0; c < 4; c++)
+		{
+			for (auto r = 0; r < 4; r++)
+			{
+				max_error = std::max(max_error, std::abs(models[i][c][r] - reference[c][r]));
+			}
+		}
+	}
+
+	state.counters["max_error"] = max_error;
+	state.SetItemsProcessed(state.iterations() * num_transforms);
+
+	if (max_error > 1e-4f)
+	{
+		state.SkipWithError("Composed transforms differ from the glm reference");
+	}
+}
+
+BENCHMARK(BM_ComposeTransformsReference)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ComposeTransforms)->Unit(benchmark::kMicrosecond);
@@ -275,7 +275,7 @@ void SetupEditor()
 				ImGui::DragFloat("Focal Length", &lens_properties.m_focal_length, 0.01f);
 			}
 
-			scene_graph->m_requires_update[node.m_transform_component] = true;
+			scene_graph->MarkTransformDirty(node.m_transform_component);
 		}
 		else if (m_selected_task.has_value())
 		{
@@ -372,7 +372,13 @@ void SetupEditor()
 
 		ImGui::InfoText("Num Mesh Nodes", std::to_string(scene_graph->GetMeshNodeHandles().size()));
 		ImGui::InfoText("Num Batches", std::to_string(batches.size()));
-		ImGui::InfoText("Max Batch Size", std::to_string(gfx::settings::max_render_batch_size));
+		std::size_t num_pages = 0;
+		for (auto const & batch : batches)
+		{
+			num_pages += batch.m_pages.size();
+		}
+		ImGui::InfoText("Num Instance Pages", std::to_string(num_pages));
+		ImGui::InfoText("Instances Per Page", std::to_string(gfx::settings::instances_per_page));
 
 	}, false, reinterpret_cast<const char*>(ICON_FA_CUBES));
 
@@ -16,9 +16,12 @@ static const bool place_random_grass = true;
 static const std::uint32_t num_grass_nodes = 150;
 static const std::uint32_t num_tree_nodes = 100;
 static const float scene_size = 10;
+static const glm::vec3 camera_position = glm::vec3(0.5, 0.95, 2.6);
+static const float lod_viewport_height = 1080; // Conservative, lower resolutions pick the same or coarser levels.
+static const float lod_max_pixel_error = 1.f;
 
 ForrestScene::ForrestScene() :
-	Scene("Forrest Scene")
+	Scene("Forrest Scene", std::nullopt, "forrest_scene.skss", 1)
 {
 
 }
@@ -71,6 +74,15 @@ void ForrestScene::LoadResources(std::optional<std::reference_wrapper<util::Prog
 	m_grass_model = m_model_pool->LoadWithMaterials<Vertex>("grass/scene.gltf", m_material_pool, m_texture_pool, false, data_gass);
 	if (progress) PROGRESS((*progress).get(), "Loading Tree Model")
 
+	m_snapshot_references.m_models = {
+		{ "tree/scene.gltf", m_tree_model },
+		{ "plane.fbx", m_plane_model },
+		{ "robot/scene.gltf", m_object_model },
+		{ "baby_robot/scene.gltf", m_object2_model },
+		{ "grass/scene.gltf", m_grass_model }
+	};
+	m_snapshot_references.m_materials = { { "forrest_ground", m_plane_material_handle } };
+
 	if (progress) POP_CHILD_PROGRESS((*progress).get());
 	int x = 0;
 }
@@ -83,7 +95,7 @@ void ForrestScene::BuildScene(std::optional<std::reference_wrapper<util::Progres
 
 	// Create Camera
 	m_camera_node = m_scene_graph->CreateNode<sg::CameraComponent>();
-	sg::helper::SetPosition(m_scene_graph, m_camera_node, glm::vec3(0.5, 0.95, 2.6));
+	sg::helper::SetPosition(m_scene_graph, m_camera_node, camera_position);
 	sg::helper::SetRotation(m_scene_graph, m_camera_node, glm::vec3(0, -90._deg, 0));
 	sg::helper::SetLensDiameter(m_scene_graph, m_camera_node, 0.1f);
 	sg::helper::SetFocalDistance(m_scene_graph, m_camera_node, 2.1f);
@@ -127,15 +139,25 @@ void ForrestScene::BuildScene(std::optional<std::reference_wrapper<util::Progres
 	std::uniform_real_distribution<> dis_tree_scale(0.01f, 0.015f);
 	std::uniform_real_distribution<> dis_rot(0, 360);
 
+	// Vegetation is placed once so the level of detail is picked from the initial camera position.
+	auto select_lod = [](ModelHandle const & model, glm::vec3 position, float scale)
+	{
+		auto pixels_per_unit = ModelHandle::GetPixelsPerUnit(glm::distance(position, camera_position), glm::radians(sg::LensProperties().m_fov), lod_viewport_height);
+		return model.GetLod(model.SelectLod(pixels_per_unit * scale, lod_max_pixel_error));
+	};
+
 	// Create Grass
 	for (std::uint32_t i = 0; i < num_grass_nodes; i++)
 	{
 		if (progress) PROGRESS((*progress).get(), "Planting Grass")
 
-		auto grass_node = m_scene_graph->CreateNode<sg::MeshComponent>(m_grass_model);
+		float rotation = dis_rot(gen);
+		auto position = glm::vec3(dis(gen), 0, dis(gen));
+
+		auto grass_node = m_scene_graph->CreateNode<sg::MeshComponent>(select_lod(m_grass_model, position, 0.01f));
 		sg::helper::SetScale(m_scene_graph, grass_node, glm::vec3(0.01f, 0.01f, 0.01f));
-		sg::helper::SetRotation(m_scene_graph, grass_node, glm::vec3(0, glm::degrees(dis_rot(gen)), 0));
-		sg::helper::SetPosition(m_scene_graph, grass_node, glm::vec3(dis(gen), 0, dis(gen)));
+		sg::helper::SetRotation(m_scene_graph, grass_node, glm::vec3(0, glm::degrees(rotation), 0));
+		sg::helper::SetPosition(m_scene_graph, grass_node, position);
 	}
 
 	// Create Trees
@@ -143,10 +165,14 @@ void ForrestScene::BuildScene(std::optional<std::reference_wrapper<util::Progres
 	{
 		if (progress) PROGRESS((*progress).get(), "Planting Trees")
 
-		auto tree_node = m_scene_graph->CreateNode<sg::MeshComponent>(m_tree_model);
-		sg::helper::SetScale(m_scene_graph, tree_node, glm::vec3(dis_tree_scale(gen)));
-		sg::helper::SetRotation(m_scene_graph, tree_node, glm::vec3(0, glm::degrees(dis_rot(gen)), 0));
-		sg::helper::SetPosition(m_scene_graph, tree_node, glm::vec3(dis(gen), 0, dis(gen)));
+		float scale = dis_tree_scale(gen);
+		float rotation = dis_rot(gen);
+		auto position = glm::vec3(dis(gen), 0, dis(gen));
+
+		auto tree_node = m_scene_graph->CreateNode<sg::MeshComponent>(select_lod(m_tree_model, position, scale));
+		sg::helper::SetScale(m_scene_graph, tree_node, glm::vec3(scale));
+		sg::helper::SetRotation(m_scene_graph, tree_node, glm::vec3(0, glm::degrees(rotation), 0));
+		sg::helper::SetPosition(m_scene_graph, tree_node, position);
 	}
 
 	if (progress) POP_CHILD_PROGRESS((*progress).get());
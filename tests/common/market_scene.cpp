@@ -13,7 +13,7 @@
 #include <random>
 
 MarketScene::MarketScene() :
-	Scene("Spaceship Scene")
+	Scene("Spaceship Scene", std::nullopt, "market_scene.skss", 1)
 {
 
 }
@@ -24,6 +24,7 @@ void MarketScene::LoadResources(std::optional<std::reference_wrapper<util::Progr
 
 	if (progress) PROGRESS((*progress).get(), "Loading Market Model");
 	m_market_model = m_model_pool->LoadWithMaterials<Vertex>("market/scene.gltf", m_material_pool, m_texture_pool, false);
+	m_snapshot_references.m_models = { { "market/scene.gltf", m_market_model } };
 
 	/*if (progress) PROGRESS((*progress).get(), "Loading Human Model");
 	m_human_model = m_model_pool->LoadWithMaterials<Vertex>("aguilar/scene.gltf", m_material_pool, m_texture_pool, false);*/
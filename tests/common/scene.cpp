@@ -11,17 +11,20 @@
 #include <iomanip>
 #include <fstream>
 #include <nlohmann/json.hpp>
+#include <settings.hpp>
 
-Scene::Scene(std::string const & name, std::optional<std::string> const & json_path) :
+Scene::Scene(std::string const & name, std::optional<std::string> const & json_path, std::optional<std::string> const & snapshot_name, std::uint32_t snapshot_version) :
 	m_model_pool(nullptr),
 	m_texture_pool(nullptr),
 	m_material_pool(nullptr),
 	m_scene_graph(nullptr),
 	m_camera_node(std::numeric_limits<std::uint32_t>::max()),
 	m_json_path(json_path),
+	m_snapshot_path(snapshot_name ? std::optional<std::string>(settings::scene_snapshot_directory + snapshot_name.value()) : std::nullopt),
+	m_save_snapshot(false),
 	m_name(name)
 {
-
+	m_snapshot_references.m_scene_version = snapshot_version;
 }
 
 Scene::~Scene()
@@ -49,7 +52,13 @@ void Scene::Init(Renderer* renderer, std::optional<std::reference_wrapper<util::
 
 	m_scene_graph = new sg::SceneGraph(renderer);
 
-	BuildScene(progress);
+	if (!LoadSceneSnapshot())
+	{
+		BuildScene(progress);
+
+		// Saved after the first update, so the snapshot contains the batches and world transforms.
+		m_save_snapshot = m_snapshot_path.has_value() && settings::use_scene_snapshots;
+	}
 
 	if (progress) POP_CHILD_PROGRESS((*progress).get());
 }
@@ -58,6 +67,12 @@ void Scene::Update(std::uint32_t frame_idx, float delta, float time)
 {
 	Update_Impl(delta, time);
 	m_scene_graph->Update(frame_idx);
+
+	if (m_save_snapshot)
+	{
+		SaveSceneSnapshot();
+		m_save_snapshot = false;
+	}
 }
 
 sg::SceneGraph* Scene::GetSceneGraph()
@@ -178,3 +193,37 @@ void Scene::SaveSceneToJSON()
 	std::ofstream o(m_json_path.value());
 	o << std::setw(2) << json << std::endl;
 }
+
+bool Scene::LoadSceneSnapshot()
+{
+	if (!m_snapshot_path.has_value() || !settings::use_scene_snapshots)
+	{
+		return false;
+	}
+
+	m_snapshot_references.m_nodes = { { "camera", m_camera_node } };
+	if (!m_scene_graph->LoadSnapshot(m_snapshot_path.value(), m_snapshot_references))
+	{
+		return false;
+	}
+
+	m_camera_node = m_snapshot_references.m_nodes[0].second;
+
+	LOG("Loaded scene snapshot `{}` with {} nodes.", m_snapshot_path.value(), m_scene_graph->GetNodeHandles().size());
+	return true;
+}
+
+void Scene::SaveSceneSnapshot()
+{
+	if (!m_snapshot_path.has_value())
+	{
+		LOGW("Tried to save a scene snapshot without a path specified.");
+		return;
+	}
+
+	m_snapshot_references.m_nodes = { { "camera", m_camera_node } };
+	if (!m_scene_graph->SaveSnapshot(m_snapshot_path.value(), m_snapshot_references))
+	{
+		LOGW("Failed to save scene snapshot `{}`.", m_snapshot_path.value());
+	}
+}
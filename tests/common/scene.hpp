@@ -16,7 +16,8 @@
 class Scene
 {
 public:
-	Scene(std::string const & name, std::optional<std::string> const & json_path = std::nullopt);
+	//! \param snapshot_name File name of the binary snapshot in `settings::scene_snapshot_directory`. Scenes without one always get build.
+	Scene(std::string const & name, std::optional<std::string> const & json_path = std::nullopt, std::optional<std::string> const & snapshot_name = std::nullopt, std::uint32_t snapshot_version = 0);
 	virtual ~Scene();
 
 	virtual void Init(Renderer* renderer, std::optional<std::reference_wrapper<util::Progress>> progress = std::nullopt);
@@ -28,6 +29,8 @@ public:
 
 	void LoadSceneFromJSON();
 	void SaveSceneToJSON();
+	bool LoadSceneSnapshot();
+	void SaveSceneSnapshot();
 
 protected:
 	virtual void LoadResources(std::optional<std::reference_wrapper<util::Progress>> progress) = 0;
@@ -44,5 +47,11 @@ protected:
 
 	const std::optional<std::string> m_json_path;
 
+	// Scenes add the models and materials they load so the snapshot can refer to them.
+	// Its scene version is the `snapshot_version` of the constructor, increment it after changing `BuildScene`.
+	sg::SnapshotReferences m_snapshot_references;
+	const std::optional<std::string> m_snapshot_path;
+	bool m_save_snapshot;
+
 	const std::string m_name;
 };
@@ -13,7 +13,7 @@
 #include <random>
 
 SpaceshipScene::SpaceshipScene() :
-	Scene("Spaceship Scene")
+	Scene("Spaceship Scene", std::nullopt, "spaceship_scene.skss", 1)
 {
 
 }
@@ -35,6 +35,12 @@ void SpaceshipScene::LoadResources(std::optional<std::reference_wrapper<util::Pr
 	if (progress) PROGRESS((*progress).get(), "Loading Rock 0 Model");
 	m_rock0_model = m_model_pool->LoadWithMaterials<Vertex>("rock0/scene.gltf", m_material_pool, m_texture_pool, false);
 
+	m_snapshot_references.m_models = {
+		{ "plane.fbx", m_plane_model },
+		{ "naboo/scene.gltf", m_spaceship_model },
+		{ "rock0/scene.gltf", m_rock0_model }
+	};
+
 	if (progress) POP_CHILD_PROGRESS((*progress).get());
 	int x = 0;
 }
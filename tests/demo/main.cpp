@@ -7,6 +7,7 @@
  */
 
 #include <chrono>
+#include <future>
 
 #include <frame_graph/frame_graph.hpp>
 #include <application.hpp>
@@ -83,7 +84,7 @@ protected:
 		m_scene->GetSceneGraph()->m_positions[node.m_transform_component].m_value = glm::vec3(new_translation[0], new_translation[1], new_translation[2]);
 		m_scene->GetSceneGraph()->m_rotations[node.m_transform_component].m_value = glm::vec3(glm::radians(new_rotation[0]), glm::radians(new_rotation[1]), glm::radians(new_rotation[2]));
 		m_scene->GetSceneGraph()->m_scales[node.m_transform_component].m_value = glm::vec3(new_scale[0], new_scale[1], new_scale[2]);
-		m_scene->GetSceneGraph()->m_requires_update[node.m_transform_component] = true;
+		m_scene->GetSceneGraph()->MarkTransformDirty(node.m_transform_component);
 	}
 
 #include "../common/editor_interface.inl"